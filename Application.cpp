@@ -20,7 +20,24 @@ bool Application::Initialize() {
     uniforms.highlightedVoxelPos = { 0, 0, 0 };
     uniforms.modelMatrix = mat4x4(1.0);
     uniforms.projectionMatrix = glm::perspective(camera.zoom * PI / 180, 1280.0f / 720.0f, 0.1f, 2500.0f);
-    buf->writeBuffer("uniform_buffer", 0, &uniforms, sizeof(MyUniforms));
+    buf->writeBuffer(gpu.getUniformBuffer(), 0, &uniforms, sizeof(MyUniforms));
+    gpu.setFarTerrainProjection(glm::perspective(camera.zoom * PI / 180, 1280.0f / 720.0f, 8.0f, HeightClipmap::extent() * 1.5f));
+
+    farTerrain.initialize(ThreadSafeChunk::WORLD_SEED);
+
+    if (USE_HEIGHTMAP_TERRAIN) {
+        const std::string imagePath = RESOURCE_DIR "/heightmap.png";
+        const std::string tiledPath = RESOURCE_DIR "/heightmap.tiles";
+        auto heightmap = std::make_shared<HeightmapSource>();
+        bool converted = std::ifstream(tiledPath).good() || HeightmapSource::convertImage(imagePath, tiledPath);
+        if (converted && heightmap->open(tiledPath, HeightmapSettings())) {
+            chunkManager.setHeightmap(heightmap);
+            farTerrain.setHeightmap(heightmap);
+        }
+        else {
+            std::cerr << "Falling back to noise terrain" << std::endl;
+        }
+    }
 
     camera.updateCameraVectors();
     updateViewMatrix();
@@ -90,10 +107,12 @@ void Application::breakBlock() {
     }
 
     // Remove the voxel
+    uint16_t oldMaterial = chunk->getMaterial(localChunkPos).materialType;
     chunk->setVoxel(localChunkPos, false);
     VoxelMaterial material;
     material.materialType = 0;
     chunk->setMaterial(localChunkPos, material);
+    chunkManager.recordVoxelEdit(lookingAtBlockPos, oldMaterial, material.materialType);
 
     // Check if the broken block is on a chunk boundary
     // If so, regenerate neighboring chunks that might be affected
@@ -184,10 +203,12 @@ void Application::placeBlock() {
     }
 
     // Add the voxel
+    uint16_t oldMaterial = chunk->getMaterial(localChunkPos).materialType;
     chunk->setVoxel(localChunkPos, true);
     VoxelMaterial material;
-    material.materialType = 4;
+    material.materialType = placeMaterial;
     chunk->setMaterial(localChunkPos, material);
+    chunkManager.recordVoxelEdit(placeBlockPos, oldMaterial, material.materialType);
 
     // Check if the placed block is on a chunk boundary
     // If so, regenerate neighboring chunks that might be affected
@@ -260,11 +281,15 @@ void Application::MainLoop() {
     deltaTime = currentFrame - lastFrame;
     lastFrame = currentFrame;
 
-    glfwPollEvents();
-    processInput();
+    {
+        PROFILE_ZONE("input");
+        glfwPollEvents();
+        processInput();
+    }
 
     // Update camera position for chunk thread (atomic operation)
     lastChunkUpdateCameraPos.store(camera.position);
+    lastChunkUpdateCameraFront.store(camera.front);
 
     // Bounds check camera position to prevent coordinate overflow
     const float MAX_CAMERA_COORD = 500000.0f;
@@ -278,19 +303,15 @@ void Application::MainLoop() {
         updateViewMatrix();
     }
 
-    // Ray intersection (same as before)
-    auto getChunkCallback = [this](ivec3 c) -> std::shared_ptr<ThreadSafeChunk> {
-        try {
-            return chunkManager.getChunk(c);
-        }
-        catch (...) {
-            return nullptr;
-        }
+    // Block picking: hierarchical traversal with the chunk lookup inlined
+    auto getChunk = [this](const ivec3& c) -> std::shared_ptr<ThreadSafeChunk> {
+        return chunkManager.getChunk(c);
         };
 
     RayIntersectionResult result;
     try {
-        result = Ray::rayVoxelIntersection(camera.position, camera.front, 100.0f, getChunkCallback);
+        PROFILE_ZONE("raycast");
+        result = Ray::traverseHierarchical(camera.position, camera.front, 100.0f, getChunk);
     }
     catch (...) {
         result = RayIntersectionResult{ false, ivec3(INT_MAX), ivec3(INT_MAX) };
@@ -351,31 +372,58 @@ void Application::MainLoop() {
     }
 
     // OPTIMIZED: Use the new optimized processing methods
-    try {
-        chunkManager.processGPUUploads(tex, buf, pip);
-    }
-    catch (...) {
-        std::cerr << "Exception in processGPUUploads()" << std::endl;
-    }
+    {
+        PROFILE_ZONE("uploads");
+        try {
+            chunkManager.processGPUUploads(tex, buf, pip);
+        }
+        catch (...) {
+            std::cerr << "Exception in processGPUUploads()" << std::endl;
+        }
 
-    try {
-        chunkManager.processBindGroupUpdates();
-    }
-    catch (...) {
-        std::cerr << "Exception in processBindGroupUpdates()" << std::endl;
+        try {
+            chunkManager.beginLightFrame(RELIGHT_BUDGET_MS);
+            chunkManager.processLightUploads(tex, pip, LIGHT_UPLOAD_BUDGET_MS);
+        }
+        catch (...) {
+            std::cerr << "Exception in processLightUploads()" << std::endl;
+        }
+
+        try {
+            chunkManager.processBindGroupUpdates();
+        }
+        catch (...) {
+            std::cerr << "Exception in processBindGroupUpdates()" << std::endl;
+        }
+
+        try {
+            chunkManager.enforceGpuBudget();
+        }
+        catch (...) {
+            std::cerr << "Exception in enforceGpuBudget()" << std::endl;
+        }
+
+        try {
+            // Hidden one chunk inside the render distance so the rings overlap the edge
+            gpu.uploadFarTerrain(farTerrain, (chunkManager.getRenderDistance() - 1) * 32.0f);
+        }
+        catch (...) {
+            std::cerr << "Exception in uploadFarTerrain()" << std::endl;
+        }
     }
 
     // OPTIMIZED: Use visible chunk rendering with distance culling
-    std::vector<ChunkRenderData> renderData;
+    ChunkRenderList renderData;
     try {
+        PROFILE_ZONE("render list");
         renderData = chunkManager.getChunkRenderData();
     }
     catch (...) {
         std::cerr << "Exception in getVisibleChunkRenderData()" << std::endl;
-        renderData.clear();
+        renderData.reset();
     }
 
-    if (!renderData.empty()) {
+    if (renderData && !renderData->empty()) {
         try {
             gpu.renderChunks(uniforms, renderData);
         }
@@ -385,6 +433,7 @@ void Application::MainLoop() {
     }
 
     frameTime = static_cast<float>(glfwGetTime()) - currentFrame;
+    PROFILE_FRAME_END();
 
     constexpr float TARGET_FRAME_TIME = 1.0f / 60.0f;
     if (frameTime < TARGET_FRAME_TIME) {
@@ -405,23 +454,29 @@ void Application::startChunkUpdateThread() {
 
 void Application::chunkUpdateThreadFunction() {
     float lastUpdateTime = 0.0f;
+    vec3 lastCameraPos = lastChunkUpdateCameraPos.load();
+    vec3 cameraVelocity(0.0f);
 
     while (!shouldStopChunkThread.load()) {
         float currentTime = static_cast<float>(glfwGetTime());
 
         if (currentTime - lastUpdateTime >= CHUNK_UPDATE_INTERVAL) {
             vec3 cameraPos = lastChunkUpdateCameraPos.load();
+            PROFILE_ZONE("chunk update");
+
+            // Smoothed so a single long frame does not throw the prefetch off
+            vec3 measuredVelocity = (cameraPos - lastCameraPos) / (currentTime - lastUpdateTime);
+            cameraVelocity = glm::mix(cameraVelocity, measuredVelocity, CAMERA_VELOCITY_SMOOTHING);
+            lastCameraPos = cameraPos;
 
-            chunkManager.updateChunksAsync(cameraPos);
+            chunkManager.updateChunksAsync(cameraPos, lastChunkUpdateCameraFront.load(), cameraVelocity);
 
             // Collect chunks that need GPU upload
-            {
-                std::lock_guard<std::mutex> lock(chunkManager.gpuUploadMutex);
+            chunkManager.queueReadyChunksForUpload();
 
-                auto readyChunks = chunkManager.getChunksReadyForGPU();
-                for (const auto& pair : readyChunks) {
-                    chunkManager.pendingGPUUploads.push({ pair.first, pair.second });
-                }
+            {
+                PROFILE_ZONE("far terrain");
+                farTerrain.update(cameraPos, FAR_TERRAIN_COLUMN_BUDGET);
             }
 
             lastUpdateTime = currentTime;
@@ -445,17 +500,11 @@ void Application::stopChunkUpdateThread() {
 }
 
 void Application::onResize() {
-    // Terminate
-    tex->removeTexture("multisample_texture");
-    tex->removeTextureView("multisample_view");
-
-    tex->removeTexture("depth_texture");
-    tex->removeTextureView("depth_view");
-
     gpu.getContext()->unconfigureSurface();
     gpu.getContext()->configureSurface();
 
-    //// Re-init
+    // Recreated under the same names, which replaces the old targets in
+    // place and keeps the renderer's handles
     gpu.initMultiSampleTexture();
     gpu.initDepthTexture();
 
@@ -464,22 +513,39 @@ void Application::onResize() {
 
 void Application::processInput() {
     float velocity = camera.movementSpeed * deltaTime;
+    vec3 displacement(0.0f);
 
     // WASD movement
     if (keyStates.W)
-        camera.position += camera.front * velocity;
+        displacement += camera.front * velocity;
     if (keyStates.S)
-        camera.position -= camera.front * velocity;
+        displacement -= camera.front * velocity;
     if (keyStates.A)
-        camera.position -= camera.right * velocity;
+        displacement -= camera.right * velocity;
     if (keyStates.D)
-        camera.position += camera.right * velocity;
+        displacement += camera.right * velocity;
 
     // Vertical movement
     if (keyStates.Space)
-        camera.position += camera.worldUp * velocity;
+        displacement += camera.worldUp * velocity;
     if (keyStates.Shift)
-        camera.position -= camera.worldUp * velocity;
+        displacement -= camera.worldUp * velocity;
+
+    if (noclip) {
+        camera.position += displacement;
+    }
+    else {
+        // Sweep the player box through a snapshot of the chunks the move can touch
+        playerBody.center = camera.position - vec3(0.0f, 0.0f, EYE_HEIGHT);
+        vec3 sweepMin = glm::min(playerBody.center, playerBody.center + displacement) - playerBody.halfExtents - vec3(1.0f);
+        vec3 sweepMax = glm::max(playerBody.center, playerBody.center + displacement) + playerBody.halfExtents + vec3(1.0f);
+        auto snapshot = chunkManager.createVoxelSnapshot(
+            VoxelSnapshot::chunkOf(ivec3(glm::floor(sweepMin))),
+            VoxelSnapshot::chunkOf(ivec3(glm::floor(sweepMax))));
+
+        VoxelCollision::moveBody(*snapshot, playerBody, displacement);
+        camera.position = playerBody.center + vec3(0.0f, 0.0f, EYE_HEIGHT);
+    }
 
     // Update view matrix if camera position changed
     updateViewMatrix();
@@ -490,14 +556,15 @@ void Application::updateProjectionMatrix(int zoom) {
     glfwGetFramebufferSize(window, &width, &height);
     float ratio = width / (float)height;
     uniforms.projectionMatrix = glm::perspective(zoom * PI / 180, ratio, 0.1f, 2500.0f);
+    gpu.setFarTerrainProjection(glm::perspective(zoom * PI / 180, ratio, 8.0f, HeightClipmap::extent() * 1.5f));
 
-    buf->writeBuffer("uniform_buffer", offsetof(MyUniforms, projectionMatrix), &uniforms.projectionMatrix, sizeof(MyUniforms::projectionMatrix));
+    buf->writeBuffer(gpu.getUniformBuffer(), offsetof(MyUniforms, projectionMatrix), &uniforms.projectionMatrix, sizeof(MyUniforms::projectionMatrix));
 }
 
 void Application::updateViewMatrix() {
     uniforms.viewMatrix = glm::lookAt(camera.position, camera.position + camera.front, camera.up);
 
-    buf->writeBuffer("uniform_buffer", offsetof(MyUniforms, viewMatrix), &uniforms.viewMatrix, sizeof(MyUniforms::viewMatrix));
+    buf->writeBuffer(gpu.getUniformBuffer(), offsetof(MyUniforms, viewMatrix), &uniforms.viewMatrix, sizeof(MyUniforms::viewMatrix));
 }
 
 void Application::onMouseMove(double xpos, double ypos) {
@@ -591,6 +658,54 @@ void Application::onKey(int key, int scancode, int action, int mods) {
         if (keyPressed) keyStates.Shift = true;
         if (keyReleased) keyStates.Shift = false;
         break;
+    case GLFW_KEY_N:
+        if (action == GLFW_PRESS) noclip = !noclip;
+        break;
+    case GLFW_KEY_L:
+        if (action == GLFW_PRESS) {
+            placeMaterial = placeMaterial == VoxelLightEngine::LAMP_MATERIAL ? 4 : VoxelLightEngine::LAMP_MATERIAL;
+        }
+        break;
+    case GLFW_KEY_T:
+        // First press starts a chunk pipeline trace, second press exports it
+        if (action == GLFW_PRESS) {
+            if (!ChunkTracer::isEnabled()) {
+                ChunkTracer::instance().clear();
+                ChunkTracer::setEnabled(true);
+                std::cout << "Chunk tracing started" << std::endl;
+            }
+            else {
+                ChunkTracer::setEnabled(false);
+                ChunkTracer::instance().printSummary(std::cout);
+                if (ChunkTracer::instance().writeChromeTrace("chunk_trace.json")) {
+                    std::cout << "Wrote chunk_trace.json" << std::endl;
+                }
+                else {
+                    std::cerr << "Failed to write chunk_trace.json" << std::endl;
+                }
+            }
+        }
+        break;
+    case GLFW_KEY_M:
+        if (action == GLFW_PRESS) {
+            chunkManager.getMemoryReport().print(std::cout);
+            chunkManager.getDedupStats().print(std::cout);
+        }
+        break;
+    case GLFW_KEY_P:
+        // Dump the frame profiler ring
+        if (action == GLFW_PRESS) {
+            FrameProfiler::instance().printSummary(std::cout);
+            bool written = FrameProfiler::instance().writeCsv("frame_profile.csv") &&
+                FrameProfiler::instance().writeChromeTrace("frame_profile.json");
+            if (written) {
+                std::cout << "Wrote frame_profile.csv and frame_profile.json" << std::endl;
+            }
+            else {
+                std::cerr << "Failed to write the frame profile" << std::endl;
+            }
+        }
+        break;
     case GLFW_KEY_ESCAPE:
         if (keyPressed) {
             glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
@@ -7,7 +7,10 @@
 #include "webgpu-utils.h"
 #include "ThreadSafeChunkManager.h"
 #include "Ray.h"
+#include "VoxelCollision.h"
+#include "HeightClipmap.h"
 #include "Rendering/WebGPURenderer.h"
+#include "Profiler.h"
 
 //#include "magic_enum.hpp"
 
@@ -109,6 +112,25 @@ private:
         bool Shift = false;   // Move down
     };
 
+    // Camera collision; noclip is the default free-fly mode, N toggles it
+    bool noclip = true;
+    CollisionBody playerBody;
+    static constexpr float EYE_HEIGHT = 0.7f; // Eye above body center
+
+    // Material for right click; L toggles between block and lamp
+    uint16_t placeMaterial = 4;
+    static constexpr float LIGHT_UPLOAD_BUDGET_MS = 1.0f;
+    static constexpr float RELIGHT_BUDGET_MS = 6.0f; // Worker time per frame, over all workers
+
+    // Far terrain beyond the chunks; sampled on the chunk update thread
+    HeightClipmap farTerrain;
+    static constexpr int FAR_TERRAIN_COLUMN_BUDGET = 384; // Surface searches per chunk update
+
+    // Build the world from resources/heightmap.png instead of the noise. The
+    // image is converted to a tiled file next to it on first use.
+    static constexpr bool USE_HEIGHTMAP_TERRAIN = false;
+
+
     WebGPURenderer gpu;
     PipelineManager *pip;
     TextureManager *tex;
@@ -143,10 +165,12 @@ private:
 
     // Camera position for chunk updates (thread-safe)
     std::atomic<glm::vec3> lastChunkUpdateCameraPos{ glm::vec3(0.0f) };
+    std::atomic<glm::vec3> lastChunkUpdateCameraFront{ glm::vec3(0.0f) };
 
     // Timing control for chunk updates
     std::atomic<float> lastChunkUpdateTime{ 0.0f };
     static constexpr float CHUNK_UPDATE_INTERVAL = 0.02f; // 50Hz chunk updates
+    static constexpr float CAMERA_VELOCITY_SMOOTHING = 0.2f; // Weight of the newest sample
 
     
 
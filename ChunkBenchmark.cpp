@@ -0,0 +1,605 @@
+// ChunkBenchmark.cpp - Headless timings for the chunk pipeline stages
+//
+// Runs terrain, topsoil, fused terrain+topsoil, mesh, LOD mesh and ray
+// stages over fixed chunks
+// without a window or GPU device. Prints a table, and with --json writes
+// the same numbers in a form that can be diffed between commits.
+//
+// Usage: ChunkBenchmark [--iterations N] [--filter text] [--json path]
+//        [--verify-classifier N] [--lattice-report N]
+// --verify-classifier checks WorldGenerator::classifyBox against full
+// sampling on N random chunk and halo boxes and exits with 2 on any wrong
+// answer, instead of running the stages. --lattice-report compares the
+// coarse lattice sampling modes with full sampling on N random surface
+// chunks: speedup, value error and voxels that changed solidity.
+
+#define WEBGPU_CPP_IMPLEMENTATION
+
+#include "ThreadSafeChunk.h"
+#include "Ray.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+// GCC pairs the inlined malloc/free below with new/delete and warns
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+// Every plain allocation is counted while a stage is being timed
+static std::atomic<bool> countAllocations{ false };
+static std::atomic<uint64_t> allocationCount{ 0 };
+static std::atomic<uint64_t> allocationBytes{ 0 };
+
+void* operator new(std::size_t size) {
+    if (countAllocations.load(std::memory_order_relaxed)) {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        allocationBytes.fetch_add(size, std::memory_order_relaxed);
+    }
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+constexpr int CHUNK_SIZE = 32;
+constexpr int TOTAL_VOXELS = CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE;
+constexpr int RAYS_PER_CASE = 4096;
+constexpr float RAY_DISTANCE = 64.0f;
+
+struct BenchCase {
+    const char* name;
+    ivec3 chunkPos;
+};
+
+// Picked for ThreadSafeChunk::WORLD_SEED; recheck them if the generator changes
+const BenchCase CASES[] = {
+    { "flat", ivec3(4, -6, 4) },     // Gentle surface, about 25% solid
+    { "mountain", ivec3(-4, 3, 5) }, // Surface height spans most of the chunk
+    { "cave", ivec3(-4, 0, 4) },     // Overhangs with enclosed air below them
+    { "solid", ivec3(0, 0, 0) },     // Fully underground
+    { "air", ivec3(0, 0, 12) },      // Above all terrain
+};
+
+struct StageResult {
+    std::string stage;
+    std::string caseName;
+    ivec3 chunkPos = ivec3(0);
+    int iterations = 0;
+    double minNs = 0.0;
+    double medianNs = 0.0;
+    double meanNs = 0.0;
+    const char* itemName = "voxel";
+    double itemsPerRun = 0.0;
+    double allocationsPerRun = 0.0;
+    double bytesPerRun = 0.0;
+    std::vector<std::pair<std::string, uint64_t>> outputs;
+
+    double itemsPerSecond() const {
+        return medianNs > 0.0 ? itemsPerRun * 1e9 / medianNs : 0.0;
+    }
+};
+
+StageResult startResult(const char* stage, const BenchCase& bench) {
+    StageResult result;
+    result.stage = stage;
+    result.caseName = bench.name;
+    result.chunkPos = bench.chunkPos;
+    return result;
+}
+
+using ChunkPtr = std::shared_ptr<ThreadSafeChunk>;
+using Neighbors = std::array<ChunkPtr, 6>;
+
+const ivec3 NEIGHBOR_OFFSETS[6] = {
+    ivec3(1, 0, 0), ivec3(-1, 0, 0),
+    ivec3(0, 1, 0), ivec3(0, -1, 0),
+    ivec3(0, 0, 1), ivec3(0, 0, -1)
+};
+
+ChunkPtr makeChunk(const ivec3& chunkPos, uint32_t lod = 0) {
+    return std::make_shared<ThreadSafeChunk>(chunkPos * CHUNK_SIZE, chunkPos, lod);
+}
+
+// Terrain-only chunks around a case, as the manager would have them when
+// topsoil and meshing of the centre chunk are queued
+struct CaseWorld {
+    std::map<std::tuple<int, int, int>, ChunkPtr> chunks;
+
+    explicit CaseWorld(const ivec3& center) {
+        for (int dz = -1; dz <= 1; ++dz) {
+            for (int dy = -1; dy <= 1; ++dy) {
+                for (int dx = -1; dx <= 1; ++dx) {
+                    ivec3 pos = center + ivec3(dx, dy, dz);
+                    ChunkPtr chunk = makeChunk(pos);
+                    chunk->generateTerrain();
+                    chunks[{ pos.x, pos.y, pos.z }] = chunk;
+                }
+            }
+        }
+    }
+
+    ChunkPtr get(const ivec3& pos) const {
+        auto it = chunks.find({ pos.x, pos.y, pos.z });
+        return it != chunks.end() ? it->second : nullptr;
+    }
+
+    Neighbors neighborsOf(const ivec3& pos) const {
+        Neighbors neighbors;
+        for (int i = 0; i < 6; ++i) {
+            neighbors[i] = get(pos + NEIGHBOR_OFFSETS[i]);
+        }
+        return neighbors;
+    }
+};
+
+// Time run(state) once per iteration on a fresh state from setup(); only
+// run() is timed and counted. collect(state) reads outputs of the last run.
+template <typename Setup, typename Run, typename Collect>
+void measure(StageResult& result, int iterations, Setup&& setup, Run&& run, Collect&& collect) {
+    std::vector<double> samples;
+    samples.reserve(iterations);
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+
+    for (int i = 0; i < iterations; ++i) {
+        auto state = setup();
+
+        allocationCount.store(0);
+        allocationBytes.store(0);
+        countAllocations.store(true);
+        auto start = std::chrono::steady_clock::now();
+
+        run(state);
+
+        auto end = std::chrono::steady_clock::now();
+        countAllocations.store(false);
+        allocations += allocationCount.load();
+        bytes += allocationBytes.load();
+        samples.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+
+        if (i == iterations - 1) {
+            collect(state);
+        }
+    }
+
+    std::sort(samples.begin(), samples.end());
+    result.iterations = iterations;
+    result.minNs = samples.front();
+    result.medianNs = samples[samples.size() / 2];
+    double total = 0.0;
+    for (double s : samples) {
+        total += s;
+    }
+    result.meanNs = total / samples.size();
+    result.allocationsPerRun = static_cast<double>(allocations) / iterations;
+    result.bytesPerRun = static_cast<double>(bytes) / iterations;
+}
+
+StageResult benchTerrain(const BenchCase& bench, int iterations) {
+    StageResult result = startResult("terrain", bench);
+    result.itemsPerRun = TOTAL_VOXELS;
+    measure(result, iterations,
+        [&] { return makeChunk(bench.chunkPos); },
+        [](ChunkPtr& chunk) { chunk->generateTerrain(); },
+        [&](ChunkPtr& chunk) {
+            result.outputs = { { "solid_voxels", static_cast<uint64_t>(chunk->getSolidVoxels()) } };
+        });
+    return result;
+}
+
+uint64_t countSurfaceVoxels(const ChunkPtr& chunk) {
+    uint64_t surface = 0;
+    for (int z = 0; z < CHUNK_SIZE; ++z) {
+        for (int y = 0; y < CHUNK_SIZE; ++y) {
+            for (int x = 0; x < CHUNK_SIZE; ++x) {
+                uint16_t material = chunk->getMaterial(ivec3(x, y, z)).materialType;
+                surface += material == 1 || material == 2; // Dirt and grass
+            }
+        }
+    }
+    return surface;
+}
+
+StageResult benchTopsoil(const BenchCase& bench, const CaseWorld& world, int iterations) {
+    StageResult result = startResult("topsoil", bench);
+    result.itemsPerRun = TOTAL_VOXELS;
+    Neighbors neighbors = world.neighborsOf(bench.chunkPos);
+    measure(result, iterations,
+        [&] {
+            ChunkPtr chunk = makeChunk(bench.chunkPos);
+            chunk->generateTerrain();
+            return chunk;
+        },
+        [&](ChunkPtr& chunk) { chunk->generateTopsoil(neighbors); },
+        [&](ChunkPtr& chunk) {
+            result.outputs = { { "surface_voxels", countSurfaceVoxels(chunk) } };
+        });
+    return result;
+}
+
+// Compare against terrain + topsoil, which also pays for the neighbours' terrain
+StageResult benchTerrainTopsoil(const BenchCase& bench, int iterations) {
+    StageResult result = startResult("terrain_topsoil", bench);
+    result.itemsPerRun = TOTAL_VOXELS;
+    measure(result, iterations,
+        [&] { return makeChunk(bench.chunkPos); },
+        [](ChunkPtr& chunk) { chunk->generateTerrainWithTopsoil(); },
+        [&](ChunkPtr& chunk) {
+            result.outputs = {
+                { "solid_voxels", static_cast<uint64_t>(chunk->getSolidVoxels()) },
+                { "surface_voxels", countSurfaceVoxels(chunk) },
+            };
+        });
+    return result;
+}
+
+StageResult benchMesh(const BenchCase& bench, const CaseWorld& world, int iterations, uint32_t lod) {
+    StageResult result = startResult(lod > 0 ? "mesh_lod" : "mesh", bench);
+    result.itemsPerRun = TOTAL_VOXELS;
+    Neighbors neighbors = world.neighborsOf(bench.chunkPos);
+    measure(result, iterations,
+        [&] {
+            ChunkPtr chunk = makeChunk(bench.chunkPos, lod);
+            chunk->generateTerrain();
+            chunk->generateTopsoil(neighbors);
+            return chunk;
+        },
+        [&](ChunkPtr& chunk) { chunk->generateMesh(neighbors); },
+        [&](ChunkPtr& chunk) {
+            uint64_t quads = chunk->getQuadCount();
+            result.outputs = {
+                { "quads", quads },
+                { "mesh_bytes", quads * sizeof(VertexAttributes) },
+            };
+        });
+    return result;
+}
+
+StageResult benchRays(const BenchCase& bench, const CaseWorld& world, int iterations) {
+    StageResult result = startResult("ray", bench);
+    result.itemName = "ray";
+    result.itemsPerRun = RAYS_PER_CASE;
+
+    // Same rays every run: origins inside the centre chunk, random directions
+    std::mt19937 rng(ThreadSafeChunk::WORLD_SEED);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<std::pair<vec3, vec3>> rays(RAYS_PER_CASE);
+    vec3 base = vec3(bench.chunkPos * CHUNK_SIZE);
+    for (auto& ray : rays) {
+        ray.first = base + vec3(unit(rng), unit(rng), unit(rng)) * float(CHUNK_SIZE);
+        vec3 dir;
+        do {
+            dir = vec3(unit(rng), unit(rng), unit(rng)) * 2.0f - 1.0f;
+        } while (glm::dot(dir, dir) < 0.01f || glm::dot(dir, dir) > 1.0f);
+        ray.second = glm::normalize(dir);
+    }
+
+    auto getChunk = [&world](const ivec3& pos) { return world.get(pos); };
+    measure(result, iterations,
+        [] { return uint64_t(0); },
+        [&](uint64_t& hits) {
+            for (const auto& ray : rays) {
+                hits += Ray::rayVoxelIntersection(ray.first, ray.second, RAY_DISTANCE, getChunk).hit;
+            }
+        },
+        [&](uint64_t& hits) {
+            result.outputs = { { "hits", hits } };
+        });
+    return result;
+}
+
+std::string compilerName() {
+#if defined(_MSC_VER)
+    return "msvc " + std::to_string(_MSC_VER);
+#elif defined(__clang__)
+    return std::string("clang ") + __clang_version__;
+#elif defined(__GNUC__)
+    return std::string("gcc ") + __VERSION__;
+#else
+    return "unknown";
+#endif
+}
+
+std::string jsonEscape(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+bool writeJson(const std::string& path, const std::vector<StageResult>& results, int iterations) {
+    std::ofstream out(path);
+    if (!out) {
+        return false;
+    }
+
+    out << "{\n";
+    out << "  \"benchmark\": \"chunk_pipeline\",\n";
+    out << "  \"seed\": " << ThreadSafeChunk::WORLD_SEED << ",\n";
+    out << "  \"iterations\": " << iterations << ",\n";
+    out << "  \"compiler\": \"" << jsonEscape(compilerName()) << "\",\n";
+#ifdef NDEBUG
+    out << "  \"build\": \"release\",\n";
+#else
+    out << "  \"build\": \"debug\",\n";
+#endif
+    out << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const StageResult& r = results[i];
+        out << "    { \"stage\": \"" << r.stage << "\", \"case\": \"" << r.caseName << "\""
+            << ", \"chunk\": [" << r.chunkPos.x << ", " << r.chunkPos.y << ", " << r.chunkPos.z << "]"
+            << ", \"iterations\": " << r.iterations
+            << ", \"min_ns\": " << static_cast<uint64_t>(r.minNs)
+            << ", \"median_ns\": " << static_cast<uint64_t>(r.medianNs)
+            << ", \"mean_ns\": " << static_cast<uint64_t>(r.meanNs)
+            << ", \"item\": \"" << r.itemName << "\""
+            << ", \"items_per_second\": " << static_cast<uint64_t>(r.itemsPerSecond())
+            << ", \"allocations\": " << r.allocationsPerRun
+            << ", \"allocated_bytes\": " << static_cast<uint64_t>(r.bytesPerRun)
+            << ", \"outputs\": {";
+        for (size_t j = 0; j < r.outputs.size(); ++j) {
+            out << (j ? ", " : " ") << "\"" << r.outputs[j].first << "\": " << r.outputs[j].second;
+        }
+        out << (r.outputs.empty() ? "}" : " }") << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+    return static_cast<bool>(out);
+}
+
+void printResult(const StageResult& r) {
+    char line[256];
+    std::snprintf(line, sizeof(line), "%-9s %-9s %12.0f %12.0f %14.3e %10.1f %12.0f  ",
+        r.stage.c_str(), r.caseName.c_str(), r.medianNs, r.minNs, r.itemsPerSecond(),
+        r.allocationsPerRun, r.bytesPerRun);
+    std::cout << line;
+    for (const auto& output : r.outputs) {
+        std::cout << output.first << "=" << output.second << " ";
+    }
+    std::cout << std::endl;
+}
+
+int verifyClassifier(int count) {
+    WorldGenerator worldGen;
+    worldGen.initialize(ThreadSafeChunk::WORLD_SEED);
+
+    // Random chunks from deep underground to well above the terrain
+    std::mt19937 rng(ThreadSafeChunk::WORLD_SEED);
+    std::uniform_int_distribution<int> horizontal(-100000, 100000);
+    std::uniform_int_distribution<int> vertical(-16, 24);
+
+    uint64_t air = 0, solid = 0, mixed = 0, wrong = 0;
+    uint64_t classifyNs = 0, sampleNs = 0;
+    std::vector<float> density;
+    for (int i = 0; i < count; ++i) {
+        ivec3 start(horizontal(rng), horizontal(rng), vertical(rng) * CHUNK_SIZE);
+        ivec3 size(CHUNK_SIZE);
+        if (i % 2) {
+            // Halo box of ThreadSafeChunk::generateTerrainWithTopsoil
+            start -= ivec3(1, 1, 3);
+            size += ivec3(2, 2, 6);
+        }
+
+        auto t0 = std::chrono::steady_clock::now();
+        WorldGenerator::BoxContents contents = worldGen.classifyBox(start, size);
+        auto t1 = std::chrono::steady_clock::now();
+        density.resize(size_t(size.x) * size.y * size.z);
+        worldGen.sampleGrid3D(density.data(), start, size);
+        auto t2 = std::chrono::steady_clock::now();
+        classifyNs += std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+        sampleNs += std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count();
+
+        size_t solidCount = std::count_if(density.begin(), density.end(),
+            [](float value) { return value > WorldGenerator::SOLID_THRESHOLD; });
+        switch (contents) {
+        case WorldGenerator::BoxContents::Air:
+            air++;
+            wrong += solidCount != 0;
+            break;
+        case WorldGenerator::BoxContents::Solid:
+            solid++;
+            wrong += solidCount != density.size();
+            break;
+        case WorldGenerator::BoxContents::Mixed:
+            mixed++;
+            break;
+        }
+    }
+
+    std::printf("Classifier over %d boxes: %llu air, %llu solid, %llu not proven, %llu wrong\n", count,
+        static_cast<unsigned long long>(air), static_cast<unsigned long long>(solid),
+        static_cast<unsigned long long>(mixed), static_cast<unsigned long long>(wrong));
+    std::printf("Mean %.1f us to classify, %.1f us to sample in full\n",
+        classifyNs / 1000.0 / count, sampleNs / 1000.0 / count);
+    return wrong ? 2 : 0;
+}
+
+int latticeReport(int count) {
+    WorldGenerator worldGen;
+    worldGen.initialize(ThreadSafeChunk::WORLD_SEED);
+
+    // Chunks around the surface, where the classifier does not help
+    std::mt19937 rng(ThreadSafeChunk::WORLD_SEED);
+    std::uniform_int_distribution<int> horizontal(-100000, 100000);
+    std::uniform_int_distribution<int> vertical(-6, 12);
+    std::vector<ivec3> corpus;
+    for (int i = 0; i < count; ++i) {
+        corpus.push_back(ivec3(horizontal(rng), horizontal(rng), vertical(rng) * CHUNK_SIZE));
+    }
+
+    // Full resolution reference, timed once per graph
+    std::vector<std::vector<float>> density(count, std::vector<float>(TOTAL_VOXELS));
+    std::vector<std::vector<float>> strata(count, std::vector<float>(TOTAL_VOXELS));
+    uint64_t densityNs = 0, strataNs = 0;
+    for (int i = 0; i < count; ++i) {
+        auto t0 = std::chrono::steady_clock::now();
+        worldGen.sampleGrid3D(density[i].data(), corpus[i], ivec3(CHUNK_SIZE));
+        auto t1 = std::chrono::steady_clock::now();
+        worldGen.sampleGrid3D2(strata[i].data(), corpus[i], ivec3(CHUNK_SIZE));
+        auto t2 = std::chrono::steady_clock::now();
+        densityNs += std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+        strataNs += std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count();
+    }
+
+    std::printf("Lattice sampling over %d chunks, full density %.0f us, full strata %.0f us per chunk\n",
+        count, densityNs / 1000.0 / count, strataNs / 1000.0 / count);
+    std::printf("graph    spacing  margin  speedup  mean err   max err  flipped voxels\n");
+
+    std::vector<float> values(TOTAL_VOXELS);
+    auto report = [&](const char* graph, int spacing, float margin, bool isDensity) {
+        worldGen.densitySpacing = isDensity ? spacing : 1;
+        worldGen.strataSpacing = isDensity ? 1 : spacing;
+        worldGen.densityRefineMargin = margin;
+
+        uint64_t ns = 0, flipped = 0;
+        double errorSum = 0.0, errorMax = 0.0;
+        for (int i = 0; i < count; ++i) {
+            auto t0 = std::chrono::steady_clock::now();
+            if (isDensity) {
+                worldGen.sampleGrid3D(values.data(), corpus[i], ivec3(CHUNK_SIZE));
+            }
+            else {
+                worldGen.sampleGrid3D2(values.data(), corpus[i], ivec3(CHUNK_SIZE));
+            }
+            ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+
+            const std::vector<float>& reference = isDensity ? density[i] : strata[i];
+            for (int v = 0; v < TOTAL_VOXELS; ++v) {
+                double error = std::abs(values[v] - reference[v]);
+                errorSum += error;
+                errorMax = std::max(errorMax, error);
+                if (isDensity) {
+                    flipped += (values[v] > WorldGenerator::SOLID_THRESHOLD) != (reference[v] > WorldGenerator::SOLID_THRESHOLD);
+                }
+            }
+        }
+
+        double speedup = static_cast<double>(isDensity ? densityNs : strataNs) / std::max<uint64_t>(ns, 1);
+        std::printf("%-8s %7d %7.2f %7.2fx %9.5f %9.4f  ", graph, spacing, margin, speedup,
+            errorSum / (double(count) * TOTAL_VOXELS), errorMax);
+        if (isDensity) {
+            std::printf("%llu\n", static_cast<unsigned long long>(flipped));
+        }
+        else {
+            std::printf("-\n");
+        }
+    };
+
+    for (int spacing : { 2, 4, 8 }) {
+        for (float margin : { 0.0f, 0.05f, 0.15f }) {
+            report("density", spacing, margin, true);
+        }
+    }
+    for (int spacing : { 2, 4, 8 }) {
+        report("strata", spacing, 0.0f, false);
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int iterations = 20;
+    std::string filter;
+    std::string jsonPath;
+    int verifyCount = 0;
+    int latticeCount = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--iterations" && i + 1 < argc) {
+            iterations = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        }
+        else if (arg == "--json" && i + 1 < argc) {
+            jsonPath = argv[++i];
+        }
+        else if (arg == "--verify-classifier" && i + 1 < argc) {
+            verifyCount = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--lattice-report" && i + 1 < argc) {
+            latticeCount = std::max(1, std::atoi(argv[++i]));
+        }
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--iterations N] [--filter text] [--json path]"
+                << " [--verify-classifier N] [--lattice-report N]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (verifyCount > 0) {
+        return verifyClassifier(verifyCount);
+    }
+    if (latticeCount > 0) {
+        return latticeReport(latticeCount);
+    }
+
+    // Stage names and case names both match the filter, e.g. "mesh" or "cave"
+    auto selected = [&filter](const std::string& stage, const std::string& caseName) {
+        return filter.empty() || stage.find(filter) != std::string::npos || caseName.find(filter) != std::string::npos;
+    };
+
+    std::cout << "Chunk pipeline benchmark, seed " << ThreadSafeChunk::WORLD_SEED
+        << ", " << iterations << " iterations" << std::endl;
+    std::cout << "stage     case         median ns       min ns   items/s     allocs   alloc bytes  outputs" << std::endl;
+
+    std::vector<StageResult> results;
+    try {
+        for (const BenchCase& bench : CASES) {
+            CaseWorld world(bench.chunkPos);
+
+            std::vector<StageResult> caseResults;
+            if (selected("terrain", bench.name)) caseResults.push_back(benchTerrain(bench, iterations));
+            if (selected("topsoil", bench.name)) caseResults.push_back(benchTopsoil(bench, world, iterations));
+            if (selected("terrain_topsoil", bench.name)) caseResults.push_back(benchTerrainTopsoil(bench, iterations));
+            if (selected("mesh", bench.name)) caseResults.push_back(benchMesh(bench, world, iterations, 0));
+            if (selected("mesh_lod", bench.name)) caseResults.push_back(benchMesh(bench, world, iterations, 1));
+            if (selected("ray", bench.name)) caseResults.push_back(benchRays(bench, world, iterations));
+
+            for (const StageResult& r : caseResults) {
+                printResult(r);
+                results.push_back(r);
+            }
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Benchmark failed: " << e.what() << std::endl;
+        return 1;
+    }
+
+    if (!jsonPath.empty()) {
+        if (!writeJson(jsonPath, results, iterations)) {
+            std::cerr << "Failed to write " << jsonPath << std::endl;
+            return 1;
+        }
+        std::cout << "Wrote " << jsonPath << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,381 @@
+#ifndef CHUNK_DEDUP
+#define CHUNK_DEDUP
+
+// ChunkDedup.h - Identical chunks share their GPU resources
+//
+// Deep stone and flat biomes produce many chunks with the same voxels. Each
+// chunk hashes its occupancy and materials once generation is done. That
+// hash combined with a hash of the chunk's light keys the material texture
+// and its bind group; a hash of the uploaded quads keys the vertex buffer,
+// since border faces also depend on the neighbours. Chunks with equal keys
+// hold the same reference counted entry. Entries are never written after
+// they are filled: a chunk whose voxels or light change takes the entry for
+// its new key, which leaves the old one untouched for the chunks still
+// drawing with it (copy on write).
+//
+// Keys are 128 bits, so distinct contents sharing one is out of reach. With
+// CHUNK_DEDUP_VERIFY, the default for debug builds, entries also keep what
+// they uploaded and every hit is compared before it is shared.
+#ifndef CHUNK_DEDUP_VERIFY
+#ifdef NDEBUG
+#define CHUNK_DEDUP_VERIFY 0
+#else
+#define CHUNK_DEDUP_VERIFY 1
+#endif
+#endif
+
+#include <webgpu/webgpu.hpp>
+#include <unordered_map>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <array>
+#include <iterator>
+#include <algorithm>
+#include <ostream>
+#include <iomanip>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include "MemoryTracker.h"
+#include "Rendering/TextureManager.h"
+#include "Rendering/BufferManager.h"
+
+using namespace wgpu;
+
+namespace ChunkHash {
+
+// Two lanes with their own seed, multiplier and input rotation. Zero means
+// no key.
+struct Key {
+    uint64_t a = 0;
+    uint64_t b = 0;
+
+    bool operator==(const Key& other) const { return a == other.a && b == other.b; }
+    bool operator!=(const Key& other) const { return !(*this == other); }
+    explicit operator bool() const { return (a | b) != 0; }
+};
+
+struct KeyHash {
+    size_t operator()(const Key& key) const { return static_cast<size_t>(key.a); }
+};
+
+static constexpr Key SEED{ 14695981039346656037ull, 0x6A09E667F3BCC909ull };
+
+// Multiply and fold the high half back down, so every input bit reaches
+// every output bit of each lane
+inline Key mix(Key hash, uint64_t value) {
+    hash.a = (hash.a ^ value) * 0x9E3779B97F4A7C15ull;
+    hash.a ^= hash.a >> 32;
+    hash.b = (hash.b ^ (value << 23 | value >> 41)) * 0xC2B2AE3D27D4EB4Full;
+    hash.b ^= hash.b >> 29;
+    return hash;
+}
+
+inline Key mix(Key hash, const Key& value) {
+    return mix(mix(hash, value.a), value.b);
+}
+
+inline Key bytes(Key hash, const uint8_t* data, size_t size) {
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        hash = mix(hash, word);
+    }
+    for (; i < size; ++i) {
+        hash = mix(hash, data[i]);
+    }
+    return hash;
+}
+
+inline Key words(Key hash, const uint32_t* data, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        hash = mix(hash, data[i]);
+    }
+    return hash;
+}
+
+// Hashes the (length << 16 | value) words ThreadSafeChunk::packRuns would
+// produce for these values without building them, so a flat array and its
+// packed runs hash the same
+template <typename ValueAt>
+inline Key runs(Key hash, int count, ValueAt&& valueAt) {
+    for (int i = 0; i < count;) {
+        uint32_t value = valueAt(i);
+        int end = i + 1;
+        while (end < count && valueAt(end) == value) {
+            ++end;
+        }
+        hash = mix(hash, uint32_t(end - i) << 16 | value);
+        i = end;
+    }
+    return hash;
+}
+
+} // namespace ChunkHash
+
+// Material texture with the bind group that samples it
+struct SharedChunkMaterial {
+    ChunkHash::Key key;
+    Texture texture = nullptr;
+    TextureView view = nullptr;
+    BindGroup bindGroup = nullptr;
+    std::atomic<uint32_t> holders{ 0 }; // Chunks drawing with it, see SharedChunkHold
+#if CHUNK_DEDUP_VERIFY
+    std::vector<uint8_t> texels; // As uploaded
+#endif
+
+    SharedChunkMaterial() = default;
+    SharedChunkMaterial(const SharedChunkMaterial&) = delete;
+    SharedChunkMaterial& operator=(const SharedChunkMaterial&) = delete;
+
+    ~SharedChunkMaterial() {
+        if (bindGroup) {
+            bindGroup.release();
+            MemoryTracker::instance().release(MemoryCategory::BindGroup, 0);
+        }
+        if (view) {
+            view.release();
+        }
+        TextureManager::destroyTrackedTexture(texture, MemoryCategory::ChunkTexture);
+    }
+};
+
+// Uploaded quads, grouped by face direction like ThreadSafeChunk::quadData
+struct SharedChunkMesh {
+    ChunkHash::Key key;
+    Buffer vertexBuffer = nullptr;
+    uint32_t vertexBufferSize = 0;
+    uint32_t quadCount = 0;
+    std::array<uint32_t, 6> faceQuadCount{};
+    std::atomic<uint32_t> holders{ 0 };
+#if CHUNK_DEDUP_VERIFY
+    std::vector<uint32_t> quads; // As uploaded
+#endif
+
+    SharedChunkMesh() = default;
+    SharedChunkMesh(const SharedChunkMesh&) = delete;
+    SharedChunkMesh& operator=(const SharedChunkMesh&) = delete;
+
+    ~SharedChunkMesh() {
+        BufferManager::destroyTrackedBuffer(vertexBuffer, MemoryCategory::VertexBuffer);
+    }
+};
+
+// A chunk's reference to an entry. Keeps the entry's holder count, which
+// unlike use_count() ignores copies in flight, such as the one a lookup
+// returns, so per-chunk memory shares add up to the real total.
+template <typename Entry>
+class SharedChunkHold {
+    std::shared_ptr<Entry> entry;
+
+public:
+    SharedChunkHold() = default;
+    SharedChunkHold(const SharedChunkHold&) = delete;
+    SharedChunkHold& operator=(const SharedChunkHold&) = delete;
+
+    ~SharedChunkHold() {
+        reset();
+    }
+
+    SharedChunkHold& operator=(std::shared_ptr<Entry> other) {
+        if (other != entry) {
+            reset();
+            entry = std::move(other);
+            if (entry) entry->holders.fetch_add(1);
+        }
+        return *this;
+    }
+
+    void reset() {
+        if (entry) {
+            entry->holders.fetch_sub(1);
+            entry.reset();
+        }
+    }
+
+    Entry* operator->() const { return entry.get(); }
+    Entry& operator*() const { return *entry; }
+    explicit operator bool() const { return entry != nullptr; }
+    const std::shared_ptr<Entry>& get() const { return entry; }
+
+    // At least 1 while held
+    uint32_t holders() const {
+        return entry ? std::max<uint32_t>(entry->holders.load(), 1) : 0;
+    }
+};
+
+// Registry of live entries, owned by the chunk manager and handed to each
+// chunk. Entries are owned by the chunks, the registry only looks them up,
+// so the last chunk to let go of one frees its GPU memory. Content counts
+// are kept for every loaded chunk, with or without a GPU, so headless runs
+// can report how much would be shared.
+class ChunkDedup {
+public:
+    struct Stats {
+        uint64_t contentLookups = 0;
+        uint64_t contentHits = 0;  // Generated chunks another loaded chunk already matched
+        size_t distinctContents = 0;
+        uint64_t materialLookups = 0;
+        uint64_t materialHits = 0;
+        size_t liveMaterials = 0;
+        uint64_t meshLookups = 0;
+        uint64_t meshHits = 0;
+        size_t liveMeshes = 0;
+        uint64_t collisions = 0; // Hits whose content differed, only counted with CHUNK_DEDUP_VERIFY
+
+        static double rate(uint64_t hits, uint64_t lookups) {
+            return lookups ? 100.0 * hits / lookups : 0.0;
+        }
+
+        void print(std::ostream& out) const {
+            out << std::fixed << std::setprecision(1);
+            out << "Dedup: content " << contentHits << "/" << contentLookups << " hits (" << rate(contentHits, contentLookups)
+                << "%), " << distinctContents << " distinct; textures " << materialHits << "/" << materialLookups
+                << " (" << rate(materialHits, materialLookups) << "%), " << liveMaterials << " live; meshes "
+                << meshHits << "/" << meshLookups << " (" << rate(meshHits, meshLookups) << "%), " << liveMeshes
+                << " live";
+            if (collisions) out << "; " << collisions << " key collisions";
+            out << std::endl;
+            out << std::defaultfloat;
+        }
+    };
+
+    // Counts a chunk with this content. Returns true when another loaded
+    // chunk already had it.
+    bool addContent(const ChunkHash::Key& hash) {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.contentLookups++;
+        bool hit = contents[hash]++ > 0;
+        if (hit) stats.contentHits++;
+        return hit;
+    }
+
+    void removeContent(const ChunkHash::Key& hash) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = contents.find(hash);
+        if (it != contents.end() && --it->second == 0) {
+            contents.erase(it);
+        }
+    }
+
+    // Null when no loaded chunk holds an entry for the key. With
+    // CHUNK_DEDUP_VERIFY, matches(entry) compares the caller's content to
+    // the entry's, and a mismatch is reported and returns null.
+    template <typename Matches>
+    std::shared_ptr<SharedChunkMaterial> findMaterial(const ChunkHash::Key& key, Matches&& matches) {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.materialLookups++;
+        std::shared_ptr<SharedChunkMaterial> entry = verifyLocked(findLocked(materials, key), matches);
+        if (entry) stats.materialHits++;
+        return entry;
+    }
+
+    // Only call with an entry that is already filled
+    void addMaterial(const std::shared_ptr<SharedChunkMaterial>& entry) {
+        std::lock_guard<std::mutex> lock(mutex);
+        addLocked(materials, entry);
+    }
+
+    // Before an entry's texture is rewritten: it no longer matches its key
+    void removeMaterial(const SharedChunkMaterial& entry) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = materials.find(entry.key);
+        if (it != materials.end() && it->second.lock().get() == &entry) {
+            materials.erase(it);
+        }
+    }
+
+    template <typename Matches>
+    std::shared_ptr<SharedChunkMesh> findMesh(const ChunkHash::Key& key, Matches&& matches) {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.meshLookups++;
+        std::shared_ptr<SharedChunkMesh> entry = verifyLocked(findLocked(meshes, key), matches);
+        if (entry) stats.meshHits++;
+        return entry;
+    }
+
+    void addMesh(const std::shared_ptr<SharedChunkMesh>& entry) {
+        std::lock_guard<std::mutex> lock(mutex);
+        addLocked(meshes, entry);
+    }
+
+    Stats getStats() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        Stats result = stats;
+        result.distinctContents = contents.size();
+        result.liveMaterials = countLive(materials);
+        result.liveMeshes = countLive(meshes);
+        return result;
+    }
+
+private:
+    static constexpr size_t PRUNE_INTERVAL = 256; // Adds between sweeps of expired entries
+
+    template <typename Entry>
+    using EntryMap = std::unordered_map<ChunkHash::Key, std::weak_ptr<Entry>, ChunkHash::KeyHash>;
+
+    template <typename Entry>
+    static std::shared_ptr<Entry> findLocked(EntryMap<Entry>& map, const ChunkHash::Key& key) {
+        auto it = map.find(key);
+        if (it == map.end()) {
+            return nullptr;
+        }
+        std::shared_ptr<Entry> entry = it->second.lock();
+        if (!entry) {
+            map.erase(it);
+        }
+        return entry;
+    }
+
+    template <typename Entry, typename Matches>
+    std::shared_ptr<Entry> verifyLocked(std::shared_ptr<Entry> entry, Matches& matches) {
+#if CHUNK_DEDUP_VERIFY
+        if (entry && !matches(static_cast<const Entry&>(*entry))) {
+            stats.collisions++;
+            std::cerr << "Dedup key collision, keeping the resource private" << std::endl;
+            return nullptr;
+        }
+#else
+        (void)matches;
+#endif
+        return entry;
+    }
+
+    template <typename Entry>
+    void addLocked(EntryMap<Entry>& map, const std::shared_ptr<Entry>& entry) {
+        map[entry->key] = entry;
+        if (++addsSincePrune >= PRUNE_INTERVAL) {
+            addsSincePrune = 0;
+            pruneLocked(materials);
+            pruneLocked(meshes);
+        }
+    }
+
+    template <typename Entry>
+    static void pruneLocked(EntryMap<Entry>& map) {
+        for (auto it = map.begin(); it != map.end();) {
+            it = it->second.expired() ? map.erase(it) : std::next(it);
+        }
+    }
+
+    template <typename Entry>
+    static size_t countLive(const EntryMap<Entry>& map) {
+        size_t live = 0;
+        for (const auto& pair : map) {
+            live += !pair.second.expired();
+        }
+        return live;
+    }
+
+    mutable std::mutex mutex;
+    std::unordered_map<ChunkHash::Key, uint32_t, ChunkHash::KeyHash> contents; // Hash to loaded chunks with it
+    EntryMap<SharedChunkMaterial> materials;
+    EntryMap<SharedChunkMesh> meshes;
+    size_t addsSincePrune = 0;
+    Stats stats;
+};
+
+#endif // CHUNK_DEDUP
@@ -0,0 +1,105 @@
+// ChunkLod.h - Downsampled voxel grids for distant chunks
+//
+// Level k is the chunk at 1/2^k resolution: one cell covers 2^k voxels per
+// axis. Each level is reduced from the one below it. A cell is solid when at
+// least half of its 8 children are, and takes the material of its highest
+// solid child so grass tops survive into the distance instead of the stone
+// underneath winning the vote.
+#ifndef CHUNK_LOD
+#define CHUNK_LOD
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+constexpr uint32_t MAX_CHUNK_LOD = 3;
+
+// Chunk distance at which levels 1..MAX_CHUNK_LOD start
+constexpr float CHUNK_LOD_DISTANCES[MAX_CHUNK_LOD] = { 12.0f, 24.0f, 40.0f };
+
+// Lattice spacing for the density and strata noise of chunks created at
+// each level, see WorldGenerator::densitySpacing. Distant chunks are only
+// drawn from mips, so they trade exactness for generation speed. Picked from
+// ChunkBenchmark --lattice-report: with the refine margin no density voxel
+// changed solidity, strata error grows quickly with spacing so it stays finer.
+constexpr int CHUNK_LOD_DENSITY_SPACING[MAX_CHUNK_LOD + 1] = { 1, 4, 8, 8 };
+constexpr int CHUNK_LOD_STRATA_SPACING[MAX_CHUNK_LOD + 1] = { 1, 2, 4, 4 };
+constexpr float CHUNK_LOD_REFINE_MARGIN = 0.05f;
+
+// Voxels generated for one level are too coarse for a nearer level with a
+// finer lattice, the chunk has to be generated again
+inline bool chunkLodNeedsRegeneration(uint32_t generatedLevel, uint32_t level) {
+    return CHUNK_LOD_DENSITY_SPACING[level] < CHUNK_LOD_DENSITY_SPACING[generatedLevel] ||
+        CHUNK_LOD_STRATA_SPACING[level] < CHUNK_LOD_STRATA_SPACING[generatedLevel];
+}
+
+// A chunk keeps its level until it is this far past a boundary, so moving
+// along a ring edge does not remesh the same chunks back and forth
+constexpr float CHUNK_LOD_HYSTERESIS = 1.5f;
+
+inline uint32_t chunkLodForDistance(float distance) {
+    uint32_t lod = 0;
+    while (lod < MAX_CHUNK_LOD && distance > CHUNK_LOD_DISTANCES[lod]) {
+        lod++;
+    }
+    return lod;
+}
+
+inline uint32_t chunkLodForDistance(float distance, uint32_t currentLod) {
+    if (currentLod >= chunkLodForDistance(distance - CHUNK_LOD_HYSTERESIS) &&
+        currentLod <= chunkLodForDistance(distance + CHUNK_LOD_HYSTERESIS)) {
+        return currentLod;
+    }
+    return chunkLodForDistance(distance);
+}
+
+struct LodMip {
+    uint32_t level = 0;
+    int size = 0;                   // Cells per axis
+    std::vector<uint16_t> materials; // x + y * size + z * size * size, 0 = air
+
+    LodMip() = default;
+    LodMip(uint32_t mipLevel, int cellsPerAxis)
+        : level(mipLevel), size(cellsPerAxis), materials(size_t(cellsPerAxis) * cellsPerAxis * cellsPerAxis, 0) {}
+
+    uint16_t at(int x, int y, int z) const {
+        return materials[x + y * size + z * size * size];
+    }
+
+    bool isSolid(int x, int y, int z) const {
+        return at(x, y, z) != 0;
+    }
+};
+
+inline LodMip downsampleLodMip(const LodMip& fine) {
+    LodMip coarse(fine.level + 1, fine.size / 2);
+
+    for (int z = 0; z < coarse.size; ++z) {
+        for (int y = 0; y < coarse.size; ++y) {
+            for (int x = 0; x < coarse.size; ++x) {
+                int solid = 0;
+                uint16_t top = 0;
+
+                // Top layer first, so the first solid child seen is the highest
+                for (int dz = 1; dz >= 0; --dz) {
+                    for (int dy = 0; dy < 2; ++dy) {
+                        for (int dx = 0; dx < 2; ++dx) {
+                            uint16_t material = fine.at(x * 2 + dx, y * 2 + dy, z * 2 + dz);
+                            if (material != 0) {
+                                solid++;
+                                if (top == 0) top = material;
+                            }
+                        }
+                    }
+                }
+
+                if (solid >= 4) {
+                    coarse.materials[x + y * coarse.size + z * coarse.size * coarse.size] = top;
+                }
+            }
+        }
+    }
+    return coarse;
+}
+
+#endif // CHUNK_LOD
@@ -0,0 +1,82 @@
+// ChunkOccupancy.h - Solid bits of a chunk and the brick mask over them
+//
+// One bit per voxel at x + y * 32 + z * 1024, plus one bit per 4x4x4 brick
+// and one per 8x8x8 region that holds any solid voxel. Kept apart from
+// ThreadSafeChunk so snapshot queries build without the renderer.
+#ifndef CHUNK_OCCUPANCY
+#define CHUNK_OCCUPANCY
+
+#include <array>
+#include <cstdint>
+
+namespace ChunkOccupancy {
+
+constexpr int CHUNK_SIZE = 32;
+constexpr int BYTES_NEEDED = CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE / 8;
+
+// 4x4x4 bricks, one occupancy bit each, for empty-space skipping
+constexpr int BRICK_SIZE = 4;
+constexpr int BRICKS_PER_AXIS = CHUNK_SIZE / BRICK_SIZE;
+constexpr int BRICK_MASK_WORDS = (BRICKS_PER_AXIS * BRICKS_PER_AXIS * BRICKS_PER_AXIS) / 64;
+
+// 8x8x8 regions of 2x2x2 bricks, 64 of them in one word
+constexpr int REGION_SIZE = 8;
+constexpr int REGIONS_PER_AXIS = CHUNK_SIZE / REGION_SIZE;
+
+// Immutable copy of the occupancy bits, shared with worker-side queries
+struct Snapshot {
+    std::array<uint8_t, BYTES_NEEDED> bits;
+    std::array<uint64_t, BRICK_MASK_WORDS> bricks;
+    uint64_t regions;
+    std::array<uint32_t, CHUNK_SIZE * CHUNK_SIZE> columns; // Bit z of column x + y * 32
+};
+
+inline int brickIndex(int x, int y, int z) {
+    return (x / BRICK_SIZE) + (y / BRICK_SIZE) * BRICKS_PER_AXIS + (z / BRICK_SIZE) * BRICKS_PER_AXIS * BRICKS_PER_AXIS;
+}
+
+inline int regionIndex(int x, int y, int z) {
+    return (x / REGION_SIZE) + (y / REGION_SIZE) * REGIONS_PER_AXIS + (z / REGION_SIZE) * REGIONS_PER_AXIS * REGIONS_PER_AXIS;
+}
+
+inline bool testVoxelBit(const uint8_t* bits, int x, int y, int z) {
+    int index = x + y * CHUNK_SIZE + z * CHUNK_SIZE * CHUNK_SIZE;
+    return (bits[index / 8] & (1 << (index % 8))) != 0;
+}
+
+inline bool testBrickBit(const uint64_t* bricks, int x, int y, int z) {
+    int brick = brickIndex(x, y, z);
+    return (bricks[brick / 64] & (uint64_t(1) << (brick % 64))) != 0;
+}
+
+inline bool testRegionBit(uint64_t regions, int x, int y, int z) {
+    return (regions >> regionIndex(x, y, z)) & 1;
+}
+
+// Whether any brick of the region around a voxel is occupied. A brick z
+// layer is one mask word, and a region's bricks sit at bits 0, 1, 8 and 9
+// from its first brick in the two words of its z range.
+inline bool regionHasSolidBricks(const uint64_t* bricks, int x, int y, int z) {
+    int brickZ = (z / REGION_SIZE) * 2;
+    int shift = (x / REGION_SIZE) * 2 + (y / REGION_SIZE) * 2 * BRICKS_PER_AXIS;
+    return (((bricks[brickZ] | bricks[brickZ + 1]) >> shift) & 0x303) != 0;
+}
+
+// Region mask rebuilt from a full brick mask
+inline uint64_t regionsFromBricks(const uint64_t* bricks) {
+    uint64_t regions = 0;
+    for (int z = 0; z < CHUNK_SIZE; z += REGION_SIZE) {
+        for (int y = 0; y < CHUNK_SIZE; y += REGION_SIZE) {
+            for (int x = 0; x < CHUNK_SIZE; x += REGION_SIZE) {
+                if (regionHasSolidBricks(bricks, x, y, z)) {
+                    regions |= uint64_t(1) << regionIndex(x, y, z);
+                }
+            }
+        }
+    }
+    return regions;
+}
+
+} // namespace ChunkOccupancy
+
+#endif // CHUNK_OCCUPANCY
@@ -0,0 +1,335 @@
+// ChunkTrace.h - Per-chunk pipeline latency tracing with Chrome trace export
+//
+// Records a timestamp at every chunk state change and a span for every worker
+// job into per-thread ring buffers. Writers never lock: each thread owns its
+// ring and only publishes a head index. Recording is off by default and costs
+// one relaxed load per call while off.
+//
+// Time spent in TerrainReady / TopsoilReady is the wait on neighbours, job
+// wait is time in the worker queue, and MeshReady is the wait for upload.
+#ifndef CHUNK_TRACE
+#define CHUNK_TRACE
+
+#include "glm/glm.hpp"
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <map>
+#include <unordered_map>
+#include <functional>
+#include <algorithm>
+#include <fstream>
+#include <ostream>
+#include <iomanip>
+#include <cstdint>
+#include <cstring>
+
+using glm::ivec3;
+
+struct ChunkTraceEvent {
+    enum Kind : uint8_t {
+        State, // name is the state entered
+        Job,   // name is the work type
+    };
+
+    uint64_t start = 0;    // Nanoseconds since the tracer epoch
+    uint64_t duration = 0; // Job run time
+    uint64_t wait = 0;     // Job time spent queued
+    const char* name = ""; // Static string
+    ivec3 chunk = ivec3(0);
+    uint32_t thread = 0;
+    Kind kind = State;
+};
+
+// Single writer ring. Old events are overwritten once it wraps.
+class ChunkTraceRing {
+public:
+    static constexpr uint64_t CAPACITY = 1 << 16;
+
+    explicit ChunkTraceRing(uint32_t threadIndex) : events(CAPACITY), thread(threadIndex) {}
+
+    void push(ChunkTraceEvent event) {
+        uint64_t index = head.load(std::memory_order_relaxed);
+        event.thread = thread;
+        events[index & (CAPACITY - 1)] = event;
+        head.store(index + 1, std::memory_order_release);
+    }
+
+    // Reader side. Events the writer lapped during the copy are discarded.
+    void copyTo(std::vector<ChunkTraceEvent>& out) const {
+        uint64_t end = head.load(std::memory_order_acquire);
+        uint64_t begin = std::max(end > CAPACITY ? end - CAPACITY : 0, tail.load(std::memory_order_relaxed));
+        size_t first = out.size();
+        for (uint64_t i = begin; i < end; ++i) {
+            out.push_back(events[i & (CAPACITY - 1)]);
+        }
+
+        uint64_t after = head.load(std::memory_order_acquire);
+        if (after > begin + CAPACITY) {
+            size_t torn = static_cast<size_t>(std::min(after - CAPACITY - begin, end - begin));
+            out.erase(out.begin() + first, out.begin() + first + torn);
+        }
+    }
+
+    void clear() {
+        tail.store(head.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+
+private:
+    std::vector<ChunkTraceEvent> events;
+    std::atomic<uint64_t> head{ 0 };
+    std::atomic<uint64_t> tail{ 0 };
+    uint32_t thread;
+};
+
+class ChunkTracer {
+public:
+    struct Percentiles {
+        size_t count = 0;
+        double p50 = 0.0; // Milliseconds
+        double p95 = 0.0;
+        double p99 = 0.0;
+    };
+
+    struct Summary {
+        std::map<std::string, Percentiles> stateTime; // Time spent in each state
+        std::map<std::string, Percentiles> jobRun;
+        std::map<std::string, Percentiles> jobWait;
+        Percentiles pipeline; // Empty until Active or Air
+        size_t events = 0;
+    };
+
+    static ChunkTracer& instance() {
+        static ChunkTracer tracer;
+        return tracer;
+    }
+
+    static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+    static void setEnabled(bool on) { enabled.store(on, std::memory_order_relaxed); }
+
+    static uint64_t now() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - epoch()).count());
+    }
+
+    void recordState(const ivec3& chunk, const char* state) {
+        ChunkTraceEvent event;
+        event.kind = ChunkTraceEvent::State;
+        event.start = now();
+        event.name = state;
+        event.chunk = chunk;
+        localRing().push(event);
+    }
+
+    void recordJob(const ivec3& chunk, const char* type, uint64_t queuedAt, uint64_t start, uint64_t end) {
+        ChunkTraceEvent event;
+        event.kind = ChunkTraceEvent::Job;
+        event.start = start;
+        event.duration = end > start ? end - start : 0;
+        event.wait = start > queuedAt ? start - queuedAt : 0;
+        event.name = type;
+        event.chunk = chunk;
+        localRing().push(event);
+    }
+
+    // Events from all threads, oldest first
+    std::vector<ChunkTraceEvent> collect() const {
+        std::vector<ChunkTraceEvent> events;
+        {
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            for (const auto& ring : rings) {
+                ring->copyTo(events);
+            }
+        }
+        std::stable_sort(events.begin(), events.end(),
+            [](const ChunkTraceEvent& a, const ChunkTraceEvent& b) { return a.start < b.start; });
+        return events;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        for (const auto& ring : rings) {
+            ring->clear();
+        }
+    }
+
+    Summary summarize() const {
+        std::vector<ChunkTraceEvent> events = collect();
+        std::map<std::string, std::vector<uint64_t>> stateTime, jobRun, jobWait;
+        std::vector<uint64_t> pipeline;
+
+        std::unordered_map<ivec3, std::vector<const ChunkTraceEvent*>, PositionHash> states;
+        for (const ChunkTraceEvent& event : events) {
+            if (event.kind == ChunkTraceEvent::Job) {
+                jobRun[event.name].push_back(event.duration);
+                jobWait[event.name].push_back(event.wait);
+            }
+            else {
+                states[event.chunk].push_back(&event);
+            }
+        }
+
+        for (const auto& pair : states) {
+            const std::vector<const ChunkTraceEvent*>& history = pair.second;
+            uint64_t created = 0;
+            bool pending = false;
+            for (size_t i = 0; i < history.size(); ++i) {
+                const char* name = history[i]->name;
+                // A chunk reloaded at the same position starts a new history
+                if (std::strcmp(name, "Empty") == 0) {
+                    created = history[i]->start;
+                    pending = true;
+                }
+                else if (pending && (std::strcmp(name, "Active") == 0 || std::strcmp(name, "Air") == 0)) {
+                    pipeline.push_back(history[i]->start - created);
+                    pending = false;
+                }
+
+                if (i + 1 < history.size() && std::strcmp(name, "Unloading") != 0) {
+                    stateTime[name].push_back(history[i + 1]->start - history[i]->start);
+                }
+            }
+        }
+
+        Summary summary;
+        summary.events = events.size();
+        for (auto& pair : stateTime) summary.stateTime[pair.first] = percentiles(pair.second);
+        for (auto& pair : jobRun) summary.jobRun[pair.first] = percentiles(pair.second);
+        for (auto& pair : jobWait) summary.jobWait[pair.first] = percentiles(pair.second);
+        summary.pipeline = percentiles(pipeline);
+        return summary;
+    }
+
+    void printSummary(std::ostream& out) const {
+        Summary summary = summarize();
+        out << "Chunk trace: " << summary.events << " events" << std::endl;
+        out << std::left << std::setw(28) << "span" << std::right << std::setw(9) << "count"
+            << std::setw(11) << "p50 ms" << std::setw(11) << "p95 ms" << std::setw(11) << "p99 ms" << std::endl;
+
+        auto row = [&out](const std::string& label, const Percentiles& p) {
+            out << std::left << std::setw(28) << label << std::right << std::setw(9) << p.count << std::fixed
+                << std::setprecision(3) << std::setw(11) << p.p50 << std::setw(11) << p.p95 << std::setw(11) << p.p99
+                << std::defaultfloat << std::endl;
+        };
+        for (const auto& pair : summary.stateTime) row("in " + pair.first, pair.second);
+        for (const auto& pair : summary.jobWait) row("queued " + pair.first, pair.second);
+        for (const auto& pair : summary.jobRun) row("run " + pair.first, pair.second);
+        row("pipeline Empty->Active", summary.pipeline);
+    }
+
+    // Chrome trace JSON (chrome://tracing, Perfetto). Jobs are spans on their
+    // worker thread, chunk states are async spans with one track per chunk.
+    bool writeChromeTrace(const std::string& path) const {
+        std::vector<ChunkTraceEvent> events = collect();
+        std::ofstream out(path);
+        if (!out) {
+            return false;
+        }
+
+        uint64_t origin = events.empty() ? 0 : events.front().start;
+        auto micros = [origin](uint64_t ns) { return static_cast<double>(ns - origin) / 1000.0; };
+        auto chunkId = [](const ivec3& p) {
+            return std::to_string(p.x) + "," + std::to_string(p.y) + "," + std::to_string(p.z);
+        };
+
+        out << std::fixed << std::setprecision(3);
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        auto separator = [&out, &first]() {
+            if (!first) out << ",\n";
+            first = false;
+        };
+
+        std::unordered_map<ivec3, const ChunkTraceEvent*, PositionHash> openState;
+        for (const ChunkTraceEvent& event : events) {
+            if (event.kind == ChunkTraceEvent::Job) {
+                separator();
+                out << "{\"name\":\"" << event.name << "\",\"cat\":\"job\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+                    << ",\"ts\":" << micros(event.start) << ",\"dur\":" << event.duration / 1000.0
+                    << ",\"args\":{\"chunk\":\"" << chunkId(event.chunk) << "\",\"wait_ms\":" << event.wait / 1e6 << "}}";
+                continue;
+            }
+
+            auto it = openState.find(event.chunk);
+            if (it != openState.end()) {
+                separator();
+                out << "{\"name\":\"" << it->second->name << "\",\"cat\":\"chunk\",\"ph\":\"e\",\"pid\":1,\"tid\":0,\"id\":\""
+                    << chunkId(event.chunk) << "\",\"ts\":" << micros(event.start) << "}";
+            }
+            separator();
+            out << "{\"name\":\"" << event.name << "\",\"cat\":\"chunk\",\"ph\":\"b\",\"pid\":1,\"tid\":0,\"id\":\""
+                << chunkId(event.chunk) << "\",\"ts\":" << micros(event.start) << "}";
+            openState[event.chunk] = &event;
+        }
+
+        // Close states still open at export time
+        uint64_t end = events.empty() ? 0 : events.back().start + events.back().duration;
+        for (const auto& pair : openState) {
+            separator();
+            out << "{\"name\":\"" << pair.second->name << "\",\"cat\":\"chunk\",\"ph\":\"e\",\"pid\":1,\"tid\":0,\"id\":\""
+                << chunkId(pair.first) << "\",\"ts\":" << micros(end) << "}";
+        }
+
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        for (uint32_t i = 0; i < rings.size(); ++i) {
+            separator();
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i + 1
+                << ",\"args\":{\"name\":\"thread " << i + 1 << "\"}}";
+        }
+        out << "\n]}\n";
+        return static_cast<bool>(out);
+    }
+
+private:
+    struct PositionHash {
+        std::size_t operator()(const ivec3& p) const {
+            return std::hash<int64_t>{}((int64_t(p.x) * 73856093) ^ (int64_t(p.y) * 19349663) ^ (int64_t(p.z) * 83492791));
+        }
+    };
+
+    static inline std::atomic<bool> enabled{ false };
+
+    mutable std::mutex ringsMutex;
+    std::vector<std::unique_ptr<ChunkTraceRing>> rings;
+
+    ChunkTracer() = default;
+
+    static std::chrono::steady_clock::time_point epoch() {
+        static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        return start;
+    }
+
+    // Rings outlive their threads so a finished thread's events still export.
+    // Thread 0 in the trace is the chunk state track.
+    ChunkTraceRing& localRing() {
+        thread_local ChunkTraceRing* ring = nullptr;
+        if (!ring) {
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            rings.push_back(std::make_unique<ChunkTraceRing>(static_cast<uint32_t>(rings.size() + 1)));
+            ring = rings.back().get();
+        }
+        return *ring;
+    }
+
+    static Percentiles percentiles(std::vector<uint64_t>& values) {
+        Percentiles result;
+        result.count = values.size();
+        if (values.empty()) {
+            return result;
+        }
+        std::sort(values.begin(), values.end());
+        auto rank = [&values](double q) {
+            size_t index = static_cast<size_t>(q * (values.size() - 1) + 0.5);
+            return values[std::min(index, values.size() - 1)] / 1e6;
+        };
+        result.p50 = rank(0.50);
+        result.p95 = rank(0.95);
+        result.p99 = rank(0.99);
+        return result;
+    }
+};
+
+#endif // CHUNK_TRACE
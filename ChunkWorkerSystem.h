@@ -1,14 +1,19 @@
 // ChunkWorkerSystem.h - Fixed version to reduce stuttering
 #include <thread>
 #include <queue>
+#include <vector>
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
 #include <functional>
+#include <array>
+#include <chrono>
+#include <algorithm>
 #include "glm/glm.hpp"
 #include "ThreadSafeChunk.h"
 
 using glm::ivec3;
+using glm::vec3;
 
 struct ChunkWorkItem {
     enum Type {
@@ -16,13 +21,18 @@ struct ChunkWorkItem {
         GenerateMesh,
         GenerateTopsoil,
         RegenerateMesh,
+        Task,
     };
+    static constexpr int TYPE_COUNT = Task + 1;
 
     Type type;
     std::shared_ptr<ThreadSafeChunk> chunk;
     ivec3 position;
     std::array<std::shared_ptr<ThreadSafeChunk>, 6> neighbors;
     int priority; // NEW: Priority level (higher = more urgent)
+    float rank = 0.0f; // Heap key from priority and the current focus, see ChunkWorkerSystem::rankFor
+    std::function<void()> task; // Only for Task items
+    uint64_t queuedAt = ChunkTracer::isEnabled() ? ChunkTracer::now() : 0;
 
     ChunkWorkItem(Type t, std::shared_ptr<ThreadSafeChunk> c, ivec3 pos, int prio = 0)
         : type(t), chunk(c), position(pos), neighbors{}, priority(prio) {
@@ -33,8 +43,28 @@ struct ChunkWorkItem {
         : type(t), chunk(c), position(pos), neighbors(neighs), priority(prio) {
     }
 
+    ChunkWorkItem(std::function<void()> fn, int prio)
+        : type(Task), chunk(nullptr), position(0), neighbors{}, priority(prio), task(std::move(fn)) {
+    }
+
     bool operator<(const ChunkWorkItem& other) const {
-        return priority < other.priority;
+        return rank < other.rank;
+    }
+
+    // Work for a chunk that has left the window
+    bool isCancelled() const {
+        return chunk && chunk->isCancelled();
+    }
+
+    static const char* typeName(Type type) {
+        switch (type) {
+        case GenerateTerrain: return "terrain";
+        case GenerateMesh: return "mesh";
+        case GenerateTopsoil: return "topsoil";
+        case RegenerateMesh: return "remesh";
+        case Task: return "task";
+        }
+        return "unknown";
     }
 
 };
@@ -43,19 +73,47 @@ class ChunkWorkerSystem {
 private:
     std::vector<std::thread> workers;
 
-    std::priority_queue<ChunkWorkItem> workQueue;
+    // Max-heap on ChunkWorkItem::rank, kept as a vector so it can be re-keyed
+    // in place when the focus moves
+    std::vector<ChunkWorkItem> workQueue;
     //std::queue<ChunkWorkItem> normalWorkQueue;
 
+    // Camera position in chunk units and view direction the ranks were
+    // computed for. Guarded by queueMutex.
+    vec3 focusChunk = vec3(0.0f);
+    vec3 focusDirection = vec3(0.0f);
+
     mutable std::mutex queueMutex;
     std::condition_variable queueCondition;
     std::atomic<bool> shouldStop{ false };
 
+    // Counters for headless profiling; cheap enough to keep on in the app
+    std::array<std::atomic<uint64_t>, ChunkWorkItem::TYPE_COUNT> completedItems{};
+    std::array<std::atomic<uint64_t>, ChunkWorkItem::TYPE_COUNT> busyNanoseconds{};
+    std::atomic<uint64_t> droppedItems{ 0 };
+    std::atomic<uint64_t> cancelledItems{ 0 };
+
+    // Terrain jobs also do topsoil from a halo instead of waiting on neighbours
+    std::atomic<bool> fusedTopsoil{ true };
+    size_t peakQueueSize = 0; // Guarded by queueMutex
+
     static constexpr int NUM_WORKER_THREADS = 8;
     static constexpr size_t MAX_QUEUE_SIZE = 10000;
+
+    // One priority step (HIGH over NORMAL) is worth this many chunks of distance
+    static constexpr float RANK_PER_PRIORITY = 4.0f / 100.0f;
+    // Work straight behind the camera ranks as if it were this much farther
+    static constexpr float BEHIND_DISTANCE_SCALE = 2.0f;
+    // Re-key the queue after the focus moves this many chunks or turns this far
+    static constexpr float REKEY_DISTANCE = 1.0f;
+    static constexpr float REKEY_COS_ANGLE = 0.94f; // About 20 degrees
+    static constexpr float MIN_DIRECTION_LENGTH = 1e-4f;
+
+public:
+    static constexpr int URGENT_PRIORITY = 200; // Work the player is waiting on (edit relight)
     static constexpr int HIGH_PRIORITY = 100;
     static constexpr int NORMAL_PRIORITY = 0;
 
-public:
     ChunkWorkerSystem() {
         // Create worker threads
         for (int i = 0; i < NUM_WORKER_THREADS; ++i) {
@@ -77,6 +135,19 @@ public:
             }
         }
         workers.clear();
+
+        // Run leftover generic tasks so nothing waiting on them hangs. They
+        // run unlocked: a task may queue more work, which queueTask refuses now.
+        std::vector<ChunkWorkItem> leftover;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            leftover.swap(workQueue);
+        }
+        for (ChunkWorkItem& item : leftover) {
+            if (item.type == ChunkWorkItem::Task && item.task) {
+                item.task();
+            }
+        }
     }
 
     void queueMeshRegeneration(std::shared_ptr<ThreadSafeChunk> chunk, ivec3 position,
@@ -86,9 +157,10 @@ public:
         {
             std::lock_guard<std::mutex> lock(queueMutex);
             if (workQueue.size() >= MAX_QUEUE_SIZE) {
+                droppedItems.fetch_add(1); // Not retried: the chunk stays in its current state
                 return;
             }
-            workQueue.emplace(ChunkWorkItem::RegenerateMesh, chunk, position, neighbors, HIGH_PRIORITY);
+            pushLocked(ChunkWorkItem(ChunkWorkItem::RegenerateMesh, chunk, position, neighbors, HIGH_PRIORITY));
         }
         queueCondition.notify_all();
     }
@@ -99,10 +171,11 @@ public:
         {
             std::lock_guard<std::mutex> lock(queueMutex);
             if (workQueue.size() >= MAX_QUEUE_SIZE) {
+                droppedItems.fetch_add(1); // Not retried: the chunk stays in its current state
                 return;
             }
 
-            workQueue.emplace(ChunkWorkItem::GenerateTerrain, chunk, position, NORMAL_PRIORITY);
+            pushLocked(ChunkWorkItem(ChunkWorkItem::GenerateTerrain, chunk, position, NORMAL_PRIORITY));
         }
         queueCondition.notify_one();
     }
@@ -114,9 +187,10 @@ public:
         {
             std::lock_guard<std::mutex> lock(queueMutex);
             if (workQueue.size() >= MAX_QUEUE_SIZE) {
+                droppedItems.fetch_add(1); // Not retried: the chunk stays in its current state
                 return;
             }
-            workQueue.emplace(ChunkWorkItem::GenerateTopsoil, chunk, position, neighbors, HIGH_PRIORITY);
+            pushLocked(ChunkWorkItem(ChunkWorkItem::GenerateTopsoil, chunk, position, neighbors, HIGH_PRIORITY));
         }
         queueCondition.notify_one();
     }
@@ -128,11 +202,64 @@ public:
         {
             std::lock_guard<std::mutex> lock(queueMutex);
             if (workQueue.size() >= MAX_QUEUE_SIZE) {
+                droppedItems.fetch_add(1); // Not retried: the chunk stays in its current state
                 return;
             }
-            workQueue.emplace(ChunkWorkItem::GenerateMesh, chunk, position, neighbors, HIGH_PRIORITY);
+            pushLocked(ChunkWorkItem(ChunkWorkItem::GenerateMesh, chunk, position, neighbors, HIGH_PRIORITY));
+        }
+        queueCondition.notify_one();
+    }
+
+    // Generic job for non-chunk work (ray batches etc). Returns false if the
+    // queue is full or shutting down so the caller can run it inline instead.
+    bool queueTask(std::function<void()> task, int priority = HIGH_PRIORITY) {
+        if (!task || shouldStop.load()) return false;
+
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            if (workQueue.size() >= MAX_QUEUE_SIZE) {
+                return false;
+            }
+            pushLocked(ChunkWorkItem(std::move(task), priority));
         }
         queueCondition.notify_one();
+        return true;
+    }
+
+    // Called every chunk update with the camera position in voxels and its
+    // view direction. Once the camera has moved or turned far enough, queued
+    // work is re-ranked for the new focus and cancelled work is dropped. A
+    // zero direction keeps the last one rather than counting as a turn.
+    void setFocus(vec3 cameraPos, vec3 viewDirection) {
+        vec3 chunk = cameraPos / 32.0f;
+        bool hasDirection = glm::length(viewDirection) > MIN_DIRECTION_LENGTH;
+        vec3 direction = hasDirection ? glm::normalize(viewDirection) : vec3(0.0f);
+
+        std::lock_guard<std::mutex> lock(queueMutex);
+        bool moved = glm::length(chunk - focusChunk) >= REKEY_DISTANCE;
+        bool turned = hasDirection && glm::dot(direction, focusDirection) < REKEY_COS_ANGLE;
+        if (!moved && !turned) {
+            return;
+        }
+
+        focusChunk = chunk;
+        if (hasDirection) {
+            focusDirection = direction;
+        }
+
+        size_t before = workQueue.size();
+        workQueue.erase(std::remove_if(workQueue.begin(), workQueue.end(),
+            [](const ChunkWorkItem& item) { return item.isCancelled(); }), workQueue.end());
+        cancelledItems.fetch_add(before - workQueue.size());
+
+        for (ChunkWorkItem& item : workQueue) {
+            item.rank = rankFor(item);
+        }
+        std::make_heap(workQueue.begin(), workQueue.end());
+    }
+
+    void setFusedTopsoil(bool fused) {
+        fusedTopsoil.store(fused);
     }
 
     size_t getQueueSize() const {
@@ -140,7 +267,54 @@ public:
         return workQueue.size();
     }
 
+    struct Stats {
+        std::array<uint64_t, ChunkWorkItem::TYPE_COUNT> completed{}; // Indexed by ChunkWorkItem::Type
+        std::array<uint64_t, ChunkWorkItem::TYPE_COUNT> busyNanoseconds{};
+        uint64_t dropped = 0; // Chunk work refused at MAX_QUEUE_SIZE
+        uint64_t cancelled = 0; // Chunk work skipped because the chunk was unloaded
+        size_t queueSize = 0;
+        size_t peakQueueSize = 0;
+    };
+
+    Stats getStats() const {
+        Stats stats;
+        for (int i = 0; i < ChunkWorkItem::TYPE_COUNT; ++i) {
+            stats.completed[i] = completedItems[i].load();
+            stats.busyNanoseconds[i] = busyNanoseconds[i].load();
+        }
+        stats.dropped = droppedItems.load();
+        stats.cancelled = cancelledItems.load();
+
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stats.queueSize = workQueue.size();
+        stats.peakQueueSize = peakQueueSize;
+        return stats;
+    }
+
 private:
+    // Higher runs first. Chunk work loses rank with distance from the focus,
+    // more so behind the camera; generic tasks rank on priority alone.
+    float rankFor(const ChunkWorkItem& item) const {
+        float rank = item.priority * RANK_PER_PRIORITY;
+        if (item.type == ChunkWorkItem::Task) {
+            return rank;
+        }
+
+        vec3 offset = vec3(item.position) - focusChunk;
+        float distance = glm::length(offset);
+        float facing = distance > 0.0f ? glm::dot(offset / distance, focusDirection) : 1.0f;
+        float behind = 0.5f * (1.0f - facing); // 0 ahead, 1 straight behind
+        return rank - distance * (1.0f + (BEHIND_DISTANCE_SCALE - 1.0f) * behind);
+    }
+
+    // Needs queueMutex
+    void pushLocked(ChunkWorkItem item) {
+        item.rank = rankFor(item);
+        workQueue.push_back(std::move(item));
+        std::push_heap(workQueue.begin(), workQueue.end());
+        peakQueueSize = std::max(peakQueueSize, workQueue.size());
+    }
+
     void workerThreadFunction() {
         while (!shouldStop.load()) {
             ChunkWorkItem workItem{ ChunkWorkItem::GenerateTerrain, nullptr, ivec3(0) };
@@ -155,15 +329,34 @@ private:
                         break;
                     }
 
-                    if (!workQueue.empty()) {
-                        workItem = workQueue.top();
-                        workQueue.pop();
-                        hasWork = true;
+                    // Cancelled work is dropped as it surfaces
+                    while (!workQueue.empty()) {
+                        std::pop_heap(workQueue.begin(), workQueue.end());
+                        workItem = std::move(workQueue.back());
+                        workQueue.pop_back();
+                        if (!workItem.isCancelled()) {
+                            hasWork = true;
+                            break;
+                        }
+                        cancelledItems.fetch_add(1);
                     }
                 }
             }
 
-            if (hasWork && workItem.chunk) {
+            if (!hasWork) {
+                continue;
+            }
+            auto workStart = std::chrono::steady_clock::now();
+
+            if (workItem.type == ChunkWorkItem::Task) {
+                try {
+                    workItem.task();
+                }
+                catch (const std::exception& e) {
+                    std::cerr << "Worker task error: " << e.what() << std::endl;
+                }
+            }
+            else if (workItem.chunk) {
                 try {
                     switch (workItem.type) {
                     case ChunkWorkItem::GenerateTerrain:
@@ -176,12 +369,25 @@ private:
                     case ChunkWorkItem::RegenerateMesh:
                         processMeshGeneration(workItem);
                         break;
+                    case ChunkWorkItem::Task:
+                        break;
                     }
                 }
                 catch (const std::exception& e) {
                     std::cerr << "Worker thread error: " << e.what() << std::endl;
                 }
             }
+
+            auto workNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - workStart).count();
+            completedItems[workItem.type].fetch_add(1);
+            busyNanoseconds[workItem.type].fetch_add(static_cast<uint64_t>(workNanoseconds));
+
+            if (ChunkTracer::isEnabled() && workItem.queuedAt) {
+                uint64_t end = ChunkTracer::now();
+                ChunkTracer::instance().recordJob(workItem.position, ChunkWorkItem::typeName(workItem.type),
+                    workItem.queuedAt, end - static_cast<uint64_t>(workNanoseconds), end);
+            }
         }
     }
 
@@ -200,7 +406,12 @@ private:
                 return;
             }*/
 
-            workItem.chunk->generateTerrain();
+            if (fusedTopsoil.load(std::memory_order_relaxed)) {
+                workItem.chunk->generateTerrainWithTopsoil();
+            }
+            else {
+                workItem.chunk->generateTerrain();
+            }
         }
         catch (const std::exception& e) {
             std::cerr << "Terrain generation error: " << e.what() << std::endl;
@@ -251,16 +462,30 @@ private:
                 return;
             }*/
 
+            // An in-place remesh is dropped if the chunk was evicted or an
+            // edit already meshed it again
+            if (workItem.type == ChunkWorkItem::RegenerateMesh && !workItem.chunk->isRemeshingInPlace()) {
+                if (workItem.chunk->getState() != ChunkState::Active) {
+                    workItem.chunk->finishRemesh();
+                }
+                return;
+            }
+
             if (workItem.chunk->getSolidVoxels() == 0) {
-                workItem.chunk->setState(ChunkState::MeshReady);
+                workItem.chunk->markMeshReady();
                 return;
             }
 
-            workItem.chunk->generateMesh(workItem.neighbors);
+            if (!workItem.chunk->generateMesh(workItem.neighbors) && workItem.chunk->isRemeshingInPlace()) {
+                workItem.chunk->finishRemesh(); // Keeps drawing the old mesh
+            }
         }
         catch (const std::exception& e) {
             std::cerr << "Mesh generation error: " << e.what() << std::endl;
-            if (workItem.chunk && workItem.chunk->getState() != ChunkState::Unloading) {
+            if (workItem.chunk && workItem.chunk->isRemeshingInPlace()) {
+                workItem.chunk->finishRemesh(); // Keeps drawing the old mesh
+            }
+            else if (workItem.chunk && workItem.chunk->getState() != ChunkState::Unloading) {
                 workItem.chunk->setState(ChunkState::MeshReady);
             }
         }
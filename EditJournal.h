@@ -0,0 +1,662 @@
+#ifndef EDIT_JOURNAL
+#define EDIT_JOURNAL
+
+// EditJournal.h - Write-ahead log for player voxel edits
+//
+// Edits are appended to an in-memory batch on the main thread and written to
+// an append-only journal by a background thread that fsyncs once per group.
+// The same thread periodically folds the durable records into per-region files
+// and truncates the journal. On startup the journal is replayed over the
+// region data, so only records newer than a chunk's region entry are applied.
+#include "glm/glm.hpp"
+#include <algorithm>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+using glm::ivec3;
+
+struct VoxelEditRecord {
+    uint64_t sequence;
+    ivec3 worldPosition;
+    uint16_t oldMaterial;
+    uint16_t newMaterial;
+};
+
+// A single voxel override inside a chunk, as replayed into freshly generated chunks
+struct ChunkVoxelEdit {
+    uint16_t voxelIndex;  // x + y * 32 + z * 32 * 32
+    uint16_t material;    // 0 = air
+};
+
+class EditJournal {
+private:
+    static constexpr int CHUNK_SIZE = 32;
+    static constexpr int REGION_SIZE = 8; // Chunks per region along each axis
+    static constexpr uint32_t REGION_MAGIC = 0x47525856; // "VXRG"
+    static constexpr uint32_t REGION_VERSION = 1;
+    static constexpr size_t RECORD_SIZE = 32;
+    static constexpr auto GROUP_COMMIT_INTERVAL = std::chrono::milliseconds(50);
+    static constexpr auto COMPACTION_INTERVAL = std::chrono::seconds(30);
+    static constexpr size_t COMPACTION_THRESHOLD = 4096; // Records
+
+    struct IVec3KeyHash {
+        std::size_t operator()(const ivec3& k) const {
+            return std::hash<int>{}(k.x) ^ (std::hash<int>{}(k.y) << 1) ^ (std::hash<int>{}(k.z) << 2);
+        }
+    };
+
+    struct VoxelOverride {
+        uint16_t material;
+        uint64_t sequence;
+    };
+
+    struct ChunkOverlay {
+        std::unordered_map<uint16_t, VoxelOverride> voxels;
+        uint64_t lastSequence = 0;
+    };
+
+    std::filesystem::path worldDirectory;
+    std::FILE* journalFile = nullptr; // Writer thread; null after a failed write until reopened
+    uint64_t journalBytes = 0;        // Writer thread; journal length up to the last synced group
+
+    // Main thread -> writer thread hand-off, kept tiny so commits stay cheap
+    std::vector<VoxelEditRecord> pendingRecords;
+    std::mutex pendingMutex;
+    std::condition_variable pendingCondition;
+
+    // Durable records not yet folded into region files (writer thread only)
+    std::vector<VoxelEditRecord> uncompactedRecords;
+    std::chrono::steady_clock::time_point lastCompaction;
+
+    // In-memory view of all known edits, used to replay into regenerated chunks
+    std::unordered_map<ivec3, ChunkOverlay, IVec3KeyHash> overlay;
+    std::unordered_map<ivec3, bool, IVec3KeyHash> loadedRegions;
+    // Chunks with entries in a region file, from the headers read at open.
+    // Chunks in neither this nor the overlay have no edits and skip disk.
+    std::unordered_set<ivec3, IVec3KeyHash> chunksOnDisk;
+    mutable std::mutex overlayMutex;
+
+    std::atomic<uint64_t> nextSequence{ 1 };
+    std::atomic<uint64_t> durableSequence{ 0 };
+    std::atomic<uint64_t> writeFailures{ 0 };
+    std::atomic<bool> shouldStop{ false };
+    std::thread writerThread;
+    bool isOpen = false;
+
+public:
+    EditJournal() = default;
+
+    ~EditJournal() {
+        close();
+    }
+
+    bool open(const std::filesystem::path& directory) {
+        if (isOpen) return true;
+
+        worldDirectory = directory;
+        std::error_code ec;
+        std::filesystem::create_directories(worldDirectory / "regions", ec);
+        if (ec) {
+            std::cerr << "Failed to create world directory: " << ec.message() << std::endl;
+            return false;
+        }
+
+        // Compaction truncates the journal, the folded sequences live on in
+        // the region files and new edits must number past them
+        uint64_t regionSequence = scanRegions();
+        nextSequence.store(std::max(nextSequence.load(), regionSequence + 1));
+        durableSequence.store(std::max(durableSequence.load(), regionSequence));
+
+        journalBytes = replayJournal();
+        discardUnsyncedTail(); // A torn record from a crash would hide everything after it
+
+        journalFile = std::fopen(journalPath().string().c_str(), "ab");
+        if (!journalFile) {
+            std::cerr << "Failed to open edit journal: " << journalPath() << std::endl;
+            return false;
+        }
+
+        lastCompaction = std::chrono::steady_clock::now();
+        shouldStop.store(false);
+        writerThread = std::thread(&EditJournal::writerThreadFunction, this);
+        isOpen = true;
+        return true;
+    }
+
+    void close() {
+        if (!isOpen) return;
+
+        shouldStop.store(true);
+        pendingCondition.notify_all();
+        if (writerThread.joinable()) {
+            writerThread.join();
+        }
+
+        if (journalFile) {
+            std::fclose(journalFile);
+            journalFile = nullptr;
+        }
+        isOpen = false;
+    }
+
+    // Main thread: record an edit. Only touches two small mutex-protected
+    // containers; all I/O happens on the writer thread.
+    uint64_t recordEdit(const ivec3& worldPosition, uint16_t oldMaterial, uint16_t newMaterial) {
+        VoxelEditRecord record;
+        record.sequence = nextSequence.fetch_add(1);
+        record.worldPosition = worldPosition;
+        record.oldMaterial = oldMaterial;
+        record.newMaterial = newMaterial;
+
+        applyToOverlay(record);
+
+        {
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            pendingRecords.push_back(record);
+        }
+        return record.sequence;
+    }
+
+    // Worker/chunk thread: all edits known for a chunk, loading its region on
+    // first use. Chunks never edited return without touching the disk.
+    std::vector<ChunkVoxelEdit> getChunkEdits(const ivec3& chunkPos) {
+        std::vector<ChunkVoxelEdit> edits;
+        {
+            std::lock_guard<std::mutex> lock(overlayMutex);
+            if (!chunksOnDisk.count(chunkPos) && !overlay.count(chunkPos)) {
+                return edits;
+            }
+        }
+        ensureRegionLoaded(regionOf(chunkPos));
+
+        std::lock_guard<std::mutex> lock(overlayMutex);
+        auto it = overlay.find(chunkPos);
+        if (it == overlay.end()) {
+            return edits;
+        }
+
+        edits.reserve(it->second.voxels.size());
+        for (const auto& pair : it->second.voxels) {
+            edits.push_back({ pair.first, pair.second.material });
+        }
+        return edits;
+    }
+
+    uint64_t getDurableSequence() const { return durableSequence.load(); }
+
+    // Block until every edit recorded so far has been fsynced. Returns false
+    // if the journal is closed or a write fails first; the writer keeps
+    // retrying the failed group either way.
+    bool flush() {
+        uint64_t target = nextSequence.load() - 1;
+        uint64_t failures = writeFailures.load();
+        pendingCondition.notify_all();
+        while (durableSequence.load() < target) {
+            if (!isOpen || writeFailures.load() != failures) {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+
+    static ivec3 chunkOf(const ivec3& worldPosition) {
+        return ivec3(floorDiv(worldPosition.x, CHUNK_SIZE), floorDiv(worldPosition.y, CHUNK_SIZE), floorDiv(worldPosition.z, CHUNK_SIZE));
+    }
+
+private:
+    static int floorDiv(int a, int b) {
+        return (a >= 0) ? a / b : (a - b + 1) / b;
+    }
+
+    static ivec3 regionOf(const ivec3& chunkPos) {
+        return ivec3(floorDiv(chunkPos.x, REGION_SIZE), floorDiv(chunkPos.y, REGION_SIZE), floorDiv(chunkPos.z, REGION_SIZE));
+    }
+
+    static uint16_t localVoxelIndex(const ivec3& worldPosition, const ivec3& chunkPos) {
+        ivec3 local = worldPosition - chunkPos * CHUNK_SIZE;
+        return static_cast<uint16_t>(local.x + local.y * CHUNK_SIZE + local.z * CHUNK_SIZE * CHUNK_SIZE);
+    }
+
+    std::filesystem::path journalPath() const {
+        return worldDirectory / "edits.journal";
+    }
+
+    std::filesystem::path regionPath(const ivec3& region) const {
+        return worldDirectory / "regions" / ("r." + std::to_string(region.x) + "." + std::to_string(region.y) + "." + std::to_string(region.z) + ".region");
+    }
+
+    static uint32_t checksum(const uint8_t* data, size_t size) {
+        // FNV-1a, enough to reject torn records at the journal tail
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= data[i];
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    static void encodeRecord(const VoxelEditRecord& record, uint8_t* out) {
+        std::memset(out, 0, RECORD_SIZE);
+        std::memcpy(out + 0, &record.sequence, 8);
+        std::memcpy(out + 8, &record.worldPosition.x, 4);
+        std::memcpy(out + 12, &record.worldPosition.y, 4);
+        std::memcpy(out + 16, &record.worldPosition.z, 4);
+        std::memcpy(out + 20, &record.oldMaterial, 2);
+        std::memcpy(out + 22, &record.newMaterial, 2);
+        uint32_t sum = checksum(out, 24);
+        std::memcpy(out + 24, &sum, 4);
+    }
+
+    static bool decodeRecord(const uint8_t* in, VoxelEditRecord& record) {
+        uint32_t storedSum;
+        std::memcpy(&storedSum, in + 24, 4);
+        if (storedSum != checksum(in, 24)) {
+            return false;
+        }
+        std::memcpy(&record.sequence, in + 0, 8);
+        std::memcpy(&record.worldPosition.x, in + 8, 4);
+        std::memcpy(&record.worldPosition.y, in + 12, 4);
+        std::memcpy(&record.worldPosition.z, in + 16, 4);
+        std::memcpy(&record.oldMaterial, in + 20, 2);
+        std::memcpy(&record.newMaterial, in + 22, 2);
+        return record.sequence != 0;
+    }
+
+    static bool syncFile(std::FILE* file) {
+        if (std::fflush(file) != 0) return false;
+#ifdef _WIN32
+        return _commit(_fileno(file)) == 0;
+#else
+        return fsync(fileno(file)) == 0;
+#endif
+    }
+
+    void applyToOverlay(const VoxelEditRecord& record) {
+        ivec3 chunkPos = chunkOf(record.worldPosition);
+        uint16_t index = localVoxelIndex(record.worldPosition, chunkPos);
+
+        std::lock_guard<std::mutex> lock(overlayMutex);
+        ChunkOverlay& chunkOverlay = overlay[chunkPos];
+        auto it = chunkOverlay.voxels.find(index);
+        if (it == chunkOverlay.voxels.end() || it->second.sequence < record.sequence) {
+            chunkOverlay.voxels[index] = { record.newMaterial, record.sequence };
+        }
+        chunkOverlay.lastSequence = std::max(chunkOverlay.lastSequence, record.sequence);
+    }
+
+    // Startup: read every intact journal record. Records older than the
+    // region entry of their chunk are already folded and are skipped.
+    // Returns the length of the intact part.
+    uint64_t replayJournal() {
+        std::ifstream file(journalPath(), std::ios::binary);
+        if (!file.is_open()) {
+            return 0;
+        }
+
+        uint64_t maxSequence = 0;
+        uint64_t intactBytes = 0;
+        size_t replayed = 0;
+        uint8_t buffer[RECORD_SIZE];
+        while (file.read(reinterpret_cast<char*>(buffer), RECORD_SIZE)) {
+            VoxelEditRecord record;
+            if (!decodeRecord(buffer, record)) {
+                break; // Torn tail from a crash mid-write
+            }
+            intactBytes += RECORD_SIZE;
+            maxSequence = std::max(maxSequence, record.sequence);
+
+            ivec3 chunkPos = chunkOf(record.worldPosition);
+            ensureRegionLoaded(regionOf(chunkPos));
+
+            bool newerThanRegion = true;
+            {
+                std::lock_guard<std::mutex> lock(overlayMutex);
+                auto it = overlay.find(chunkPos);
+                if (it != overlay.end() && it->second.lastSequence >= record.sequence) {
+                    newerThanRegion = false;
+                }
+            }
+
+            if (newerThanRegion) {
+                applyToOverlay(record);
+                uncompactedRecords.push_back(record);
+                replayed++;
+            }
+        }
+
+        nextSequence.store(std::max(nextSequence.load(), maxSequence + 1));
+        durableSequence.store(std::max(durableSequence.load(), maxSequence));
+
+        if (replayed > 0) {
+            std::cout << "Edit journal: replayed " << replayed << " edits" << std::endl;
+        }
+        return intactBytes;
+    }
+
+    // Cut the journal back to journalBytes, dropping a partly written group
+    // so its retry doesn't follow a torn record. Closes the file; the next
+    // write reopens it.
+    void discardUnsyncedTail() {
+        if (journalFile) {
+            std::fclose(journalFile);
+            journalFile = nullptr;
+        }
+        std::error_code ec;
+        uint64_t size = std::filesystem::file_size(journalPath(), ec);
+        if (!ec && size > journalBytes) {
+            std::filesystem::resize_file(journalPath(), journalBytes, ec);
+            if (ec) {
+                std::cerr << "Failed to trim edit journal: " << ec.message() << std::endl;
+            }
+        }
+    }
+
+    // Writer thread: one write and one fsync for the whole group
+    bool writeGroup(const std::vector<uint8_t>& bytes) {
+        if (!journalFile) {
+            journalFile = std::fopen(journalPath().string().c_str(), "ab");
+            if (!journalFile) {
+                return false;
+            }
+        }
+        if (std::fwrite(bytes.data(), 1, bytes.size(), journalFile) != bytes.size()) {
+            return false;
+        }
+        return syncFile(journalFile);
+    }
+
+    void ensureRegionLoaded(const ivec3& region) {
+        {
+            std::lock_guard<std::mutex> lock(overlayMutex);
+            if (loadedRegions.count(region)) return;
+            loadedRegions[region] = true;
+        }
+
+        std::unordered_map<ivec3, ChunkOverlay, IVec3KeyHash> regionData;
+        if (!readRegion(region, regionData)) {
+            return;
+        }
+
+        // Merge without clobbering anything newer that is already in memory
+        std::lock_guard<std::mutex> lock(overlayMutex);
+        for (auto& pair : regionData) {
+            ChunkOverlay& target = overlay[pair.first];
+            for (const auto& voxel : pair.second.voxels) {
+                auto it = target.voxels.find(voxel.first);
+                if (it == target.voxels.end() || it->second.sequence < voxel.second.sequence) {
+                    target.voxels[voxel.first] = voxel.second;
+                }
+            }
+            target.lastSequence = std::max(target.lastSequence, pair.second.lastSequence);
+        }
+    }
+
+    // Startup: index the chunks stored in every region file and return the
+    // highest lastSequence among them. Reads only the chunk headers and seeks
+    // past the edits.
+    uint64_t scanRegions() {
+        uint64_t highest = 0;
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(worldDirectory / "regions", ec)) {
+            if (entry.path().extension() != ".region") continue;
+
+            ivec3 region;
+            if (std::sscanf(entry.path().filename().string().c_str(), "r.%d.%d.%d.region", &region.x, &region.y, &region.z) != 3) {
+                continue;
+            }
+
+            std::ifstream file(entry.path(), std::ios::binary);
+            uint32_t magic = 0, version = 0, chunkCount = 0;
+            file.read(reinterpret_cast<char*>(&magic), 4);
+            file.read(reinterpret_cast<char*>(&version), 4);
+            file.read(reinterpret_cast<char*>(&chunkCount), 4);
+            if (!file || magic != REGION_MAGIC || version != REGION_VERSION) continue;
+
+            for (uint32_t c = 0; c < chunkCount; ++c) {
+                uint16_t localChunk = 0, padding = 0;
+                uint64_t lastSequence = 0;
+                uint32_t editCount = 0;
+                file.read(reinterpret_cast<char*>(&localChunk), 2);
+                file.read(reinterpret_cast<char*>(&padding), 2);
+                file.read(reinterpret_cast<char*>(&lastSequence), 8);
+                file.read(reinterpret_cast<char*>(&editCount), 4);
+                if (!file) break;
+                highest = std::max(highest, lastSequence);
+                {
+                    std::lock_guard<std::mutex> lock(overlayMutex);
+                    chunksOnDisk.insert(region * REGION_SIZE + ivec3(
+                        localChunk % REGION_SIZE,
+                        (localChunk / REGION_SIZE) % REGION_SIZE,
+                        localChunk / (REGION_SIZE * REGION_SIZE)));
+                }
+                file.seekg(std::streamoff(editCount) * 4, std::ios::cur);
+            }
+        }
+        return highest;
+    }
+
+    bool readRegion(const ivec3& region, std::unordered_map<ivec3, ChunkOverlay, IVec3KeyHash>& out) const {
+        std::ifstream file(regionPath(region), std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        uint32_t magic = 0, version = 0, chunkCount = 0;
+        file.read(reinterpret_cast<char*>(&magic), 4);
+        file.read(reinterpret_cast<char*>(&version), 4);
+        file.read(reinterpret_cast<char*>(&chunkCount), 4);
+        if (!file || magic != REGION_MAGIC || version != REGION_VERSION) {
+            std::cerr << "Ignoring invalid region file " << regionPath(region) << std::endl;
+            return false;
+        }
+
+        for (uint32_t c = 0; c < chunkCount; ++c) {
+            uint16_t localChunk = 0, padding = 0;
+            uint64_t lastSequence = 0;
+            uint32_t editCount = 0;
+            file.read(reinterpret_cast<char*>(&localChunk), 2);
+            file.read(reinterpret_cast<char*>(&padding), 2);
+            file.read(reinterpret_cast<char*>(&lastSequence), 8);
+            file.read(reinterpret_cast<char*>(&editCount), 4);
+            if (!file) return false;
+
+            ivec3 chunkPos = region * REGION_SIZE + ivec3(
+                localChunk % REGION_SIZE,
+                (localChunk / REGION_SIZE) % REGION_SIZE,
+                localChunk / (REGION_SIZE * REGION_SIZE));
+
+            ChunkOverlay& chunkOverlay = out[chunkPos];
+            chunkOverlay.lastSequence = lastSequence;
+            for (uint32_t e = 0; e < editCount; ++e) {
+                uint16_t voxelIndex = 0, material = 0;
+                file.read(reinterpret_cast<char*>(&voxelIndex), 2);
+                file.read(reinterpret_cast<char*>(&material), 2);
+                if (!file) return false;
+                chunkOverlay.voxels[voxelIndex] = { material, lastSequence };
+            }
+        }
+        return true;
+    }
+
+    bool writeRegion(const ivec3& region, const std::unordered_map<ivec3, ChunkOverlay, IVec3KeyHash>& data) const {
+        std::filesystem::path finalPath = regionPath(region);
+        std::filesystem::path tempPath = finalPath;
+        tempPath += ".tmp";
+
+        std::FILE* file = std::fopen(tempPath.string().c_str(), "wb");
+        if (!file) {
+            return false;
+        }
+
+        uint32_t chunkCount = static_cast<uint32_t>(data.size());
+        std::fwrite(&REGION_MAGIC, 4, 1, file);
+        std::fwrite(&REGION_VERSION, 4, 1, file);
+        std::fwrite(&chunkCount, 4, 1, file);
+
+        for (const auto& pair : data) {
+            ivec3 local = pair.first - region * REGION_SIZE;
+            uint16_t localChunk = static_cast<uint16_t>(local.x + local.y * REGION_SIZE + local.z * REGION_SIZE * REGION_SIZE);
+            uint16_t padding = 0;
+            uint32_t editCount = static_cast<uint32_t>(pair.second.voxels.size());
+            std::fwrite(&localChunk, 2, 1, file);
+            std::fwrite(&padding, 2, 1, file);
+            std::fwrite(&pair.second.lastSequence, 8, 1, file);
+            std::fwrite(&editCount, 4, 1, file);
+            for (const auto& voxel : pair.second.voxels) {
+                std::fwrite(&voxel.first, 2, 1, file);
+                std::fwrite(&voxel.second.material, 2, 1, file);
+            }
+        }
+
+        bool ok = syncFile(file);
+        std::fclose(file);
+        if (!ok) {
+            return false;
+        }
+
+        // Atomic replace, so a crash leaves either the old or the new region
+        std::error_code ec;
+        std::filesystem::rename(tempPath, finalPath, ec);
+        return !ec;
+    }
+
+    void writerThreadFunction() {
+        std::vector<VoxelEditRecord> batch; // Stays filled after a failed write, retried with the next group
+        std::vector<VoxelEditRecord> incoming;
+        std::vector<uint8_t> bytes;
+        bool failing = false;
+
+        while (true) {
+            bool stopping = false;
+            {
+                std::unique_lock<std::mutex> lock(pendingMutex);
+                pendingCondition.wait_for(lock, GROUP_COMMIT_INTERVAL, [this] { return shouldStop.load(); });
+                stopping = shouldStop.load();
+                incoming.swap(pendingRecords);
+            }
+            batch.insert(batch.end(), incoming.begin(), incoming.end());
+            incoming.clear();
+
+            if (!batch.empty()) {
+                bytes.resize(batch.size() * RECORD_SIZE);
+                for (size_t i = 0; i < batch.size(); ++i) {
+                    encodeRecord(batch[i], bytes.data() + i * RECORD_SIZE);
+                }
+
+                if (writeGroup(bytes)) {
+                    journalBytes += bytes.size();
+                    durableSequence.store(batch.back().sequence);
+                    uncompactedRecords.insert(uncompactedRecords.end(), batch.begin(), batch.end());
+                    batch.clear();
+                    if (failing) {
+                        std::cerr << "Edit journal writes recovered" << std::endl;
+                        failing = false;
+                    }
+                }
+                else {
+                    if (!failing) {
+                        std::cerr << "Edit journal write failed, retrying" << std::endl;
+                        failing = true;
+                    }
+                    discardUnsyncedTail();
+                    writeFailures.fetch_add(1);
+                    if (stopping) {
+                        std::cerr << "Edit journal: " << batch.size() << " edits were not saved" << std::endl;
+                    }
+                }
+            }
+
+            bool compactionDue = uncompactedRecords.size() >= COMPACTION_THRESHOLD ||
+                (!uncompactedRecords.empty() && std::chrono::steady_clock::now() - lastCompaction >= COMPACTION_INTERVAL);
+            if (compactionDue || (stopping && !uncompactedRecords.empty())) {
+                compact();
+            }
+
+            if (stopping) {
+                break;
+            }
+        }
+    }
+
+    // Writer thread: fold durable journal records into their region files,
+    // then truncate the journal. Region writes are atomic and the journal is
+    // only truncated after every touched region is on disk.
+    void compact() {
+        std::unordered_map<ivec3, std::unordered_map<ivec3, ChunkOverlay, IVec3KeyHash>, IVec3KeyHash> touchedRegions;
+
+        for (const auto& record : uncompactedRecords) {
+            ivec3 chunkPos = chunkOf(record.worldPosition);
+            ivec3 region = regionOf(chunkPos);
+
+            auto regionIt = touchedRegions.find(region);
+            if (regionIt == touchedRegions.end()) {
+                regionIt = touchedRegions.emplace(region, std::unordered_map<ivec3, ChunkOverlay, IVec3KeyHash>{}).first;
+                readRegion(region, regionIt->second);
+            }
+
+            ChunkOverlay& chunkOverlay = regionIt->second[chunkPos];
+            if (record.sequence <= chunkOverlay.lastSequence) {
+                continue; // Already folded by an earlier compaction
+            }
+            chunkOverlay.voxels[localVoxelIndex(record.worldPosition, chunkPos)] = { record.newMaterial, record.sequence };
+            chunkOverlay.lastSequence = record.sequence;
+        }
+
+        for (const auto& pair : touchedRegions) {
+            if (!writeRegion(pair.first, pair.second)) {
+                std::cerr << "Failed to write region " << regionPath(pair.first) << ", keeping journal" << std::endl;
+                return;
+            }
+        }
+
+        // A failed freopen closes the old stream. The untruncated journal is
+        // still valid, its records are skipped as folded on replay.
+        std::FILE* truncated = journalFile ? std::freopen(journalPath().string().c_str(), "wb", journalFile) : nullptr;
+        if (!truncated) {
+            journalFile = nullptr;
+            std::error_code ec;
+            std::filesystem::resize_file(journalPath(), 0, ec);
+            if (ec) {
+                std::cerr << "Failed to truncate edit journal: " << ec.message() << std::endl;
+            }
+            journalBytes = std::filesystem::file_size(journalPath(), ec);
+            if (ec) {
+                journalBytes = 0;
+            }
+            journalFile = std::fopen(journalPath().string().c_str(), "ab");
+            if (!journalFile) {
+                std::cerr << "Failed to reopen edit journal, retrying on the next write" << std::endl;
+            }
+        }
+        else {
+            journalFile = truncated;
+            journalBytes = 0;
+            syncFile(journalFile);
+        }
+
+        uncompactedRecords.clear();
+        lastCompaction = std::chrono::steady_clock::now();
+    }
+};
+
+#endif
@@ -0,0 +1,228 @@
+// HeightClipmap.h - Surface heights for the far terrain beyond the voxel chunks
+//
+// LEVELS nested square grids of POSTS x POSTS surface heights centred on the
+// camera. Level l has posts every BASE_SPACING << l voxels, so each level
+// covers twice the width of the one inside it and the set reaches
+// extent() voxels from the camera at a fixed cost. Origins are snapped to even
+// post indices so a level's edges always fall on posts of the level outside it.
+//
+// Storage is toroidal: post p lives in slot p mod POSTS. When the camera moves
+// only the rows and columns that entered the window are sampled, the rest of
+// the level is reused. A level is handed to the renderer only once its whole
+// window is sampled, until then the GPU keeps drawing the previous window.
+#ifndef HEIGHT_CLIPMAP
+#define HEIGHT_CLIPMAP
+
+#include <array>
+#include <vector>
+#include <mutex>
+#include <climits>
+#include <memory>
+#include "glm/glm.hpp"
+#include "WorldGenerator.h"
+#include "HeightmapSource.h"
+
+using glm::ivec2;
+
+class HeightClipmap {
+public:
+    static constexpr int LEVELS = 5;
+    static constexpr int CELLS = 64;
+    static constexpr int POSTS = CELLS + 1;
+    static constexpr int BASE_SPACING = 32;
+
+    // Vertical search range for the surface, covers the generator's terrain
+    static constexpr int SURFACE_MIN = -64;
+    static constexpr int SURFACE_MAX = 512;
+    static constexpr int SEARCH_STEP = 8;
+
+    struct LevelState {
+        ivec2 origin = ivec2(0); // Post index of the window's lower corner
+        int spacing = 0;         // Voxels between posts
+        bool ready = false;      // Whole window sampled at least once
+    };
+
+    void initialize(uint32_t seed) {
+        worldGen.initialize(seed);
+        for (int l = 0; l < LEVELS; ++l) {
+            Level& level = levels[l];
+            level.state.spacing = BASE_SPACING << l;
+            level.heights.assign(POSTS * POSTS, 0.0f);
+            level.slotPost.assign(POSTS * POSTS, ivec2(INT_MIN));
+            level.target = ivec2(INT_MIN);
+        }
+    }
+
+    // Chunk update thread, before the first update. Posts are then read from
+    // the heightmap's columns so the far terrain matches the chunks.
+    void setHeightmap(std::shared_ptr<HeightmapSource> source) {
+        heightmap = std::move(source);
+    }
+
+    // Half width of the outermost level in voxels
+    static constexpr float extent() {
+        return float(CELLS / 2) * float(BASE_SPACING << (LEVELS - 1));
+    }
+
+    // Chunk update thread. Samples at most columnBudget columns, finest level
+    // first so the terrain nearest the voxel edge fills in before the horizon.
+    void update(glm::vec3 cameraPos, int columnBudget) {
+        for (int l = 0; l < LEVELS && columnBudget > 0; ++l) {
+            Level& level = levels[l];
+            ivec2 target = targetOrigin(cameraPos, level.state.spacing);
+            level.target = target;
+            if (level.state.ready && level.state.origin == target) {
+                continue;
+            }
+
+            samples.clear();
+            bool complete = true;
+            float hint = float(SURFACE_MAX / 2);
+            for (int j = 0; j < POSTS && complete; ++j) {
+                for (int i = 0; i < POSTS; ++i) {
+                    ivec2 post = target + ivec2(i, j);
+                    int slot = slotIndex(post);
+                    if (level.slotPost[slot] == post) {
+                        hint = level.heights[slot];
+                        continue;
+                    }
+                    if (columnBudget == 0) {
+                        complete = false;
+                        break;
+                    }
+
+                    ivec2 world = post * level.state.spacing;
+                    hint = findSurfaceHeight(world.x, world.y, int(hint));
+                    level.slotPost[slot] = post;
+                    samples.push_back({ slot, hint });
+                    columnBudget--;
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const Sample& sample : samples) {
+                level.heights[sample.slot] = sample.height;
+            }
+            if (complete) {
+                level.state.origin = target;
+                level.state.ready = true;
+                level.dirty = true;
+            }
+        }
+    }
+
+    // Main thread. Calls fn(level, state, heights) for every level whose
+    // window changed since the last call. heights is POSTS x POSTS in slot
+    // order, ready for a straight texture upload.
+    template<typename Func>
+    void forEachDirtyLevel(Func fn) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int l = 0; l < LEVELS; ++l) {
+            if (levels[l].dirty) {
+                fn(l, levels[l].state, levels[l].heights.data());
+                levels[l].dirty = false;
+            }
+        }
+    }
+
+    std::array<LevelState, LEVELS> getLevels() {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::array<LevelState, LEVELS> states;
+        for (int l = 0; l < LEVELS; ++l) {
+            states[l] = levels[l].state;
+        }
+        return states;
+    }
+
+    // Height of the first air voxel above the topmost solid one in a column,
+    // using the same density test as ThreadSafeChunk::generateTerrain. The
+    // search starts at hint (usually the neighbouring post) and walks up or
+    // down in SEARCH_STEP strides before bisecting to the exact voxel.
+    float findSurfaceHeight(int x, int y, int hint) {
+        if (heightmap) {
+            float height;
+            heightmap->columnHeights(ivec2(x, y), ivec2(1), &height);
+            // Voxels are solid while their centre is under the surface
+            return glm::clamp(glm::ceil(height - 0.5f), float(SURFACE_MIN), float(SURFACE_MAX));
+        }
+
+        auto solid = [&](int z) {
+            return worldGen.sample3D(glm::vec3(x, z, y)) > WorldGenerator::SOLID_THRESHOLD;
+        };
+
+        int z = glm::clamp(hint, SURFACE_MIN, SURFACE_MAX);
+        int low, high; // low is solid, high is air
+        if (solid(z)) {
+            low = z;
+            high = z + SEARCH_STEP;
+            while (high < SURFACE_MAX && solid(high)) {
+                low = high;
+                high += SEARCH_STEP;
+            }
+            if (high >= SURFACE_MAX) return float(SURFACE_MAX);
+        }
+        else {
+            high = z;
+            low = z - SEARCH_STEP;
+            while (low > SURFACE_MIN && !solid(low)) {
+                high = low;
+                low -= SEARCH_STEP;
+            }
+            if (low <= SURFACE_MIN) return float(SURFACE_MIN);
+        }
+
+        while (high - low > 1) {
+            int mid = (low + high) / 2;
+            if (solid(mid)) {
+                low = mid;
+            }
+            else {
+                high = mid;
+            }
+        }
+        return float(low + 1);
+    }
+
+private:
+    struct Level {
+        LevelState state;
+        ivec2 target;                 // Window being sampled
+        std::vector<float> heights;   // Guarded by mutex
+        std::vector<ivec2> slotPost;  // Post held by each slot, chunk thread only
+        bool dirty = false;
+    };
+
+    struct Sample {
+        int slot;
+        float height;
+    };
+
+    static int wrap(int post) {
+        int slot = post % POSTS;
+        return slot < 0 ? slot + POSTS : slot;
+    }
+
+    static int slotIndex(ivec2 post) {
+        return wrap(post.x) + wrap(post.y) * POSTS;
+    }
+
+    static int floorDiv(int value, int divisor) {
+        return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+    }
+
+    // Even origin centred on the camera, so the window moves in steps of two
+    // posts and stays aligned with the next coarser level
+    static ivec2 targetOrigin(glm::vec3 cameraPos, int spacing) {
+        ivec2 cameraVoxel = ivec2(glm::floor(glm::vec2(cameraPos.x, cameraPos.y)));
+        ivec2 centre = ivec2(floorDiv(cameraVoxel.x, spacing * 2), floorDiv(cameraVoxel.y, spacing * 2)) * 2;
+        return centre - ivec2(CELLS / 2);
+    }
+
+    WorldGenerator worldGen;
+    std::shared_ptr<HeightmapSource> heightmap; // Null for noise terrain
+    std::array<Level, LEVELS> levels;
+    std::vector<Sample> samples; // Chunk thread scratch
+    std::mutex mutex;
+};
+
+#endif // HEIGHT_CLIPMAP
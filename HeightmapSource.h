@@ -0,0 +1,375 @@
+// HeightmapSource.h - Terrain heights from a heightmap that may not fit in RAM
+//
+// The heightmap is stored as a tiled raw file (see convertImage) and memory
+// mapped, so only the source tiles a chunk actually touches are paged in.
+// Source samples are voxelsPerSample voxels apart. World columns are produced
+// by ImageUpscaler::resample one OUTPUT_TILE square at a time, only for the
+// squares chunks ask for, and kept in an LRU cache shared by all workers.
+//
+// Tiled file: HeightmapFileHeader, then tilesX * tilesY tiles in row order,
+// each tileSize * tileSize little-endian uint16 samples in row order. Edge
+// tiles are padded by repeating the last row and column.
+#ifndef HEIGHTMAP_SOURCE
+#define HEIGHTMAP_SOURCE
+
+#include "glm/glm.hpp"
+#include "ImageUpscaler.h"
+#include "WorldGenerator.h"
+#include <vector>
+#include <list>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using glm::ivec2;
+using glm::ivec3;
+
+struct HeightmapFileHeader {
+    uint32_t magic = 0x54485856; // "VXHT"
+    uint32_t version = 1;
+    uint32_t width = 0;          // Samples
+    uint32_t height = 0;
+    uint32_t tileSize = 0;       // Samples per tile side
+    uint32_t reserved = 0;
+};
+
+struct HeightmapSettings {
+    float voxelsPerSample = 4.0f; // Horizontal distance between source samples
+    float heightRange = 384.0f;   // Voxels between sample values 0 and 65535
+    float baseHeight = -128.0f;   // World z of sample value 0
+    ivec2 origin = ivec2(0);      // World column of source sample (0, 0)
+    ImageUpscaler::Filter filter = ImageUpscaler::Filter::Bicubic;
+};
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    bool open(const std::string& path) {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+            close();
+            return false;
+        }
+        size = static_cast<size_t>(fileSize.QuadPart);
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) {
+            close();
+            return false;
+        }
+        data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size == 0) {
+            close();
+            return false;
+        }
+        size = static_cast<size_t>(info.st_size);
+        void* view = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        data = view == MAP_FAILED ? nullptr : static_cast<const uint8_t*>(view);
+#endif
+        if (!data) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (data) UnmapViewOfFile(data);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (data) munmap(const_cast<uint8_t*>(data), size);
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+#endif
+        data = nullptr;
+        size = 0;
+    }
+
+    const uint8_t* getData() const { return data; }
+    size_t getSize() const { return size; }
+
+private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+};
+
+class HeightmapSource {
+public:
+    static constexpr int OUTPUT_TILE = 64;     // World columns per cached square side
+    static constexpr size_t CACHE_TILES = 1024; // 16 MB of heights
+    static constexpr float DENSITY_PER_VOXEL = 0.01f;
+
+    // Writes an image (8 or 16 bit, any channel count, first channel used)
+    // as a tiled heightmap. The image is decoded whole, so sources bigger
+    // than RAM have to be written in the tiled format directly.
+    static bool convertImage(const std::string& imagePath, const std::string& tiledPath, int tileSize = 256) {
+        int width = 0, height = 0, channels = 0;
+        stbi_us* pixels = stbi_load_16(imagePath.c_str(), &width, &height, &channels, 1);
+        if (!pixels) {
+            std::cerr << "Failed to load heightmap " << imagePath << std::endl;
+            return false;
+        }
+
+        std::ofstream out(tiledPath, std::ios::binary | std::ios::trunc);
+        HeightmapFileHeader header;
+        header.width = width;
+        header.height = height;
+        header.tileSize = tileSize;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        int tilesX = (width + tileSize - 1) / tileSize;
+        int tilesY = (height + tileSize - 1) / tileSize;
+        std::vector<uint16_t> tile(size_t(tileSize) * tileSize);
+        for (int ty = 0; ty < tilesY; ty++) {
+            for (int tx = 0; tx < tilesX; tx++) {
+                for (int y = 0; y < tileSize; y++) {
+                    int sy = std::min(ty * tileSize + y, height - 1);
+                    for (int x = 0; x < tileSize; x++) {
+                        int sx = std::min(tx * tileSize + x, width - 1);
+                        tile[y * tileSize + x] = pixels[size_t(sy) * width + sx];
+                    }
+                }
+                out.write(reinterpret_cast<const char*>(tile.data()), tile.size() * sizeof(uint16_t));
+            }
+        }
+        stbi_image_free(pixels);
+
+        if (!out) {
+            std::cerr << "Failed to write " << tiledPath << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool open(const std::string& tiledPath, const HeightmapSettings& heightmapSettings) {
+        if (!file.open(tiledPath)) {
+            std::cerr << "Failed to map heightmap " << tiledPath << std::endl;
+            return false;
+        }
+        if (file.getSize() < sizeof(HeightmapFileHeader)) {
+            std::cerr << "Heightmap " << tiledPath << " is truncated" << std::endl;
+            file.close();
+            return false;
+        }
+
+        std::memcpy(&header, file.getData(), sizeof(header));
+        HeightmapFileHeader expected;
+        if (header.magic != expected.magic || header.version != expected.version ||
+            header.width == 0 || header.height == 0 || header.tileSize == 0) {
+            std::cerr << "Heightmap " << tiledPath << " has an unknown format" << std::endl;
+            file.close();
+            return false;
+        }
+
+        tilesX = (header.width + header.tileSize - 1) / header.tileSize;
+        tilesY = (header.height + header.tileSize - 1) / header.tileSize;
+        size_t needed = sizeof(HeightmapFileHeader) + size_t(tilesX) * tilesY * header.tileSize * header.tileSize * sizeof(uint16_t);
+        if (file.getSize() < needed) {
+            std::cerr << "Heightmap " << tiledPath << " is truncated" << std::endl;
+            file.close();
+            return false;
+        }
+
+        settings = heightmapSettings;
+        return true;
+    }
+
+    // Surface height of every column in [start, start + size), row by row
+    void columnHeights(ivec2 start, ivec2 size, float* out) {
+        ivec2 firstTile = floorDiv(start);
+        ivec2 lastTile = floorDiv(start + size - 1);
+        for (int ty = firstTile.y; ty <= lastTile.y; ty++) {
+            for (int tx = firstTile.x; tx <= lastTile.x; tx++) {
+                std::shared_ptr<const std::vector<float>> tile = getTile(ivec2(tx, ty));
+                ivec2 tileStart = ivec2(tx, ty) * OUTPUT_TILE;
+                ivec2 low = glm::max(start, tileStart);
+                ivec2 high = glm::min(start + size, tileStart + OUTPUT_TILE);
+                for (int y = low.y; y < high.y; y++) {
+                    const float* src = tile->data() + (y - tileStart.y) * OUTPUT_TILE + (low.x - tileStart.x);
+                    std::copy(src, src + (high.x - low.x), out + (y - start.y) * size.x + (low.x - start.x));
+                }
+            }
+        }
+    }
+
+    // Same contract as WorldGenerator::classifyBox, but exact: a box is
+    // uniform when no column's surface falls inside its z range
+    WorldGenerator::BoxContents classifyBox(ivec3 start, ivec3 size) {
+        std::vector<float> heights(size_t(size.x) * size.y);
+        columnHeights(ivec2(start.x, start.y), ivec2(size.x, size.y), heights.data());
+        auto [low, high] = std::minmax_element(heights.begin(), heights.end());
+
+        if (*high <= start.z + 0.5f) return WorldGenerator::BoxContents::Air;
+        if (*low > start.z + size.z - 0.5f) return WorldGenerator::BoxContents::Solid;
+        return WorldGenerator::BoxContents::Mixed;
+    }
+
+    // Stand-in for WorldGenerator::sampleGrid3D with the same layout. Values
+    // grow with depth below the surface and cross SOLID_THRESHOLD at it, so
+    // a voxel is solid when its centre is under the surface.
+    void sampleDensity(float* out, ivec3 start, ivec3 size) {
+        std::vector<float> heights(size_t(size.x) * size.y);
+        columnHeights(ivec2(start.x, start.y), ivec2(size.x, size.y), heights.data());
+
+        for (int y = 0; y < size.y; y++) {
+            for (int z = 0; z < size.z; z++) {
+                float centre = start.z + z + 0.5f;
+                const float* row = &heights[size_t(y) * size.x];
+                float* dst = out + (size_t(y) * size.z + z) * size.x;
+                for (int x = 0; x < size.x; x++) {
+                    dst[x] = WorldGenerator::SOLID_THRESHOLD + (row[x] - centre) * DENSITY_PER_VOXEL;
+                }
+            }
+        }
+    }
+
+private:
+    struct TileKey {
+        std::size_t operator()(const ivec2& k) const {
+            return std::hash<int64_t>{}((int64_t(k.x) << 32) ^ uint32_t(k.y));
+        }
+    };
+
+    struct CacheEntry {
+        std::shared_ptr<const std::vector<float>> heights;
+        std::list<ivec2>::iterator use;
+    };
+
+    static ivec2 floorDiv(ivec2 value) {
+        auto axis = [](int v) { return v >= 0 ? v / OUTPUT_TILE : -((-v + OUTPUT_TILE - 1) / OUTPUT_TILE); };
+        return ivec2(axis(value.x), axis(value.y));
+    }
+
+    std::shared_ptr<const std::vector<float>> getTile(ivec2 tile) {
+        {
+            std::lock_guard<std::mutex> lock(cacheMutex);
+            auto it = cache.find(tile);
+            if (it != cache.end()) {
+                lru.splice(lru.begin(), lru, it->second.use);
+                return it->second.heights;
+            }
+        }
+
+        // Built outside the lock, two workers may occasionally build the same tile
+        std::shared_ptr<const std::vector<float>> heights = buildTile(tile);
+
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        auto it = cache.find(tile);
+        if (it != cache.end()) {
+            return it->second.heights;
+        }
+        lru.push_front(tile);
+        cache[tile] = { heights, lru.begin() };
+        while (cache.size() > CACHE_TILES) {
+            cache.erase(lru.back());
+            lru.pop_back();
+        }
+        return heights;
+    }
+
+    std::shared_ptr<const std::vector<float>> buildTile(ivec2 tile) {
+        // Source samples under the square, plus the bicubic footprint
+        float step = 1.0f / settings.voxelsPerSample;
+        glm::vec2 first = glm::vec2(tile * OUTPUT_TILE - settings.origin) * step;
+        glm::vec2 last = first + float(OUTPUT_TILE - 1) * step;
+        ivec2 mapSize(header.width, header.height);
+        ivec2 low = glm::clamp(ivec2(glm::floor(first)) - 1, ivec2(0), mapSize - 1);
+        ivec2 high = glm::clamp(ivec2(glm::floor(last)) + 2, ivec2(0), mapSize - 1);
+        ivec2 windowSize = high - low + 1;
+
+        std::vector<float> window(size_t(windowSize.x) * windowSize.y);
+        for (int y = 0; y < windowSize.y; y++) {
+            readSourceRow(low.y + y, low.x, windowSize.x, &window[size_t(y) * windowSize.x]);
+        }
+
+        auto heights = std::make_shared<std::vector<float>>(OUTPUT_TILE * OUTPUT_TILE);
+        ImageUpscaler::resample(window.data(), windowSize.x, windowSize.y, windowSize.x,
+            heights->data(), OUTPUT_TILE, OUTPUT_TILE, first.x - low.x, first.y - low.y, step, settings.filter);
+
+        float scale = settings.heightRange / 65535.0f;
+        for (float& h : *heights) {
+            h = settings.baseHeight + h * scale;
+        }
+        return heights;
+    }
+
+    // count samples of source row y from column x, crossing tiles as needed
+    void readSourceRow(int y, int x, int count, float* out) const {
+        const int tileSize = header.tileSize;
+        const uint8_t* base = file.getData() + sizeof(HeightmapFileHeader);
+        int ty = y / tileSize;
+        int row = y % tileSize;
+
+        while (count > 0) {
+            int tx = x / tileSize;
+            int column = x % tileSize;
+            int run = std::min(count, tileSize - column);
+            size_t offset = ((size_t(ty) * tilesX + tx) * tileSize + row) * tileSize + column;
+            const uint8_t* src = base + offset * sizeof(uint16_t);
+            for (int i = 0; i < run; i++) {
+                uint16_t value;
+                std::memcpy(&value, src + i * sizeof(uint16_t), sizeof(value));
+                out[i] = value;
+            }
+            out += run;
+            x += run;
+            count -= run;
+        }
+    }
+
+    MappedFile file;
+    HeightmapFileHeader header;
+    HeightmapSettings settings;
+    int tilesX = 0;
+    int tilesY = 0;
+
+    std::mutex cacheMutex;
+    std::list<ivec2> lru; // Most recently used first
+    std::unordered_map<ivec2, CacheEntry, TileKey> cache;
+};
+
+#endif // HEIGHTMAP_SOURCE
@@ -1,43 +1,51 @@
+#ifndef IMAGE_UPSCALER
+#define IMAGE_UPSCALER
+
 #include <iostream>
 #include <vector>
+#include <memory>
+#include <algorithm>
 #include <cmath>
 
 #include "stb_image.h"
 
 class ImageUpscaler {
+public:
+    enum class Filter { Bilinear, Bicubic };
+
 private:
-    // Linear interpolation between two values
-    float lerp(float a, float b, float t) {
-        return a + t * (b - a);
-    }
+    // Source taps and weights for one output coordinate along an axis
+    struct Taps {
+        int index[4];
+        float weight[4];
+    };
 
-    // Bilinear interpolation for a single channel
-    float bilinearInterpolate(const unsigned char* data, int width, int height,
-        float x, float y, int channel, int channels) {
-        // Clamp coordinates to image bounds
-        x = std::max(0.0f, std::min(x, width - 1.0f));
-        y = std::max(0.0f, std::min(y, height - 1.0f));
-
-        int x1 = (int)x;
-        int y1 = (int)y;
-        int x2 = std::min(x1 + 1, width - 1);
-        int y2 = std::min(y1 + 1, height - 1);
-
-        float fx = x - x1;
-        float fy = y - y1;
-
-        // Get the four surrounding pixels
-        float p11 = data[(y1 * width + x1) * channels + channel];
-        float p12 = data[(y1 * width + x2) * channels + channel];
-        float p21 = data[(y2 * width + x1) * channels + channel];
-        float p22 = data[(y2 * width + x2) * channels + channel];
-
-        // Interpolate horizontally
-        float top = lerp(p11, p12, fx);
-        float bottom = lerp(p21, p22, fx);
-
-        // Interpolate vertically
-        return lerp(top, bottom, fy);
+    static Taps tapsFor(float position, int size, Filter filter) {
+        position = std::max(0.0f, std::min(position, size - 1.0f));
+        int base = (int)position;
+        float t = position - base;
+        Taps taps;
+
+        if (filter == Filter::Bilinear) {
+            taps.index[0] = base;
+            taps.index[1] = std::min(base + 1, size - 1);
+            taps.index[2] = taps.index[3] = taps.index[1];
+            taps.weight[0] = 1.0f - t;
+            taps.weight[1] = t;
+            taps.weight[2] = taps.weight[3] = 0.0f;
+            return taps;
+        }
+
+        // Catmull-Rom, passes through the samples so heights are not flattened
+        float t2 = t * t, t3 = t2 * t;
+        taps.weight[0] = 0.5f * (-t + 2.0f * t2 - t3);
+        taps.weight[1] = 0.5f * (2.0f - 5.0f * t2 + 3.0f * t3);
+        taps.weight[2] = 0.5f * (t + 4.0f * t2 - 3.0f * t3);
+        taps.weight[3] = 0.5f * (-t2 + t3);
+        for (int k = 0; k < 4; k++) {
+            taps.index[k] = std::max(0, std::min(base - 1 + k, size - 1));
+        }
+        return taps;
     }
 
 public:
@@ -54,7 +62,7 @@ public:
     // Read a pixel from upscaled data at given coordinates
     Pixel readPixel(std::shared_ptr<std::vector<unsigned char>>imageData, int width, int height,
         int channels, int x, int y) {
-        // Bounds checking
+        // Bounds checking, the reads below are unchecked
         if (x < 0 || x >= width || y < 0 || y >= height) {
             std::cerr << "Warning: Pixel coordinates (" << x << ", " << y
                 << ") out of bounds for image " << width << "x" << height << std::endl;
@@ -66,20 +74,20 @@ public:
 
         switch (channels) {
         case 1: // Grayscale
-            pixel.r = pixel.g = pixel.b = imageData->at(index);
+            pixel.r = pixel.g = pixel.b = (*imageData)[index];
             pixel.a = 255;
             break;
         case 3: // RGB
-            pixel.r = imageData->at(index);
-            pixel.g = imageData->at(index+1);
-            pixel.b = imageData->at(index+2);
+            pixel.r = (*imageData)[index];
+            pixel.g = (*imageData)[index + 1];
+            pixel.b = (*imageData)[index + 2];
             pixel.a = 255;
             break;
         case 4: // RGBA
-            pixel.r = imageData->at(index);
-            pixel.g = imageData->at(index + 1);
-            pixel.b = imageData->at(index + 2);
-            pixel.a = imageData->at(index + 3);
+            pixel.r = (*imageData)[index];
+            pixel.g = (*imageData)[index + 1];
+            pixel.b = (*imageData)[index + 2];
+            pixel.a = (*imageData)[index + 3];
             break;
         default:
             std::cerr << "Unsupported number of channels: " << channels << std::endl;
@@ -131,34 +139,66 @@ public:
         return imageData[index];
     }
 
+    // Resamples one float channel. Output pixel (x, y) reads the source at
+    // (originX + x * step, originY + y * step), clamped to the source edges.
+    // Separable: each output row first blends whole source rows, a plain
+    // loop over contiguous floats that the compiler vectorises, then runs the
+    // horizontal taps, which are computed once per call.
+    static void resample(const float* src, int srcWidth, int srcHeight, int srcStride,
+        float* dst, int dstWidth, int dstHeight, float originX, float originY, float step, Filter filter) {
+        std::vector<Taps> columns(dstWidth);
+        for (int x = 0; x < dstWidth; x++) {
+            columns[x] = tapsFor(originX + x * step, srcWidth, filter);
+        }
+
+        std::vector<float> row(srcWidth);
+        for (int y = 0; y < dstHeight; y++) {
+            Taps rows = tapsFor(originY + y * step, srcHeight, filter);
+            const float* r0 = src + rows.index[0] * srcStride;
+            const float* r1 = src + rows.index[1] * srcStride;
+            const float* r2 = src + rows.index[2] * srcStride;
+            const float* r3 = src + rows.index[3] * srcStride;
+            float w0 = rows.weight[0], w1 = rows.weight[1], w2 = rows.weight[2], w3 = rows.weight[3];
+            for (int x = 0; x < srcWidth; x++) {
+                row[x] = w0 * r0[x] + w1 * r1[x] + w2 * r2[x] + w3 * r3[x];
+            }
+
+            float* out = dst + y * dstWidth;
+            for (int x = 0; x < dstWidth; x++) {
+                const Taps& taps = columns[x];
+                out[x] = taps.weight[0] * row[taps.index[0]] + taps.weight[1] * row[taps.index[1]] +
+                    taps.weight[2] * row[taps.index[2]] + taps.weight[3] * row[taps.index[3]];
+            }
+        }
+    }
+
     std::vector<unsigned char> upscaleImage(const unsigned char* originalData,
         int originalWidth, int originalHeight,
-        int channels, float scaleFactor) {
+        int channels, float scaleFactor, Filter filter = Filter::Bilinear) {
         int newWidth = (int)(originalWidth * scaleFactor);
         int newHeight = (int)(originalHeight * scaleFactor);
 
         std::vector<unsigned char> upscaledData(newWidth * newHeight * channels);
+        std::vector<float> plane(originalWidth * originalHeight);
+        std::vector<float> resampled(newWidth * newHeight);
 
-        for (int y = 0; y < newHeight; y++) {
-            for (int x = 0; x < newWidth; x++) {
-                // Map new coordinates back to original image coordinates
-                float originalX = x / scaleFactor;
-                float originalY = y / scaleFactor;
-
-                // Interpolate each channel
-                for (int c = 0; c < channels; c++) {
-                    float interpolatedValue = bilinearInterpolate(
-                        originalData, originalWidth, originalHeight,
-                        originalX, originalY, c, channels
-                    );
-
-                    // Clamp and store the result
-                    upscaledData[(y * newWidth + x) * channels + c] =
-                        (unsigned char)std::max(0.0f, std::min(255.0f, interpolatedValue));
-                }
+        // One channel at a time so the kernel works on contiguous floats
+        for (int c = 0; c < channels; c++) {
+            for (int i = 0; i < originalWidth * originalHeight; i++) {
+                plane[i] = originalData[i * channels + c];
+            }
+
+            resample(plane.data(), originalWidth, originalHeight, originalWidth,
+                resampled.data(), newWidth, newHeight, 0.0f, 0.0f, 1.0f / scaleFactor, filter);
+
+            // Clamp and store the result
+            for (int i = 0; i < newWidth * newHeight; i++) {
+                upscaledData[i * channels + c] = (unsigned char)std::max(0.0f, std::min(255.0f, resampled[i]));
             }
         }
 
         return upscaledData;
     }
-};
\ No newline at end of file
+};
+
+#endif // IMAGE_UPSCALER
@@ -0,0 +1,157 @@
+// MemoryTracker.h - Byte accounting for chunk storage and GPU resources
+//
+// GPU allocations are counted live by hooks in BufferManager and
+// TextureManager. CPU chunk storage is measured per chunk on demand
+// (ThreadSafeChunk::getMemoryFootprint) so the manager can break totals down
+// by state and LOD. Live GPU counters minus the per-chunk sum is memory held
+// by chunks that already left the chunk map.
+#ifndef MEMORY_TRACKER
+#define MEMORY_TRACKER
+
+#include <array>
+#include <atomic>
+#include <map>
+#include <string>
+#include <ostream>
+#include <iomanip>
+#include <cstdint>
+
+enum class MemoryCategory : int {
+    VoxelBits,     // Solid bitset, brick mask and occupancy snapshot
+    MaterialData,
+    LightData,
+    RetainedMesh,  // CPU quadData kept until upload
+    VertexBuffer,  // Per-quad records
+    ChunkTexture,  // Per-chunk 3D material/light texture
+    UniformBuffer, // Per-chunk ChunkData buffer
+    BindGroup,     // Counted only, the driver does not report a size
+    SharedGpu,     // Named renderer resources: atlas, depth, MSAA, frame uniforms
+    COUNT
+};
+
+constexpr int MEMORY_CATEGORY_COUNT = static_cast<int>(MemoryCategory::COUNT);
+
+inline const char* memoryCategoryName(MemoryCategory category) {
+    switch (category) {
+    case MemoryCategory::VoxelBits: return "voxel bits";
+    case MemoryCategory::MaterialData: return "materials";
+    case MemoryCategory::LightData: return "light";
+    case MemoryCategory::RetainedMesh: return "retained mesh";
+    case MemoryCategory::VertexBuffer: return "gpu vertex";
+    case MemoryCategory::ChunkTexture: return "gpu texture";
+    case MemoryCategory::UniformBuffer: return "gpu uniform";
+    case MemoryCategory::BindGroup: return "bind groups";
+    case MemoryCategory::SharedGpu: return "gpu shared";
+    case MemoryCategory::COUNT: break;
+    }
+    return "unknown";
+}
+
+inline bool isGpuMemory(MemoryCategory category) {
+    return category >= MemoryCategory::VertexBuffer;
+}
+
+struct MemoryFootprint {
+    std::array<uint64_t, MEMORY_CATEGORY_COUNT> bytes{};
+    std::array<uint64_t, MEMORY_CATEGORY_COUNT> count{}; // Allocations
+    uint64_t chunks = 0;
+
+    void add(MemoryCategory category, uint64_t size) {
+        bytes[static_cast<int>(category)] += size;
+        count[static_cast<int>(category)]++;
+    }
+
+    void add(const MemoryFootprint& other) {
+        for (int i = 0; i < MEMORY_CATEGORY_COUNT; ++i) {
+            bytes[i] += other.bytes[i];
+            count[i] += other.count[i];
+        }
+        chunks += other.chunks;
+    }
+
+    uint64_t cpuBytes() const { return sumBytes(false); }
+    uint64_t gpuBytes() const { return sumBytes(true); }
+
+private:
+    uint64_t sumBytes(bool gpu) const {
+        uint64_t total = 0;
+        for (int i = 0; i < MEMORY_CATEGORY_COUNT; ++i) {
+            if (isGpuMemory(static_cast<MemoryCategory>(i)) == gpu) total += bytes[i];
+        }
+        return total;
+    }
+};
+
+// Process-wide live counters fed by the allocation hooks
+class MemoryTracker {
+public:
+    static MemoryTracker& instance() {
+        static MemoryTracker tracker;
+        return tracker;
+    }
+
+    void allocate(MemoryCategory category, uint64_t size) {
+        bytes[static_cast<int>(category)].fetch_add(size, std::memory_order_relaxed);
+        count[static_cast<int>(category)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void release(MemoryCategory category, uint64_t size) {
+        bytes[static_cast<int>(category)].fetch_sub(size, std::memory_order_relaxed);
+        count[static_cast<int>(category)].fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    MemoryFootprint snapshot() const {
+        MemoryFootprint footprint;
+        for (int i = 0; i < MEMORY_CATEGORY_COUNT; ++i) {
+            footprint.bytes[i] = bytes[i].load(std::memory_order_relaxed);
+            footprint.count[i] = count[i].load(std::memory_order_relaxed);
+        }
+        return footprint;
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, MEMORY_CATEGORY_COUNT> bytes{};
+    std::array<std::atomic<uint64_t>, MEMORY_CATEGORY_COUNT> count{};
+
+    MemoryTracker() = default;
+};
+
+struct MemoryReport {
+    std::map<std::string, MemoryFootprint> byState;
+    std::map<uint32_t, MemoryFootprint> byLod;
+    MemoryFootprint loadedChunks; // Sum over the chunk map
+    MemoryFootprint liveGpu;      // From the allocation hooks
+
+    void print(std::ostream& out) const {
+        auto mb = [](uint64_t bytes) { return bytes / (1024.0 * 1024.0); };
+        out << std::fixed << std::setprecision(2);
+        out << "Memory: " << loadedChunks.chunks << " chunks, CPU " << mb(loadedChunks.cpuBytes()) << " MB, GPU "
+            << mb(loadedChunks.gpuBytes()) << " MB (live GPU " << mb(liveGpu.gpuBytes()) << " MB)" << std::endl;
+
+        out << std::left << std::setw(16) << "category" << std::right << std::setw(12) << "chunks MB"
+            << std::setw(10) << "count" << std::setw(12) << "live MB" << std::setw(10) << "live" << std::endl;
+        for (int i = 0; i < MEMORY_CATEGORY_COUNT; ++i) {
+            MemoryCategory category = static_cast<MemoryCategory>(i);
+            out << std::left << std::setw(16) << memoryCategoryName(category) << std::right
+                << std::setw(12) << mb(loadedChunks.bytes[i]) << std::setw(10) << loadedChunks.count[i];
+            if (isGpuMemory(category)) {
+                out << std::setw(12) << mb(liveGpu.bytes[i]) << std::setw(10) << liveGpu.count[i];
+            }
+            out << std::endl;
+        }
+
+        for (const auto& pair : byState) {
+            out << "  " << std::left << std::setw(20) << pair.first << std::right << std::setw(7) << pair.second.chunks
+                << " chunks  CPU " << std::setw(9) << mb(pair.second.cpuBytes()) << " MB  GPU " << std::setw(9)
+                << mb(pair.second.gpuBytes()) << " MB" << std::endl;
+        }
+        for (const auto& pair : byLod) {
+            out << "  LOD " << std::left << std::setw(16) << pair.first << std::right << std::setw(7) << pair.second.chunks
+                << " chunks  CPU " << std::setw(9) << mb(pair.second.cpuBytes()) << " MB  GPU " << std::setw(9)
+                << mb(pair.second.gpuBytes()) << " MB" << std::endl;
+        }
+        out << std::defaultfloat;
+    }
+};
+
+#endif // MEMORY_TRACKER
@@ -0,0 +1,231 @@
+// Profiler.h - Scoped CPU timing zones per frame, plus GPU render pass time
+//
+// PROFILE_ZONE("name") times the rest of the enclosing scope into the open
+// frame of a fixed ring. Any thread may record. Zones from the chunk update
+// thread land in whichever frame is open when they end. Everything compiles
+// out when PROFILER_ENABLED is 0, the default for NDEBUG builds.
+#ifndef FRAME_PROFILER
+#define FRAME_PROFILER
+
+#ifndef PROFILER_ENABLED
+#ifdef NDEBUG
+#define PROFILER_ENABLED 0
+#else
+#define PROFILER_ENABLED 1
+#endif
+#endif
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <string>
+#include <fstream>
+#include <ostream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdint>
+
+class FrameProfiler {
+public:
+    static constexpr uint64_t FRAME_HISTORY = 256;
+    static constexpr uint32_t MAX_ZONES = 32; // Per frame, extra zones are dropped
+
+    struct Zone {
+        const char* name = "";
+        uint32_t thread = 0;
+        uint64_t start = 0; // Nanoseconds since the profiler epoch
+        uint64_t duration = 0;
+    };
+
+    struct Frame {
+        uint64_t index = 0;
+        uint64_t start = 0;
+        uint64_t duration = 0;
+        double gpuMs = -1.0; // Render pass time from timestamp queries, -1 if unknown
+        std::atomic<uint32_t> zoneCount{ 0 };
+        std::array<Zone, MAX_ZONES> zones;
+    };
+
+    static FrameProfiler& instance() {
+        static FrameProfiler profiler;
+        return profiler;
+    }
+
+    static uint64_t now() {
+        static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - epoch).count());
+    }
+
+    void recordZone(const char* name, uint64_t start, uint64_t end) {
+        Frame& frame = frames[current.load(std::memory_order_acquire) % FRAME_HISTORY];
+        uint32_t slot = frame.zoneCount.fetch_add(1, std::memory_order_relaxed);
+        if (slot < MAX_ZONES) {
+            frame.zones[slot] = { name, threadIndex(), start, end - start };
+        }
+    }
+
+    // Main thread, once per frame before the frame limiter sleeps
+    void endFrame() {
+        uint64_t index = current.load(std::memory_order_relaxed);
+        uint64_t time = now();
+        frames[index % FRAME_HISTORY].duration = time - frames[index % FRAME_HISTORY].start;
+
+        Frame& next = frames[(index + 1) % FRAME_HISTORY];
+        next.index = index + 1;
+        next.start = time;
+        next.duration = 0;
+        next.gpuMs = -1.0;
+        next.zoneCount.store(0, std::memory_order_relaxed);
+        current.store(index + 1, std::memory_order_release);
+    }
+
+    uint64_t currentFrame() const { return current.load(std::memory_order_relaxed); }
+
+    // GPU results arrive a few frames late. Dropped once the frame left the ring.
+    void recordGpuTime(uint64_t frameIndex, double milliseconds) {
+        Frame& frame = frames[frameIndex % FRAME_HISTORY];
+        if (frame.index == frameIndex) {
+            frame.gpuMs = milliseconds;
+        }
+    }
+
+    void printSummary(std::ostream& out) const {
+        struct Totals { double sum = 0.0; double max = 0.0; uint64_t count = 0; };
+        std::map<std::string, Totals> zones;
+        Totals frameTotals, gpuTotals;
+
+        forEachCompletedFrame([&](const Frame& frame) {
+            add(frameTotals, frame.duration / 1e6);
+            if (frame.gpuMs >= 0.0) add(gpuTotals, frame.gpuMs);
+            for (uint32_t i = 0; i < zoneCount(frame); ++i) {
+                add(zones[frame.zones[i].name], frame.zones[i].duration / 1e6);
+            }
+        });
+
+        out << "Frame profile over " << frameTotals.count << " frames" << std::endl;
+        out << std::left << std::setw(16) << "zone" << std::right << std::setw(8) << "count"
+            << std::setw(10) << "avg ms" << std::setw(10) << "max ms" << std::endl;
+        auto row = [&out](const std::string& name, const Totals& t) {
+            out << std::left << std::setw(16) << name << std::right << std::setw(8) << t.count << std::fixed
+                << std::setprecision(3) << std::setw(10) << (t.count ? t.sum / t.count : 0.0) << std::setw(10) << t.max
+                << std::defaultfloat << std::endl;
+        };
+        row("frame", frameTotals);
+        for (const auto& pair : zones) row(pair.first, pair.second);
+        if (gpuTotals.count) row("gpu pass", gpuTotals);
+    }
+
+    // One row per zone, plus a gpu row per frame that has a result
+    bool writeCsv(const std::string& path) const {
+        std::ofstream out(path);
+        if (!out) return false;
+
+        out << "frame,zone,thread,start_ms,duration_ms\n";
+        out << std::fixed << std::setprecision(4);
+        forEachCompletedFrame([&out](const Frame& frame) {
+            out << frame.index << ",frame,0," << frame.start / 1e6 << "," << frame.duration / 1e6 << "\n";
+            for (uint32_t i = 0; i < zoneCount(frame); ++i) {
+                const Zone& zone = frame.zones[i];
+                out << frame.index << "," << zone.name << "," << zone.thread << "," << zone.start / 1e6 << ","
+                    << zone.duration / 1e6 << "\n";
+            }
+            if (frame.gpuMs >= 0.0) {
+                out << frame.index << ",gpu pass,gpu," << frame.start / 1e6 << "," << frame.gpuMs << "\n";
+            }
+        });
+        return static_cast<bool>(out);
+    }
+
+    // Chrome trace JSON (chrome://tracing, Perfetto). GPU pass times have no
+    // GPU clock origin, so they are drawn from the start of their frame.
+    bool writeChromeTrace(const std::string& path) const {
+        std::ofstream out(path);
+        if (!out) return false;
+
+        out << std::fixed << std::setprecision(3);
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        auto span = [&out, &first](const char* name, const std::string& tid, uint64_t frame, double startUs, double durationUs) {
+            if (!first) out << ",\n";
+            first = false;
+            out << "{\"name\":\"" << name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":\"" << tid << "\",\"ts\":" << startUs
+                << ",\"dur\":" << durationUs << ",\"args\":{\"frame\":" << frame << "}}";
+        };
+
+        forEachCompletedFrame([&](const Frame& frame) {
+            span("frame", "frames", frame.index, frame.start / 1e3, frame.duration / 1e3);
+            for (uint32_t i = 0; i < zoneCount(frame); ++i) {
+                const Zone& zone = frame.zones[i];
+                span(zone.name, "thread " + std::to_string(zone.thread), frame.index, zone.start / 1e3, zone.duration / 1e3);
+            }
+            if (frame.gpuMs >= 0.0) {
+                span("gpu pass", "gpu", frame.index, frame.start / 1e3, frame.gpuMs * 1e3);
+            }
+        });
+        out << "\n]}\n";
+        return static_cast<bool>(out);
+    }
+
+private:
+    std::array<Frame, FRAME_HISTORY> frames;
+    std::atomic<uint64_t> current{ 0 };
+    std::atomic<uint32_t> nextThread{ 0 };
+
+    FrameProfiler() = default;
+
+    uint32_t threadIndex() {
+        thread_local uint32_t index = nextThread.fetch_add(1);
+        return index;
+    }
+
+    static uint32_t zoneCount(const Frame& frame) {
+        return std::min(frame.zoneCount.load(std::memory_order_relaxed), MAX_ZONES);
+    }
+
+    template<typename T>
+    static void add(T& totals, double value) {
+        totals.sum += value;
+        totals.max = std::max(totals.max, value);
+        totals.count++;
+    }
+
+    // Oldest first, skipping the frame still being recorded
+    template<typename Fn>
+    void forEachCompletedFrame(Fn&& fn) const {
+        uint64_t open = current.load(std::memory_order_acquire);
+        uint64_t first = open > FRAME_HISTORY - 1 ? open - (FRAME_HISTORY - 1) : 0;
+        for (uint64_t index = first; index < open; ++index) {
+            const Frame& frame = frames[index % FRAME_HISTORY];
+            if (frame.index == index) {
+                fn(frame);
+            }
+        }
+    }
+};
+
+class ProfileZone {
+public:
+    explicit ProfileZone(const char* zoneName) : name(zoneName), start(FrameProfiler::now()) {}
+    ~ProfileZone() { FrameProfiler::instance().recordZone(name, start, FrameProfiler::now()); }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    const char* name;
+    uint64_t start;
+};
+
+#if PROFILER_ENABLED
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_FRAME_END() FrameProfiler::instance().endFrame()
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_FRAME_END() ((void)0)
+#endif
+
+#endif // FRAME_PROFILER
@@ -1,6 +1,12 @@
 // Fixed Ray.h with proper bounds checking and null safety
+#ifndef RAY
+#define RAY
+
 #include "glm/glm.hpp"
 #include <functional>
+#include <memory>
+#include <climits>
+#include "ThreadSafeChunk.h"
 
 using glm::vec3;
 using glm::ivec3;
@@ -9,202 +15,131 @@ struct RayIntersectionResult {
     bool hit;                    // Whether an intersection was found
     glm::ivec3 hitVoxelPos;     // Position of the voxel that was hit
     glm::ivec3 adjacentVoxelPos; // Position of the adjacent voxel (for block placement)
+    float distance = 0.0f;       // Distance along the ray to the entry face
+    glm::ivec3 normal = glm::ivec3(0); // Normal of the face that was entered
 };
 
-class Ray {
+// Remembers the last chunk it resolved, so a traversal only pays for a map
+// lookup and a shared_ptr copy when it crosses into a different chunk
+template <typename ChunkLookup>
+class CachedChunkAccessor {
+    ChunkLookup& lookup;
+    ivec3 cachedPos = ivec3(INT_MAX);
+    std::shared_ptr<ThreadSafeChunk> cachedChunk;
+
 public:
-    static RayIntersectionResult rayVoxelIntersection(const glm::vec3& cameraPos, const glm::vec3& direction, float maxDistance, std::function<std::shared_ptr<ThreadSafeChunk>(const ivec3&)> getChunkCallback) {
-        // Clamp max distance to prevent infinite loops
-        maxDistance = glm::clamp(maxDistance, 0.1f, 1000.0f);
+    explicit CachedChunkAccessor(ChunkLookup& l) : lookup(l) {}
 
-        // Normalize the direction vector and validate
-        glm::vec3 dir = glm::normalize(direction);
-        if (glm::length(dir) < 0.001f) {
-            return RayIntersectionResult{ false, ivec3(0), ivec3(0) };
+    const std::shared_ptr<ThreadSafeChunk>& get(const ivec3& chunkPos) {
+        if (chunkPos != cachedPos) {
+            cachedChunk = lookup(chunkPos);
+            cachedPos = chunkPos;
         }
+        return cachedChunk;
+    }
+};
 
-        // Bounds check camera position
-        const float MAX_WORLD_COORD = 1000000.0f;
-        if (glm::abs(cameraPos.x) > MAX_WORLD_COORD ||
-            glm::abs(cameraPos.y) > MAX_WORLD_COORD ||
-            glm::abs(cameraPos.z) > MAX_WORLD_COORD) {
-            return RayIntersectionResult{ false, ivec3(0), ivec3(0) };
-        }
+class Ray {
+public:
+    static constexpr float MAX_RAY_DISTANCE = 4096.0f;
 
-        // Current position along the ray (in world coordinates)
-        glm::vec3 currentPos = cameraPos;
+    static RayIntersectionResult rayVoxelIntersection(const glm::vec3& cameraPos, const glm::vec3& direction, float maxDistance, std::function<std::shared_ptr<ThreadSafeChunk>(const ivec3&)> getChunkCallback) {
+        // The std::function is only invoked once per chunk crossed
+        return traverseHierarchical(cameraPos, direction, maxDistance, getChunkCallback);
+    }
 
-        // Current voxel coordinates (in world coordinates)
-        glm::ivec3 worldVoxelPos = glm::ivec3(
-            static_cast<int>(glm::floor(currentPos.x)),
-            static_cast<int>(glm::floor(currentPos.y)),
-            static_cast<int>(glm::floor(currentPos.z))
-        );
+    // Hierarchical DDA: skips unloaded and empty chunks in one step, then empty
+    // 8x8x8 regions and 4x4x4 bricks using the chunk occupancy masks, and only
+    // walks single voxels inside occupied bricks. ChunkLookup is any callable ivec3 -> shared_ptr,
+    // so the lookup inlines when called with a lambda.
+    template <typename ChunkLookup>
+    static RayIntersectionResult traverseHierarchical(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, ChunkLookup&& lookup) {
+        constexpr int CHUNK_SIZE = 32;
+        constexpr int BRICK_SIZE = ThreadSafeChunk::BRICK_SIZE;
+        constexpr int REGION_SIZE = ChunkOccupancy::REGION_SIZE;
+        constexpr float MAX_WORLD_COORD = 1000000.0f;
+        constexpr int MAX_ITERATIONS = 100000;
 
-        // Calculate step direction for each axis
-        glm::ivec3 step = glm::ivec3(
-            dir.x > 0 ? 1 : -1,
-            dir.y > 0 ? 1 : -1,
-            dir.z > 0 ? 1 : -1
-        );
+        const RayIntersectionResult miss{ false, ivec3(INT_MAX), ivec3(INT_MAX) };
 
-        // Calculate delta distances (how far along the ray we must travel for each axis to cross one voxel)
-        glm::vec3 deltaDist = glm::vec3(
-            dir.x != 0 ? glm::abs(1.0f / dir.x) : 1e30f,
-            dir.y != 0 ? glm::abs(1.0f / dir.y) : 1e30f,
-            dir.z != 0 ? glm::abs(1.0f / dir.z) : 1e30f
-        );
+        maxDistance = glm::clamp(maxDistance, 0.1f, MAX_RAY_DISTANCE);
 
-        // Calculate initial side distances
-        glm::vec3 sideDist;
-        if (dir.x < 0) {
-            sideDist.x = (currentPos.x - static_cast<float>(worldVoxelPos.x)) * deltaDist.x;
-        }
-        else {
-            sideDist.x = (static_cast<float>(worldVoxelPos.x) + 1.0f - currentPos.x) * deltaDist.x;
+        if (glm::length(direction) < 0.001f) {
+            return miss;
         }
+        glm::vec3 dir = glm::normalize(direction);
 
-        if (dir.y < 0) {
-            sideDist.y = (currentPos.y - static_cast<float>(worldVoxelPos.y)) * deltaDist.y;
-        }
-        else {
-            sideDist.y = (static_cast<float>(worldVoxelPos.y) + 1.0f - currentPos.y) * deltaDist.y;
+        if (glm::abs(origin.x) > MAX_WORLD_COORD ||
+            glm::abs(origin.y) > MAX_WORLD_COORD ||
+            glm::abs(origin.z) > MAX_WORLD_COORD) {
+            return miss;
         }
 
-        if (dir.z < 0) {
-            sideDist.z = (currentPos.z - static_cast<float>(worldVoxelPos.z)) * deltaDist.z;
-        }
-        else {
-            sideDist.z = (static_cast<float>(worldVoxelPos.z) + 1.0f - currentPos.z) * deltaDist.z;
-        }
+        DdaState dda(origin, dir);
+        CachedChunkAccessor<std::remove_reference_t<ChunkLookup>> chunks(lookup);
 
-        // Perform DDA traversal
-        int side = 0; // Which side was hit (0=x, 1=y, 2=z)
-        constexpr int CHUNK_SIZE = 32;
-        float totalDistance = 0.0f;
-        constexpr int MAX_ITERATIONS = 10000; // Prevent infinite loops
         int iterations = 0;
-
-        // Keep track of the previous voxel position for adjacency calculation
-        glm::ivec3 previousVoxelPos = worldVoxelPos;
-
-        while (totalDistance < maxDistance && iterations < MAX_ITERATIONS) {
-            iterations++;
-
-            // Bounds check for world coordinates
-            if (glm::abs(worldVoxelPos.x) > MAX_WORLD_COORD ||
-                glm::abs(worldVoxelPos.y) > MAX_WORLD_COORD ||
-                glm::abs(worldVoxelPos.z) > MAX_WORLD_COORD) {
+        while (dda.t <= maxDistance && iterations++ < MAX_ITERATIONS) {
+            if (glm::abs(dda.voxel.x) > MAX_WORLD_COORD ||
+                glm::abs(dda.voxel.y) > MAX_WORLD_COORD ||
+                glm::abs(dda.voxel.z) > MAX_WORLD_COORD) {
                 break;
             }
 
-            // Calculate which chunk this world voxel belongs to
-            ivec3 chunkPos = ivec3(
-                worldVoxelPos.x >= 0 ? worldVoxelPos.x / CHUNK_SIZE : (worldVoxelPos.x - CHUNK_SIZE + 1) / CHUNK_SIZE,
-                worldVoxelPos.y >= 0 ? worldVoxelPos.y / CHUNK_SIZE : (worldVoxelPos.y - CHUNK_SIZE + 1) / CHUNK_SIZE,
-                worldVoxelPos.z >= 0 ? worldVoxelPos.z / CHUNK_SIZE : (worldVoxelPos.z - CHUNK_SIZE + 1) / CHUNK_SIZE
-            );
+            ivec3 chunkPos = floorDiv(dda.voxel, CHUNK_SIZE);
+            const std::shared_ptr<ThreadSafeChunk>& chunk = chunks.get(chunkPos);
 
-            // Bounds check for chunk coordinates
-            const int MAX_CHUNK_COORD = MAX_WORLD_COORD / CHUNK_SIZE;
-            if (glm::abs(chunkPos.x) > MAX_CHUNK_COORD ||
-                glm::abs(chunkPos.y) > MAX_CHUNK_COORD ||
-                glm::abs(chunkPos.z) > MAX_CHUNK_COORD) {
-                break;
-            }
-
-            // Get the chunk at this position with null safety
-            std::shared_ptr<ThreadSafeChunk> chunk = nullptr;
-            try {
-                chunk = getChunkCallback(chunkPos);
+            if (!chunk || chunk->getSolidVoxels() == 0) {
+                dda.skipCell(chunkPos * CHUNK_SIZE, CHUNK_SIZE);
+                continue;
             }
-            catch (...) {
-                // Handle any exceptions from the callback
-                break;
+            ChunkState state = chunk->getState();
+            if (state == ChunkState::Air || state == ChunkState::Unloading) {
+                dda.skipCell(chunkPos * CHUNK_SIZE, CHUNK_SIZE);
+                continue;
             }
 
-            if (chunk) {
-                // Convert world voxel position to chunk-local coordinates
-                ivec3 localVoxelPos = ivec3(
-                    worldVoxelPos.x - chunkPos.x * CHUNK_SIZE,
-                    worldVoxelPos.y - chunkPos.y * CHUNK_SIZE,
-                    worldVoxelPos.z - chunkPos.z * CHUNK_SIZE
-                );
-
-                // Ensure local coordinates are within chunk bounds
-                if (localVoxelPos.x >= 0 && localVoxelPos.x < CHUNK_SIZE &&
-                    localVoxelPos.y >= 0 && localVoxelPos.y < CHUNK_SIZE &&
-                    localVoxelPos.z >= 0 && localVoxelPos.z < CHUNK_SIZE) {
-
-                    // Check if current voxel is solid
-                    try {
-                        if (chunk->getVoxel(localVoxelPos)) {
-                            // Calculate the adjacent voxel position based on which face we hit
-                            glm::ivec3 adjacentPos = worldVoxelPos;
-                            if (side == 0) { // Hit X face
-                                adjacentPos.x -= step.x;
-                            }
-                            else if (side == 1) { // Hit Y face
-                                adjacentPos.y -= step.y;
-                            }
-                            else { // Hit Z face
-                                adjacentPos.z -= step.z;
-                            }
-
-                            // Bounds check the adjacent position
-                            if (glm::abs(adjacentPos.x) <= MAX_WORLD_COORD &&
-                                glm::abs(adjacentPos.y) <= MAX_WORLD_COORD &&
-                                glm::abs(adjacentPos.z) <= MAX_WORLD_COORD) {
+            // Walk regions, bricks and voxels of this chunk under a single lock
+            ivec3 chunkOrigin = chunkPos * CHUNK_SIZE;
+            bool hit = chunk->withVoxelData([&](const uint8_t* bits, const uint64_t* bricks, uint64_t regions) {
+                while (dda.t <= maxDistance && iterations++ < MAX_ITERATIONS) {
+                    ivec3 local = dda.voxel - chunkOrigin;
+                    if (local.x < 0 || local.x >= CHUNK_SIZE ||
+                        local.y < 0 || local.y >= CHUNK_SIZE ||
+                        local.z < 0 || local.z >= CHUNK_SIZE) {
+                        return false; // Left the chunk
+                    }
 
-                                // Return the intersection result
-                                return RayIntersectionResult{
-                                    true,           // hit
-                                    worldVoxelPos,  // hitVoxelPos
-                                    adjacentPos     // adjacentVoxelPos
-                                };
-                            }
-                        }
+                    if (!ChunkOccupancy::testRegionBit(regions, local.x, local.y, local.z)) {
+                        dda.skipCell(chunkOrigin + (local / REGION_SIZE) * REGION_SIZE, REGION_SIZE);
+                        continue;
                     }
-                    catch (...) {
-                        // Handle any exceptions from voxel access
-                        break;
+                    if (!ChunkOccupancy::testBrickBit(bricks, local.x, local.y, local.z)) {
+                        dda.skipCell(chunkOrigin + (local / BRICK_SIZE) * BRICK_SIZE, BRICK_SIZE);
+                        continue;
                     }
-                }
-            }
 
-            // Store current position as previous before moving
-            previousVoxelPos = worldVoxelPos;
-
-            // Move to next voxel and track distance
-            if (sideDist.x < sideDist.y && sideDist.x < sideDist.z) {
-                // X side is closest
-                totalDistance = sideDist.x;
-                sideDist.x += deltaDist.x;
-                worldVoxelPos.x += step.x;
-                side = 0;
-            }
-            else if (sideDist.y < sideDist.z) {
-                // Y side is closest
-                totalDistance = sideDist.y;
-                sideDist.y += deltaDist.y;
-                worldVoxelPos.y += step.y;
-                side = 1;
-            }
-            else {
-                // Z side is closest
-                totalDistance = sideDist.z;
-                sideDist.z += deltaDist.z;
-                worldVoxelPos.z += step.z;
-                side = 2;
+                    if (ChunkOccupancy::testVoxelBit(bits, local.x, local.y, local.z)) {
+                        return true;
+                    }
+                    dda.stepVoxel();
+                }
+                return false;
+            });
+
+            if (hit) {
+                RayIntersectionResult result;
+                result.hit = true;
+                result.hitVoxelPos = dda.voxel;
+                result.normal = ivec3(0);
+                result.normal[dda.axis] = -dda.step[dda.axis];
+                result.adjacentVoxelPos = dda.voxel + result.normal;
+                result.distance = dda.t;
+                return result;
             }
         }
 
-        // No intersection found within max distance
-        return RayIntersectionResult{
-            false,              // hit
-            ivec3(INT_MAX, INT_MAX, INT_MAX),    // hitVoxelPos (invalid)
-            ivec3(INT_MAX, INT_MAX, INT_MAX)     // adjacentVoxelPos (invalid)
-        };
+        return miss;
     }
 
     // Modified multi-chunk version with safety checks
@@ -233,7 +168,7 @@ public:
         glm::vec3 previousPos = currentPos;
 
         // Step size for ray marching (smaller = more accurate, larger = faster)
-        const float stepSize = 0.1f;
+        constexpr float stepSize = 0.1f;
         glm::vec3 rayStep = dir * stepSize;
 
         float totalDistance = 0.0f;
@@ -353,4 +288,88 @@ public:
 
         return intersectionPoint;
     }
-};
\ No newline at end of file
+
+private:
+    static ivec3 floorDiv(const ivec3& v, int size) {
+        return ivec3(
+            v.x >= 0 ? v.x / size : (v.x - size + 1) / size,
+            v.y >= 0 ? v.y / size : (v.y - size + 1) / size,
+            v.z >= 0 ? v.z / size : (v.z - size + 1) / size
+        );
+    }
+
+    // Voxel-resolution DDA that can also jump over whole aligned cells.
+    // After a jump the entered voxel is re-derived from integer cell bounds,
+    // so skipping never drifts off the grid.
+    struct DdaState {
+        vec3 origin;
+        vec3 dir;
+        ivec3 voxel;
+        ivec3 step;
+        vec3 tDelta;
+        vec3 tMax;
+        float t = 0.0f;
+        int axis = 0; // Axis of the last boundary crossed
+
+        DdaState(const vec3& o, const vec3& d) : origin(o), dir(d) {
+            voxel = ivec3(glm::floor(origin));
+            for (int a = 0; a < 3; ++a) {
+                step[a] = dir[a] > 0 ? 1 : -1;
+                tDelta[a] = dir[a] != 0 ? glm::abs(1.0f / dir[a]) : 1e30f;
+            }
+            resetTMax();
+        }
+
+        void resetTMax() {
+            for (int a = 0; a < 3; ++a) {
+                if (dir[a] == 0) {
+                    tMax[a] = 1e30f;
+                    continue;
+                }
+                float boundary = static_cast<float>(voxel[a] + (step[a] > 0 ? 1 : 0));
+                tMax[a] = (boundary - origin[a]) / dir[a];
+            }
+        }
+
+        void stepVoxel() {
+            if (tMax.x < tMax.y && tMax.x < tMax.z) axis = 0;
+            else if (tMax.y < tMax.z) axis = 1;
+            else axis = 2;
+
+            t = tMax[axis];
+            tMax[axis] += tDelta[axis];
+            voxel[axis] += step[axis];
+        }
+
+        // Move to the first voxel past the aligned cell [cellMin, cellMin + size)
+        void skipCell(const ivec3& cellMin, int size) {
+            vec3 tExit;
+            for (int a = 0; a < 3; ++a) {
+                if (dir[a] == 0) {
+                    tExit[a] = 1e30f;
+                    continue;
+                }
+                float boundary = static_cast<float>(step[a] > 0 ? cellMin[a] + size : cellMin[a]);
+                tExit[a] = (boundary - origin[a]) / dir[a];
+            }
+
+            if (tExit.x < tExit.y && tExit.x < tExit.z) axis = 0;
+            else if (tExit.y < tExit.z) axis = 1;
+            else axis = 2;
+
+            t = glm::max(t, tExit[axis]);
+            vec3 p = origin + dir * t;
+            for (int a = 0; a < 3; ++a) {
+                if (a == axis) {
+                    voxel[a] = step[a] > 0 ? cellMin[a] + size : cellMin[a] - 1;
+                }
+                else {
+                    voxel[a] = glm::clamp(static_cast<int>(glm::floor(p[a])), cellMin[a], cellMin[a] + size - 1);
+                }
+            }
+            resetTMax();
+        }
+    };
+};
+
+#endif
@@ -0,0 +1,454 @@
+// RayBatch.h - Packet raycasting for many rays per frame (AI sight, audio, probes)
+#ifndef RAY_BATCH
+#define RAY_BATCH
+
+#include "glm/glm.hpp"
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <numeric>
+#include <functional>
+#include <cmath>
+#include <cstdint>
+#include "VoxelSnapshot.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define RAY_BATCH_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RAY_BATCH_SSE
+#endif
+
+using glm::vec3;
+using glm::ivec3;
+
+// Structure-of-arrays ray input. Directions need not be normalized.
+struct RayBatchInput {
+    std::vector<float> originX, originY, originZ;
+    std::vector<float> dirX, dirY, dirZ;
+    float maxDistance = 100.0f;
+
+    void reserve(size_t count) {
+        originX.reserve(count); originY.reserve(count); originZ.reserve(count);
+        dirX.reserve(count); dirY.reserve(count); dirZ.reserve(count);
+    }
+
+    void addRay(const vec3& origin, const vec3& direction) {
+        originX.push_back(origin.x); originY.push_back(origin.y); originZ.push_back(origin.z);
+        dirX.push_back(direction.x); dirY.push_back(direction.y); dirZ.push_back(direction.z);
+    }
+
+    void clear() {
+        originX.clear(); originY.clear(); originZ.clear();
+        dirX.clear(); dirY.clear(); dirZ.clear();
+    }
+
+    size_t size() const {
+        return originX.size();
+    }
+};
+
+// Structure-of-arrays results, indexed like the input. Misses keep INT32_MAX
+// positions, matching RayIntersectionResult.
+struct RayBatchResults {
+    std::vector<uint8_t> hit;
+    std::vector<int32_t> hitX, hitY, hitZ;
+    std::vector<int8_t> normalX, normalY, normalZ;
+    std::vector<float> distance;
+
+    void resize(size_t count) {
+        hit.assign(count, 0);
+        hitX.assign(count, INT32_MAX); hitY.assign(count, INT32_MAX); hitZ.assign(count, INT32_MAX);
+        normalX.assign(count, 0); normalY.assign(count, 0); normalZ.assign(count, 0);
+        distance.assign(count, 0.0f);
+    }
+
+    size_t size() const {
+        return hit.size();
+    }
+};
+
+// Lane back-ends. Each exposes the same static interface so the packet
+// traversal is written once.
+struct ScalarLanes {
+    static constexpr int WIDTH = 1;
+    using F = float;
+    using M = bool;
+
+    static F load(const float* p) { return *p; }
+    static void store(float* p, F v) { *p = v; }
+    static F set1(float v) { return v; }
+    static F add(F a, F b) { return a + b; }
+    static F sub(F a, F b) { return a - b; }
+    static F mul(F a, F b) { return a * b; }
+    static F min(F a, F b) { return a < b ? a : b; }
+    static F max(F a, F b) { return a > b ? a : b; }
+    static F floor(F a) { return std::floor(a); }
+    static M lt(F a, F b) { return a < b; }
+    static M gt(F a, F b) { return a > b; }
+    static M andMask(M a, M b) { return a && b; }
+    static M orMask(M a, M b) { return a || b; }
+    static M andNotMask(M a, M b) { return !a && b; }
+    static F select(M m, F a, F b) { return m ? a : b; }
+};
+
+#if defined(RAY_BATCH_SSE) || defined(RAY_BATCH_AVX)
+struct SseLanes {
+    static constexpr int WIDTH = 4;
+    using F = __m128;
+    using M = __m128;
+
+    static F load(const float* p) { return _mm_load_ps(p); }
+    static void store(float* p, F v) { _mm_store_ps(p, v); }
+    static F set1(float v) { return _mm_set1_ps(v); }
+    static F add(F a, F b) { return _mm_add_ps(a, b); }
+    static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+    static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+    static F min(F a, F b) { return _mm_min_ps(a, b); }
+    static F max(F a, F b) { return _mm_max_ps(a, b); }
+    static F floor(F a) {
+        // SSE2 has no floor: truncate, then correct negative non-integers
+        F t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+        return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a), _mm_set1_ps(1.0f)));
+    }
+    static M lt(F a, F b) { return _mm_cmplt_ps(a, b); }
+    static M gt(F a, F b) { return _mm_cmpgt_ps(a, b); }
+    static M andMask(M a, M b) { return _mm_and_ps(a, b); }
+    static M orMask(M a, M b) { return _mm_or_ps(a, b); }
+    static M andNotMask(M a, M b) { return _mm_andnot_ps(a, b); }
+    static F select(M m, F a, F b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+};
+#endif
+
+#if defined(RAY_BATCH_AVX)
+struct AvxLanes {
+    static constexpr int WIDTH = 8;
+    using F = __m256;
+    using M = __m256;
+
+    static F load(const float* p) { return _mm256_load_ps(p); }
+    static void store(float* p, F v) { _mm256_store_ps(p, v); }
+    static F set1(float v) { return _mm256_set1_ps(v); }
+    static F add(F a, F b) { return _mm256_add_ps(a, b); }
+    static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+    static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+    static F min(F a, F b) { return _mm256_min_ps(a, b); }
+    static F max(F a, F b) { return _mm256_max_ps(a, b); }
+    static F floor(F a) { return _mm256_floor_ps(a); }
+    static M lt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static M gt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+    static M andMask(M a, M b) { return _mm256_and_ps(a, b); }
+    static M orMask(M a, M b) { return _mm256_or_ps(a, b); }
+    static M andNotMask(M a, M b) { return _mm256_andnot_ps(a, b); }
+    static F select(M m, F a, F b) { return _mm256_blendv_ps(b, a, m); }
+};
+#endif
+
+// Four lanes by default even on AVX builds: lanes in a packet run until the
+// longest ray finishes, and at eight lanes that divergence cost more than the
+// wider math saved. AvxLanes can still be passed to castRange explicitly.
+#if defined(RAY_BATCH_SSE) || defined(RAY_BATCH_AVX)
+using DefaultRayLanes = SseLanes;
+#else
+using DefaultRayLanes = ScalarLanes;
+#endif
+
+class RayBatchCaster;
+
+// Handle for a batch running on worker threads. Results are valid once
+// isDone() returns true or wait() has returned.
+class RayBatchJob {
+    friend class RayBatchCaster;
+
+    std::shared_ptr<const VoxelSnapshot> snapshot;
+    RayBatchInput rays;
+    RayBatchResults results;
+    std::vector<uint32_t> order;
+
+    std::atomic<int> remainingTasks{ 0 };
+    mutable std::mutex doneMutex;
+    mutable std::condition_variable doneCondition;
+
+    void finishTask() {
+        if (remainingTasks.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(doneMutex);
+            doneCondition.notify_all();
+        }
+    }
+
+public:
+    bool isDone() const {
+        return remainingTasks.load() == 0;
+    }
+
+    void wait() const {
+        std::unique_lock<std::mutex> lock(doneMutex);
+        doneCondition.wait(lock, [this] { return remainingTasks.load() == 0; });
+    }
+
+    const RayBatchResults& getResults() const {
+        return results;
+    }
+};
+
+class RayBatchCaster {
+public:
+    static constexpr int RAYS_PER_TASK = 256;
+    static constexpr float MAX_RAY_DISTANCE = 4096.0f;
+
+    // Trace every ray on the calling thread
+    static void cast(const VoxelSnapshot& snapshot, const RayBatchInput& rays, RayBatchResults& results) {
+        results.resize(rays.size());
+        std::vector<uint32_t> order = coherentOrder(rays);
+        castRange(snapshot, rays, order, 0, order.size(), results);
+    }
+
+    // Split the batch into tasks of RAYS_PER_TASK coherent rays and hand them to
+    // submit(std::function<void()>), which returns false if it could not queue
+    // the task; rejected tasks run inline so the job always completes.
+    template <typename Submit>
+    static std::shared_ptr<RayBatchJob> castAsync(std::shared_ptr<const VoxelSnapshot> snapshot, RayBatchInput rays, Submit&& submit) {
+        auto job = std::make_shared<RayBatchJob>();
+        job->snapshot = std::move(snapshot);
+        job->rays = std::move(rays);
+        job->results.resize(job->rays.size());
+        job->order = coherentOrder(job->rays);
+
+        size_t count = job->order.size();
+        if (count == 0 || !job->snapshot) {
+            return job;
+        }
+
+        int taskCount = static_cast<int>((count + RAYS_PER_TASK - 1) / RAYS_PER_TASK);
+        job->remainingTasks.store(taskCount);
+
+        for (int i = 0; i < taskCount; ++i) {
+            size_t begin = static_cast<size_t>(i) * RAYS_PER_TASK;
+            size_t end = std::min(count, begin + RAYS_PER_TASK);
+            std::function<void()> task = [job, begin, end] {
+                castRange(*job->snapshot, job->rays, job->order, begin, end, job->results);
+                job->finishTask();
+            };
+            if (!submit(task)) {
+                task();
+            }
+        }
+        return job;
+    }
+
+    template <typename L = DefaultRayLanes>
+    static void castRange(const VoxelSnapshot& snapshot, const RayBatchInput& rays, const std::vector<uint32_t>& order,
+        size_t begin, size_t end, RayBatchResults& results) {
+        constexpr int W = L::WIDTH;
+        if (snapshot.empty()) {
+            return; // Everything misses; results are already cleared
+        }
+        float maxDistance = glm::clamp(rays.maxDistance, 0.1f, MAX_RAY_DISTANCE);
+
+        for (size_t i = begin; i < end; i += W) {
+            int count = static_cast<int>(std::min<size_t>(W, end - i));
+            tracePacket<L>(snapshot, rays, order.data() + i, count, maxDistance, results);
+        }
+    }
+
+    // Group rays by direction octant, then by origin chunk along a Morton
+    // curve, so packet lanes step through the same chunks and bricks.
+    static std::vector<uint32_t> coherentOrder(const RayBatchInput& rays) {
+        size_t count = rays.size();
+        std::vector<uint64_t> keys(count);
+        for (size_t i = 0; i < count; ++i) {
+            uint64_t octant = (rays.dirX[i] < 0 ? 1u : 0u) | (rays.dirY[i] < 0 ? 2u : 0u) | (rays.dirZ[i] < 0 ? 4u : 0u);
+            uint32_t cx = chunkKeyCoord(rays.originX[i]);
+            uint32_t cy = chunkKeyCoord(rays.originY[i]);
+            uint32_t cz = chunkKeyCoord(rays.originZ[i]);
+            keys[i] = (octant << 60) | (spreadBits(cx) | (spreadBits(cy) << 1) | (spreadBits(cz) << 2));
+        }
+
+        std::vector<uint32_t> order(count);
+        std::iota(order.begin(), order.end(), 0u);
+        std::sort(order.begin(), order.end(), [&keys](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+        return order;
+    }
+
+private:
+    static constexpr int MAX_ITERATIONS = 100000;
+    static constexpr float MAX_WORLD_COORD = 1000000.0f;
+
+    static uint32_t chunkKeyCoord(float v) {
+        int chunk = static_cast<int>(std::floor(glm::clamp(v, -MAX_WORLD_COORD, MAX_WORLD_COORD) / VoxelSnapshot::CHUNK_SIZE));
+        return static_cast<uint32_t>(chunk + (1 << 19)) & 0xFFFFFu;
+    }
+
+    static uint64_t spreadBits(uint32_t v) {
+        uint64_t result = 0;
+        for (int bit = 0; bit < 20; ++bit) {
+            result |= static_cast<uint64_t>((v >> bit) & 1u) << (bit * 3);
+        }
+        return result;
+    }
+
+    // Distance at which the ray leaves the snapshot bounds (capped at
+    // maxDistance), or -1 if it never enters them
+    static float clipToBounds(const vec3& origin, const vec3& dir, const vec3& boundsMin, const vec3& boundsMax, float maxDistance) {
+        float tEnter = 0.0f;
+        float tExit = maxDistance;
+        for (int a = 0; a < 3; ++a) {
+            float t0 = (boundsMin[a] - origin[a]) / dir[a];
+            float t1 = (boundsMax[a] - origin[a]) / dir[a];
+            tEnter = std::max(tEnter, std::min(t0, t1));
+            tExit = std::min(tExit, std::max(t0, t1));
+        }
+        return tEnter <= tExit ? tExit : -1.0f;
+    }
+
+    // Lockstep DDA over one packet. Occupancy lookups are a scalar gather;
+    // the cell-exit math runs in SIMD. Every lane exits an aligned empty cell
+    // of its own size (32, 8, 4 or 1) per iteration, recomputing t from the ray
+    // origin, so mixed skip sizes within a packet stay exact.
+    template <typename L>
+    static void tracePacket(const VoxelSnapshot& snapshot, const RayBatchInput& rays, const uint32_t* indices, int count,
+        float maxDistance, RayBatchResults& results) {
+        constexpr int W = L::WIDTH;
+        using F = typename L::F;
+        using M = typename L::M;
+
+        alignas(32) float ox[W], oy[W], oz[W];
+        alignas(32) float dx[W], dy[W], dz[W];
+        alignas(32) float ix[W], iy[W], iz[W];
+        alignas(32) float vx[W], vy[W], vz[W];
+        alignas(32) float nx[W], ny[W], nz[W];
+        alignas(32) float t[W], tLimit[W], cellSize[W], invCellSize[W], active[W];
+        VoxelSnapshot::ChunkCache caches[W];
+
+        vec3 boundsMin = snapshot.getBoundsMin();
+        vec3 boundsMax = snapshot.getBoundsMax();
+
+        int activeCount = 0;
+        for (int lane = 0; lane < W; ++lane) {
+            vec3 origin(0.0f), dir(1.0f, 0.0f, 0.0f);
+            bool valid = false;
+            if (lane < count) {
+                uint32_t ray = indices[lane];
+                origin = vec3(rays.originX[ray], rays.originY[ray], rays.originZ[ray]);
+                vec3 rawDir(rays.dirX[ray], rays.dirY[ray], rays.dirZ[ray]);
+                valid = glm::length(rawDir) >= 0.001f &&
+                    glm::abs(origin.x) <= MAX_WORLD_COORD &&
+                    glm::abs(origin.y) <= MAX_WORLD_COORD &&
+                    glm::abs(origin.z) <= MAX_WORLD_COORD;
+                if (valid) {
+                    dir = glm::normalize(rawDir);
+                }
+            }
+
+            // Axis-parallel rays: a tiny positive component keeps the exit
+            // distance on that axis huge and positive without a special case
+            for (int a = 0; a < 3; ++a) {
+                if (dir[a] == 0.0f) dir[a] = 1e-20f;
+            }
+
+            ox[lane] = origin.x; oy[lane] = origin.y; oz[lane] = origin.z;
+            dx[lane] = dir.x; dy[lane] = dir.y; dz[lane] = dir.z;
+            ix[lane] = 1.0f / dir.x; iy[lane] = 1.0f / dir.y; iz[lane] = 1.0f / dir.z;
+            vx[lane] = std::floor(origin.x); vy[lane] = std::floor(origin.y); vz[lane] = std::floor(origin.z);
+            nx[lane] = dir.x > 0 ? -1.0f : 1.0f; ny[lane] = 0.0f; nz[lane] = 0.0f;
+            t[lane] = 0.0f;
+            tLimit[lane] = valid ? clipToBounds(origin, dir, boundsMin, boundsMax, maxDistance) : -1.0f;
+            valid = valid && tLimit[lane] >= 0.0f;
+            cellSize[lane] = 1.0f;
+            invCellSize[lane] = 1.0f;
+            active[lane] = valid ? 1.0f : 0.0f;
+            activeCount += valid ? 1 : 0;
+        }
+
+        const F zero = L::set1(0.0f);
+        const F one = L::set1(1.0f);
+        const F minusOne = L::set1(-1.0f);
+        const F half = L::set1(0.5f);
+        const F OX = L::load(ox), OY = L::load(oy), OZ = L::load(oz);
+        const F DX = L::load(dx), DY = L::load(dy), DZ = L::load(dz);
+        const F IX = L::load(ix), IY = L::load(iy), IZ = L::load(iz);
+        const M posX = L::gt(DX, zero), posY = L::gt(DY, zero), posZ = L::gt(DZ, zero);
+        const F normalX = L::select(posX, minusOne, one);
+        const F normalY = L::select(posY, minusOne, one);
+        const F normalZ = L::select(posZ, minusOne, one);
+
+        int iterations = 0;
+        while (activeCount > 0 && iterations++ < MAX_ITERATIONS) {
+            // Gather: classify the current cell of each live lane
+            for (int lane = 0; lane < W; ++lane) {
+                if (active[lane] == 0.0f) continue;
+
+                ivec3 voxel(static_cast<int>(vx[lane]), static_cast<int>(vy[lane]), static_cast<int>(vz[lane]));
+                if (t[lane] > tLimit[lane] ||
+                    glm::abs(vx[lane]) > MAX_WORLD_COORD ||
+                    glm::abs(vy[lane]) > MAX_WORLD_COORD ||
+                    glm::abs(vz[lane]) > MAX_WORLD_COORD) {
+                    active[lane] = 0.0f;
+                    --activeCount;
+                    continue;
+                }
+
+                int size = snapshot.emptyCellSize(voxel, caches[lane]);
+                if (size == 0) {
+                    uint32_t ray = indices[lane];
+                    results.hit[ray] = 1;
+                    results.hitX[ray] = voxel.x; results.hitY[ray] = voxel.y; results.hitZ[ray] = voxel.z;
+                    results.normalX[ray] = static_cast<int8_t>(nx[lane]);
+                    results.normalY[ray] = static_cast<int8_t>(ny[lane]);
+                    results.normalZ[ray] = static_cast<int8_t>(nz[lane]);
+                    results.distance[ray] = t[lane];
+                    active[lane] = 0.0f;
+                    --activeCount;
+                    continue;
+                }
+                cellSize[lane] = static_cast<float>(size);
+                invCellSize[lane] = 1.0f / static_cast<float>(size);
+            }
+            if (activeCount == 0) break;
+
+            // Step: exit the aligned empty cell along the nearest face
+            F S = L::load(cellSize);
+            F invS = L::load(invCellSize);
+            F VX = L::load(vx), VY = L::load(vy), VZ = L::load(vz);
+            F T = L::load(t);
+
+            F minX = L::mul(L::floor(L::mul(VX, invS)), S);
+            F minY = L::mul(L::floor(L::mul(VY, invS)), S);
+            F minZ = L::mul(L::floor(L::mul(VZ, invS)), S);
+            F maxX = L::add(minX, S), maxY = L::add(minY, S), maxZ = L::add(minZ, S);
+
+            F tx = L::mul(L::sub(L::select(posX, maxX, minX), OX), IX);
+            F ty = L::mul(L::sub(L::select(posY, maxY, minY), OY), IY);
+            F tz = L::mul(L::sub(L::select(posZ, maxZ, minZ), OZ), IZ);
+
+            M xNearest = L::andMask(L::lt(tx, ty), L::lt(tx, tz));
+            M yNearest = L::andNotMask(xNearest, L::lt(ty, tz));
+            M xyNearest = L::orMask(xNearest, yNearest);
+
+            F tNew = L::max(T, L::min(tx, L::min(ty, tz)));
+
+            F cx = L::min(L::max(L::floor(L::add(OX, L::mul(DX, tNew))), minX), L::sub(maxX, one));
+            F cy = L::min(L::max(L::floor(L::add(OY, L::mul(DY, tNew))), minY), L::sub(maxY, one));
+            F cz = L::min(L::max(L::floor(L::add(OZ, L::mul(DZ, tNew))), minZ), L::sub(maxZ, one));
+
+            F ax = L::select(posX, maxX, L::sub(minX, one));
+            F ay = L::select(posY, maxY, L::sub(minY, one));
+            F az = L::select(posZ, maxZ, L::sub(minZ, one));
+
+            M live = L::gt(L::load(active), half);
+            L::store(vx, L::select(live, L::select(xNearest, ax, cx), VX));
+            L::store(vy, L::select(live, L::select(yNearest, ay, cy), VY));
+            L::store(vz, L::select(live, L::select(xyNearest, cz, az), VZ));
+            L::store(t, L::select(live, tNew, T));
+            L::store(nx, L::select(live, L::select(xNearest, normalX, zero), L::load(nx)));
+            L::store(ny, L::select(live, L::select(yNearest, normalY, zero), L::load(ny)));
+            L::store(nz, L::select(live, L::select(xyNearest, zero, normalZ), L::load(nz)));
+        }
+    }
+};
+
+#endif
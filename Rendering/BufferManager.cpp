@@ -1,41 +1,64 @@
 #include "BufferManager.h"
 
-void BufferManager::deleteBuffer(std::string bufferName) {
-    Buffer buffer = getBuffer(bufferName);
+void BufferManager::deleteBuffer(const std::string& bufferName) {
+    Buffer buffer = buffers.erase(bufferName);
     if (buffer) {
+        MemoryTracker::instance().release(MemoryCategory::SharedGpu, buffer.getSize());
         buffer.destroy();
         buffer.release();
-        buffers.erase(bufferName);
     }
 }
 
-void BufferManager::writeBuffer(const std::string bufferName, uint64_t bufferOffset, void* data, size_t size) {
-    Buffer buffer = getBuffer(bufferName);
+void BufferManager::writeBuffer(BufferHandle handle, uint64_t bufferOffset, const void* data, size_t size) {
+    Buffer buffer = getBuffer(handle);
     if (buffer) {
         queue.writeBuffer(buffer, bufferOffset, data, size);
     }
 }
 
-Buffer BufferManager::createBuffer(std::string bufferName, BufferDescriptor config) {
+void BufferManager::writeBuffer(const std::string& bufferName, uint64_t bufferOffset, const void* data, size_t size) {
+    writeBuffer(findBuffer(bufferName), bufferOffset, data, size);
+}
+
+Buffer BufferManager::createBuffer(const std::string& bufferName, const BufferDescriptor& config) {
     Buffer buffer = device.createBuffer(config);
-    buffers[bufferName] = buffer;
+    if (buffer) {
+        MemoryTracker::instance().allocate(MemoryCategory::SharedGpu, config.size);
+    }
+
+    Buffer previous = buffers.insert(bufferName, buffer);
+    if (previous) {
+        MemoryTracker::instance().release(MemoryCategory::SharedGpu, previous.getSize());
+        previous.destroy();
+        previous.release();
+    }
+    return buffer;
+}
 
+Buffer BufferManager::createTrackedBuffer(const BufferDescriptor& config, MemoryCategory category) {
+    Buffer buffer = device.createBuffer(config);
+    if (buffer) {
+        MemoryTracker::instance().allocate(category, config.size);
+    }
     return buffer;
 }
 
-Buffer BufferManager::getBuffer(std::string bufferName) {
-    auto buffer = buffers.find(bufferName);
-    if (buffer != buffers.end()) {
-        return buffer->second;
+void BufferManager::destroyTrackedBuffer(Buffer& buffer, MemoryCategory category) {
+    if (!buffer) {
+        return;
     }
-    return nullptr;
+    MemoryTracker::instance().release(category, buffer.getSize());
+    buffer.destroy();
+    buffer.release();
+    buffer = nullptr;
 }
 
 void BufferManager::terminate() {
-    for (auto pair : buffers) {
-        if (pair.second) {
-            pair.second.destroy();
-            pair.second.release();
+    buffers.forEach([](const std::string&, Buffer buffer) {
+        if (buffer) {
+            MemoryTracker::instance().release(MemoryCategory::SharedGpu, buffer.getSize());
+            buffer.destroy();
+            buffer.release();
         }
-    }
+    });
 }
\ No newline at end of file
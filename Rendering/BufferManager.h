@@ -4,11 +4,13 @@
 
 #include <unordered_map>
 #include <webgpu/webgpu.hpp>
+#include "../MemoryTracker.h"
+#include "ResourceHandle.h"
 
 using namespace wgpu;
 
 class BufferManager {
-    std::unordered_map<std::string, Buffer> buffers;
+    SlotMap<BufferTag, Buffer> buffers;
     Device device;
     Queue queue;
 
@@ -18,11 +20,23 @@ public:
     Device getDevice() const { return device; }
     Queue getQueue() const { return queue; }
 
-    Buffer createBuffer(std::string bufferName, BufferDescriptor config);
-    Buffer getBuffer(std::string bufferName);
-    void writeBuffer(const std::string bufferName, uint64_t bufferOffset, void* data, size_t size);
+    // Creating under an existing name replaces the buffer in place and keeps
+    // its handle, see ResourceHandle.h
+    Buffer createBuffer(const std::string& bufferName, const BufferDescriptor& config);
 
-    void deleteBuffer(std::string bufferName);
+    // Name lookups are for setup and tooling, per frame code keeps handles
+    BufferHandle findBuffer(const std::string& bufferName) const { return buffers.find(bufferName); }
+    Buffer getBuffer(BufferHandle handle) const { return buffers.get(handle); }
+    Buffer getBuffer(const std::string& bufferName) const { return buffers.get(buffers.find(bufferName)); }
+
+    void writeBuffer(BufferHandle handle, uint64_t bufferOffset, const void* data, size_t size);
+    void writeBuffer(const std::string& bufferName, uint64_t bufferOffset, const void* data, size_t size);
+
+    void deleteBuffer(const std::string& bufferName);
+
+    // Unnamed buffers owned by chunks, counted under their memory category
+    Buffer createTrackedBuffer(const BufferDescriptor& config, MemoryCategory category);
+    static void destroyTrackedBuffer(Buffer& buffer, MemoryCategory category);
 
     void terminate();
 };
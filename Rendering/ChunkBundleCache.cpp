@@ -0,0 +1,207 @@
+#include "ChunkBundleCache.h"
+#include <algorithm>
+
+namespace {
+
+int floorDiv(int value, int divisor) {
+    return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+ivec3 clusterOf(const ivec3& chunkPosition) {
+    constexpr int CLUSTER_VOXELS = ChunkBundleCache::CLUSTER_CHUNKS * 32;
+    return ivec3(floorDiv(chunkPosition.x, CLUSTER_VOXELS), floorDiv(chunkPosition.y, CLUSTER_VOXELS), floorDiv(chunkPosition.z, CLUSTER_VOXELS));
+}
+
+bool positionLess(const ChunkRenderData& a, const ChunkRenderData& b) {
+    if (a.chunkPosition.x != b.chunkPosition.x) return a.chunkPosition.x < b.chunkPosition.x;
+    if (a.chunkPosition.y != b.chunkPosition.y) return a.chunkPosition.y < b.chunkPosition.y;
+    return a.chunkPosition.z < b.chunkPosition.z;
+}
+
+// Everything a recorded draw depends on
+bool sameDraws(const std::vector<ChunkRenderData>& a, const std::vector<ChunkRenderData>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].chunkPosition != b[i].chunkPosition ||
+            a[i].chunkDataBindGroup != b[i].chunkDataBindGroup ||
+            a[i].materialBindGroup != b[i].materialBindGroup ||
+            a[i].vertexBuffer != b[i].vertexBuffer ||
+            a[i].vertexBufferSize != b[i].vertexBufferSize ||
+            a[i].quadCount != b[i].quadCount ||
+            a[i].faceQuadCount != b[i].faceQuadCount) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+const std::vector<RenderBundle>& ChunkBundleCache::update(const ChunkRenderList& renderList, vec3 cameraPos, const PassState& state) {
+    stats.recorded = 0;
+    bool changed = false;
+
+    // A reloaded pipeline or rebuilt global bind group invalidates every bundle
+    WGPURenderPipeline pipeline = state.pipeline;
+    WGPUBindGroup globalBindGroup = state.globalBindGroup;
+    if (pipeline != recordedPipeline || globalBindGroup != recordedGlobalBindGroup) {
+        clear();
+        recordedPipeline = pipeline;
+        recordedGlobalBindGroup = globalBindGroup;
+    }
+
+    if (renderList != currentList) {
+        static const std::vector<ChunkRenderData> noChunks;
+        regroup(renderList ? *renderList : noChunks);
+        currentList = renderList;
+        changed = true;
+    }
+
+    for (auto& [key, cluster] : clusters) {
+        ivec3 cameraKey = cameraKeyFor(key, cameraPos);
+        if (cameraKey != cluster.cameraKey) {
+            cluster.cameraKey = cameraKey;
+            cluster.dirty = true;
+        }
+        if (!cluster.dirty) {
+            continue;
+        }
+
+        if (cluster.bundle) {
+            cluster.bundle.release();
+        }
+        cluster.bundle = record(cluster, cameraPos, state);
+        cluster.dirty = false;
+        stats.recorded++;
+        changed = true;
+    }
+
+    if (changed) {
+        bundles.clear();
+        for (const auto& [key, cluster] : clusters) {
+            if (cluster.bundle) {
+                bundles.push_back(cluster.bundle);
+            }
+        }
+    }
+    stats.clusters = clusters.size();
+    return bundles;
+}
+
+void ChunkBundleCache::clear() {
+    for (auto& [key, cluster] : clusters) {
+        if (cluster.bundle) {
+            cluster.bundle.release();
+        }
+    }
+    clusters.clear();
+    bundles.clear();
+    currentList.reset();
+    recordedPipeline = nullptr;
+    recordedGlobalBindGroup = nullptr;
+}
+
+void ChunkBundleCache::regroup(const std::vector<ChunkRenderData>& renderData) {
+    for (auto& [key, members] : grouped) {
+        members.clear();
+    }
+    for (const ChunkRenderData& data : renderData) {
+        if (data.isValid()) {
+            grouped[clusterOf(data.chunkPosition)].push_back(data);
+        }
+    }
+
+    // Clusters that lost all their chunks
+    for (auto it = clusters.begin(); it != clusters.end();) {
+        auto members = grouped.find(it->first);
+        if (members == grouped.end() || members->second.empty()) {
+            if (it->second.bundle) {
+                it->second.bundle.release();
+            }
+            it = clusters.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    for (auto it = grouped.begin(); it != grouped.end();) {
+        std::vector<ChunkRenderData>& members = it->second;
+        if (members.empty()) {
+            it = grouped.erase(it);
+            continue;
+        }
+
+        // The manager's list comes from a hash map, sort so an unchanged
+        // cluster compares equal whatever order its chunks arrived in
+        std::sort(members.begin(), members.end(), positionLess);
+        Cluster& cluster = clusters[it->first];
+        if (cluster.dirty || !sameDraws(cluster.members, members)) {
+            cluster.members.swap(members);
+            cluster.dirty = true;
+        }
+        ++it;
+    }
+}
+
+// Same draws renderChunks used to encode per frame: each chunk's bind groups
+// and vertex buffer, then one draw per run of face groups facing the camera
+RenderBundle ChunkBundleCache::record(const Cluster& cluster, vec3 cameraPos, const PassState& state) {
+    WGPUTextureFormat colorFormat = state.colorFormat;
+    RenderBundleEncoderDescriptor encoderDesc = Default;
+    encoderDesc.label = "Chunk Cluster Bundle Encoder";
+    encoderDesc.colorFormatCount = 1;
+    encoderDesc.colorFormats = &colorFormat;
+    encoderDesc.depthStencilFormat = state.depthFormat;
+    encoderDesc.sampleCount = state.sampleCount;
+    encoderDesc.depthReadOnly = false;
+    encoderDesc.stencilReadOnly = true;
+    RenderBundleEncoder encoder = device.createRenderBundleEncoder(encoderDesc);
+
+    encoder.setPipeline(state.pipeline);
+    encoder.setBindGroup(0, state.globalBindGroup, 0, nullptr);
+
+    for (const ChunkRenderData& data : cluster.members) {
+        encoder.setBindGroup(1, data.materialBindGroup, 0, nullptr);
+        encoder.setBindGroup(2, data.chunkDataBindGroup, 0, nullptr);
+        encoder.setVertexBuffer(0, data.vertexBuffer, 0, data.vertexBufferSize);
+
+        // Neighbouring face groups are contiguous in the index buffer, so
+        // runs share a draw
+        uint8_t faces = data.visibleFaces(cameraPos);
+        int face = 0;
+        while (face < 6) {
+            if (!(faces & (1 << face))) {
+                face++;
+                continue;
+            }
+
+            uint32_t firstQuad = data.faceQuadStart[face];
+            uint32_t count = 0;
+            while (face < 6 && (faces & (1 << face))) {
+                count += data.faceQuadCount[face];
+                face++;
+            }
+            // Each quad is an instance, expanded to 6 vertices in vs_main
+            if (count > 0) {
+                encoder.draw(6, count, 0, firstQuad);
+            }
+        }
+    }
+
+    RenderBundleDescriptor bundleDesc = Default;
+    bundleDesc.label = "Chunk Cluster Bundle";
+    RenderBundle bundle = encoder.finish(bundleDesc);
+    encoder.release();
+    return bundle;
+}
+
+// Which face groups a chunk shows depends only on the camera's chunk
+// coordinate relative to it. Clamped to one past the cluster on each side,
+// so moving around outside a cluster's extent never records it again.
+ivec3 ChunkBundleCache::cameraKeyFor(const ivec3& cluster, vec3 cameraPos) {
+    ivec3 cameraChunk = ivec3(glm::floor(cameraPos / 32.0f));
+    ivec3 low = cluster * CLUSTER_CHUNKS;
+    ivec3 high = low + CLUSTER_CHUNKS - 1;
+    return glm::clamp(cameraChunk, low - 1, high + 1);
+}
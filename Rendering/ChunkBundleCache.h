@@ -0,0 +1,78 @@
+#ifndef CHUNK_BUNDLE_CACHE
+#define CHUNK_BUNDLE_CACHE
+
+// ChunkBundleCache.h - Chunk draws pre-recorded into render bundles
+//
+// Chunks are grouped into clusters of CLUSTER_CHUNKS^3 and the draws of each
+// cluster are recorded once into a RenderBundle that the frame replays. A
+// cluster is recorded again only when its members change (a chunk added,
+// removed or remeshed shows up as a new render list with different
+// resources) or when the camera crosses a chunk boundary inside the
+// cluster's extent, which changes the face groups its chunks can show.
+#include <webgpu/webgpu.hpp>
+#include <unordered_map>
+#include <vector>
+#include <memory>
+#include <climits>
+#include "../ThreadSafeChunk.h"
+
+using namespace wgpu;
+
+class ChunkBundleCache {
+public:
+    static constexpr int CLUSTER_CHUNKS = 4; // Chunks per cluster side
+
+    // State each bundle is recorded with, bundles inherit nothing from the pass
+    struct PassState {
+        RenderPipeline pipeline;
+        BindGroup globalBindGroup;
+        TextureFormat colorFormat = TextureFormat::Undefined;
+        TextureFormat depthFormat = TextureFormat::Depth24Plus;
+        uint32_t sampleCount = 4;
+    };
+
+    struct Stats {
+        size_t clusters = 0;
+        size_t recorded = 0; // Bundles recorded by the last update
+    };
+
+    explicit ChunkBundleCache(Device d) : device(d) {}
+    ~ChunkBundleCache() { clear(); }
+
+    // Brings the bundles up to date and returns them for executeBundles. The
+    // render list is compared by identity, the chunk manager builds a new one
+    // whenever a chunk starts or stops being drawable.
+    const std::vector<RenderBundle>& update(const ChunkRenderList& renderList, vec3 cameraPos, const PassState& state);
+
+    void clear();
+    Stats getStats() const { return stats; }
+
+private:
+    struct ClusterHash {
+        std::size_t operator()(const ivec3& k) const {
+            return std::hash<int64_t>{}((int64_t(k.x) * 73856093) ^ (int64_t(k.y) * 19349663) ^ (int64_t(k.z) * 83492791));
+        }
+    };
+
+    struct Cluster {
+        std::vector<ChunkRenderData> members; // Sorted by position
+        ivec3 cameraKey = ivec3(INT_MIN);
+        RenderBundle bundle = nullptr;
+        bool dirty = true;
+    };
+
+    void regroup(const std::vector<ChunkRenderData>& renderData);
+    RenderBundle record(const Cluster& cluster, vec3 cameraPos, const PassState& state);
+    static ivec3 cameraKeyFor(const ivec3& cluster, vec3 cameraPos);
+
+    Device device;
+    std::unordered_map<ivec3, Cluster, ClusterHash> clusters;
+    std::unordered_map<ivec3, std::vector<ChunkRenderData>, ClusterHash> grouped; // Regroup scratch
+    ChunkRenderList currentList;
+    WGPURenderPipeline recordedPipeline = nullptr;
+    WGPUBindGroup recordedGlobalBindGroup = nullptr;
+    std::vector<RenderBundle> bundles;
+    Stats stats;
+};
+
+#endif // CHUNK_BUNDLE_CACHE
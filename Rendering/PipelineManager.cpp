@@ -1,7 +1,7 @@
 #include "PipelineManager.h"
 
 
-RenderPipeline PipelineManager::createRenderPipeline(const std::string pipelineName, PipelineConfig& config) {
+RenderPipeline PipelineManager::createRenderPipeline(const std::string& pipelineName, PipelineConfig& config) {
     std::cout << "Creating shader module..." << std::endl;
     ShaderModule shaderModule = loadShaderModule(config.shaderPath, device);
     std::cout << "Shader module: " << shaderModule << std::endl;
@@ -14,7 +14,7 @@ RenderPipeline PipelineManager::createRenderPipeline(const std::string pipelineN
     vertexBufferLayout.attributeCount = static_cast<uint32_t>(config.vertexAttributes.size());
     vertexBufferLayout.attributes = config.vertexAttributes.data();
     vertexBufferLayout.arrayStride = sizeof(VertexAttributes);
-    vertexBufferLayout.stepMode = VertexStepMode::Vertex;
+    vertexBufferLayout.stepMode = config.stepMode;
 
     pipelineDesc.vertex.bufferCount = 1;
     pipelineDesc.vertex.buffers = &vertexBufferLayout;
@@ -82,7 +82,10 @@ RenderPipeline PipelineManager::createRenderPipeline(const std::string pipelineN
     RenderPipeline pipeline = device.createRenderPipeline(pipelineDesc);
     std::cout << "Render pipeline: " << pipeline << std::endl;
 
-    pipelines[pipelineName] = pipeline;
+    RenderPipeline previous = pipelines.insert(pipelineName, pipeline);
+    if (previous) {
+        previous.release();
+    }
 
     // We no longer need to access the shader module
     shaderModule.release();
@@ -90,26 +93,28 @@ RenderPipeline PipelineManager::createRenderPipeline(const std::string pipelineN
     return pipeline;
 }
 
-BindGroupLayout PipelineManager::createBindGroupLayout(const std::string bindGroupLayoutName, const std::vector<BindGroupLayoutEntry>& entries) {
+BindGroupLayout PipelineManager::createBindGroupLayout(const std::string& bindGroupLayoutName, const std::vector<BindGroupLayoutEntry>& entries) {
     BindGroupLayoutDescriptor chunkDataBindGroupLayoutDesc{};
     chunkDataBindGroupLayoutDesc.entryCount = (uint32_t)entries.size();
     chunkDataBindGroupLayoutDesc.entries = entries.data();
 
     BindGroupLayout layout = device.createBindGroupLayout(chunkDataBindGroupLayoutDesc);
-    bindGroupLayouts[bindGroupLayoutName] = layout;
+    BindGroupLayout previous = bindGroupLayouts.insert(bindGroupLayoutName, layout);
+    if (previous) {
+        previous.release();
+    }
     return layout;
 }
 
-void PipelineManager::deleteBindGroup(std::string bindGroupName) {
-    BindGroup group = getBindGroup(bindGroupName);
+void PipelineManager::deleteBindGroup(const std::string& bindGroupName) {
+    BindGroup group = bindGroups.erase(bindGroupName);
     if (group) {
         group.release();
-        bindGroups.erase(bindGroupName);
     }
 }
 
-BindGroup PipelineManager::createBindGroup(const std::string bindGroupName, const std::string bindGroupLayoutName, const std::vector<BindGroupEntry>& bindings) {
-    BindGroupLayout layout = bindGroupLayouts.find(bindGroupLayoutName)->second;
+BindGroup PipelineManager::createBindGroup(const std::string& bindGroupName, const std::string& bindGroupLayoutName, const std::vector<BindGroupEntry>& bindings) {
+    BindGroupLayout layout = getBindGroupLayout(bindGroupLayoutName);
 
     BindGroupDescriptor bindGroupDesc;
     bindGroupDesc.layout = layout;
@@ -117,52 +122,31 @@ BindGroup PipelineManager::createBindGroup(const std::string bindGroupName, cons
     bindGroupDesc.entries = bindings.data();
 
     BindGroup bindGroup = device.createBindGroup(bindGroupDesc);
-    bindGroups[bindGroupName] = bindGroup;
-    return bindGroup;
-}
-
-RenderPipeline PipelineManager::getPipeline(std::string pipelineName) {
-    auto pipeline = pipelines.find(pipelineName);
-    if (pipeline != pipelines.end()) {
-        return pipeline->second;
-    }
-    return nullptr;
-}
-
-BindGroupLayout PipelineManager::getBindGroupLayout(std::string bindGroupLayoutName) {
-    auto layout = bindGroupLayouts.find(bindGroupLayoutName);
-    if (layout != bindGroupLayouts.end()) {
-        return layout->second;
+    BindGroup previous = bindGroups.insert(bindGroupName, bindGroup);
+    if (previous) {
+        previous.release();
     }
-    return nullptr;
-}
-
-BindGroup PipelineManager::getBindGroup(std::string bindGroupLayoutName) {
-    auto bindGroup = bindGroups.find(bindGroupLayoutName);
-    if (bindGroup != bindGroups.end()) {
-        return bindGroup->second;
-    }
-    return nullptr;
+    return bindGroup;
 }
 
 void PipelineManager::terminate() {
-    for (auto pair : pipelines) {
-        if (pair.second) {
-            pair.second.release();
+    pipelines.forEach([](const std::string&, RenderPipeline pipeline) {
+        if (pipeline) {
+            pipeline.release();
         }
-    }
+    });
 
-    for (auto pair : bindGroupLayouts) {
-        if (pair.second) {
-            pair.second.release();
+    bindGroupLayouts.forEach([](const std::string&, BindGroupLayout layout) {
+        if (layout) {
+            layout.release();
         }
-    }
+    });
 
-    for (auto pair : bindGroups) {
-        if (pair.second) {
-            pair.second.release();
+    bindGroups.forEach([](const std::string&, BindGroup bindGroup) {
+        if (bindGroup) {
+            bindGroup.release();
         }
-    }
+    });
 }
 
 ShaderModule PipelineManager::loadShaderModule(const std::filesystem::path& path, Device device) {
@@ -7,12 +7,14 @@
 #include <fstream> 
 #include <vector>
 #include "../VertexAttributes.h"
+#include "ResourceHandle.h"
 
 using namespace wgpu;
 
 struct PipelineConfig {
     std::string shaderPath;
     std::vector<VertexAttribute> vertexAttributes;
+    VertexStepMode stepMode = VertexStepMode::Vertex;
     std::vector<BindGroupLayout> bindGroupLayouts;
     TextureFormat colorFormat = TextureFormat::BGRA8Unorm;
     TextureFormat depthFormat = TextureFormat::Depth24Plus;
@@ -24,9 +26,9 @@ struct PipelineConfig {
 };
 
 class PipelineManager {
-    std::unordered_map<std::string, RenderPipeline> pipelines;
-    std::unordered_map<std::string, BindGroupLayout> bindGroupLayouts;
-    std::unordered_map<std::string, BindGroup> bindGroups;
+    SlotMap<RenderPipelineTag, RenderPipeline> pipelines;
+    SlotMap<BindGroupLayoutTag, BindGroupLayout> bindGroupLayouts;
+    SlotMap<BindGroupTag, BindGroup> bindGroups;
     Device device;
     TextureFormat surfaceFormat;
 
@@ -35,13 +37,25 @@ public:
 
     Device getDevice() const { return device; }
 
-    RenderPipeline createRenderPipeline(const std::string pipelineName, PipelineConfig & config);
-    BindGroupLayout createBindGroupLayout(const std::string bindGroupLayoutName, const std::vector<BindGroupLayoutEntry>& entries);
-    BindGroup createBindGroup(const std::string bindGroupName, const std::string bindGroupLayoutName, const std::vector<BindGroupEntry>& bindings);
-    RenderPipeline getPipeline(std::string pipelineName);
-    BindGroupLayout getBindGroupLayout(std::string bindGroupLayoutName);
-    BindGroup getBindGroup(std::string bindGroupName);
-    void deleteBindGroup(std::string bindGroupName);
+    // Creating under an existing name replaces the object in place and keeps
+    // its handle, so a reloaded pipeline or rebuilt bind group needs no remap
+    RenderPipeline createRenderPipeline(const std::string& pipelineName, PipelineConfig & config);
+    BindGroupLayout createBindGroupLayout(const std::string& bindGroupLayoutName, const std::vector<BindGroupLayoutEntry>& entries);
+    BindGroup createBindGroup(const std::string& bindGroupName, const std::string& bindGroupLayoutName, const std::vector<BindGroupEntry>& bindings);
+
+    // Name lookups are for setup and tooling, per frame code keeps handles
+    RenderPipelineHandle findPipeline(const std::string& pipelineName) const { return pipelines.find(pipelineName); }
+    BindGroupLayoutHandle findBindGroupLayout(const std::string& bindGroupLayoutName) const { return bindGroupLayouts.find(bindGroupLayoutName); }
+    BindGroupHandle findBindGroup(const std::string& bindGroupName) const { return bindGroups.find(bindGroupName); }
+
+    RenderPipeline getPipeline(RenderPipelineHandle handle) const { return pipelines.get(handle); }
+    BindGroupLayout getBindGroupLayout(BindGroupLayoutHandle handle) const { return bindGroupLayouts.get(handle); }
+    BindGroup getBindGroup(BindGroupHandle handle) const { return bindGroups.get(handle); }
+
+    RenderPipeline getPipeline(const std::string& pipelineName) const { return pipelines.get(pipelines.find(pipelineName)); }
+    BindGroupLayout getBindGroupLayout(const std::string& bindGroupLayoutName) const { return bindGroupLayouts.get(bindGroupLayouts.find(bindGroupLayoutName)); }
+    BindGroup getBindGroup(const std::string& bindGroupName) const { return bindGroups.get(bindGroups.find(bindGroupName)); }
+    void deleteBindGroup(const std::string& bindGroupName);
 
     void terminate();
 private:
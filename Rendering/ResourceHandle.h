@@ -0,0 +1,151 @@
+#ifndef RESOURCE_HANDLE
+#define RESOURCE_HANDLE
+
+// ResourceHandle.h - Typed, generation checked handles for named GPU resources
+//
+// Managers keep each resource kind in a SlotMap. The name given at creation
+// is only used to find the handle once, for debug labels and for tooling,
+// the frame loop resolves handles with an index and a generation compare.
+// Creating a resource under a name that already exists puts the new object
+// in the same slot, so handles held across a resize or reload stay valid.
+// Erasing bumps the slot generation, stale handles then resolve to null.
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+
+template<typename Tag>
+struct ResourceHandle {
+    static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+    uint32_t index = INVALID_INDEX;
+    uint32_t generation = 0;
+
+    bool isValid() const { return index != INVALID_INDEX; }
+    bool operator==(const ResourceHandle& other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const ResourceHandle& other) const { return !(*this == other); }
+};
+
+struct TextureTag {};
+struct TextureViewTag {};
+struct SamplerTag {};
+struct BufferTag {};
+struct RenderPipelineTag {};
+struct BindGroupLayoutTag {};
+struct BindGroupTag {};
+
+using TextureHandle = ResourceHandle<TextureTag>;
+using TextureViewHandle = ResourceHandle<TextureViewTag>;
+using SamplerHandle = ResourceHandle<SamplerTag>;
+using BufferHandle = ResourceHandle<BufferTag>;
+using RenderPipelineHandle = ResourceHandle<RenderPipelineTag>;
+using BindGroupLayoutHandle = ResourceHandle<BindGroupLayoutTag>;
+using BindGroupHandle = ResourceHandle<BindGroupTag>;
+
+template<typename Tag, typename Resource>
+class SlotMap {
+public:
+    using Handle = ResourceHandle<Tag>;
+
+    // Stores resource under name. When the name is taken the slot and its
+    // handle are reused and the previous resource is returned, for the
+    // caller to release; otherwise the return value is null.
+    Resource insert(const std::string& name, Resource resource, Handle* handle = nullptr) {
+        auto existing = byName.find(name);
+        if (existing != byName.end()) {
+            Slot& slot = slots[existing->second];
+            Resource previous = slot.resource;
+            slot.resource = resource;
+            if (handle) *handle = { existing->second, slot.generation };
+            return previous;
+        }
+
+        uint32_t index;
+        if (!freeSlots.empty()) {
+            index = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        else {
+            index = static_cast<uint32_t>(slots.size());
+            slots.emplace_back();
+        }
+        Slot& slot = slots[index];
+        slot.resource = resource;
+        slot.name = name;
+        slot.occupied = true;
+        byName[name] = index;
+        if (handle) *handle = { index, slot.generation };
+        return nullptr;
+    }
+
+    // No hashing and no allocation, null for stale or invalid handles
+    Resource get(Handle handle) const {
+        if (handle.index < slots.size()) {
+            const Slot& slot = slots[handle.index];
+            if (slot.occupied && slot.generation == handle.generation) {
+                return slot.resource;
+            }
+        }
+        return nullptr;
+    }
+
+    Handle find(const std::string& name) const {
+        auto it = byName.find(name);
+        if (it == byName.end()) {
+            return Handle();
+        }
+        return { it->second, slots[it->second].generation };
+    }
+
+    // Removes the named entry and returns its resource for the caller to
+    // release, null if there was none
+    Resource erase(const std::string& name) {
+        auto it = byName.find(name);
+        if (it == byName.end()) {
+            return nullptr;
+        }
+        uint32_t index = it->second;
+        byName.erase(it);
+
+        Slot& slot = slots[index];
+        Resource resource = slot.resource;
+        slot.resource = nullptr;
+        slot.name.clear();
+        slot.occupied = false;
+        slot.generation++;
+        freeSlots.push_back(index);
+        return resource;
+    }
+
+    // Debug label of a live handle, empty otherwise
+    const std::string& name(Handle handle) const {
+        static const std::string none;
+        if (handle.index < slots.size() && slots[handle.index].occupied && slots[handle.index].generation == handle.generation) {
+            return slots[handle.index].name;
+        }
+        return none;
+    }
+
+    template<typename Func>
+    void forEach(Func fn) const {
+        for (const Slot& slot : slots) {
+            if (slot.occupied) {
+                fn(slot.name, slot.resource);
+            }
+        }
+    }
+
+private:
+    struct Slot {
+        Resource resource = nullptr;
+        uint32_t generation = 1;
+        bool occupied = false;
+        std::string name;
+    };
+
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots;
+    std::unordered_map<std::string, uint32_t> byName;
+};
+
+#endif // RESOURCE_HANDLE
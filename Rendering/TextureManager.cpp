@@ -1,6 +1,7 @@
 #include "TextureManager.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "../stb_image.h"
+#include <future>
 
 void TextureManager::writeTexture(const ImageCopyTexture& destination,
     const void* data, size_t size,
@@ -10,90 +11,140 @@ void TextureManager::writeTexture(const ImageCopyTexture& destination,
     queue.writeTexture(destination, data, size, source, writeSize);
 }
 
-Texture TextureManager::getTexture(const std::string textureName) {
-    auto texture = textures.find(textureName);
-    if (texture != textures.end()) {
-        return texture->second;
+Texture TextureManager::createTexture(const std::string& name, const TextureDescriptor& config) {
+    Texture texture = device.createTexture(config);
+    if (texture) {
+        MemoryTracker::instance().allocate(MemoryCategory::SharedGpu, textureBytes(texture));
+    }
+
+    Texture previous = textures.insert(name, texture);
+    if (previous) {
+        MemoryTracker::instance().release(MemoryCategory::SharedGpu, textureBytes(previous));
+        previous.destroy();
+        previous.release();
     }
-    return nullptr;
+
+    return texture;
 }
 
-TextureView TextureManager::getTextureView(const std::string viewName) {
-    auto textureView = textureViews.find(viewName);
-    if (textureView != textureViews.end()) {
-        return textureView->second;
+Texture TextureManager::createTrackedTexture(const TextureDescriptor& config, MemoryCategory category) {
+    Texture texture = device.createTexture(config);
+    if (texture) {
+        MemoryTracker::instance().allocate(category, textureBytes(texture));
     }
-    return nullptr;
+    return texture;
 }
 
-Sampler TextureManager::getSampler(const std::string samplerName) {
-    auto sampler = samplers.find(samplerName);
-    if (sampler != samplers.end()) {
-        return sampler->second;
+void TextureManager::destroyTrackedTexture(Texture& texture, MemoryCategory category) {
+    if (!texture) {
+        return;
     }
-    return nullptr;
+    MemoryTracker::instance().release(category, textureBytes(texture));
+    texture.destroy();
+    texture.release();
+    texture = nullptr;
 }
 
-Texture TextureManager::createTexture(const std::string& name, const TextureDescriptor& config) {
-    Texture texture = device.createTexture(config);
-    textures[name] = texture;
+// Size of all mips and samples, for the formats this renderer creates
+uint64_t TextureManager::textureBytes(Texture texture) {
+    uint64_t texelBytes = 4;
+    switch (texture.getFormat()) {
+    case TextureFormat::R8Unorm:
+    case TextureFormat::R8Uint:
+        texelBytes = 1;
+        break;
+    case TextureFormat::RG8Unorm:
+    case TextureFormat::RG8Uint:
+    case TextureFormat::R16Uint:
+        texelBytes = 2;
+        break;
+    default:
+        break;
+    }
 
-    return texture;
+    bool is3D = texture.getDimension() == TextureDimension::_3D;
+    uint64_t width = texture.getWidth();
+    uint64_t height = texture.getHeight();
+    uint64_t depth = texture.getDepthOrArrayLayers();
+    uint64_t total = 0;
+    for (uint32_t level = 0; level < texture.getMipLevelCount(); ++level) {
+        uint64_t levelDepth = is3D ? std::max<uint64_t>(1, depth >> level) : depth;
+        total += std::max<uint64_t>(1, width >> level) * std::max<uint64_t>(1, height >> level) * levelDepth;
+    }
+    return total * texelBytes * texture.getSampleCount();
 }
 
 TextureView TextureManager::createTextureView(const std::string& textureName, const std::string& viewName, const TextureViewDescriptor& config) {
-    auto texture = textures.find(textureName);
-    if (texture == textures.end()) {
+    Texture texture = getTexture(textureName);
+    if (!texture) {
         return nullptr;
     }
 
-    TextureView view = texture->second.createView(config);
-    textureViews[viewName] = view;
+    TextureView view = texture.createView(config);
+    TextureView previous = textureViews.insert(viewName, view);
+    if (previous) {
+        previous.release();
+    }
     return view;
 }
 
 Sampler TextureManager::createSampler(const std::string& samplerName, const SamplerDescriptor& config) {
     Sampler sampler = device.createSampler(config);
-    samplers[samplerName] = sampler;
+    Sampler previous = samplers.insert(samplerName, sampler);
+    if (previous) {
+        previous.release();
+    }
     return sampler;
 }
 
 void TextureManager::terminate() {
-    for (auto it : textures) {
-        if (it.second) {
-            it.second.destroy();
-            it.second.release();
+    textures.forEach([](const std::string&, Texture texture) {
+        if (texture) {
+            MemoryTracker::instance().release(MemoryCategory::SharedGpu, textureBytes(texture));
+            texture.destroy();
+            texture.release();
         }
-    }
+    });
 }
 
-uint32_t TextureManager::bit_width(uint32_t m) {
-    if (m == 0) return 0;
-    else { uint32_t w = 0; while (m >>= 1) ++w; return w; }
+Texture TextureManager::loadTexture(const std::string name, const std::string textureViewName, const std::filesystem::path& path) {
+    return loadTextures({ { name, textureViewName, path } }).front();
 }
 
-Texture TextureManager::loadTexture(const std::string name, const std::string textureViewName, const std::filesystem::path& path) {
-    int width, height, channels;
-    unsigned char* pixelData = stbi_load(path.string().c_str(), &width, &height, &channels, 4 /* force 4 channels */);
-    if (nullptr == pixelData) return nullptr;
+std::vector<Texture> TextureManager::loadTextures(const std::vector<TextureLoadRequest>& requests) {
+    // Decode and mip reduction are CPU only, one task per file. Device and
+    // queue calls stay on this thread.
+    std::vector<std::future<MipChain>> chains;
+    chains.reserve(requests.size());
+    for (const TextureLoadRequest& request : requests) {
+        chains.push_back(std::async(std::launch::async, TextureMips::loadMipChain, request.path, mipCacheDirectory, request.srgbMips));
+    }
+
+    std::vector<Texture> loaded;
+    loaded.reserve(requests.size());
+    for (size_t i = 0; i < requests.size(); ++i) {
+        MipChain chain = chains[i].get();
+        loaded.push_back(chain.empty() ? nullptr : createFromMipChain(requests[i], chain));
+    }
+    return loaded;
+}
 
+Texture TextureManager::createFromMipChain(const TextureLoadRequest& request, const MipChain& chain) {
     TextureDescriptor textureDesc;
     textureDesc.dimension = TextureDimension::_2D;
     textureDesc.format = TextureFormat::RGBA8Unorm; // by convention for bmp, png and jpg file. Be careful with other formats.
     textureDesc.sampleCount = 1;
-    textureDesc.size = { (unsigned int)width, (unsigned int)height, 1 };
-    textureDesc.mipLevelCount = bit_width(std::max(textureDesc.size.width, textureDesc.size.height));
+    textureDesc.size = { chain.width, chain.height, 1 };
+    textureDesc.mipLevelCount = chain.levelCount;
 
     textureDesc.usage = TextureUsage::TextureBinding | TextureUsage::CopyDst;
     textureDesc.viewFormatCount = 0;
     textureDesc.viewFormats = nullptr;
-    Texture texture = createTexture(name, textureDesc);
+    Texture texture = createTexture(request.name, textureDesc);
 
-    writeMipMaps(texture, textureDesc.size, textureDesc.mipLevelCount, pixelData);
+    uploadMipChain(texture, chain);
 
-    stbi_image_free(pixelData);
-
-    if (textureViewName.length() > 0) {
+    if (request.viewName.length() > 0) {
         TextureViewDescriptor textureViewDesc;
         textureViewDesc.aspect = TextureAspect::All;
         textureViewDesc.baseArrayLayer = 0;
@@ -102,87 +153,43 @@ Texture TextureManager::loadTexture(const std::string name, const std::string te
         textureViewDesc.mipLevelCount = textureDesc.mipLevelCount;
         textureViewDesc.dimension = TextureViewDimension::_2D;
         textureViewDesc.format = textureDesc.format;
-        TextureView view = createTextureView(name, textureViewName, textureViewDesc);
+        createTextureView(request.name, request.viewName, textureViewDesc);
     }
 
     return texture;
 }
 
-void TextureManager::writeMipMaps(
-    Texture texture,
-    Extent3D textureSize,
-    uint32_t mipLevelCount,
-    const unsigned char* pixelData)
-{
-
+void TextureManager::uploadMipChain(Texture texture, const MipChain& chain) {
     // Arguments telling which part of the texture we upload to
     ImageCopyTexture destination;
     destination.texture = texture;
     destination.origin = { 0, 0, 0 };
     destination.aspect = TextureAspect::All;
 
-    // Arguments telling how the C++ side pixel memory is laid out
+    // Every level is a slice of the one chain buffer
     TextureDataLayout source;
-    source.offset = 0;
-
-    // Create image data
-    Extent3D mipLevelSize = textureSize;
-    std::vector<unsigned char> previousLevelPixels;
-    Extent3D previousMipLevelSize;
-    for (uint32_t level = 0; level < mipLevelCount; ++level) {
-        // Pixel data for the current level
-        std::vector<unsigned char> pixels(4 * mipLevelSize.width * mipLevelSize.height);
-        if (level == 0) {
-            // We cannot really avoid this copy since we need this
-            // in previousLevelPixels at the next iteration
-            memcpy(pixels.data(), pixelData, pixels.size());
-        }
-        else {
-            // Create mip level data
-            for (uint32_t i = 0; i < mipLevelSize.width; ++i) {
-                for (uint32_t j = 0; j < mipLevelSize.height; ++j) {
-                    unsigned char* p = &pixels[4 * (j * mipLevelSize.width + i)];
-                    // Get the corresponding 4 pixels from the previous level
-                    unsigned char* p00 = &previousLevelPixels[4 * ((2 * j + 0) * previousMipLevelSize.width + (2 * i + 0))];
-                    unsigned char* p01 = &previousLevelPixels[4 * ((2 * j + 0) * previousMipLevelSize.width + (2 * i + 1))];
-                    unsigned char* p10 = &previousLevelPixels[4 * ((2 * j + 1) * previousMipLevelSize.width + (2 * i + 0))];
-                    unsigned char* p11 = &previousLevelPixels[4 * ((2 * j + 1) * previousMipLevelSize.width + (2 * i + 1))];
-                    // Average
-                    p[0] = (p00[0] + p01[0] + p10[0] + p11[0]) / 4;
-                    p[1] = (p00[1] + p01[1] + p10[1] + p11[1]) / 4;
-                    p[2] = (p00[2] + p01[2] + p10[2] + p11[2]) / 4;
-                    p[3] = (p00[3] + p01[3] + p10[3] + p11[3]) / 4;
-                }
-            }
-        }
-
-        // Upload data to the GPU texture
+    for (uint32_t level = 0; level < chain.levelCount; ++level) {
+        Extent3D mipLevelSize = { chain.levelWidth(level), chain.levelHeight(level), 1 };
         destination.mipLevel = level;
+        source.offset = 0;
         source.bytesPerRow = 4 * mipLevelSize.width;
         source.rowsPerImage = mipLevelSize.height;
-        queue.writeTexture(destination, pixels.data(), pixels.size(), source, mipLevelSize);
-
-        previousLevelPixels = std::move(pixels);
-        previousMipLevelSize = mipLevelSize;
-        mipLevelSize.width /= 2;
-        mipLevelSize.height /= 2;
+        queue.writeTexture(destination, chain.texels.data() + chain.offsets[level], chain.levelBytes(level), source, mipLevelSize);
     }
-
 }
 
 void TextureManager::removeTexture(const std::string& name) {
-    auto it = textures.find(name);
-    if (it != textures.end()) {
-        it->second.destroy();
-        it->second.release();
-        textures.erase(it);
+    Texture texture = textures.erase(name);
+    if (texture) {
+        MemoryTracker::instance().release(MemoryCategory::SharedGpu, textureBytes(texture));
+        texture.destroy();
+        texture.release();
     }
 }
 
 void TextureManager::removeTextureView(const std::string& name) {
-    auto it = textureViews.find(name);
-    if (it != textureViews.end()) {
-        it->second.release();
-        textureViews.erase(it);
+    TextureView view = textureViews.erase(name);
+    if (view) {
+        view.release();
     }
 }
\ No newline at end of file
@@ -5,15 +5,27 @@
 #include <unordered_map>
 #include <webgpu/webgpu.hpp>
 #include <filesystem>
+#include <vector>
+#include "../MemoryTracker.h"
+#include "TextureMips.h"
+#include "ResourceHandle.h"
 
 using namespace wgpu;
 
+struct TextureLoadRequest {
+    std::string name;
+    std::string viewName;   // Empty for no view
+    std::filesystem::path path;
+    bool srgbMips = false;  // Average colour in linear light when reducing mips
+};
+
 class TextureManager {
-    std::unordered_map<std::string, Texture> textures;
-    std::unordered_map<std::string, TextureView> textureViews;
-    std::unordered_map<std::string, Sampler> samplers;
+    SlotMap<TextureTag, Texture> textures;
+    SlotMap<TextureViewTag, TextureView> textureViews;
+    SlotMap<SamplerTag, Sampler> samplers;
     Device device;
     Queue queue;
+    std::filesystem::path mipCacheDirectory = "cache/textures";
 
 public:
     TextureManager(Device d, Queue q) : device(d), queue(q) {}
@@ -22,25 +34,47 @@ public:
     Device getDevice() const { return device; }
     Queue getQueue() const { return queue; }
 
+    // Creating under an existing name replaces the resource in place and
+    // keeps its handle, see ResourceHandle.h
     Texture createTexture(const std::string& name, const TextureDescriptor& config);
     TextureView createTextureView(const std::string& textureName, const std::string& viewName, const TextureViewDescriptor& config);
     Sampler createSampler(const std::string& samplerName, const SamplerDescriptor& config);
     
     Texture loadTexture(const std::string name, const std::string textureViewName, const std::filesystem::path& path);
+    // Decodes and builds mips for all requests in parallel, then creates and
+    // uploads on the calling thread. Null entries for files that failed.
+    std::vector<Texture> loadTextures(const std::vector<TextureLoadRequest>& requests);
+
+    // Where pre-mipped texels are kept between launches, empty disables it
+    void setMipCacheDirectory(const std::filesystem::path& directory) { mipCacheDirectory = directory; }
 
-    Texture getTexture(const std::string textureName);
-    TextureView getTextureView(const std::string viewName);
-    Sampler getSampler(const std::string samplerName);
+    // Name lookups are for setup and tooling, per frame code keeps handles
+    TextureHandle findTexture(const std::string& textureName) const { return textures.find(textureName); }
+    TextureViewHandle findTextureView(const std::string& viewName) const { return textureViews.find(viewName); }
+    SamplerHandle findSampler(const std::string& samplerName) const { return samplers.find(samplerName); }
+
+    Texture getTexture(TextureHandle handle) const { return textures.get(handle); }
+    TextureView getTextureView(TextureViewHandle handle) const { return textureViews.get(handle); }
+    Sampler getSampler(SamplerHandle handle) const { return samplers.get(handle); }
+
+    Texture getTexture(const std::string& textureName) const { return textures.get(textures.find(textureName)); }
+    TextureView getTextureView(const std::string& viewName) const { return textureViews.get(textureViews.find(viewName)); }
+    Sampler getSampler(const std::string& samplerName) const { return samplers.get(samplers.find(samplerName)); }
     void writeTexture(const ImageCopyTexture& destination, const void* data, size_t size, const TextureDataLayout& source, const Extent3D& writeSize);
 
     void removeTextureView(const std::string& name);
     void removeTexture(const std::string& name);
 
+    // Unnamed textures owned by chunks, counted under their memory category
+    Texture createTrackedTexture(const TextureDescriptor& config, MemoryCategory category);
+    static void destroyTrackedTexture(Texture& texture, MemoryCategory category);
+    static uint64_t textureBytes(Texture texture);
+
     void terminate();
 
 private:
-    uint32_t bit_width(uint32_t m);
-    void TextureManager::writeMipMaps(Texture texture, Extent3D textureSize, uint32_t mipLevelCount, const unsigned char* pixelData);
+    Texture createFromMipChain(const TextureLoadRequest& request, const MipChain& chain);
+    void uploadMipChain(Texture texture, const MipChain& chain);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,282 @@
+#ifndef TEXTURE_MIPS
+#define TEXTURE_MIPS
+
+// TextureMips.h - CPU side of texture loading, safe to run off the main thread
+//
+// Decodes an image and builds its whole RGBA8 mip chain in one buffer. The
+// result is cached on disk under the FNV-1a hash of the source file bytes,
+// so later launches skip both the decode and the reduction and upload the
+// cached texels directly. Any change to the source file changes the hash.
+#include <vector>
+#include <string>
+#include <array>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <thread>
+#include <functional>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+
+#include "../stb_image.h"
+
+struct MipChain {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t levelCount = 0;
+    std::vector<uint8_t> texels;  // Level 0 first, each level rows of RGBA8
+    std::vector<size_t> offsets;  // Byte offset of each level in texels
+
+    uint32_t levelWidth(uint32_t level) const { return std::max(1u, width >> level); }
+    uint32_t levelHeight(uint32_t level) const { return std::max(1u, height >> level); }
+    size_t levelBytes(uint32_t level) const { return size_t(4) * levelWidth(level) * levelHeight(level); }
+    bool empty() const { return texels.empty(); }
+};
+
+namespace TextureMips {
+
+static constexpr uint32_t CACHE_MAGIC = 0x504D5856; // "VXMP"
+static constexpr uint32_t CACHE_VERSION = 1;
+
+struct CacheHeader {
+    uint32_t magic = CACHE_MAGIC;
+    uint32_t version = CACHE_VERSION;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t levelCount = 0;
+    uint32_t srgb = 0;
+    uint64_t sourceHash = 0;
+};
+
+// Same level count the renderer has always used: floor(log2(largest side))
+inline uint32_t levelCountFor(uint32_t width, uint32_t height) {
+    uint32_t size = std::max(width, height);
+    uint32_t count = 0;
+    while (size >>= 1) ++count;
+    return std::max(count, 1u);
+}
+
+inline uint64_t hashBytes(const uint8_t* data, size_t size) {
+    // FNV-1a 64
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// 2x2 box filter with rounding. Rows are summed into 16 bit lanes first so
+// both passes are straight loops over contiguous bytes that the compiler
+// turns into SIMD adds. Odd trailing rows and columns are dropped, a one
+// texel wide source is averaged with itself.
+inline void reduceLinear(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight,
+    uint8_t* dst, uint32_t dstWidth, uint32_t dstHeight, std::vector<uint16_t>& rowSum) {
+    const size_t srcRow = size_t(4) * srcWidth;
+    rowSum.resize(srcRow);
+
+    for (uint32_t y = 0; y < dstHeight; ++y) {
+        const uint8_t* row0 = src + srcRow * std::min(2 * y, srcHeight - 1);
+        const uint8_t* row1 = src + srcRow * std::min(2 * y + 1, srcHeight - 1);
+        uint16_t* sum = rowSum.data();
+        for (size_t i = 0; i < srcRow; ++i) {
+            sum[i] = uint16_t(row0[i] + row1[i]);
+        }
+
+        uint8_t* out = dst + size_t(4) * dstWidth * y;
+        if (srcWidth == 1) {
+            for (int c = 0; c < 4; ++c) {
+                out[c] = uint8_t((sum[c] * 2 + 2) >> 2);
+            }
+            continue;
+        }
+        for (uint32_t x = 0; x < dstWidth; ++x) {
+            const uint16_t* pair = sum + 8 * size_t(x);
+            for (int c = 0; c < 4; ++c) {
+                out[4 * x + c] = uint8_t((pair[c] + pair[4 + c] + 2) >> 2);
+            }
+        }
+    }
+}
+
+// Same reduction with colour averaged in linear light, so dark and bright
+// texels blend to the brightness the eye expects. Alpha stays linear.
+inline void reduceSrgb(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight,
+    uint8_t* dst, uint32_t dstWidth, uint32_t dstHeight) {
+    static const std::array<float, 256> toLinear = [] {
+        std::array<float, 256> table{};
+        for (int i = 0; i < 256; ++i) {
+            float c = i / 255.0f;
+            table[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return table;
+    }();
+    static constexpr int TO_SRGB_STEPS = 4096;
+    static const std::array<uint8_t, TO_SRGB_STEPS + 1> toSrgb = [] {
+        std::array<uint8_t, TO_SRGB_STEPS + 1> table{};
+        for (int i = 0; i <= TO_SRGB_STEPS; ++i) {
+            float c = float(i) / TO_SRGB_STEPS;
+            float s = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+            table[i] = uint8_t(std::clamp(s * 255.0f + 0.5f, 0.0f, 255.0f));
+        }
+        return table;
+    }();
+
+    for (uint32_t y = 0; y < dstHeight; ++y) {
+        uint32_t y0 = std::min(2 * y, srcHeight - 1);
+        uint32_t y1 = std::min(2 * y + 1, srcHeight - 1);
+        for (uint32_t x = 0; x < dstWidth; ++x) {
+            uint32_t x0 = std::min(2 * x, srcWidth - 1);
+            uint32_t x1 = std::min(2 * x + 1, srcWidth - 1);
+            const uint8_t* p00 = src + 4 * (size_t(y0) * srcWidth + x0);
+            const uint8_t* p01 = src + 4 * (size_t(y0) * srcWidth + x1);
+            const uint8_t* p10 = src + 4 * (size_t(y1) * srcWidth + x0);
+            const uint8_t* p11 = src + 4 * (size_t(y1) * srcWidth + x1);
+            uint8_t* out = dst + 4 * (size_t(y) * dstWidth + x);
+            for (int c = 0; c < 3; ++c) {
+                float linear = 0.25f * (toLinear[p00[c]] + toLinear[p01[c]] + toLinear[p10[c]] + toLinear[p11[c]]);
+                out[c] = toSrgb[int(linear * TO_SRGB_STEPS + 0.5f)];
+            }
+            out[3] = uint8_t((p00[3] + p01[3] + p10[3] + p11[3] + 2) >> 2);
+        }
+    }
+}
+
+inline MipChain buildMipChain(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t levelCount, bool srgb) {
+    MipChain chain;
+    chain.width = width;
+    chain.height = height;
+    chain.levelCount = levelCount;
+
+    size_t total = 0;
+    for (uint32_t level = 0; level < levelCount; ++level) {
+        chain.offsets.push_back(total);
+        total += chain.levelBytes(level);
+    }
+    chain.texels.resize(total);
+    std::memcpy(chain.texels.data(), rgba, chain.levelBytes(0));
+
+    std::vector<uint16_t> rowSum;
+    for (uint32_t level = 1; level < levelCount; ++level) {
+        const uint8_t* src = chain.texels.data() + chain.offsets[level - 1];
+        uint8_t* dst = chain.texels.data() + chain.offsets[level];
+        if (srgb) {
+            reduceSrgb(src, chain.levelWidth(level - 1), chain.levelHeight(level - 1), dst, chain.levelWidth(level), chain.levelHeight(level));
+        }
+        else {
+            reduceLinear(src, chain.levelWidth(level - 1), chain.levelHeight(level - 1), dst, chain.levelWidth(level), chain.levelHeight(level), rowSum);
+        }
+    }
+    return chain;
+}
+
+inline std::filesystem::path cachePath(const std::filesystem::path& cacheDirectory, uint64_t sourceHash, bool srgb) {
+    char name[40];
+    std::snprintf(name, sizeof(name), "%016llx%s.mips", static_cast<unsigned long long>(sourceHash), srgb ? "-srgb" : "");
+    return cacheDirectory / name;
+}
+
+inline bool readCache(const std::filesystem::path& path, uint64_t sourceHash, bool srgb, MipChain& chain) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+
+    CacheHeader header;
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in || header.magic != CACHE_MAGIC || header.version != CACHE_VERSION ||
+        header.sourceHash != sourceHash || header.srgb != uint32_t(srgb) ||
+        header.width == 0 || header.height == 0 || header.levelCount != levelCountFor(header.width, header.height)) {
+        return false;
+    }
+
+    chain.width = header.width;
+    chain.height = header.height;
+    chain.levelCount = header.levelCount;
+    chain.offsets.clear();
+    size_t total = 0;
+    for (uint32_t level = 0; level < chain.levelCount; ++level) {
+        chain.offsets.push_back(total);
+        total += chain.levelBytes(level);
+    }
+    chain.texels.resize(total);
+    in.read(reinterpret_cast<char*>(chain.texels.data()), total);
+    if (!in) {
+        chain = MipChain();
+        return false;
+    }
+    return true;
+}
+
+// Written under a per-thread name and renamed, so two loads of the same
+// file never leave a half written entry behind
+inline void writeCache(const std::filesystem::path& path, uint64_t sourceHash, bool srgb, const MipChain& chain) {
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+    if (ec) {
+        std::cerr << "Failed to create texture cache directory: " << ec.message() << std::endl;
+        return;
+    }
+
+    std::filesystem::path temporary = path;
+    temporary += "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        CacheHeader header;
+        header.width = chain.width;
+        header.height = chain.height;
+        header.levelCount = chain.levelCount;
+        header.srgb = srgb;
+        header.sourceHash = sourceHash;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(chain.texels.data()), chain.texels.size());
+        if (!out) {
+            std::cerr << "Failed to write texture cache " << temporary << std::endl;
+            out.close();
+            std::filesystem::remove(temporary, ec);
+            return;
+        }
+    }
+    std::filesystem::rename(temporary, path, ec);
+    if (ec) {
+        std::filesystem::remove(temporary, ec);
+    }
+}
+
+// Whole CPU side of loading one texture. Empty chain if the file is missing
+// or not an image. An empty cacheDirectory disables the cache.
+inline MipChain loadMipChain(const std::filesystem::path& path, const std::filesystem::path& cacheDirectory, bool srgb) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::cerr << "Failed to open texture " << path << std::endl;
+        return MipChain();
+    }
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    uint64_t sourceHash = hashBytes(bytes.data(), bytes.size());
+    MipChain chain;
+    if (!cacheDirectory.empty() && readCache(cachePath(cacheDirectory, sourceHash, srgb), sourceHash, srgb, chain)) {
+        return chain;
+    }
+
+    int width, height, channels;
+    unsigned char* pixelData = stbi_load_from_memory(bytes.data(), int(bytes.size()), &width, &height, &channels, 4 /* force 4 channels */);
+    if (nullptr == pixelData) {
+        std::cerr << "Failed to decode texture " << path << std::endl;
+        return MipChain();
+    }
+
+    chain = buildMipChain(pixelData, width, height, levelCountFor(width, height), srgb);
+    stbi_image_free(pixelData);
+
+    if (!cacheDirectory.empty()) {
+        writeCache(cachePath(cacheDirectory, sourceHash, srgb), sourceHash, srgb, chain);
+    }
+    return chain;
+}
+
+} // namespace TextureMips
+
+#endif // TEXTURE_MIPS
@@ -65,7 +65,14 @@ bool WebGPUContext::initialize(const RenderConfig& config) {
     RequiredLimits requiredLimits = GetRequiredLimits(adapter);
     deviceDesc.nextInChain = nullptr;
     deviceDesc.label = "My Device"; // anything works here, that's your call
-    deviceDesc.requiredFeatureCount = 0; // we do not require any specific feature
+    std::vector<WGPUFeatureName> requiredFeatures;
+#if PROFILER_ENABLED
+    if (adapter.hasFeature(FeatureName::TimestampQuery)) {
+        requiredFeatures.push_back(FeatureName::TimestampQuery);
+    }
+#endif
+    deviceDesc.requiredFeatureCount = requiredFeatures.size();
+    deviceDesc.requiredFeatures = requiredFeatures.data();
     deviceDesc.requiredLimits = &requiredLimits;
     deviceDesc.defaultQueue.nextInChain = nullptr;
     deviceDesc.defaultQueue.label = "The default queue";
@@ -79,6 +86,7 @@ bool WebGPUContext::initialize(const RenderConfig& config) {
 
     device = adapter.requestDevice(deviceDesc);
     std::cout << "Got device: " << device << std::endl;
+    timestampQueriesSupported = device.hasFeature(FeatureName::TimestampQuery);
 
     uncapturedErrorCallbackHandle = device.setUncapturedErrorCallback([](ErrorType type, char const* message) {
         std::cout << "Uncaptured device error: type " << type;
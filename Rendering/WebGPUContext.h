@@ -5,6 +5,7 @@
 #include "../glm/glm.hpp"
 #include "../glm/ext.hpp"
 #include "../magic_enum.hpp"
+#include "../Profiler.h"
 
 using namespace wgpu;
 using glm::mat4x4;
@@ -45,6 +46,7 @@ public:
     TextureFormat surfaceFormat = TextureFormat::Undefined;
 
     uint32_t uniformStride = 0;
+    bool timestampQueriesSupported = false; // Requested only when the profiler is compiled in
     std::unique_ptr<ErrorCallback> uncapturedErrorCallbackHandle;
 
     Device getDevice() { return device; }
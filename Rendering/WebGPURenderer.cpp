@@ -11,6 +11,7 @@ bool WebGPURenderer::initialize() {
 	pipelineManager = std::make_unique<PipelineManager>(context->getDevice(), context->getSurfaceFormat());
 	bufferManager = std::make_unique<BufferManager>(context->getDevice(), context->getQueue());
 	textureManager = std::make_unique<TextureManager>(context->getDevice(), context->getQueue());
+	chunkBundles = std::make_unique<ChunkBundleCache>(context->getDevice());
 
 	initMultiSampleTexture();
 	initDepthTexture();
@@ -18,6 +19,8 @@ bool WebGPURenderer::initialize() {
 	initUniformBuffers();
 	initTextures();
 	initBindGroup();
+	initFarTerrain();
+	initTimestampQueries();
 
 	return true;
 }
@@ -38,42 +41,134 @@ BufferManager* WebGPURenderer::getBufferManager() {
 	return bufferManager.get();
 }
 
-void WebGPURenderer::renderChunks(MyUniforms& uniforms, const std::vector<ChunkRenderData>& chunkRenderData) {
+void WebGPURenderer::renderChunks(MyUniforms& uniforms, const ChunkRenderList& chunkRenderList) {
 	// Early exit if no chunks to render
-	if (chunkRenderData.empty()) {
+	if (!chunkRenderList || chunkRenderList->empty()) {
 		return;
 	}
 
 	// Write frame uniforms once
-	context->getQueue().writeBuffer(bufferManager->getBuffer("uniform_buffer"), 0, &uniforms, sizeof(MyUniforms));
+	context->getQueue().writeBuffer(bufferManager->getBuffer(uniformBuffer), 0, &uniforms, sizeof(MyUniforms));
 
 	auto [surfaceTexture, targetView] = GetNextSurfaceViewData();
 	if (!targetView) return;
 
-	CommandEncoderDescriptor encoderDesc = Default;
-	encoderDesc.label = "Chunk Render Encoder";
-	CommandEncoder encoder = context->getDevice().createCommandEncoder(encoderDesc);
+	CommandBuffer command;
+	bool measureGpu = timestampQuerySet && !timestampReadbackPending;
+	{
+		PROFILE_ZONE("encode");
+		CommandEncoderDescriptor encoderDesc = Default;
+		encoderDesc.label = "Chunk Render Encoder";
+		CommandEncoder encoder = context->getDevice().createCommandEncoder(encoderDesc);
+
+		// Clusters whose chunks or visible face groups changed are recorded
+		// again, the rest replay as they are
+		ChunkBundleCache::PassState bundleState;
+		bundleState.pipeline = pipelineManager->getPipeline(voxelPipeline);
+		bundleState.globalBindGroup = pipelineManager->getBindGroup(globalUniformsGroup);
+		bundleState.colorFormat = context->getSurfaceFormat();
+		const std::vector<RenderBundle>* bundles;
+		{
+			PROFILE_ZONE("bundles");
+			bundles = &chunkBundles->update(chunkRenderList, uniforms.cameraWorldPos, bundleState);
+		}
+
+		// Far terrain clears the frame, the chunks are drawn over it
+		if (farTerrainReady) {
+			encodeFarTerrainPass(encoder, uniforms);
+		}
+
+		// Set up render pass
+		RenderPassDescriptor renderPassDesc = {};
+		RenderPassColorAttachment renderPassColorAttachment = {};
+		renderPassColorAttachment.view = textureManager->getTextureView(multisampleView);
+		renderPassColorAttachment.resolveTarget = targetView;
+		renderPassColorAttachment.loadOp = farTerrainReady ? LoadOp::Load : LoadOp::Clear;
+		renderPassColorAttachment.storeOp = StoreOp::Store;
+		renderPassColorAttachment.clearValue = Color{ 0.7, 0.8, 0.9, 1.0 };
+#ifndef WEBGPU_BACKEND_WGPU
+		renderPassColorAttachment.depthSlice = WGPU_DEPTH_SLICE_UNDEFINED;
+#endif
+
+		renderPassDesc.colorAttachmentCount = 1;
+		renderPassDesc.colorAttachments = &renderPassColorAttachment;
+
+		RenderPassDepthStencilAttachment depthStencilAttachment;
+		depthStencilAttachment.view = textureManager->getTextureView(depthView);
+		depthStencilAttachment.depthClearValue = 1.0f;
+		depthStencilAttachment.depthLoadOp = LoadOp::Clear;
+		depthStencilAttachment.depthStoreOp = StoreOp::Store;
+		depthStencilAttachment.depthReadOnly = false;
+		depthStencilAttachment.stencilClearValue = 0;
+		depthStencilAttachment.stencilLoadOp = LoadOp::Undefined;
+		depthStencilAttachment.stencilStoreOp = StoreOp::Undefined;
+		depthStencilAttachment.stencilReadOnly = true;
+
+		renderPassDesc.depthStencilAttachment = &depthStencilAttachment;
+		renderPassDesc.timestampWrites = nullptr;
+
+		RenderPassTimestampWrites timestampWrites = {};
+		if (measureGpu) {
+			timestampWrites.querySet = timestampQuerySet;
+			timestampWrites.beginningOfPassWriteIndex = 0;
+			timestampWrites.endOfPassWriteIndex = 1;
+			renderPassDesc.timestampWrites = &timestampWrites;
+		}
+
+		RenderPassEncoder renderPass = encoder.beginRenderPass(renderPassDesc);
+
+		renderPass.executeBundles(bundles->size(), bundles->data());
+
+		renderPass.end();
+		renderPass.release();
+
+		if (measureGpu) {
+			encoder.resolveQuerySet(timestampQuerySet, 0, 2, timestampResolveBuffer, 0);
+			encoder.copyBufferToBuffer(timestampResolveBuffer, 0, timestampReadbackBuffer, 0, 2 * sizeof(uint64_t));
+		}
+
+		CommandBufferDescriptor cmdBufferDescriptor = {};
+		cmdBufferDescriptor.label = "Chunk Render Commands";
+		command = encoder.finish(cmdBufferDescriptor);
+		encoder.release();
+	}
+
+	PROFILE_ZONE("submit/present");
+	context->getQueue().submit(1, &command);
+	command.release();
+	if (measureGpu) {
+		readTimestamps(FrameProfiler::instance().currentFrame());
+	}
+	targetView.release();
+	context->getSurface().present();
+	context->getDevice().tick();
+}
+
+void WebGPURenderer::encodeFarTerrainPass(CommandEncoder& encoder, const MyUniforms& uniforms) {
+	farTerrainUniforms.viewProjection = farTerrainProjection * uniforms.viewMatrix;
+	farTerrainUniforms.cameraPos = vec4(uniforms.cameraWorldPos, farTerrainUniforms.cameraPos.w);
+	context->getQueue().writeBuffer(bufferManager->getBuffer(farTerrainUniformBuffer), 0, &farTerrainUniforms, sizeof(FarTerrainUniforms));
 
-	// Set up render pass
 	RenderPassDescriptor renderPassDesc = {};
-	RenderPassColorAttachment renderPassColorAttachment = {};
-	renderPassColorAttachment.view = textureManager->getTextureView("multisample_view");
-	renderPassColorAttachment.resolveTarget = targetView;
-	renderPassColorAttachment.loadOp = LoadOp::Clear;
-	renderPassColorAttachment.storeOp = StoreOp::Store;
-	renderPassColorAttachment.clearValue = Color{ 0.7, 0.8, 0.9, 1.0 };
+	RenderPassColorAttachment colorAttachment = {};
+	colorAttachment.view = textureManager->getTextureView(multisampleView);
+	colorAttachment.resolveTarget = nullptr;
+	colorAttachment.loadOp = LoadOp::Clear;
+	colorAttachment.storeOp = StoreOp::Store;
+	colorAttachment.clearValue = Color{ 0.7, 0.8, 0.9, 1.0 };
 #ifndef WEBGPU_BACKEND_WGPU
-	renderPassColorAttachment.depthSlice = WGPU_DEPTH_SLICE_UNDEFINED;
+	colorAttachment.depthSlice = WGPU_DEPTH_SLICE_UNDEFINED;
 #endif
 
 	renderPassDesc.colorAttachmentCount = 1;
-	renderPassDesc.colorAttachments = &renderPassColorAttachment;
+	renderPassDesc.colorAttachments = &colorAttachment;
 
+	// Depth only orders the far terrain against itself
 	RenderPassDepthStencilAttachment depthStencilAttachment;
-	depthStencilAttachment.view = textureManager->getTextureView("depth_view");
+	depthStencilAttachment.view = textureManager->getTextureView(depthView);
 	depthStencilAttachment.depthClearValue = 1.0f;
 	depthStencilAttachment.depthLoadOp = LoadOp::Clear;
-	depthStencilAttachment.depthStoreOp = StoreOp::Store;
+	depthStencilAttachment.depthStoreOp = StoreOp::Discard;
 	depthStencilAttachment.depthReadOnly = false;
 	depthStencilAttachment.stencilClearValue = 0;
 	depthStencilAttachment.stencilLoadOp = LoadOp::Undefined;
@@ -84,53 +179,84 @@ void WebGPURenderer::renderChunks(MyUniforms& uniforms, const std::vector<ChunkR
 	renderPassDesc.timestampWrites = nullptr;
 
 	RenderPassEncoder renderPass = encoder.beginRenderPass(renderPassDesc);
+	renderPass.setPipeline(pipelineManager->getPipeline(farTerrainPipeline));
+	renderPass.setBindGroup(0, pipelineManager->getBindGroup(farTerrainGroup), 0, nullptr);
+	renderPass.setVertexBuffer(0, bufferManager->getBuffer(farTerrainVertices), 0, HeightClipmap::POSTS * HeightClipmap::POSTS * sizeof(uint32_t));
+	renderPass.setIndexBuffer(bufferManager->getBuffer(farTerrainIndices), IndexFormat::Uint16, 0, farTerrainIndexCount * sizeof(uint16_t));
 
-	// Set pipeline once
-	renderPass.setPipeline(pipelineManager->getPipeline("voxel_pipeline"));
+	// One instance per clipmap level
+	renderPass.drawIndexed(farTerrainIndexCount, HeightClipmap::LEVELS, 0, 0, 0);
 
-	// Set global uniforms once
-	renderPass.setBindGroup(0, pipelineManager->getBindGroup("global_uniforms_group"), 0, nullptr);
+	renderPass.end();
+	renderPass.release();
+}
 
-	// Batch rendering - group chunks by material bind group to reduce state changes
-	const auto& firstChunk = chunkRenderData[0];
-	BindGroup currentMaterialBindGroup = firstChunk.materialBindGroup;
-	renderPass.setBindGroup(1, currentMaterialBindGroup, 0, nullptr);
+void WebGPURenderer::uploadFarTerrain(HeightClipmap& clipmap, float hideRadius) {
+	clipmap.forEachDirtyLevel([&](int level, const HeightClipmap::LevelState& state, const float* heights) {
+		ImageCopyTexture destination;
+		destination.texture = textureManager->getTexture(farTerrainHeights);
+		destination.mipLevel = 0;
+		destination.origin = { 0, 0, static_cast<uint32_t>(level) };
+		destination.aspect = TextureAspect::All;
 
-	// Render all chunks
-	for (const auto& data : chunkRenderData) {
-		// Validate render data
-		if (!data.isValid()) {
-			continue;
-		}
+		TextureDataLayout source;
+		source.offset = 0;
+		source.bytesPerRow = HeightClipmap::POSTS * sizeof(float);
+		source.rowsPerImage = HeightClipmap::POSTS;
 
-		// Only change material bind group if different (reduces state changes)
-		if (data.materialBindGroup != currentMaterialBindGroup) {
-			currentMaterialBindGroup = data.materialBindGroup;
-			renderPass.setBindGroup(1, currentMaterialBindGroup, 0, nullptr);
-		}
+		textureManager->writeTexture(destination, heights, HeightClipmap::POSTS * HeightClipmap::POSTS * sizeof(float), source,
+			{ HeightClipmap::POSTS, HeightClipmap::POSTS, 1 });
 
-		// Set chunk-specific bind group and buffers
-		renderPass.setBindGroup(2, data.chunkDataBindGroup, 0, nullptr);
-		renderPass.setVertexBuffer(0, data.vertexBuffer, 0, data.vertexBufferSize);
-		renderPass.setIndexBuffer(data.indexBuffer, IndexFormat::Uint16, 0, data.indexBufferSize);
+		farTerrainUniforms.levels[level] = glm::ivec4(state.origin, state.spacing, 1);
+		farTerrainReady = true;
+	});
 
-		// Draw the chunk
-		renderPass.drawIndexed(data.indexCount, 1, 0, 0, 0);
+	farTerrainUniforms.cameraPos.w = hideRadius;
+	farTerrainUniforms.fog = vec4(hideRadius, HeightClipmap::extent(), 0.0f, 0.0f);
+}
+
+void WebGPURenderer::setFarTerrainProjection(const mat4x4& projection) {
+	farTerrainProjection = projection;
+}
+
+void WebGPURenderer::initTimestampQueries() {
+#if PROFILER_ENABLED
+	if (!context->timestampQueriesSupported) {
+		return;
 	}
 
-	renderPass.end();
-	renderPass.release();
+	QuerySetDescriptor querySetDesc = Default;
+	querySetDesc.label = "Render pass timestamps";
+	querySetDesc.type = QueryType::Timestamp;
+	querySetDesc.count = 2;
+	timestampQuerySet = context->getDevice().createQuerySet(querySetDesc);
 
-	CommandBufferDescriptor cmdBufferDescriptor = {};
-	cmdBufferDescriptor.label = "Chunk Render Commands";
-	CommandBuffer command = encoder.finish(cmdBufferDescriptor);
-	encoder.release();
+	BufferDescriptor bufferDesc = Default;
+	bufferDesc.size = 2 * sizeof(uint64_t);
+	bufferDesc.usage = BufferUsage::QueryResolve | BufferUsage::CopySrc;
+	bufferDesc.mappedAtCreation = false;
+	timestampResolveBuffer = bufferManager->createBuffer("timestamp_resolve", bufferDesc);
 
-	context->getQueue().submit(1, &command);
-	command.release();
-	targetView.release();
-	context->getSurface().present();
-	context->getDevice().tick();
+	bufferDesc.usage = BufferUsage::MapRead | BufferUsage::CopyDst;
+	timestampReadbackBuffer = bufferManager->createBuffer("timestamp_readback", bufferDesc);
+#endif
+}
+
+// Timestamps are in nanoseconds. The callback runs from a later device tick.
+void WebGPURenderer::readTimestamps(uint64_t frameIndex) {
+	timestampReadbackPending = true;
+	timestampMapCallback = timestampReadbackBuffer.mapAsync(MapMode::Read, 0, 2 * sizeof(uint64_t),
+		[this, frameIndex](BufferMapAsyncStatus status) {
+			if (status == BufferMapAsyncStatus::Success) {
+				const uint64_t* times = static_cast<const uint64_t*>(
+					timestampReadbackBuffer.getConstMappedRange(0, 2 * sizeof(uint64_t)));
+				if (times && times[1] >= times[0]) {
+					FrameProfiler::instance().recordGpuTime(frameIndex, (times[1] - times[0]) / 1e6);
+				}
+				timestampReadbackBuffer.unmap();
+			}
+			timestampReadbackPending = false;
+		});
 }
 
 bool WebGPURenderer::initMultiSampleTexture() {
@@ -159,6 +285,7 @@ bool WebGPURenderer::initMultiSampleTexture() {
 	multiSampleTextureViewDesc.dimension = TextureViewDimension::_2D;
 	multiSampleTextureViewDesc.format = multiSampleTextureFormat;
 	TextureView multiSampleTextureView = textureManager->createTextureView("multisample_texture", "multisample_view", multiSampleTextureViewDesc);
+	multisampleView = textureManager->findTextureView("multisample_view");
 
 	return multiSampleTextureView != nullptr;
 }
@@ -188,6 +315,7 @@ bool WebGPURenderer::initDepthTexture() {
 	depthTextureViewDesc.dimension = TextureViewDimension::_2D;
 	depthTextureViewDesc.format = depthTextureFormat;
 	TextureView depthTextureView = textureManager->createTextureView("depth_texture", "depth_view", depthTextureViewDesc);
+	depthView = textureManager->findTextureView("depth_view");
 
 	return depthTextureView != nullptr;
 }
@@ -204,11 +332,12 @@ bool WebGPURenderer::initRenderPipeline() {
 
 	// vertex attributes
 	std::vector<VertexAttribute> vertexAttribs(1);
-	// data attribute
+	// packed quad, one per instance
 	vertexAttribs[0].shaderLocation = 0;
 	vertexAttribs[0].format = VertexFormat::Uint32;
 	vertexAttribs[0].offset = 0;
 	config.vertexAttributes = vertexAttribs;
+	config.stepMode = VertexStepMode::Instance;
 
 	// uniforms binding
 	std::vector<BindGroupLayoutEntry> globalUniforms(3, Default);
@@ -257,6 +386,7 @@ bool WebGPURenderer::initRenderPipeline() {
 	);
 
 	pipelineManager->createRenderPipeline("voxel_pipeline", config);
+	voxelPipeline = pipelineManager->findPipeline("voxel_pipeline");
 
 	return true;
 }
@@ -266,9 +396,10 @@ bool WebGPURenderer::initUniformBuffers() {
 	bufferDesc.size = sizeof(MyUniforms);
 	bufferDesc.usage = BufferUsage::CopyDst | BufferUsage::Uniform;
 	bufferDesc.mappedAtCreation = false;
-	Buffer uniformBuffer = bufferManager->createBuffer("uniform_buffer", bufferDesc);
+	Buffer buffer = bufferManager->createBuffer("uniform_buffer", bufferDesc);
+	uniformBuffer = bufferManager->findBuffer("uniform_buffer");
 
-	return uniformBuffer != nullptr;
+	return buffer != nullptr;
 }
 
 bool WebGPURenderer::initTextures() {
@@ -307,7 +438,7 @@ bool WebGPURenderer::initBindGroup() {
 	std::vector<BindGroupEntry> bindings(3);
 
 	bindings[0].binding = 0;
-	bindings[0].buffer = bufferManager->getBuffer("uniform_buffer");
+	bindings[0].buffer = bufferManager->getBuffer(uniformBuffer);
 	bindings[0].offset = 0;
 	bindings[0].size = sizeof(MyUniforms);
 
@@ -318,6 +449,138 @@ bool WebGPURenderer::initBindGroup() {
 	bindings[2].sampler = textureManager->getSampler("atlas_sampler");
 
 	BindGroup bindGroup = pipelineManager->createBindGroup("global_uniforms_group", "global_uniforms", bindings);
+	globalUniformsGroup = pipelineManager->findBindGroup("global_uniforms_group");
+
+	return bindGroup != nullptr;
+}
+
+bool WebGPURenderer::initFarTerrain() {
+	constexpr int POSTS = HeightClipmap::POSTS;
+	constexpr int CELLS = HeightClipmap::CELLS;
+
+	TextureDescriptor heightsDesc;
+	heightsDesc.dimension = TextureDimension::_2D;
+	heightsDesc.format = TextureFormat::R32Float;
+	heightsDesc.mipLevelCount = 1;
+	heightsDesc.sampleCount = 1;
+	heightsDesc.size = { POSTS, POSTS, HeightClipmap::LEVELS };
+	heightsDesc.usage = TextureUsage::TextureBinding | TextureUsage::CopyDst;
+	heightsDesc.viewFormatCount = 0;
+	heightsDesc.viewFormats = nullptr;
+	textureManager->createTexture("far_terrain_heights", heightsDesc);
+	farTerrainHeights = textureManager->findTexture("far_terrain_heights");
+
+	TextureViewDescriptor heightsViewDesc;
+	heightsViewDesc.aspect = TextureAspect::All;
+	heightsViewDesc.baseArrayLayer = 0;
+	heightsViewDesc.arrayLayerCount = HeightClipmap::LEVELS;
+	heightsViewDesc.baseMipLevel = 0;
+	heightsViewDesc.mipLevelCount = 1;
+	heightsViewDesc.dimension = TextureViewDimension::_2DArray;
+	heightsViewDesc.format = TextureFormat::R32Float;
+	TextureView heightsView = textureManager->createTextureView("far_terrain_heights", "far_terrain_heights_view", heightsViewDesc);
+
+	// One grid shared by every level, vertices carry the post index
+	std::vector<uint32_t> vertices;
+	vertices.reserve(POSTS * POSTS);
+	for (int j = 0; j < POSTS; ++j) {
+		for (int i = 0; i < POSTS; ++i) {
+			vertices.push_back(static_cast<uint32_t>(i) | (static_cast<uint32_t>(j) << 16));
+		}
+	}
+
+	std::vector<uint16_t> indices;
+	indices.reserve(CELLS * CELLS * 6);
+	for (int j = 0; j < CELLS; ++j) {
+		for (int i = 0; i < CELLS; ++i) {
+			uint16_t a = static_cast<uint16_t>(i + j * POSTS);
+			uint16_t b = static_cast<uint16_t>(a + 1);
+			uint16_t c = static_cast<uint16_t>(a + 1 + POSTS);
+			uint16_t d = static_cast<uint16_t>(a + POSTS);
+			indices.insert(indices.end(), { a, b, c, a, c, d });
+		}
+	}
+	farTerrainIndexCount = static_cast<uint32_t>(indices.size());
+
+	BufferDescriptor bufferDesc;
+	bufferDesc.mappedAtCreation = false;
+	bufferDesc.size = vertices.size() * sizeof(uint32_t);
+	bufferDesc.usage = BufferUsage::CopyDst | BufferUsage::Vertex;
+	bufferManager->createBuffer("far_terrain_vertices", bufferDesc);
+	farTerrainVertices = bufferManager->findBuffer("far_terrain_vertices");
+	bufferManager->writeBuffer(farTerrainVertices, 0, vertices.data(), bufferDesc.size);
+
+	bufferDesc.size = indices.size() * sizeof(uint16_t);
+	bufferDesc.usage = BufferUsage::CopyDst | BufferUsage::Index;
+	bufferManager->createBuffer("far_terrain_indices", bufferDesc);
+	farTerrainIndices = bufferManager->findBuffer("far_terrain_indices");
+	bufferManager->writeBuffer(farTerrainIndices, 0, indices.data(), bufferDesc.size);
+
+	bufferDesc.size = sizeof(FarTerrainUniforms);
+	bufferDesc.usage = BufferUsage::CopyDst | BufferUsage::Uniform;
+	bufferManager->createBuffer("far_terrain_uniform_buffer", bufferDesc);
+	farTerrainUniformBuffer = bufferManager->findBuffer("far_terrain_uniform_buffer");
+
+	PipelineConfig config;
+	config.shaderPath = RESOURCE_DIR "/far_terrain.wgsl";
+	config.colorFormat = TextureFormat::BGRA8Unorm;
+	config.depthFormat = TextureFormat::Depth24Plus;
+	config.sampleCount = 4;
+	config.cullMode = CullMode::Back;
+	config.depthWriteEnabled = true;
+	config.depthCompare = CompareFunction::Less;
+
+	std::vector<VertexAttribute> vertexAttribs(1);
+	vertexAttribs[0].shaderLocation = 0;
+	vertexAttribs[0].format = VertexFormat::Uint32;
+	vertexAttribs[0].offset = 0;
+	config.vertexAttributes = vertexAttribs;
+
+	std::vector<BindGroupLayoutEntry> farTerrainEntries(4, Default);
+	farTerrainEntries[0].binding = 0;
+	farTerrainEntries[0].visibility = ShaderStage::Vertex | ShaderStage::Fragment;
+	farTerrainEntries[0].buffer.type = BufferBindingType::Uniform;
+	farTerrainEntries[0].buffer.minBindingSize = sizeof(FarTerrainUniforms);
+
+	// Heights are read with textureLoad, R32Float is not filterable
+	farTerrainEntries[1].binding = 1;
+	farTerrainEntries[1].visibility = ShaderStage::Vertex;
+	farTerrainEntries[1].texture.sampleType = TextureSampleType::UnfilterableFloat;
+	farTerrainEntries[1].texture.viewDimension = TextureViewDimension::_2DArray;
+
+	farTerrainEntries[2].binding = 2;
+	farTerrainEntries[2].visibility = ShaderStage::Fragment;
+	farTerrainEntries[2].texture.sampleType = TextureSampleType::Float;
+	farTerrainEntries[2].texture.viewDimension = TextureViewDimension::_2D;
+
+	farTerrainEntries[3].binding = 3;
+	farTerrainEntries[3].visibility = ShaderStage::Fragment;
+	farTerrainEntries[3].sampler.type = SamplerBindingType::Filtering;
+
+	config.bindGroupLayouts.push_back(
+		pipelineManager->createBindGroupLayout("far_terrain_uniforms", farTerrainEntries)
+	);
+
+	pipelineManager->createRenderPipeline("far_terrain_pipeline", config);
+	farTerrainPipeline = pipelineManager->findPipeline("far_terrain_pipeline");
+
+	std::vector<BindGroupEntry> bindings(4);
+	bindings[0].binding = 0;
+	bindings[0].buffer = bufferManager->getBuffer(farTerrainUniformBuffer);
+	bindings[0].offset = 0;
+	bindings[0].size = sizeof(FarTerrainUniforms);
+
+	bindings[1].binding = 1;
+	bindings[1].textureView = heightsView;
+
+	bindings[2].binding = 2;
+	bindings[2].textureView = textureManager->getTextureView("atlas_view");
+
+	bindings[3].binding = 3;
+	bindings[3].sampler = textureManager->getSampler("atlas_sampler");
+
+	BindGroup bindGroup = pipelineManager->createBindGroup("far_terrain_group", "far_terrain_uniforms", bindings);
+	farTerrainGroup = pipelineManager->findBindGroup("far_terrain_group");
 
 	return bindGroup != nullptr;
 }
@@ -357,6 +620,10 @@ std::pair<SurfaceTexture, TextureView> WebGPURenderer::GetNextSurfaceViewData()
 }
 
 void WebGPURenderer::terminate() {
+	chunkBundles->clear();
+	if (timestampQuerySet) {
+		timestampQuerySet.release();
+	}
 	textureManager->terminate();
 	pipelineManager->terminate();
 	bufferManager->terminate();
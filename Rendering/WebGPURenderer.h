@@ -8,7 +8,9 @@
 #include "BufferManager.h"
 #include "TextureManager.h"
 #include "WebGPUContext.h"
+#include "ChunkBundleCache.h"
 #include "../ThreadSafeChunk.h"
+#include "../HeightClipmap.h"
 
 using namespace wgpu;
 using glm::mat4x4;
@@ -16,16 +18,62 @@ using glm::vec4;
 using glm::vec3;
 using glm::ivec3;
 
+// Layout matches FarTerrainUniforms in far_terrain.wgsl
+struct FarTerrainUniforms {
+    mat4x4 viewProjection;
+    vec4 cameraPos;                                // w = radius covered by voxel chunks
+    vec4 fog;                                      // x = fog start, y = fog end
+    glm::ivec4 levels[HeightClipmap::LEVELS];      // origin post xy, spacing, ready
+};
+
+static_assert(sizeof(FarTerrainUniforms) % 16 == 0);
+
 class WebGPURenderer {
 private:
     std::unique_ptr<WebGPUContext> context;
     std::unique_ptr<PipelineManager> pipelineManager;
     std::unique_ptr<BufferManager> bufferManager;
     std::unique_ptr<TextureManager> textureManager;
+    std::unique_ptr<ChunkBundleCache> chunkBundles;
 
     const float PI = 3.14159265358979323846f;
     MyUniforms uniforms;
 
+    // Resolved once by the init functions. Recreating a resource under its
+    // name keeps the handle, so a resize needs no lookups either.
+    TextureViewHandle multisampleView;
+    TextureViewHandle depthView;
+    RenderPipelineHandle voxelPipeline;
+    BindGroupHandle globalUniformsGroup;
+    BufferHandle uniformBuffer;
+    RenderPipelineHandle farTerrainPipeline;
+    BindGroupHandle farTerrainGroup;
+    BufferHandle farTerrainUniformBuffer;
+    BufferHandle farTerrainVertices;
+    BufferHandle farTerrainIndices;
+    TextureHandle farTerrainHeights;
+
+    // Render pass GPU time for the frame profiler. The readback buffer is
+    // single buffered, frames submitted while it is mapped go unmeasured.
+    QuerySet timestampQuerySet;
+    Buffer timestampResolveBuffer;
+    Buffer timestampReadbackBuffer;
+    std::unique_ptr<BufferMapCallback> timestampMapCallback;
+    bool timestampReadbackPending = false;
+
+    void initTimestampQueries();
+    void readTimestamps(uint64_t frameIndex);
+
+    // Far terrain is drawn in its own pass before the chunks, with a
+    // projection reaching the clipmap horizon. The chunk pass clears depth
+    // again, voxel geometry is always nearer than the far terrain it covers.
+    FarTerrainUniforms farTerrainUniforms = {};
+    mat4x4 farTerrainProjection = mat4x4(1.0f);
+    uint32_t farTerrainIndexCount = 0;
+    bool farTerrainReady = false;
+
+    void encodeFarTerrainPass(CommandEncoder& encoder, const MyUniforms& uniforms);
+
 public:
     bool initialize();
 
@@ -37,16 +85,22 @@ public:
     bool initTextures();
     bool initUniformBuffers();
     bool initBindGroup();
+    bool initFarTerrain();
+
+    void uploadFarTerrain(HeightClipmap& clipmap, float hideRadius);
+    void setFarTerrainProjection(const mat4x4& projection);
 
     PipelineManager* getPipelineManager();
     BufferManager* getBufferManager();
     TextureManager* getTextureManager();
+    BufferHandle getUniformBuffer() const { return uniformBuffer; }
     WebGPUContext* getContext();
     GLFWwindow* getWindow();
 
     std::pair<SurfaceTexture, TextureView> GetNextSurfaceViewData();
 
-    void renderChunks(MyUniforms& uniforms, const std::vector<ChunkRenderData>& chunkRenderData);
+    void renderChunks(MyUniforms& uniforms, const ChunkRenderList& chunkRenderList);
+    ChunkBundleCache::Stats getBundleStats() const { return chunkBundles->getStats(); }
     void terminate();
 };
 
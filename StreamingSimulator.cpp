@@ -0,0 +1,488 @@
+// StreamingSimulator.cpp - Headless world streaming run for scheduler changes
+//
+// Drives ThreadSafeChunkManager along a scripted camera path with the real
+// worker threads but no window or GPU. Uploads go to a counting sink that
+// marks chunks Active. Reports the time until the render distance is full,
+// queue depth, stuck chunks, per-stage throughput, memory per chunk state and
+// how many generated chunks had the same content as one already loaded.
+//
+// Usage: StreamingSimulator [--distance N] [--path static|line|circle]
+//        [--speed blocks/s] [--move-seconds S] [--timeout S] [--json path]
+//        [--trace path] [--split-topsoil] [--heightmap path] [--sight-rays N]
+// --trace writes a Chrome trace of chunk states and worker jobs and prints
+// per-stage latency percentiles. --split-topsoil runs topsoil as its own
+// stage after the neighbours' terrain, as before the fused job. --heightmap
+// generates from a tiled heightmap file (HeightmapSource) instead of noise.
+// --sight-rays keeps a batch of N line-of-sight rays from agents around the
+// camera in flight on the workers, as AI would, and reports its latency.
+// Edits are journaled to a scratch directory that is removed afterwards.
+// Exits with 2 if the render distance never fills, so CI can fail on it.
+
+#define WEBGPU_CPP_IMPLEMENTATION
+
+#include "ThreadSafeChunkManager.h"
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr float FRAME_SECONDS = 1.0f / 60.0f;
+constexpr float CHUNK_UPDATE_INTERVAL = 0.02f; // Same cadence as Application
+constexpr float CHECK_INTERVAL = 0.1f;
+constexpr float STUCK_SECONDS = 2.0f;
+constexpr size_t MAX_STUCK_LISTED = 10;
+constexpr float CIRCLE_RADIUS = 256.0f;
+constexpr float SIGHT_AGENT_RADIUS = 48.0f;
+constexpr int SIGHT_SNAPSHOT_CHUNKS = 2; // Chunks around the camera the rays can cross
+
+struct Options {
+    int distance = 8;
+    std::string path = "static";
+    float speed = 20.0f; // Blocks per second
+    float moveSeconds = 10.0f;
+    float timeoutSeconds = 120.0f;
+    std::string jsonPath;
+    std::string tracePath;
+    bool splitTopsoil = false;
+    std::string heightmapPath;
+    int sightRays = 0;
+};
+
+struct PosHash {
+    std::size_t operator()(const ivec3& p) const {
+        return std::hash<int64_t>{}((int64_t(p.x) * 73856093) ^ (int64_t(p.y) * 19349663) ^ (int64_t(p.z) * 83492791));
+    }
+};
+
+struct TrackedChunk {
+    ChunkState state = ChunkState::Empty;
+    bool present = false;
+    float lastChange = 0.0f;
+};
+
+struct StuckChunk {
+    ivec3 position;
+    std::string state;
+    float unchangedSeconds;
+};
+
+// Fresh journal directory per run, removed with everything in it on exit,
+// so the simulator never reads or writes the player's save
+struct ScratchSaveDirectory {
+    std::filesystem::path path = std::filesystem::temp_directory_path() /
+        ("streaming-simulator-" + std::to_string(Clock::now().time_since_epoch().count()));
+
+    ~ScratchSaveDirectory() {
+        std::error_code ec;
+        std::filesystem::remove_all(path, ec);
+    }
+};
+
+const char* stageName(int type) {
+    return ChunkWorkItem::typeName(static_cast<ChunkWorkItem::Type>(type));
+}
+
+vec3 cameraAt(const Options& options, float seconds) {
+    const vec3 start(16.0f, 16.0f, 150.0f);
+    float t = std::min(seconds, options.moveSeconds);
+
+    if (options.path == "line") {
+        return start + vec3(options.speed * t, 0.0f, 0.0f);
+    }
+    if (options.path == "circle") {
+        float angle = options.speed * t / CIRCLE_RADIUS;
+        return start + vec3(std::cos(angle) - 1.0f, std::sin(angle), 0.0f) * CIRCLE_RADIUS;
+    }
+    return start;
+}
+
+// Derivative of cameraAt
+vec3 cameraVelocityAt(const Options& options, float seconds) {
+    if (seconds >= options.moveSeconds) {
+        return vec3(0.0f);
+    }
+    if (options.path == "line") {
+        return vec3(options.speed, 0.0f, 0.0f);
+    }
+    if (options.path == "circle") {
+        float angle = options.speed * seconds / CIRCLE_RADIUS;
+        return vec3(-std::sin(angle), std::cos(angle), 0.0f) * options.speed;
+    }
+    return vec3(0.0f);
+}
+
+// Unit view direction, kept apart from the velocity: the camera faces along
+// its path and keeps the last heading once it stops. Static runs face +x.
+vec3 cameraLookAt(const Options& options, float seconds) {
+    if (options.path == "circle") {
+        float angle = options.speed * std::min(seconds, options.moveSeconds) / CIRCLE_RADIUS;
+        return vec3(-std::sin(angle), std::cos(angle), 0.0f);
+    }
+    return vec3(1.0f, 0.0f, 0.0f);
+}
+
+// Chunks the pipeline can finish around the streaming centre. The outer
+// ring of the load volume never gets all six neighbours, so it is left out.
+std::vector<ivec3> targetChunks(const ivec3& center, int distance) {
+    std::vector<ivec3> targets;
+    int horizontal = distance - 1;
+    int vertical = distance / 2 - 1;
+    for (int z = -vertical; z <= vertical; ++z) {
+        for (int y = -horizontal; y <= horizontal; ++y) {
+            for (int x = -horizontal; x <= horizontal; ++x) {
+                targets.push_back(center + ivec3(x, y, z));
+            }
+        }
+    }
+    return targets;
+}
+
+// Rays from agents on a ring around the camera towards it, at varying heights
+RayBatchInput sightRays(const vec3& camera, int count, uint32_t& seed) {
+    RayBatchInput rays;
+    rays.maxDistance = SIGHT_AGENT_RADIUS * 1.5f;
+    rays.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        float angle = (seed >> 8) * (6.2831853f / 16777216.0f);
+        float height = static_cast<float>(static_cast<int>(seed % 64) - 32);
+        vec3 agent = camera + vec3(std::cos(angle) * SIGHT_AGENT_RADIUS, std::sin(angle) * SIGHT_AGENT_RADIUS, height);
+        rays.addRay(agent, camera - agent);
+    }
+    return rays;
+}
+
+bool isDone(ChunkState state) {
+    return state == ChunkState::Active || state == ChunkState::Air;
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--distance" && hasValue) {
+            options.distance = std::max(2, std::atoi(argv[++i]));
+        }
+        else if (arg == "--path" && hasValue) {
+            options.path = argv[++i];
+            if (options.path != "static" && options.path != "line" && options.path != "circle") {
+                return false;
+            }
+        }
+        else if (arg == "--speed" && hasValue) {
+            options.speed = static_cast<float>(std::atof(argv[++i]));
+        }
+        else if (arg == "--move-seconds" && hasValue) {
+            options.moveSeconds = std::max(0.0f, static_cast<float>(std::atof(argv[++i])));
+        }
+        else if (arg == "--timeout" && hasValue) {
+            options.timeoutSeconds = std::max(1.0f, static_cast<float>(std::atof(argv[++i])));
+        }
+        else if (arg == "--json" && hasValue) {
+            options.jsonPath = argv[++i];
+        }
+        else if (arg == "--trace" && hasValue) {
+            options.tracePath = argv[++i];
+        }
+        else if (arg == "--split-topsoil") {
+            options.splitTopsoil = true;
+        }
+        else if (arg == "--heightmap" && hasValue) {
+            options.heightmapPath = argv[++i];
+        }
+        else if (arg == "--sight-rays" && hasValue) {
+            options.sightRays = std::max(0, std::atoi(argv[++i]));
+        }
+        else {
+            return false;
+        }
+    }
+    if (options.path == "static") {
+        options.moveSeconds = 0.0f;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " [--distance N] [--path static|line|circle] [--speed blocks/s]"
+            << " [--move-seconds S] [--timeout S] [--json path] [--trace path] [--split-topsoil] [--heightmap path]"
+            << " [--sight-rays N]" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Streaming simulation: distance " << options.distance << ", path " << options.path
+        << ", " << options.moveSeconds << " s of movement, timeout " << options.timeoutSeconds << " s" << std::endl;
+
+    float timeToFull = -1.0f;
+    float fullCoverage = 0.0f;
+    float elapsed = 0.0f;
+    size_t peakPendingUploads = 0;
+    uint64_t uploads = 0;
+    int frames = 0;
+    std::vector<StuckChunk> stuck;
+    std::map<std::string, int> unfinishedStates;
+    size_t targetCount = 0;
+    ChunkWorkerSystem::Stats stats;
+    MemoryReport memory;
+    ChunkDedup::Stats dedup;
+    uint64_t sightBatches = 0;
+    uint64_t sightHits = 0;
+    double sightLatencyMs = 0.0;
+
+    ChunkTracer::setEnabled(!options.tracePath.empty());
+
+    ScratchSaveDirectory saveDirectory;
+
+    {
+        ThreadSafeChunkManager chunkManager(saveDirectory.path);
+        chunkManager.setRenderDistance(options.distance);
+        chunkManager.setFusedTopsoil(!options.splitTopsoil);
+        if (!options.heightmapPath.empty()) {
+            auto heightmap = std::make_shared<HeightmapSource>();
+            if (!heightmap->open(options.heightmapPath, HeightmapSettings())) {
+                return 1;
+            }
+            chunkManager.setHeightmap(heightmap);
+        }
+
+        std::shared_ptr<RayBatchJob> sightJob;
+        Clock::time_point sightStart;
+        uint32_t sightSeed = 1;
+
+        std::unordered_map<ivec3, TrackedChunk, PosHash> tracked;
+        std::vector<ivec3> targets;
+        ivec3 targetCenter(INT32_MAX);
+
+        auto start = Clock::now();
+        float lastUpdate = -CHUNK_UPDATE_INTERVAL;
+        float lastFrame = -FRAME_SECONDS;
+        float lastCheck = -CHECK_INTERVAL;
+
+        while (true) {
+            elapsed = std::chrono::duration<float>(Clock::now() - start).count();
+
+            if (elapsed - lastUpdate >= CHUNK_UPDATE_INTERVAL) {
+                chunkManager.updateChunksAsync(cameraAt(options, elapsed), cameraLookAt(options, elapsed),
+                    cameraVelocityAt(options, elapsed));
+                chunkManager.queueReadyChunksForUpload();
+                lastUpdate = elapsed;
+            }
+
+            if (elapsed - lastFrame >= FRAME_SECONDS) {
+                {
+                    std::lock_guard<std::mutex> lock(chunkManager.gpuUploadMutex);
+                    peakPendingUploads = std::max(peakPendingUploads, chunkManager.pendingGPUUploads.size());
+                }
+                uploads += chunkManager.processUploadsWithoutGPU();
+
+                // Collect the last sight batch once it lands, then start the next
+                if (sightJob && sightJob->isDone()) {
+                    const RayBatchResults& results = sightJob->getResults();
+                    for (size_t i = 0; i < results.size(); ++i) {
+                        sightHits += results.hit[i];
+                    }
+                    sightLatencyMs += std::chrono::duration<double, std::milli>(Clock::now() - sightStart).count();
+                    sightBatches++;
+                    sightJob.reset();
+                }
+                if (!sightJob && options.sightRays > 0) {
+                    vec3 camera = cameraAt(options, elapsed);
+                    ivec3 cameraChunk = VoxelSnapshot::chunkOf(ivec3(glm::floor(camera)));
+                    sightStart = Clock::now();
+                    sightJob = chunkManager.castRayBatchAsync(
+                        chunkManager.createVoxelSnapshot(cameraChunk - ivec3(SIGHT_SNAPSHOT_CHUNKS), cameraChunk + ivec3(SIGHT_SNAPSHOT_CHUNKS)),
+                        sightRays(camera, options.sightRays, sightSeed));
+                }
+                lastFrame = elapsed;
+                frames++;
+            }
+
+            if (elapsed - lastCheck >= CHECK_INTERVAL) {
+                lastCheck = elapsed;
+
+                ivec3 center = chunkManager.getStreamingCenter();
+                if (center != targetCenter) {
+                    targetCenter = center;
+                    targets = targetChunks(center, options.distance);
+                    tracked.clear();
+                }
+
+                size_t done = 0;
+                for (const ivec3& pos : targets) {
+                    std::shared_ptr<ThreadSafeChunk> chunk = chunkManager.getChunk(pos);
+                    TrackedChunk& entry = tracked[pos];
+                    ChunkState state = chunk ? chunk->getState() : ChunkState::Empty;
+                    if (entry.present != (chunk != nullptr) || entry.state != state) {
+                        entry.present = chunk != nullptr;
+                        entry.state = state;
+                        entry.lastChange = elapsed;
+                    }
+                    done += chunk && isDone(state);
+                }
+
+                fullCoverage = targets.empty() ? 1.0f : static_cast<float>(done) / targets.size();
+                bool cameraStopped = elapsed >= options.moveSeconds;
+                if (cameraStopped && done == targets.size()) {
+                    timeToFull = elapsed;
+                    break;
+                }
+                if (elapsed >= options.timeoutSeconds) {
+                    break;
+                }
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        // Anything unfinished that has not moved for a while is stuck, e.g.
+        // work dropped at MAX_QUEUE_SIZE or a neighbour that never arrived
+        targetCount = targets.size();
+        for (const ivec3& pos : targets) {
+            const TrackedChunk& entry = tracked[pos];
+            if (entry.present && isDone(entry.state)) {
+                continue;
+            }
+            std::string state = entry.present ? chunkStateName(entry.state) : "Missing";
+            unfinishedStates[state]++;
+
+            float unchanged = elapsed - entry.lastChange;
+            if (unchanged >= STUCK_SECONDS) {
+                stuck.push_back({ pos, state, unchanged });
+            }
+        }
+
+        stats = chunkManager.getWorkerStats();
+        memory = chunkManager.getMemoryReport();
+        dedup = chunkManager.getDedupStats();
+    }
+    ChunkTracer::setEnabled(false);
+
+    // Report
+    float wallSeconds = std::max(elapsed, 1e-3f);
+    float afterStop = timeToFull >= 0.0f ? timeToFull - options.moveSeconds : -1.0f;
+
+    if (timeToFull >= 0.0f) {
+        std::printf("Render distance full after %.2f s (%.2f s after the camera stopped), %d frames\n",
+            timeToFull, afterStop, frames);
+    }
+    else {
+        std::printf("Render distance NOT full after %.2f s: %.1f%% of %zu chunks done\n",
+            elapsed, fullCoverage * 100.0f, targetCount);
+    }
+    std::printf("Queue: peak %zu, dropped %llu, cancelled %llu, left %zu. Upload sink: %llu chunks, peak pending %zu\n",
+        stats.peakQueueSize, static_cast<unsigned long long>(stats.dropped),
+        static_cast<unsigned long long>(stats.cancelled), stats.queueSize,
+        static_cast<unsigned long long>(uploads), peakPendingUploads);
+
+    std::printf("%-8s %10s %12s %12s %10s\n", "stage", "items", "items/s", "avg ms", "busy s");
+    for (int type = 0; type < ChunkWorkItem::TYPE_COUNT; ++type) {
+        uint64_t count = stats.completed[type];
+        double busy = stats.busyNanoseconds[type] * 1e-9;
+        std::printf("%-8s %10llu %12.1f %12.3f %10.2f\n", stageName(type), static_cast<unsigned long long>(count),
+            count / wallSeconds, count ? busy * 1e3 / count : 0.0, busy);
+    }
+
+    if (!unfinishedStates.empty()) {
+        std::printf("Unfinished:");
+        for (const auto& pair : unfinishedStates) {
+            std::printf(" %s=%d", pair.first.c_str(), pair.second);
+        }
+        std::printf("\n");
+    }
+    if (!stuck.empty()) {
+        std::printf("Stuck (unchanged for %.0f s or more): %zu\n", STUCK_SECONDS, stuck.size());
+        for (size_t i = 0; i < stuck.size() && i < MAX_STUCK_LISTED; ++i) {
+            std::printf("  (%d, %d, %d) %s for %.1f s\n", stuck[i].position.x, stuck[i].position.y, stuck[i].position.z,
+                stuck[i].state.c_str(), stuck[i].unchangedSeconds);
+        }
+    }
+
+    if (sightBatches > 0) {
+        std::printf("Sight rays: %llu batches of %d, avg %.3f ms from submit to seen done, %.1f%% blocked\n",
+            static_cast<unsigned long long>(sightBatches), options.sightRays, sightLatencyMs / sightBatches,
+            100.0 * sightHits / (static_cast<double>(sightBatches) * options.sightRays));
+    }
+
+    memory.print(std::cout);
+    dedup.print(std::cout);
+
+    if (!options.jsonPath.empty()) {
+        std::ofstream out(options.jsonPath);
+        out << "{\n";
+        out << "  \"benchmark\": \"streaming\",\n";
+        out << "  \"distance\": " << options.distance << ",\n";
+        out << "  \"path\": \"" << options.path << "\",\n";
+        out << "  \"speed\": " << options.speed << ",\n";
+        out << "  \"move_seconds\": " << options.moveSeconds << ",\n";
+        out << "  \"target_chunks\": " << targetCount << ",\n";
+        out << "  \"time_to_full_ms\": " << (timeToFull >= 0.0f ? timeToFull * 1000.0f : -1.0f) << ",\n";
+        out << "  \"time_after_stop_ms\": " << (afterStop >= 0.0f ? afterStop * 1000.0f : -1.0f) << ",\n";
+        out << "  \"coverage\": " << fullCoverage << ",\n";
+        out << "  \"frames\": " << frames << ",\n";
+        out << "  \"uploads\": " << uploads << ",\n";
+        out << "  \"peak_pending_uploads\": " << peakPendingUploads << ",\n";
+        out << "  \"peak_queue_depth\": " << stats.peakQueueSize << ",\n";
+        out << "  \"dropped_work_items\": " << stats.dropped << ",\n";
+        out << "  \"cancelled_work_items\": " << stats.cancelled << ",\n";
+        out << "  \"stuck_chunks\": " << stuck.size() << ",\n";
+        out << "  \"stages\": {";
+        for (int type = 0; type < ChunkWorkItem::TYPE_COUNT; ++type) {
+            uint64_t count = stats.completed[type];
+            out << (type ? ", " : " ") << "\"" << stageName(type) << "\": { \"items\": " << count
+                << ", \"items_per_second\": " << count / wallSeconds
+                << ", \"busy_ms\": " << stats.busyNanoseconds[type] / 1000000 << " }";
+        }
+        out << " },\n";
+        out << "  \"memory\": { \"cpu_bytes\": " << memory.loadedChunks.cpuBytes()
+            << ", \"gpu_bytes\": " << memory.loadedChunks.gpuBytes() << ", \"categories\": {";
+        for (int i = 0; i < MEMORY_CATEGORY_COUNT; ++i) {
+            out << (i ? ", " : " ") << "\"" << memoryCategoryName(static_cast<MemoryCategory>(i)) << "\": "
+                << memory.loadedChunks.bytes[i];
+        }
+        out << " }, \"states\": {";
+        bool firstState = true;
+        for (const auto& pair : memory.byState) {
+            out << (firstState ? " " : ", ") << "\"" << pair.first << "\": { \"chunks\": " << pair.second.chunks
+                << ", \"cpu_bytes\": " << pair.second.cpuBytes() << ", \"gpu_bytes\": " << pair.second.gpuBytes() << " }";
+            firstState = false;
+        }
+        out << " } },\n";
+        out << "  \"dedup\": { \"content_lookups\": " << dedup.contentLookups << ", \"content_hits\": " << dedup.contentHits
+            << ", \"content_hit_rate\": " << ChunkDedup::Stats::rate(dedup.contentHits, dedup.contentLookups) / 100.0
+            << ", \"distinct_contents\": " << dedup.distinctContents << " },\n";
+        out << "  \"sight_rays\": { \"rays_per_batch\": " << options.sightRays << ", \"batches\": " << sightBatches
+            << ", \"avg_latency_ms\": " << (sightBatches ? sightLatencyMs / sightBatches : 0.0) << " }\n";
+        out << "}\n";
+        if (!out) {
+            std::cerr << "Failed to write " << options.jsonPath << std::endl;
+            return 1;
+        }
+    }
+
+    if (!options.tracePath.empty()) {
+        ChunkTracer::instance().printSummary(std::cout);
+        if (!ChunkTracer::instance().writeChromeTrace(options.tracePath)) {
+            std::cerr << "Failed to write " << options.tracePath << std::endl;
+            return 1;
+        }
+    }
+
+    return timeToFull >= 0.0f ? 0 : 2;
+}
@@ -11,8 +11,15 @@
 #include "VertexAttributes.h"
 #include <array>
 #include <optional>
+#include <algorithm>
 #include <string>
 #include "WorldGenerator.h"
+#include "HeightmapSource.h"
+#include "ChunkTrace.h"
+#include "ChunkLod.h"
+#include "ChunkOccupancy.h"
+#include "EditJournal.h"
+#include "ChunkDedup.h"
 #include "Rendering/TextureManager.h"
 #include "Rendering/BufferManager.h"
 #include "Rendering/PipelineManager.h"
@@ -27,12 +34,15 @@ struct ChunkRenderData {
     BindGroup chunkDataBindGroup;
     BindGroup materialBindGroup;
 
-    Buffer indexBuffer;
+    // One record per quad, drawn as 6 vertices per instance
     Buffer vertexBuffer;
 
-    uint32_t indexBufferSize;
     uint32_t vertexBufferSize;
-    uint16_t indexCount;
+    uint32_t quadCount;
+
+    // Quad range of each face direction, in neighbour order (+X, -X, +Y, -Y, +Z, -Z)
+    std::array<uint32_t, 6> faceQuadStart{};
+    std::array<uint32_t, 6> faceQuadCount{};
 
     // Optional: chunk position for sorting/culling
     ivec3 chunkPosition;
@@ -41,10 +51,30 @@ struct ChunkRenderData {
     // Validation method
     bool isValid() const {
         return chunkDataBindGroup && materialBindGroup &&
-            indexBuffer && vertexBuffer && indexCount > 0;
+            vertexBuffer && quadCount > 0;
+    }
+
+    // Bit per face direction that can face the camera. A face is only seen
+    // from the side its normal points to, so when the whole chunk lies on one
+    // side of the camera along an axis the group pointing away is skipped.
+    uint8_t visibleFaces(vec3 cameraPos) const {
+        constexpr float CHUNK_EXTENT = 32.0f;
+        vec3 low = vec3(chunkPosition);
+        vec3 high = low + CHUNK_EXTENT;
+
+        uint8_t mask = 0;
+        for (int axis = 0; axis < 3; ++axis) {
+            if (cameraPos[axis] > low[axis]) mask |= 1 << (axis * 2);      // Positive faces
+            if (cameraPos[axis] < high[axis]) mask |= 1 << (axis * 2 + 1); // Negative faces
+        }
+        return mask;
     }
 };
 
+// Immutable snapshot of the drawable chunks. A new one is built whenever the
+// set changes, so consumers can detect changes by pointer.
+using ChunkRenderList = std::shared_ptr<const std::vector<ChunkRenderData>>;
+
 enum class ChunkState {
     Empty,              // Just created, no data
     GeneratingTerrain,  // Background thread generating voxel data
@@ -60,6 +90,24 @@ enum class ChunkState {
     RegeneratingMesh,
 };
 
+inline const char* chunkStateName(ChunkState state) {
+    switch (state) {
+    case ChunkState::Empty: return "Empty";
+    case ChunkState::GeneratingTerrain: return "GeneratingTerrain";
+    case ChunkState::TerrainReady: return "TerrainReady";
+    case ChunkState::GeneratingTopsoil: return "GeneratingTopsoil";
+    case ChunkState::TopsoilReady: return "TopsoilReady";
+    case ChunkState::GeneratingMesh: return "GeneratingMesh";
+    case ChunkState::MeshReady: return "MeshReady";
+    case ChunkState::UploadingToGPU: return "UploadingToGPU";
+    case ChunkState::Active: return "Active";
+    case ChunkState::Unloading: return "Unloading";
+    case ChunkState::Air: return "Air";
+    case ChunkState::RegeneratingMesh: return "RegeneratingMesh";
+    }
+    return "Unknown";
+}
+
 struct VoxelMaterial {
     uint16_t materialType;  // 0=air, 1=stone, 2=dirt, 3=grass, etc.
 };
@@ -67,48 +115,93 @@ struct VoxelMaterial {
 class ThreadSafeChunk {
 public:
     std::atomic<ChunkState> state{ ChunkState::Empty };
+
+    // An Active chunk meshed again in the background (LOD change) stays
+    // Active and draws its uploaded mesh; the new one is staged in quadData
+    // and swapped in by uploadToGPU
+    std::atomic<bool> remeshInPlace{ false };
+    std::atomic<bool> remeshReady{ false };
     std::atomic<int> solidVoxels{ 0 };
 
 private:
-    uint32_t lod = 0;
+    std::atomic<uint32_t> lod{ 0 }; // Reassigned by the manager as the player moves
+    uint32_t generationLod = 0;      // Level the noise lattice was picked for, fixed
+    std::atomic<bool> cancelled{ false }; // Set once when the chunk leaves the window
     WorldGenerator worldGen;
 
     static constexpr int CHUNK_SIZE = 32;
     static constexpr int TOTAL_VOXELS = CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE;
     static constexpr int BYTES_NEEDED = (TOTAL_VOXELS + 7) / 8;
 
+    // Voxels above and below the chunk generateTerrainWithTopsoil samples.
+    // Topsoil treats any step of 3 or more as stone, so that is as far as it looks.
+    static constexpr int TOPSOIL_HALO = 3;
+
+public:
+    static constexpr uint32_t WORLD_SEED = 1234;
+
+    // See ChunkOccupancy.h
+    static constexpr int BRICK_SIZE = ChunkOccupancy::BRICK_SIZE;
+    static constexpr int BRICK_MASK_WORDS = ChunkOccupancy::BRICK_MASK_WORDS;
+    using OccupancySnapshot = ChunkOccupancy::Snapshot;
+
+private:
     ivec3 position;
     ivec3 id;
 
     // Direct WebGPU resource handles - no more strings!
-    Texture materialTexture;
-    TextureView materialTextureView;
     Buffer chunkDataBuffer;
-    Buffer vertexBuffer;
-    Buffer indexBuffer;
     BindGroup chunkDataBindGroup;
-    BindGroup materialBindGroup;
+
+    // Possibly shared with identical chunks, see ChunkDedup.h. Replaced,
+    // never written, when the chunk changes.
+    SharedChunkHold<SharedChunkMaterial> sharedMaterial; // Guarded by materialDataMutex
+    SharedChunkHold<SharedChunkMesh> sharedMesh;         // Guarded by meshDataMutex
+    std::shared_ptr<ChunkDedup> dedup;                   // Null keeps every resource private
 
     // Resource state tracking
     std::atomic<bool> materialInitialized{ false };
     std::atomic<bool> chunkDataBufferInitialized{ false };
     std::atomic<bool> meshBufferInitialized{ false };
-    std::atomic<bool> bindGroupsInitialized{ false };
+    std::atomic<bool> bindGroupsInitialized{ false }; // Chunk data bind group
 
-    // Mesh data
-    uint32_t indexCount = 0;
-    uint32_t vertexBufferSize = 0;
-    uint32_t indexBufferSize = 0;
+    // Occupancy and materials, recomputed on the next refresh after an edit
+    mutable std::mutex contentMutex;
+    ChunkHash::Key contentHash;              // Guarded by contentMutex
+    std::atomic<bool> contentStale{ true };  // Set by every edit
+    ChunkHash::Key registeredContent;        // Hash counted in dedup; guarded by contentMutex
 
     // Data storage (same as before)
     std::vector<uint8_t> voxelData;
+    std::array<uint64_t, BRICK_MASK_WORDS> brickOccupancy{};
+    uint64_t regionOccupancy = 0; // 8x8x8 regions over brickOccupancy
     mutable std::mutex voxelDataMutex;
+    mutable std::shared_ptr<const OccupancySnapshot> occupancySnapshot; // Guarded by voxelDataMutex, dropped on edit
+    mutable std::shared_ptr<const LodMip> lodMip; // Guarded by voxelDataMutex, dropped on edit
     std::vector<VoxelMaterial> materialData;
     mutable std::mutex materialDataMutex;
-    std::vector<VertexAttributes> vertexData;
-    std::vector<uint16_t> indexData;
+
+    // Cold chunks keep materials and light as (length << 16 | value) runs
+    // instead of the flat arrays. Reads decode, writes unpack first.
+    std::vector<uint32_t> packedMaterials; // Guarded by materialDataMutex
+    std::vector<uint32_t> packedLight;     // Guarded by lightDataMutex
+    std::vector<VertexAttributes> quadData;           // One packed record per quad
+    std::array<uint32_t, 6> meshFaceQuadCount{};      // quadData is grouped by face direction
+    ChunkHash::Key meshHash;                          // Of quadData, keys the shared vertex buffer
     mutable std::mutex meshDataMutex;
 
+    // Voxel light, sky in the high nibble and block light in the low nibble.
+    // Solid voxels hold the brightest light offered to any of their faces.
+    // Allocated when the light engine first touches the chunk.
+    std::vector<uint8_t> lightData;
+    mutable std::mutex lightDataMutex;
+
+    // Player edits replayed from the edit journal after generation
+    std::vector<ChunkVoxelEdit> pendingEdits;
+
+    // Replaces the noise density when the world is built from a heightmap
+    std::shared_ptr<HeightmapSource> heightmap;
+
     struct ChunkData {
         glm::ivec3 worldPosition;
         uint32_t lod;
@@ -118,7 +211,13 @@ private:
 public:
     ThreadSafeChunk(const ivec3& pos = ivec3(0), const ivec3& i = ivec3(0), uint32_t lodlevel = 0)
         : position(pos), id(i), lod(lodlevel), voxelData(BYTES_NEEDED, 0) {
-        worldGen.initialize(1234);
+        worldGen.initialize(WORLD_SEED);
+
+        uint32_t level = glm::min(lodlevel, MAX_CHUNK_LOD);
+        generationLod = level;
+        worldGen.densitySpacing = CHUNK_LOD_DENSITY_SPACING[level];
+        worldGen.strataSpacing = CHUNK_LOD_STRATA_SPACING[level];
+        worldGen.densityRefineMargin = CHUNK_LOD_REFINE_MARGIN;
 
         if (voxelData.size() != BYTES_NEEDED) {
             voxelData.resize(BYTES_NEEDED, 0);
@@ -126,56 +225,81 @@ public:
         if (materialData.size() != TOTAL_VOXELS) {
             materialData.resize(TOTAL_VOXELS);
         }
+        if (ChunkTracer::isEnabled()) {
+            ChunkTracer::instance().recordState(id, chunkStateName(ChunkState::Empty));
+        }
     }
 
     ~ThreadSafeChunk() {
         cleanup();
+        std::lock_guard<std::mutex> lock(contentMutex);
+        if (dedup && registeredContent) {
+            dedup->removeContent(registeredContent);
+        }
     }
 
     ChunkState getState() const { return state.load(); }
-    void setState(ChunkState newState) { state.store(newState); }
+
+    // Queued jobs for a cancelled chunk are skipped, running ones stop at the
+    // next slice. Never reset: a chunk that comes back is a new object.
+    void cancelJobs() { cancelled.store(true); }
+    bool isCancelled() const { return cancelled.load(std::memory_order_relaxed); }
+    void setState(ChunkState newState) {
+        state.store(newState);
+        if (ChunkTracer::isEnabled()) {
+            ChunkTracer::instance().recordState(id, chunkStateName(newState));
+        }
+    }
+
+    // Update thread: start an in-place remesh of an Active chunk. False if
+    // the chunk isn't Active or already has one pending.
+    bool beginRemesh() {
+        if (state.load() != ChunkState::Active) return false;
+        return !remeshInPlace.exchange(true);
+    }
+
+    // An in-place remesh is only kept while the chunk stays Active; evicted
+    // or unloaded chunks go through the normal states again
+    bool isRemeshingInPlace() const {
+        return remeshInPlace.load() && state.load() == ChunkState::Active;
+    }
+
+    // Mesh staged by an in-place remesh, waiting for uploadToGPU
+    bool hasRemeshReady() const { return remeshReady.load() && state.load() == ChunkState::Active; }
+
+    // End of a mesh job: MeshReady for a new chunk, staged for an in-place remesh
+    void markMeshReady() {
+        if (isRemeshingInPlace()) {
+            remeshReady.store(true);
+        }
+        else {
+            finishRemesh();
+            setState(ChunkState::MeshReady);
+        }
+    }
+
+    // The staged mesh is live, or was dropped; the chunk can be remeshed again
+    void finishRemesh() {
+        remeshReady.store(false);
+        remeshInPlace.store(false);
+    }
 
     int getSolidVoxels() const { return solidVoxels.load(); }
     const ivec3& getPosition() const { return position; }
     void setPosition(const ivec3& pos) { position = pos; }
 
-    bool initializeGPUResources(TextureManager* tex, BufferManager* buf, PipelineManager* pip) {
+    // Must be set before terrain generation is queued
+    void setPendingEdits(std::vector<ChunkVoxelEdit> edits) { pendingEdits = std::move(edits); }
+    void setHeightmap(std::shared_ptr<HeightmapSource> source) { heightmap = std::move(source); }
+    void setDedup(std::shared_ptr<ChunkDedup> registry) { dedup = std::move(registry); }
+
+    // Per-position resources: the chunk data buffer and its bind group
+    bool initializeGPUResources(BufferManager* buf, PipelineManager* pip) {
         if (bindGroupsInitialized.load()) {
             return true; // Already initialized
         }
 
         try {
-            // Initialize 3D material texture
-            if (!materialInitialized.load()) {
-                TextureDescriptor textureDesc = {};
-                textureDesc.dimension = TextureDimension::_3D;
-                textureDesc.format = TextureFormat::RG8Unorm;
-                textureDesc.mipLevelCount = 1;
-                textureDesc.sampleCount = 1;
-                textureDesc.size = { CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE };
-                textureDesc.usage = TextureUsage::TextureBinding | TextureUsage::CopyDst;
-                textureDesc.label = "Chunk 3D Material Texture";
-
-                // Create texture directly
-                materialTexture = tex->getDevice().createTexture(textureDesc);
-                if (!materialTexture) return false;
-
-                // Create texture view
-                TextureViewDescriptor viewDesc = {};
-                viewDesc.aspect = TextureAspect::All;
-                viewDesc.baseArrayLayer = 0;
-                viewDesc.arrayLayerCount = 1;
-                viewDesc.baseMipLevel = 0;
-                viewDesc.mipLevelCount = 1;
-                viewDesc.dimension = TextureViewDimension::_3D;
-                viewDesc.format = TextureFormat::RG8Unorm;
-
-                materialTextureView = materialTexture.createView(viewDesc);
-                if (!materialTextureView) return false;
-
-                materialInitialized.store(true);
-            }
-
             // Initialize chunk data buffer
             if (!chunkDataBufferInitialized.load()) {
                 BufferDescriptor chunkDataBufferDesc;
@@ -183,45 +307,29 @@ public:
                 chunkDataBufferDesc.usage = BufferUsage::CopyDst | BufferUsage::Uniform;
                 chunkDataBufferDesc.mappedAtCreation = false;
 
-                chunkDataBuffer = buf->getDevice().createBuffer(chunkDataBufferDesc);
+                chunkDataBuffer = buf->createTrackedBuffer(chunkDataBufferDesc, MemoryCategory::UniformBuffer);
                 if (!chunkDataBuffer) return false;
 
                 chunkDataBufferInitialized.store(true);
             }
 
-            // Create bind groups
-            if (!bindGroupsInitialized.load()) {
-                // Material bind group
-                std::vector<BindGroupEntry> materialBindings(2);
-                materialBindings[0].binding = 0;
-                materialBindings[0].textureView = materialTextureView;
-                materialBindings[1].binding = 1;
-                materialBindings[1].sampler = tex->getSampler("material_sampler");
-
-                BindGroupDescriptor materialBindGroupDesc;
-                materialBindGroupDesc.layout = pip->getBindGroupLayout("material_uniforms");
-                materialBindGroupDesc.entryCount = materialBindings.size();
-                materialBindGroupDesc.entries = materialBindings.data();
-                materialBindGroup = pip->getDevice().createBindGroup(materialBindGroupDesc);
-
-                // Chunk data bind group
-                std::vector<BindGroupEntry> chunkDataBindings(1);
-                chunkDataBindings[0].binding = 0;
-                chunkDataBindings[0].buffer = chunkDataBuffer;
-                chunkDataBindings[0].offset = 0;
-                chunkDataBindings[0].size = sizeof(ChunkData);
-
-                BindGroupDescriptor chunkDataBindGroupDesc;
-                chunkDataBindGroupDesc.layout = pip->getBindGroupLayout("chunkdata_uniforms");
-                chunkDataBindGroupDesc.entryCount = chunkDataBindings.size();
-                chunkDataBindGroupDesc.entries = chunkDataBindings.data();
-                chunkDataBindGroup = pip->getDevice().createBindGroup(chunkDataBindGroupDesc);
-
-                if (!materialBindGroup || !chunkDataBindGroup) return false;
-
-                bindGroupsInitialized.store(true);
-            }
+            // Chunk data bind group
+            std::vector<BindGroupEntry> chunkDataBindings(1);
+            chunkDataBindings[0].binding = 0;
+            chunkDataBindings[0].buffer = chunkDataBuffer;
+            chunkDataBindings[0].offset = 0;
+            chunkDataBindings[0].size = sizeof(ChunkData);
+
+            BindGroupDescriptor chunkDataBindGroupDesc;
+            chunkDataBindGroupDesc.layout = pip->getBindGroupLayout("chunkdata_uniforms");
+            chunkDataBindGroupDesc.entryCount = chunkDataBindings.size();
+            chunkDataBindGroupDesc.entries = chunkDataBindings.data();
+            chunkDataBindGroup = pip->getDevice().createBindGroup(chunkDataBindGroupDesc);
 
+            if (!chunkDataBindGroup) return false;
+            MemoryTracker::instance().allocate(MemoryCategory::BindGroup, 0);
+
+            bindGroupsInitialized.store(true);
             return true;
         }
         catch (const std::exception& e) {
@@ -230,35 +338,78 @@ public:
         }
     }
 
-    void uploadMaterialTexture(TextureManager* tex) {
-        if (!materialInitialized.load() || materialData.empty()) {
-            return;
-        }
+    // Points the chunk at the material texture for its current voxels and
+    // light, taking the one an identical loaded chunk already filled. A
+    // texture only this chunk draws with is refilled in place, a shared one
+    // is left to the others and a new one is created. Returns true when the
+    // material bind group changed, so render data built before is stale.
+    bool uploadMaterialTexture(TextureManager* tex, PipelineManager* pip) {
+        ChunkHash::Key content = refreshContentHash();
 
         std::lock_guard<std::mutex> lock(materialDataMutex);
+        if (materialData.empty() && packedMaterials.empty()) {
+            return false;
+        }
 
-        try {
-            ImageCopyTexture destination = {};
-            destination.texture = materialTexture;
-            destination.mipLevel = 0;
-            destination.origin = { 0, 0, 0 };
-            destination.aspect = TextureAspect::All;
-
-            TextureDataLayout source = {};
-            source.offset = 0;
-            source.bytesPerRow = CHUNK_SIZE * sizeof(VoxelMaterial);
-            source.rowsPerImage = CHUNK_SIZE;
-
-            tex->writeTexture(
-                destination,
-                materialData.data(),
-                materialData.size() * sizeof(VoxelMaterial),
-                source,
-                { CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE });
+        ChunkHash::Key key;
+        {
+            std::lock_guard<std::mutex> lightLock(lightDataMutex);
+            key = ChunkHash::mix(content, lightHashLocked());
         }
-        catch (const std::exception& e) {
-            std::cerr << "Failed to upload material texture: " << e.what() << std::endl;
+        if (sharedMaterial && sharedMaterial->key == key) {
+            return false;
+        }
+
+        std::shared_ptr<SharedChunkMaterial> entry;
+        if (dedup) {
+            entry = dedup->findMaterial(key, [this](const SharedChunkMaterial& found) {
+#if CHUNK_DEDUP_VERIFY
+                return found.texels == materialTexelsLocked();
+#else
+                (void)found;
+                return true;
+#endif
+            });
+        }
+        if (!entry && sharedMaterial.holders() == 1) {
+            if (dedup) dedup->removeMaterial(*sharedMaterial);
+            sharedMaterial->key = key;
+            writeMaterialTexelsLocked(tex, *sharedMaterial);
+            if (dedup) dedup->addMaterial(sharedMaterial.get());
+            return false;
+        }
+        if (!entry) {
+            entry = createMaterialLocked(tex, pip, key);
+            if (!entry) {
+                return false;
+            }
+            if (dedup) {
+                dedup->addMaterial(entry);
+            }
+        }
+
+        sharedMaterial = std::move(entry);
+        materialInitialized.store(true);
+        return true;
+    }
+
+    // Main thread: the light changed. A texture only this chunk draws with is
+    // rewritten in place without hashing, and leaves the registry since its
+    // key no longer describes it. Shared ones go through uploadMaterialTexture.
+    bool updateMaterialLight(TextureManager* tex, PipelineManager* pip) {
+        {
+            std::lock_guard<std::mutex> lock(materialDataMutex);
+            if (materialData.empty() && packedMaterials.empty()) {
+                return false;
+            }
+            if (sharedMaterial.holders() == 1) {
+                if (dedup) dedup->removeMaterial(*sharedMaterial);
+                sharedMaterial->key = ChunkHash::Key(); // Never matches, rehashed on the next upload
+                writeMaterialTexelsLocked(tex, *sharedMaterial);
+                return false;
+            }
         }
+        return uploadMaterialTexture(tex, pip);
     }
 
     void updateChunkDataBuffer(BufferManager* buf) {
@@ -268,7 +419,7 @@ public:
 
         ChunkData chunkData;
         chunkData.worldPosition = position;
-        chunkData.lod = lod;
+        chunkData.lod = lod.load();
 
         buf->getQueue().writeBuffer(chunkDataBuffer, 0, &chunkData, sizeof(ChunkData));
     }
@@ -293,6 +444,9 @@ public:
 
         std::lock_guard<std::mutex> lock(materialDataMutex);
         int index = pos.x + pos.y * CHUNK_SIZE + pos.z * CHUNK_SIZE * CHUNK_SIZE;
+        if (!packedMaterials.empty()) {
+            return { static_cast<uint16_t>(runValueAt(packedMaterials, index)) };
+        }
         if (index >= 0 && index < static_cast<int>(materialData.size())) {
             return materialData[index];
         }
@@ -306,11 +460,19 @@ public:
             return;
         }
 
-        std::lock_guard<std::mutex> lock(materialDataMutex);
-        int index = pos.x + pos.y * CHUNK_SIZE + pos.z * CHUNK_SIZE * CHUNK_SIZE;
-        if (index >= 0 && index < static_cast<int>(materialData.size())) {
-            materialData[index] = material;
+        {
+            std::lock_guard<std::mutex> lock(materialDataMutex);
+            unpackMaterialsLocked();
+            int index = pos.x + pos.y * CHUNK_SIZE + pos.z * CHUNK_SIZE * CHUNK_SIZE;
+            if (index >= 0 && index < static_cast<int>(materialData.size())) {
+                materialData[index] = material;
+            }
         }
+
+        // Mips and the content hash carry materials too
+        std::lock_guard<std::mutex> lock(voxelDataMutex);
+        lodMip.reset();
+        contentStale.store(true);
     }
 
     bool getVoxel(vec3 pos) const {
@@ -363,21 +525,445 @@ public:
         if (value && !currentValue) {
             solidVoxels.fetch_add(1);
             voxelData[byteIndex] |= (1 << bitIndex);
+            int brick = ChunkOccupancy::brickIndex(x, y, z);
+            brickOccupancy[brick / 64] |= (uint64_t(1) << (brick % 64));
+            regionOccupancy |= uint64_t(1) << ChunkOccupancy::regionIndex(x, y, z);
+            occupancySnapshot.reset();
+            lodMip.reset();
+            contentStale.store(true);
         }
         else if (!value && currentValue) {
             solidVoxels.fetch_sub(1);
             voxelData[byteIndex] &= ~(1 << bitIndex);
+            if (!brickHasSolidVoxels(x, y, z)) {
+                int brick = ChunkOccupancy::brickIndex(x, y, z);
+                brickOccupancy[brick / 64] &= ~(uint64_t(1) << (brick % 64));
+                if (!ChunkOccupancy::regionHasSolidBricks(brickOccupancy.data(), x, y, z)) {
+                    regionOccupancy &= ~(uint64_t(1) << ChunkOccupancy::regionIndex(x, y, z));
+                }
+            }
+            occupancySnapshot.reset();
+            lodMip.reset();
+            contentStale.store(true);
+        }
+    }
+
+    // Every voxel solid, for chunks generation proved uniform. Expects an empty chunk.
+    void fillSolid() {
+        std::lock_guard<std::mutex> lock(voxelDataMutex);
+        std::fill(voxelData.begin(), voxelData.end(), uint8_t(0xFF));
+        brickOccupancy.fill(~uint64_t(0));
+        regionOccupancy = ~uint64_t(0);
+        solidVoxels.store(TOTAL_VOXELS);
+        occupancySnapshot.reset();
+        lodMip.reset();
+        contentStale.store(true);
+    }
+
+    // Run fn(voxelBits, brickMask, regionMask) with the voxel lock held once, so
+    // callers that touch many voxels of one chunk don't pay a lock per voxel
+    template <typename Fn>
+    auto withVoxelData(Fn&& fn) const {
+        std::lock_guard<std::mutex> lock(voxelDataMutex);
+        return fn(static_cast<const uint8_t*>(voxelData.data()), static_cast<const uint64_t*>(brickOccupancy.data()), regionOccupancy);
+    }
+
+    // Run fn(materials, count) with the material lock held; count is 0 before generation.
+    // Packed chunks are decoded into a temporary and stay packed.
+    template <typename Fn>
+    auto withMaterialData(Fn&& fn) const {
+        std::lock_guard<std::mutex> lock(materialDataMutex);
+        if (!packedMaterials.empty()) {
+            std::vector<VoxelMaterial> decoded(TOTAL_VOXELS);
+            forEachRun(packedMaterials, [&decoded](int i, uint32_t value) { decoded[i].materialType = static_cast<uint16_t>(value); });
+            return fn(static_cast<const VoxelMaterial*>(decoded.data()), decoded.size());
+        }
+        return fn(static_cast<const VoxelMaterial*>(materialData.data()), materialData.size());
+    }
+
+    static constexpr uint8_t DEFAULT_LIGHT = 0xF0; // Full sky, no block light
+
+    // Run fn(light) with the light lock held, allocating the field on first use
+    template <typename Fn>
+    auto withLightData(Fn&& fn) {
+        std::lock_guard<std::mutex> lock(lightDataMutex);
+        if (!packedLight.empty()) {
+            lightData.resize(TOTAL_VOXELS);
+            forEachRun(packedLight, [this](int i, uint32_t value) { lightData[i] = static_cast<uint8_t>(value); });
+            std::vector<uint32_t>().swap(packedLight);
+        }
+        if (lightData.size() != TOTAL_VOXELS) {
+            lightData.assign(TOTAL_VOXELS, 0);
+        }
+        return fn(lightData.data());
+    }
+
+    uint8_t getLight(ivec3 pos) const {
+        if (pos.x < 0 || pos.x >= CHUNK_SIZE ||
+            pos.y < 0 || pos.y >= CHUNK_SIZE ||
+            pos.z < 0 || pos.z >= CHUNK_SIZE) {
+            return DEFAULT_LIGHT;
+        }
+
+        std::lock_guard<std::mutex> lock(lightDataMutex);
+        int index = pos.x + pos.y * CHUNK_SIZE + pos.z * CHUNK_SIZE * CHUNK_SIZE;
+        if (!packedLight.empty()) {
+            return static_cast<uint8_t>(runValueAt(packedLight, index));
+        }
+        if (lightData.size() != TOTAL_VOXELS) {
+            return DEFAULT_LIGHT;
+        }
+        return lightData[index];
+    }
+
+    // Copy is made once per edit generation; unchanged chunks hand out the same pointer
+    std::shared_ptr<const OccupancySnapshot> getOccupancySnapshot() const {
+        std::lock_guard<std::mutex> lock(voxelDataMutex);
+        if (!occupancySnapshot) {
+            auto snapshot = std::make_shared<OccupancySnapshot>();
+            std::copy(voxelData.begin(), voxelData.begin() + BYTES_NEEDED, snapshot->bits.begin());
+            snapshot->bricks = brickOccupancy;
+            snapshot->regions = regionOccupancy;
+            snapshot->columns.fill(0);
+            for (int z = 0; z < CHUNK_SIZE; ++z) {
+                for (int column = 0; column < CHUNK_SIZE * CHUNK_SIZE; ++column) {
+                    int index = column + z * CHUNK_SIZE * CHUNK_SIZE;
+                    if (voxelData[index / 8] & (1 << (index % 8))) {
+                        snapshot->columns[column] |= (1u << z);
+                    }
+                }
+            }
+            occupancySnapshot = snapshot;
+        }
+        return occupancySnapshot;
+    }
+
+    // Downsampled grid for LOD meshing. The mip of the most recent level is
+    // cached until the next edit; neighbours meshing at the same level share it.
+    std::shared_ptr<const LodMip> getLodMip(uint32_t level) const {
+        level = std::min(level, MAX_CHUNK_LOD);
+        std::lock_guard<std::mutex> lock(voxelDataMutex);
+        if (lodMip && lodMip->level == level) {
+            return lodMip;
+        }
+
+        LodMip mip(0, CHUNK_SIZE);
+        withMaterialData([&](const VoxelMaterial* materials, size_t count) {
+            for (int i = 0; i < TOTAL_VOXELS; ++i) {
+                if (voxelData[i / 8] & (1 << (i % 8))) {
+                    // Solid voxels without a material yet still count as solid
+                    uint16_t material = i < static_cast<int>(count) ? materials[i].materialType : 0;
+                    mip.materials[i] = material != 0 ? material : 1;
+                }
+            }
+            return 0;
+            });
+        while (mip.level < level) {
+            mip = downsampleLodMip(mip);
+        }
+
+        lodMip = std::make_shared<const LodMip>(std::move(mip));
+        return lodMip;
+    }
+
+    uint32_t getLod() const { return lod.load(); }
+    uint32_t getGenerationLod() const { return generationLod; }
+
+    // The manager remeshes the chunk after a change
+    void setLod(uint32_t level) { lod.store(std::min(level, MAX_CHUNK_LOD)); }
+
+private:
+    template <typename T, typename Value>
+    static std::vector<uint32_t> packRuns(const std::vector<T>& values, Value&& valueOf) {
+        std::vector<uint32_t> runs;
+        for (size_t i = 0; i < values.size();) {
+            uint32_t value = valueOf(values[i]);
+            size_t end = i + 1;
+            while (end < values.size() && valueOf(values[end]) == value) {
+                ++end;
+            }
+            runs.push_back(static_cast<uint32_t>(end - i) << 16 | value);
+            i = end;
+        }
+        runs.shrink_to_fit();
+        return runs;
+    }
+
+    static uint32_t runValueAt(const std::vector<uint32_t>& runs, int index) {
+        for (uint32_t run : runs) {
+            int length = static_cast<int>(run >> 16);
+            if (index < length) {
+                return run & 0xFFFF;
+            }
+            index -= length;
         }
+        return 0;
     }
 
+    // fn(index, value) for every voxel
+    template <typename Fn>
+    static void forEachRun(const std::vector<uint32_t>& runs, Fn&& fn) {
+        int index = 0;
+        for (uint32_t run : runs) {
+            int end = index + static_cast<int>(run >> 16);
+            for (; index < end; ++index) {
+                fn(index, run & 0xFFFF);
+            }
+        }
+    }
+
+    // Caller holds materialDataMutex
+    void unpackMaterialsLocked() {
+        if (packedMaterials.empty()) {
+            return;
+        }
+        materialData.resize(TOTAL_VOXELS);
+        forEachRun(packedMaterials, [this](int i, uint32_t value) { materialData[i].materialType = static_cast<uint16_t>(value); });
+        std::vector<uint32_t>().swap(packedMaterials);
+    }
+
+    // Canonical over packed and flat storage, see ChunkHash::runs
+    ChunkHash::Key computeContentHash() const {
+        ChunkHash::Key hash = ChunkHash::SEED;
+        {
+            std::lock_guard<std::mutex> lock(voxelDataMutex);
+            hash = ChunkHash::bytes(hash, voxelData.data(), voxelData.size());
+        }
+        {
+            std::lock_guard<std::mutex> lock(materialDataMutex);
+            if (!packedMaterials.empty()) {
+                hash = ChunkHash::words(hash, packedMaterials.data(), packedMaterials.size());
+            }
+            else if (materialData.size() == TOTAL_VOXELS) {
+                hash = ChunkHash::runs(hash, TOTAL_VOXELS, [this](int i) { return uint32_t(materialData[i].materialType); });
+            }
+        }
+        return hash;
+    }
+
+    // Recomputes the content hash after an edit and moves this chunk's count
+    // in dedup to it
+    ChunkHash::Key refreshContentHash() {
+        std::lock_guard<std::mutex> lock(contentMutex);
+        if (contentStale.exchange(false)) {
+            contentHash = computeContentHash(); // An edit from here on marks it stale again
+        }
+        if (contentHash != registeredContent) {
+            if (dedup) {
+                if (registeredContent) dedup->removeContent(registeredContent);
+                dedup->addContent(contentHash);
+            }
+            registeredContent = contentHash;
+        }
+        return contentHash;
+    }
+
+    // Caller holds lightDataMutex. Unlit chunks hash as all DEFAULT_LIGHT,
+    // which is what they upload.
+    ChunkHash::Key lightHashLocked() const {
+        if (!packedLight.empty()) {
+            return ChunkHash::words(ChunkHash::SEED, packedLight.data(), packedLight.size());
+        }
+        if (lightData.size() == TOTAL_VOXELS) {
+            return ChunkHash::runs(ChunkHash::SEED, TOTAL_VOXELS, [this](int i) { return uint32_t(lightData[i]); });
+        }
+        return ChunkHash::mix(ChunkHash::SEED, uint32_t(TOTAL_VOXELS) << 16 | DEFAULT_LIGHT);
+    }
+
+    // Caller holds materialDataMutex. R = material id, G = light; unlit
+    // chunks upload as open sky.
+    std::vector<uint8_t> materialTexelsLocked() const {
+        std::vector<uint8_t> texels(TOTAL_VOXELS * 2);
+        if (!packedMaterials.empty()) {
+            forEachRun(packedMaterials, [&texels](int i, uint32_t value) { texels[i * 2] = static_cast<uint8_t>(value); });
+        }
+        else {
+            for (int i = 0; i < TOTAL_VOXELS; ++i) {
+                texels[i * 2] = static_cast<uint8_t>(materialData[i].materialType);
+            }
+        }
+
+        std::lock_guard<std::mutex> lightLock(lightDataMutex);
+        if (!packedLight.empty()) {
+            forEachRun(packedLight, [&texels](int i, uint32_t value) { texels[i * 2 + 1] = static_cast<uint8_t>(value); });
+        }
+        else {
+            bool hasLight = lightData.size() == TOTAL_VOXELS;
+            for (int i = 0; i < TOTAL_VOXELS; ++i) {
+                texels[i * 2 + 1] = hasLight ? lightData[i] : DEFAULT_LIGHT;
+            }
+        }
+        return texels;
+    }
+
+    // Caller holds materialDataMutex. New texture, view and bind group,
+    // filled from this chunk; null on failure.
+    std::shared_ptr<SharedChunkMaterial> createMaterialLocked(TextureManager* tex, PipelineManager* pip, const ChunkHash::Key& key) {
+        try {
+            auto entry = std::make_shared<SharedChunkMaterial>();
+            entry->key = key;
+
+            TextureDescriptor textureDesc = {};
+            textureDesc.dimension = TextureDimension::_3D;
+            textureDesc.format = TextureFormat::RG8Unorm;
+            textureDesc.mipLevelCount = 1;
+            textureDesc.sampleCount = 1;
+            textureDesc.size = { CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE };
+            textureDesc.usage = TextureUsage::TextureBinding | TextureUsage::CopyDst;
+            textureDesc.label = "Chunk 3D Material Texture";
+
+            entry->texture = tex->createTrackedTexture(textureDesc, MemoryCategory::ChunkTexture);
+            if (!entry->texture) return nullptr;
+
+            TextureViewDescriptor viewDesc = {};
+            viewDesc.aspect = TextureAspect::All;
+            viewDesc.baseArrayLayer = 0;
+            viewDesc.arrayLayerCount = 1;
+            viewDesc.baseMipLevel = 0;
+            viewDesc.mipLevelCount = 1;
+            viewDesc.dimension = TextureViewDimension::_3D;
+            viewDesc.format = TextureFormat::RG8Unorm;
+
+            entry->view = entry->texture.createView(viewDesc);
+            if (!entry->view) return nullptr;
+
+            std::vector<BindGroupEntry> materialBindings(2);
+            materialBindings[0].binding = 0;
+            materialBindings[0].textureView = entry->view;
+            materialBindings[1].binding = 1;
+            materialBindings[1].sampler = tex->getSampler("material_sampler");
+
+            BindGroupDescriptor materialBindGroupDesc;
+            materialBindGroupDesc.layout = pip->getBindGroupLayout("material_uniforms");
+            materialBindGroupDesc.entryCount = materialBindings.size();
+            materialBindGroupDesc.entries = materialBindings.data();
+            entry->bindGroup = pip->getDevice().createBindGroup(materialBindGroupDesc);
+            if (!entry->bindGroup) return nullptr;
+            MemoryTracker::instance().allocate(MemoryCategory::BindGroup, 0);
+
+            writeMaterialTexelsLocked(tex, *entry);
+            return entry;
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Failed to upload material texture: " << e.what() << std::endl;
+            return nullptr;
+        }
+    }
+
+    // Caller holds materialDataMutex. Fills the entry's texture from this chunk.
+    void writeMaterialTexelsLocked(TextureManager* tex, SharedChunkMaterial& entry) const {
+        std::vector<uint8_t> texels = materialTexelsLocked();
+
+        ImageCopyTexture destination = {};
+        destination.texture = entry.texture;
+        destination.mipLevel = 0;
+        destination.origin = { 0, 0, 0 };
+        destination.aspect = TextureAspect::All;
+
+        TextureDataLayout source = {};
+        source.offset = 0;
+        source.bytesPerRow = CHUNK_SIZE * 2;
+        source.rowsPerImage = CHUNK_SIZE;
+
+        tex->writeTexture(
+            destination,
+            texels.data(),
+            texels.size(),
+            source,
+            { CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE });
+#if CHUNK_DEDUP_VERIFY
+        entry.texels = std::move(texels);
+#endif
+    }
+
+    // Caller holds meshDataMutex. New vertex buffer holding quadData.
+    std::shared_ptr<SharedChunkMesh> createMeshLocked(BufferManager* buf) {
+        auto entry = std::make_shared<SharedChunkMesh>();
+        entry->key = meshHash;
+
+        // Quads are instance-stepped vertex data, no index buffer
+        BufferDescriptor vertexBufferDesc;
+        entry->vertexBufferSize = quadData.size() * sizeof(VertexAttributes);
+        vertexBufferDesc.size = entry->vertexBufferSize;
+        vertexBufferDesc.usage = BufferUsage::CopyDst | BufferUsage::Vertex;
+        vertexBufferDesc.mappedAtCreation = false;
+
+        entry->vertexBuffer = buf->createTrackedBuffer(vertexBufferDesc, MemoryCategory::VertexBuffer);
+        if (!entry->vertexBuffer) return nullptr;
+
+        entry->quadCount = static_cast<uint32_t>(quadData.size());
+        entry->faceQuadCount = meshFaceQuadCount;
+
+        // Upload data
+        buf->getQueue().writeBuffer(entry->vertexBuffer, 0, quadData.data(), entry->vertexBufferSize);
+#if CHUNK_DEDUP_VERIFY
+        entry->quads.reserve(quadData.size());
+        for (const VertexAttributes& quad : quadData) {
+            entry->quads.push_back(quad.data);
+        }
+#endif
+        return entry;
+    }
+
+    // Caller holds voxelDataMutex. A brick row of 4 voxels is one nibble.
+    bool brickHasSolidVoxels(int x, int y, int z) const {
+        int bx = (x / BRICK_SIZE) * BRICK_SIZE;
+        int by = (y / BRICK_SIZE) * BRICK_SIZE;
+        int bz = (z / BRICK_SIZE) * BRICK_SIZE;
+        for (int dz = 0; dz < BRICK_SIZE; ++dz) {
+            for (int dy = 0; dy < BRICK_SIZE; ++dy) {
+                int index = bx + (by + dy) * CHUNK_SIZE + (bz + dz) * CHUNK_SIZE * CHUNK_SIZE;
+                if ((voxelData[index / 8] >> (index % 8)) & 0xF) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Density comes from the heightmap when one is set, the noise otherwise.
+    // Both use the sampleGrid3D layout and SOLID_THRESHOLD.
+    WorldGenerator::BoxContents classifyTerrain(ivec3 start, ivec3 size) {
+        return heightmap ? heightmap->classifyBox(start, size) : worldGen.classifyBox(start, size);
+    }
+
+    void sampleTerrain(float* out, ivec3 start, ivec3 size) {
+        if (heightmap) {
+            heightmap->sampleDensity(out, start, size);
+        }
+        else {
+            worldGen.sampleGrid3D(out, start, size);
+        }
+    }
+
+public:
+
     void generateTerrain() {
+        if (isCancelled()) return;
+
         setState(ChunkState::GeneratingMesh);
-        for (int x = 0; x < CHUNK_SIZE; x++) {
+
+        // Chunks well above or below the surface are proved uniform from a
+        // coarse lattice and skip the full sampling
+        WorldGenerator::BoxContents contents = classifyTerrain(position, ivec3(CHUNK_SIZE));
+        if (contents == WorldGenerator::BoxContents::Solid) {
+            fillSolid();
+        }
+
+        // One batched call, indexed x + z * size + y * size * size
+        std::vector<float> density;
+        if (contents == WorldGenerator::BoxContents::Mixed) {
+            density.resize(TOTAL_VOXELS);
+            sampleTerrain(density.data(), position, ivec3(CHUNK_SIZE));
+        }
+
+        for (int x = 0; x < CHUNK_SIZE && !density.empty(); x++) {
+            if (isCancelled()) return;
+
             for (int y = 0; y < CHUNK_SIZE; y++) {
                 for (int z = 0; z < CHUNK_SIZE; z++) {
-                    ivec3 worldPos = ivec3(x, y, z) + position;
-                    float noiseValue = worldGen.sample3D(vec3(worldPos.x, worldPos.z, worldPos.y));
-                    if (noiseValue > -0.4) {
+                    float noiseValue = density[x + z * CHUNK_SIZE + y * CHUNK_SIZE * CHUNK_SIZE];
+                    if (noiseValue > WorldGenerator::SOLID_THRESHOLD) {
                         setVoxel(vec3(x, y, z), true);
                     }
                     //f/*loat height = worldGen.sample2D(vec2(x + position.x, y + position.y));
@@ -389,6 +975,8 @@ public:
             }
         }
 
+        applyPendingEdits(false);
+
         if (getSolidVoxels() > 0) {
             setState(ChunkState::TerrainReady);
         }
@@ -397,7 +985,153 @@ public:
         }
     }
 
+    // generateTerrain and generateTopsoil as one job that does not wait for
+    // the neighbours. Density is sampled in one batched call for the chunk
+    // plus a one voxel ring around it and TOPSOIL_HALO voxels above and
+    // below, which covers everything topsoil looks at outside the chunk.
+    void generateTerrainWithTopsoil() {
+        if (isCancelled()) return;
+
+        setState(ChunkState::GeneratingMesh);
+
+        const ivec3 haloStart = position - ivec3(1, 1, TOPSOIL_HALO);
+        const ivec3 haloSize(CHUNK_SIZE + 2, CHUNK_SIZE + 2, CHUNK_SIZE + 2 * TOPSOIL_HALO);
+
+        // A halo proved uniform needs no samples, a solid one has no surface
+        WorldGenerator::BoxContents contents = classifyTerrain(haloStart, haloSize);
+        std::vector<float> density;
+        if (contents == WorldGenerator::BoxContents::Mixed) {
+            density.resize(haloSize.x * haloSize.y * haloSize.z);
+            sampleTerrain(density.data(), haloStart, haloSize);
+        }
+        else if (contents == WorldGenerator::BoxContents::Solid) {
+            fillSolid();
+        }
+
+        // Local coordinates, x and y in [-1, CHUNK_SIZE], z in [-TOPSOIL_HALO, CHUNK_SIZE + TOPSOIL_HALO)
+        auto haloSolid = [&](ivec3 pos) {
+            if (density.empty()) {
+                return contents == WorldGenerator::BoxContents::Solid;
+            }
+            int index = (pos.x + 1) + (pos.z + TOPSOIL_HALO) * haloSize.x + (pos.y + 1) * haloSize.x * haloSize.z;
+            return density[index] > WorldGenerator::SOLID_THRESHOLD;
+        };
+
+        for (int x = 0; x < CHUNK_SIZE && !density.empty(); x++) {
+            if (isCancelled()) return;
+
+            for (int y = 0; y < CHUNK_SIZE; y++) {
+                for (int z = 0; z < CHUNK_SIZE; z++) {
+                    if (haloSolid(ivec3(x, y, z))) {
+                        setVoxel(vec3(x, y, z), true);
+                    }
+                }
+            }
+        }
+
+        applyPendingEdits(false);
+
+        if (getSolidVoxels() == 0) {
+            setState(ChunkState::Air);
+            return;
+        }
+
+        // The chunk's own voxels include edits, the halo is unedited terrain
+        auto isSolid = [&](ivec3 pos) -> bool {
+            if (pos.x >= 0 && pos.x < CHUNK_SIZE &&
+                pos.y >= 0 && pos.y < CHUNK_SIZE &&
+                pos.z >= 0 && pos.z < CHUNK_SIZE) {
+                return getVoxel(pos);
+            }
+            return haloSolid(pos);
+        };
+
+        // Same steps as calculateSteepness in generateTopsoil: the top solid
+        // voxel of each surrounding column at or below the chunk's top row,
+        // searched down into the chunk below for columns inside the chunk
+        // and to z = 0 for side neighbours. Diagonal columns outside the
+        // chunk and empty columns don't count. Bit z + TOPSOIL_HALO of
+        // x + 1 + (y + 1) * (CHUNK_SIZE + 2) is set for solid voxels from
+        // -TOPSOIL_HALO up to CHUNK_SIZE - 1.
+        constexpr int RING = CHUNK_SIZE + 2;
+        std::vector<uint64_t> columns(RING * RING, 0);
+        withVoxelData([&](const uint8_t* bits, const uint64_t*, uint64_t) {
+            for (int y = -1; y <= CHUNK_SIZE; y++) {
+                for (int x = -1; x <= CHUNK_SIZE; x++) {
+                    bool inside = x >= 0 && x < CHUNK_SIZE && y >= 0 && y < CHUNK_SIZE;
+                    uint64_t& column = columns[(x + 1) + (y + 1) * RING];
+                    for (int z = -TOPSOIL_HALO; z < CHUNK_SIZE; z++) {
+                        bool solid = inside && z >= 0 ? ChunkOccupancy::testVoxelBit(bits, x, y, z) : haloSolid(ivec3(x, y, z));
+                        if (solid) {
+                            column |= uint64_t(1) << (z + TOPSOIL_HALO);
+                        }
+                    }
+                }
+            }
+        });
+
+        // Chunk columns empty down to the halo's bottom look further, like
+        // generateTopsoil does in the chunk below. Sampled once per column.
+        std::vector<int8_t> solidUnderHalo(CHUNK_SIZE * CHUNK_SIZE, -1);
+        auto hasSolidUnderHalo = [&](int x, int y) {
+            int8_t& known = solidUnderHalo[x + y * CHUNK_SIZE];
+            if (known < 0) {
+                std::vector<float> column(CHUNK_SIZE - TOPSOIL_HALO);
+                sampleTerrain(column.data(), position + ivec3(x, y, -CHUNK_SIZE), ivec3(1, 1, CHUNK_SIZE - TOPSOIL_HALO));
+                known = std::any_of(column.begin(), column.end(),
+                    [](float value) { return value > WorldGenerator::SOLID_THRESHOLD; });
+            }
+            return known > 0;
+        };
+
+        auto steepnessAt = [&](int x, int y, int z) -> int {
+            int steepest = 0;
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    if (dx == 0 && dy == 0) continue;
+
+                    int nx = x + dx, ny = y + dy;
+                    bool outsideX = nx < 0 || nx >= CHUNK_SIZE;
+                    bool outsideY = ny < 0 || ny >= CHUNK_SIZE;
+                    if (outsideX && outsideY) continue;
+
+                    uint64_t column = columns[(nx + 1) + (ny + 1) * RING];
+                    if (outsideX || outsideY) {
+                        column >>= TOPSOIL_HALO; // Side neighbours only from z = 0
+                        column <<= TOPSOIL_HALO;
+                    }
+
+                    if (column) {
+                        int top = CHUNK_SIZE - 1 + TOPSOIL_HALO;
+                        while (!(column >> top & 1)) top--;
+                        top -= TOPSOIL_HALO;
+                        if (top != -1) { // Reads as an empty column there too
+                            steepest = std::max(steepest, std::abs(z - top));
+                        }
+                    }
+                    else if (!outsideX && !outsideY && hasSolidUnderHalo(nx, ny)) {
+                        steepest = std::max(steepest, z + TOPSOIL_HALO + 1); // At least, topsoil stops at 3
+                    }
+                }
+            }
+            return steepest;
+        };
+
+        if (!applyTopsoil(isSolid, steepnessAt)) {
+            return;
+        }
+
+        applyPendingEdits(true);
+
+        // Voxels are final, count the chunk's content for dedup
+        refreshContentHash();
+
+        setState(ChunkState::TopsoilReady);
+    }
+
     void generateTopsoil(const std::array<std::shared_ptr<ThreadSafeChunk>, 6>& neighbors = {}) {
+        if (isCancelled()) return;
+
         setState(ChunkState::GeneratingTopsoil);
         // Lambda to safely check voxels including cross-chunk positions
         auto isVoxelSolid = [this, &neighbors](ivec3 pos) -> bool {
@@ -496,12 +1230,35 @@ public:
             return maxHeightDifference;
             };
 
-        for (int x = 0; x < CHUNK_SIZE; x++) {
-            for (int y = 0; y < CHUNK_SIZE; y++) {
-                for (int z = 0; z < CHUNK_SIZE; z++) {
+        if (!applyTopsoil(isVoxelSolid, calculateSteepness)) {
+            return;
+        }
+
+        applyPendingEdits(true);
+
+        // Voxels are final, count the chunk's content for dedup
+        refreshContentHash();
+
+        setState(ChunkState::TopsoilReady);
+    }
+
+    // Rock strata for every solid voxel, then grass, dirt or stone layers
+    // under each surface voxel depending on how steep the ground around it is.
+    // isSolid is asked about the voxel above each one, up to z == CHUNK_SIZE.
+    // steepnessAt(x, y, z) is the largest height step to the 8 surrounding
+    // columns. Returns false if the chunk was cancelled part way.
+    template<typename SolidFunc, typename SteepnessFunc>
+    bool applyTopsoil(SolidFunc isSolid, SteepnessFunc steepnessAt) {
+        std::vector<float> strata(TOTAL_VOXELS);
+        worldGen.sampleGrid3D2(strata.data(), position, ivec3(CHUNK_SIZE));
+
+        for (int x = 0; x < CHUNK_SIZE; x++) {
+            if (isCancelled()) return false;
+
+            for (int y = 0; y < CHUNK_SIZE; y++) {
+                for (int z = 0; z < CHUNK_SIZE; z++) {
                     if (getVoxel(ivec3(x, y, z))) {
-                        vec3 pos = vec3(position + ivec3(x, y, z));
-                        float noiseValue = worldGen.sample3D2(pos);
+                        float noiseValue = strata[x + y * CHUNK_SIZE + z * CHUNK_SIZE * CHUNK_SIZE];
                         VoxelMaterial material;
                         if (noiseValue > -1 && noiseValue < -0.8) {
                             material.materialType = 3; // stone
@@ -541,11 +1298,11 @@ public:
 
                         // Check if this voxel has air above it (surface detection)
                         ivec3 positionAbove = ivec3(x, y, z + 1);
-                        bool isAtSurface = !isVoxelSolid(positionAbove);
+                        bool isAtSurface = !isSolid(positionAbove);
 
                         if (isAtSurface) {
                             // Calculate steepness by checking the 8 surrounding columns
-                            int maxHeightDifference = calculateSteepness(x, y, z);
+                            int maxHeightDifference = steepnessAt(x, y, z);
 
                             // Determine material type based on steepness
                             int materialType;
@@ -606,21 +1363,39 @@ public:
             }
         }
 
-        setState(ChunkState::TopsoilReady);
+        return true;
+    }
+
+    void applyPendingEdits(bool applyMaterials) {
+        for (const ChunkVoxelEdit& edit : pendingEdits) {
+            ivec3 local = ivec3(
+                edit.voxelIndex % CHUNK_SIZE,
+                (edit.voxelIndex / CHUNK_SIZE) % CHUNK_SIZE,
+                edit.voxelIndex / (CHUNK_SIZE * CHUNK_SIZE));
+
+            if (applyMaterials) {
+                setMaterial(local, { edit.material });
+            }
+            else {
+                setVoxel(local, edit.material != 0);
+            }
+        }
     }
 
     bool generateMesh(const std::array<std::shared_ptr<ThreadSafeChunk>, 6>& neighbors = {}) {
-        setState(ChunkState::GeneratingMesh);
+        if (isCancelled()) {
+            return false;
+        }
+
+        if (!isRemeshingInPlace()) {
+            setState(ChunkState::GeneratingMesh);
+        }
         if (lod > 0) {
             return generateMeshLod(neighbors);
 		}
-        
-        if (state.load() == ChunkState::Unloading) {
-            return false;
-        }
 
         if (solidVoxels.load() == 0) {
-            setState(ChunkState::MeshReady);
+            markMeshReady();
             return true;
         }
 
@@ -680,6 +1455,11 @@ public:
                     return true; // Treat as empty if neighbor is being unloaded
                 }
 
+                // A coarser neighbour does not line up with our surface; emit the face to hide the crack
+                if (neighbors[faceIndex]->getLod() != 0) {
+                    return true;
+                }
+
                 ivec3 neighborPos = pos;
 
                 // CRITICAL: Map out-of-bounds coordinates to neighbor chunk space
@@ -743,94 +1523,56 @@ public:
             return 3 - ((side1 ? 1 : 0) + (side2 ? 1 : 0) + (corner ? 1 : 0));
             };
 
-        auto packData = [](uint8_t position_x, uint8_t position_y, uint8_t position_z,
-            uint8_t normal_index, uint8_t vertex_index, uint8_t ao_index) -> uint32_t {
-                // Validate input ranges
-                // normal_index should be 0-7 (3 bits)
-                // vertex_index should be 0-3 (2 bits)
-                normal_index &= 0x7;   // Mask to 3 bits
-                vertex_index &= 0x3;   // Mask to 2 bits
-
+        // One record per quad; the shader expands it to 6 vertices.
+        // Bits 0-14 position (5 bits per axis), 15-17 normal, 18-25 AO for
+        // corners 0-3 (2 bits each), 26 flip, set when the quad is split
+        // along the 1-3 diagonal so AO interpolates evenly.
+        auto packQuad = [](int position_x, int position_y, int position_z,
+            int normal_index, const std::array<uint32_t, 4>& ao, bool flip) -> uint32_t {
                 uint32_t packed = 0;
-
-                // Position X: bits 0-7
-                packed |= static_cast<uint32_t>(position_x);
-
-                // Position Y: bits 8-15
-                packed |= static_cast<uint32_t>(position_y) << 8;
-
-                // Position Z: bits 16-23
-                packed |= static_cast<uint32_t>(position_z) << 16;
-
-                // Normal Index: bits 24-26
-                packed |= static_cast<uint32_t>(normal_index) << 24;
-
-                // Vertex Index: bits 27-28
-                packed |= static_cast<uint32_t>(vertex_index) << 27;
-
-                // AO Index: bits 29-30
-                packed |= static_cast<uint32_t>(ao_index) << 29;
-
+                packed |= static_cast<uint32_t>(position_x & 0x1F);
+                packed |= static_cast<uint32_t>(position_y & 0x1F) << 5;
+                packed |= static_cast<uint32_t>(position_z & 0x1F) << 10;
+                packed |= static_cast<uint32_t>(normal_index & 0x7) << 15;
+                for (int corner = 0; corner < 4; ++corner) {
+                    packed |= (ao[corner] & 0x3) << (18 + corner * 2);
+                }
+                packed |= static_cast<uint32_t>(flip ? 1 : 0) << 26;
                 return packed;
             };
         
         std::lock_guard<std::mutex> lock(meshDataMutex);
-        indexData.clear();
-        vertexData.clear();
+        quadData.clear();
+
+        std::array<std::vector<VertexAttributes>, 6> faceQuads;
 
         try {
             for (int x = 0; x < CHUNK_SIZE; ++x) {
                 for (int y = 0; y < CHUNK_SIZE; ++y) {
                     for (int z = 0; z < CHUNK_SIZE; ++z) {
                         // Check if chunk is still valid during processing
-                        if (state.load() == ChunkState::Unloading) {
+                        if (isCancelled()) {
                             return false;
                         }
 
                         ivec3 currentPos = ivec3(x, y, z);
 
                         if (getVoxel(currentPos)) {
-                            ivec3 voxelPos = currentPos + position;
-
                             // Check each face for culling (including cross-chunk)
                             for (int face = 0; face < 6; ++face) {
                                 ivec3 neighborPos = currentPos + neighborOffsets[face];
 
                                 if (isEmptyVoxel(neighborPos, face)) {
-                                    uint32_t baseIndex = static_cast<uint32_t>(vertexData.size());
-
-                                    std::array<float, 4> aoValues;
+                                    std::array<uint32_t, 4> aoValues;
                                     for (int vertex = 0; vertex < 4; ++vertex) {
                                         aoValues[vertex] = calculateAmbientOcclusion(currentPos, face, vertex);
                                     }
 
                                     bool flipQuad = aoValues[0] + aoValues[2] > aoValues[1] + aoValues[3];
 
-                                    for (int vertex = 0; vertex < 4; ++vertex) {
-                                        uint8_t pv = static_cast<uint8_t>(vertex);
-                                        VertexAttributes vert;
-                                        vert.data = packData(x, y, z, face, vertex, aoValues[vertex]);
-                                        vertexData.push_back(vert);
-                                    }
-
-                                    if (flipQuad) {
-                                        indexData.push_back(baseIndex + 0);
-                                        indexData.push_back(baseIndex + 1);
-                                        indexData.push_back(baseIndex + 3);
-
-                                        indexData.push_back(baseIndex + 1);
-                                        indexData.push_back(baseIndex + 2);
-                                        indexData.push_back(baseIndex + 3);
-                                    }
-                                    else {
-                                        indexData.push_back(baseIndex + 0);
-                                        indexData.push_back(baseIndex + 1);
-                                        indexData.push_back(baseIndex + 2);
-
-                                        indexData.push_back(baseIndex + 0);
-                                        indexData.push_back(baseIndex + 2);
-                                        indexData.push_back(baseIndex + 3);
-                                    }
+                                    VertexAttributes quad;
+                                    quad.data = packQuad(x, y, z, face, aoValues, flipQuad);
+                                    faceQuads[face].push_back(quad);
                                 }
                             }
                         }
@@ -843,427 +1585,90 @@ public:
             return false;
         }
 
-        if (state.load() == ChunkState::Unloading) {
+        appendFaceGroups(faceQuads);
+
+        if (isCancelled()) {
             return false;
         }
 
-        setState(ChunkState::MeshReady);
+        markMeshReady();
         return true;
     }
 
+    // Mesh the mip of the current level: one quad per exposed cell face,
+    // scaled by 2^lod in the shader. Faces on a border with a chunk of another
+    // level are always emitted so they cover the crack between the two.
     bool generateMeshLod(const std::array<std::shared_ptr<ThreadSafeChunk>, 6>& neighbors = {}) {
-        // Pack data function (same as regular mesh)
-        auto packData = [](uint8_t position_x, uint8_t position_y, uint8_t position_z,
-            uint8_t normal_index, uint8_t vertex_index, uint8_t ao_index) -> uint32_t {
-                normal_index &= 0x7;   // Mask to 3 bits
-                vertex_index &= 0x3;   // Mask to 2 bits
+        uint32_t level = lod.load();
+        std::shared_ptr<const LodMip> mip = getLodMip(level);
+        if (!mip) {
+            return false;
+        }
 
+        // Same layout as the full detail quads, except LOD has no AO and
+        // bits 18-25 carry the cell material instead
+        auto packLodQuad = [](int cell_x, int cell_y, int cell_z, uint16_t material, int normal_index) -> uint32_t {
                 uint32_t packed = 0;
-                packed |= static_cast<uint32_t>(position_x);
-                packed |= static_cast<uint32_t>(position_y) << 8;
-                packed |= static_cast<uint32_t>(position_z) << 16;
-                packed |= static_cast<uint32_t>(normal_index) << 24;
-                packed |= static_cast<uint32_t>(vertex_index) << 27;
-                packed |= static_cast<uint32_t>(ao_index) << 29;
-
+                packed |= static_cast<uint32_t>(cell_x & 0x1F);
+                packed |= static_cast<uint32_t>(cell_y & 0x1F) << 5;
+                packed |= static_cast<uint32_t>(cell_z & 0x1F) << 10;
+                packed |= static_cast<uint32_t>(normal_index & 0x7) << 15;
+                packed |= static_cast<uint32_t>(material & 0xFF) << 18;
                 return packed;
             };
 
-        auto isEmptyVoxel = [this, &neighbors](ivec3 pos, int faceIndex = -1) -> bool {
-            // Check if position is within current chunk bounds
-            if (pos.x >= 0 && pos.x < CHUNK_SIZE &&
-                pos.y >= 0 && pos.y < CHUNK_SIZE &&
-                pos.z >= 0 && pos.z < CHUNK_SIZE) {
-                return !getVoxel(pos);
-            }
-            // Position is outside current chunk - check neighbor chunks
-            if (faceIndex >= 0 && faceIndex < 6 && neighbors[faceIndex] != nullptr) {
-                // Check if neighbor is still valid (not being destroyed)
-                if (neighbors[faceIndex]->getState() == ChunkState::Unloading) {
-                    return true; // Treat as empty if neighbor is being unloaded
-                }
-                ivec3 neighborPos = pos;
-                // CRITICAL: Map out-of-bounds coordinates to neighbor chunk space
-                switch (faceIndex) {
-                case 0: // Right face (+X): pos.x == CHUNK_SIZE, map to x=0 in right neighbor
-                    if (pos.x == CHUNK_SIZE) neighborPos.x = 0;
-                    break;
-                case 1: // Left face (-X): pos.x == -1, map to x=31 in left neighbor
-                    if (pos.x == -1) neighborPos.x = CHUNK_SIZE - 1;
-                    break;
-                case 2: // Front face (+Y): pos.y == CHUNK_SIZE, map to y=0 in front neighbor
-                    if (pos.y == CHUNK_SIZE) neighborPos.y = 0;
-                    break;
-                case 3: // Back face (-Y): pos.y == -1, map to y=31 in back neighbor
-                    if (pos.y == -1) neighborPos.y = CHUNK_SIZE - 1;
-                    break;
-                case 4: // Top face (+Z): pos.z == CHUNK_SIZE, map to z=0 in top neighbor
-                    if (pos.z == CHUNK_SIZE) neighborPos.z = 0;
-                    break;
-                case 5: // Bottom face (-Z): pos.z == -1, map to z=31 in bottom neighbor
-                    if (pos.z == -1) neighborPos.z = CHUNK_SIZE - 1;
-                    break;
-                }
-                // Validate neighbor position and check voxel
-                if (neighborPos.x >= 0 && neighborPos.x < CHUNK_SIZE &&
-                    neighborPos.y >= 0 && neighborPos.y < CHUNK_SIZE &&
-                    neighborPos.z >= 0 && neighborPos.z < CHUNK_SIZE) {
-                    bool neighborHasVoxel = neighbors[faceIndex]->getVoxel(neighborPos);
-                    return !neighborHasVoxel;
-                }
-            }
-            // No neighbor available - consider it empty (exposed to air)
-            return true;
-            };
+        ivec3 neighborOffsets[6] = {
+            ivec3(1, 0, 0), ivec3(-1, 0, 0),
+            ivec3(0, 1, 0), ivec3(0, -1, 0),
+            ivec3(0, 0, 1), ivec3(0, 0, -1)
+        };
 
-        // Helper function to check if a slice has any solid voxels
-        auto sliceHasSolidVoxels = [this](int slicePos, int axis) -> bool {
-            // For boundary slices (position 0 and CHUNK_SIZE), we need to check if there are 
-            // solid voxels adjacent to the slice position
-            if (axis == 0) { // X-axis
-                if (slicePos == 0) {
-                    // Check if there are solid voxels in the first column (x=0)
-                    for (int i = 0; i < CHUNK_SIZE; ++i) {
-                        for (int j = 0; j < CHUNK_SIZE; ++j) {
-                            if (getVoxel(ivec3(0, i, j))) return true;
-                        }
-                    }
-                    return false;
-                }
-                else if (slicePos == CHUNK_SIZE) {
-                    // Check if there are solid voxels in the last column (x=31)
-                    for (int i = 0; i < CHUNK_SIZE; ++i) {
-                        for (int j = 0; j < CHUNK_SIZE; ++j) {
-                            if (getVoxel(ivec3(CHUNK_SIZE - 1, i, j))) return true;
-                        }
-                    }
-                    return false;
-                }
-                else {
-                    // Interior slice - check both adjacent columns
-                    for (int i = 0; i < CHUNK_SIZE; ++i) {
-                        for (int j = 0; j < CHUNK_SIZE; ++j) {
-                            if (getVoxel(ivec3(slicePos - 1, i, j)) || getVoxel(ivec3(slicePos, i, j))) {
-                                return true;
-                            }
-                        }
-                    }
-                    return false;
-                }
-            }
-            else if (axis == 1) { // Y-axis
-                if (slicePos == 0) {
-                    for (int i = 0; i < CHUNK_SIZE; ++i) {
-                        for (int j = 0; j < CHUNK_SIZE; ++j) {
-                            if (getVoxel(ivec3(i, 0, j))) return true;
-                        }
-                    }
-                    return false;
-                }
-                else if (slicePos == CHUNK_SIZE) {
-                    for (int i = 0; i < CHUNK_SIZE; ++i) {
-                        for (int j = 0; j < CHUNK_SIZE; ++j) {
-                            if (getVoxel(ivec3(i, CHUNK_SIZE - 1, j))) return true;
-                        }
-                    }
-                    return false;
-                }
-                else {
-                    for (int i = 0; i < CHUNK_SIZE; ++i) {
-                        for (int j = 0; j < CHUNK_SIZE; ++j) {
-                            if (getVoxel(ivec3(i, slicePos - 1, j)) || getVoxel(ivec3(i, slicePos, j))) {
-                                return true;
-                            }
-                        }
-                    }
-                    return false;
-                }
-            }
-            else { // Z-axis
-                if (slicePos == 0) {
-                    for (int i = 0; i < CHUNK_SIZE; ++i) {
-                        for (int j = 0; j < CHUNK_SIZE; ++j) {
-                            if (getVoxel(ivec3(i, j, 0))) return true;
-                        }
-                    }
-                    return false;
-                }
-                else if (slicePos == CHUNK_SIZE) {
-                    for (int i = 0; i < CHUNK_SIZE; ++i) {
-                        for (int j = 0; j < CHUNK_SIZE; ++j) {
-                            if (getVoxel(ivec3(i, j, CHUNK_SIZE - 1))) return true;
-                        }
-                    }
-                    return false;
-                }
-                else {
-                    for (int i = 0; i < CHUNK_SIZE; ++i) {
-                        for (int j = 0; j < CHUNK_SIZE; ++j) {
-                            if (getVoxel(ivec3(i, j, slicePos - 1)) || getVoxel(ivec3(i, j, slicePos))) {
-                                return true;
-                            }
-                        }
-                    }
-                    return false;
-                }
+        // Same-level neighbours are culled against, anything else leaves the border open
+        std::array<std::shared_ptr<const LodMip>, 6> neighborMips = {};
+        for (int face = 0; face < 6; ++face) {
+            if (neighbors[face] && neighbors[face]->getState() != ChunkState::Unloading &&
+                neighbors[face]->getLod() == level) {
+                neighborMips[face] = neighbors[face]->getLodMip(level);
             }
-            };
-
-        // Helper function to check if a slice quad should be rendered
-        auto shouldRenderSliceQuad = [this, &isEmptyVoxel, &neighbors](int slicePos, int axis, bool positiveDirection) -> bool {
-            // For LOD rendering, we need to be more conservative about culling
-            // A slice quad should be rendered if ANY voxel on that slice face is exposed
-
-            for (int i = 0; i < CHUNK_SIZE; ++i) {
-                for (int j = 0; j < CHUNK_SIZE; ++j) {
-                    ivec3 voxelPos = ivec3(0,0,0);
-                    ivec3 checkPos = ivec3(0,0,0);
-                    int faceIndex = 0;
-
-                    switch (axis) {
-                    case 0: // X-axis slice
-                        if (positiveDirection) {
-                            // Right face - check if there's a solid voxel at slicePos-1 and air at slicePos
-                            if (slicePos == 0) continue; // No voxel to the left of slice 0
-                            voxelPos = ivec3(slicePos - 1, i, j);
-                            checkPos = ivec3(slicePos, i, j);
-                            faceIndex = 0;
-                        }
-                        else {
-                            // Left face - check if there's a solid voxel at slicePos and air at slicePos-1
-                            if (slicePos == CHUNK_SIZE) continue; // No voxel to the right of slice CHUNK_SIZE
-                            voxelPos = ivec3(slicePos, i, j);
-                            checkPos = ivec3(slicePos - 1, i, j);
-                            faceIndex = 1;
-                        }
-                        break;
-                    case 1: // Y-axis slice
-                        if (positiveDirection) {
-                            if (slicePos == 0) continue;
-                            voxelPos = ivec3(i, slicePos - 1, j);
-                            checkPos = ivec3(i, slicePos, j);
-                            faceIndex = 2;
-                        }
-                        else {
-                            if (slicePos == CHUNK_SIZE) continue;
-                            voxelPos = ivec3(i, slicePos, j);
-                            checkPos = ivec3(i, slicePos - 1, j);
-                            faceIndex = 3;
-                        }
-                        break;
-                    case 2: // Z-axis slice
-                        if (positiveDirection) {
-                            if (slicePos == 0) continue;
-                            voxelPos = ivec3(i, j, slicePos - 1);
-                            checkPos = ivec3(i, j, slicePos);
-                            faceIndex = 4;
-                        }
-                        else {
-                            if (slicePos == CHUNK_SIZE) continue;
-                            voxelPos = ivec3(i, j, slicePos);
-                            checkPos = ivec3(i, j, slicePos - 1);
-                            faceIndex = 5;
-                        }
-                        break;
-                    }
+        }
 
-                    // If there's a solid voxel and the adjacent position is empty, render the quad
-                    if (getVoxel(voxelPos) && isEmptyVoxel(checkPos, faceIndex)) {
-                        return true;
-                    }
-                }
+        int size = mip->size;
+        auto isEmptyCell = [&](ivec3 cell, int face) -> bool {
+            if (cell.x >= 0 && cell.x < size && cell.y >= 0 && cell.y < size && cell.z >= 0 && cell.z < size) {
+                return !mip->isSolid(cell.x, cell.y, cell.z);
             }
-            return false;
-            };
-
-        std::lock_guard<std::mutex> lock(meshDataMutex);
-        indexData.clear();
-        vertexData.clear();
-
-        try {
-            // X-axis quads (YZ planes at x = 0, 1, 2, ..., 32)
-            for (int x = 0; x <= CHUNK_SIZE; ++x) {
-                if (state.load() == ChunkState::Unloading) {
-                    return false;
-                }
-
-                // Skip if this slice has no relevant solid voxels
-                if (!sliceHasSolidVoxels(x, 0)) {
-                    continue;
-                }
-
-                // Right-facing quad (normal +X, face index 0)
-                if (shouldRenderSliceQuad(x, 0, true)) {
-                    uint32_t baseIndex = static_cast<uint32_t>(vertexData.size());
-
-                    for (int vertex = 0; vertex < 4; ++vertex) {
-                        VertexAttributes vert;
-                        vert.data = packData(
-                            static_cast<uint8_t>(x), // X slice position (0-32)
-                            0, // Y position (not used for X-axis slices)
-                            0, // Z position (not used for X-axis slices)
-                            0, // Normal index (right face)
-                            static_cast<uint8_t>(vertex),
-                            3  // Full brightness (no AO for LOD)
-                        );
-                        vertexData.push_back(vert);
-                    }
-
-                    // Right face winding
-                    indexData.push_back(baseIndex + 0);
-                    indexData.push_back(baseIndex + 1);
-                    indexData.push_back(baseIndex + 2);
-                    indexData.push_back(baseIndex + 0);
-                    indexData.push_back(baseIndex + 2);
-                    indexData.push_back(baseIndex + 3);
-                }
-
-                // Left-facing quad (normal -X, face index 1)
-                if (shouldRenderSliceQuad(x, 0, false)) {
-                    uint32_t baseIndex = static_cast<uint32_t>(vertexData.size());
-
-                    for (int vertex = 0; vertex < 4; ++vertex) {
-                        VertexAttributes vert;
-                        vert.data = packData(
-                            static_cast<uint8_t>(x), // X slice position
-                            0, // Y position (not used for X-axis slices)
-                            0, // Z position (not used for X-axis slices)
-                            1, // Normal index (left face)
-                            static_cast<uint8_t>(vertex),
-                            3  // Full brightness (no AO for LOD)
-                        );
-                        vertexData.push_back(vert);
-                    }
-
-                    // Left face winding
-                    indexData.push_back(baseIndex + 0);
-                    indexData.push_back(baseIndex + 1);
-                    indexData.push_back(baseIndex + 2);
-                    indexData.push_back(baseIndex + 0);
-                    indexData.push_back(baseIndex + 2);
-                    indexData.push_back(baseIndex + 3);
-                }
+            const std::shared_ptr<const LodMip>& neighbor = neighborMips[face];
+            if (!neighbor) {
+                return true;
             }
+            ivec3 wrapped = (cell + ivec3(size)) % size;
+            return !neighbor->isSolid(wrapped.x, wrapped.y, wrapped.z);
+        };
 
-            // Y-axis quads (XZ planes at y = 0, 1, 2, ..., 32)
-            for (int y = 0; y <= CHUNK_SIZE; ++y) {
-                if (state.load() == ChunkState::Unloading) {
-                    return false;
-                }
-
-                if (!sliceHasSolidVoxels(y, 1)) {
-                    continue;
-                }
-
-                // Front-facing quad (normal +Y, face index 2)
-                if (shouldRenderSliceQuad(y, 1, true)) {
-                    uint32_t baseIndex = static_cast<uint32_t>(vertexData.size());
-
-                    for (int vertex = 0; vertex < 4; ++vertex) {
-                        VertexAttributes vert;
-                        vert.data = packData(
-                            0, // X position (not used for Y-axis slices)
-                            static_cast<uint8_t>(y), // Y slice position (0-32)
-                            0, // Z position (not used for Y-axis slices)
-                            2, // Normal index (front face)
-                            static_cast<uint8_t>(vertex),
-                            3  // Full brightness (no AO for LOD)
-                        );
-                        vertexData.push_back(vert);
-                    }
-
-                    indexData.push_back(baseIndex + 0);
-                    indexData.push_back(baseIndex + 1);
-                    indexData.push_back(baseIndex + 2);
-                    indexData.push_back(baseIndex + 0);
-                    indexData.push_back(baseIndex + 2);
-                    indexData.push_back(baseIndex + 3);
-                }
-
-                // Back-facing quad (normal -Y, face index 3)
-                if (shouldRenderSliceQuad(y, 1, false)) {
-                    uint32_t baseIndex = static_cast<uint32_t>(vertexData.size());
-
-                    for (int vertex = 0; vertex < 4; ++vertex) {
-                        VertexAttributes vert;
-                        vert.data = packData(
-                            0, // X position (not used for Y-axis slices)
-                            static_cast<uint8_t>(y), // Y slice position
-                            0, // Z position (not used for Y-axis slices)
-                            3, // Normal index (back face)
-                            static_cast<uint8_t>(vertex),
-                            3  // Full brightness (no AO for LOD)
-                        );
-                        vertexData.push_back(vert);
-                    }
+        std::lock_guard<std::mutex> lock(meshDataMutex);
+        quadData.clear();
 
-                    indexData.push_back(baseIndex + 0);
-                    indexData.push_back(baseIndex + 1);
-                    indexData.push_back(baseIndex + 2);
-                    indexData.push_back(baseIndex + 0);
-                    indexData.push_back(baseIndex + 2);
-                    indexData.push_back(baseIndex + 3);
-                }
-            }
+        std::array<std::vector<VertexAttributes>, 6> faceQuads;
 
-            // Z-axis quads (XY planes at z = 0, 1, 2, ..., 32)
-            for (int z = 0; z <= CHUNK_SIZE; ++z) {
-                if (state.load() == ChunkState::Unloading) {
+        try {
+            for (int z = 0; z < size; ++z) {
+                if (isCancelled()) {
                     return false;
                 }
 
-                if (!sliceHasSolidVoxels(z, 2)) {
-                    continue;
-                }
+                for (int y = 0; y < size; ++y) {
+                    for (int x = 0; x < size; ++x) {
+                        uint16_t material = mip->at(x, y, z);
+                        if (material == 0) continue;
 
-                // Top-facing quad (normal +Z, face index 4)
-                if (shouldRenderSliceQuad(z, 2, true)) {
-                    uint32_t baseIndex = static_cast<uint32_t>(vertexData.size());
-
-                    for (int vertex = 0; vertex < 4; ++vertex) {
-                        VertexAttributes vert;
-                        vert.data = packData(
-                            0, // X position (not used for Z-axis slices)
-                            0, // Y position (not used for Z-axis slices)
-                            static_cast<uint8_t>(z), // Z slice position (0-32)
-                            4, // Normal index (top face)
-                            static_cast<uint8_t>(vertex),
-                            3  // Full brightness (no AO for LOD)
-                        );
-                        vertexData.push_back(vert);
-                    }
+                        for (int face = 0; face < 6; ++face) {
+                            if (!isEmptyCell(ivec3(x, y, z) + neighborOffsets[face], face)) continue;
 
-                    indexData.push_back(baseIndex + 0);
-                    indexData.push_back(baseIndex + 1);
-                    indexData.push_back(baseIndex + 2);
-                    indexData.push_back(baseIndex + 0);
-                    indexData.push_back(baseIndex + 2);
-                    indexData.push_back(baseIndex + 3);
-                }
-
-                // Bottom-facing quad (normal -Z, face index 5)
-                if (shouldRenderSliceQuad(z, 2, false)) {
-                    uint32_t baseIndex = static_cast<uint32_t>(vertexData.size());
-
-                    for (int vertex = 0; vertex < 4; ++vertex) {
-                        VertexAttributes vert;
-                        vert.data = packData(
-                            0, // X position (not used for Z-axis slices)
-                            0, // Y position (not used for Z-axis slices)
-                            static_cast<uint8_t>(z), // Z slice position
-                            5, // Normal index (bottom face)
-                            static_cast<uint8_t>(vertex),
-                            3  // Full brightness (no AO for LOD)
-                        );
-                        vertexData.push_back(vert);
+                            VertexAttributes quad;
+                            quad.data = packLodQuad(x, y, z, material, face);
+                            faceQuads[face].push_back(quad);
+                        }
                     }
-
-                    indexData.push_back(baseIndex + 0);
-                    indexData.push_back(baseIndex + 1);
-                    indexData.push_back(baseIndex + 2);
-                    indexData.push_back(baseIndex + 0);
-                    indexData.push_back(baseIndex + 2);
-                    indexData.push_back(baseIndex + 3);
                 }
             }
         }
@@ -1272,76 +1677,108 @@ public:
             return false;
         }
 
-        if (state.load() == ChunkState::Unloading) {
+        appendFaceGroups(faceQuads);
+
+        if (isCancelled()) {
             return false;
         }
 
-        setState(ChunkState::MeshReady);
+        markMeshReady();
         return true;
     }
 
+    // Lays the per-direction quad lists out back to back in quadData so
+    // each face direction is one contiguous draw range. Needs meshDataMutex.
+    void appendFaceGroups(const std::array<std::vector<VertexAttributes>, 6>& faceQuads) {
+        size_t total = 0;
+        for (const auto& quads : faceQuads) {
+            total += quads.size();
+        }
+
+        quadData.clear();
+        quadData.reserve(total);
+        for (int face = 0; face < 6; ++face) {
+            meshFaceQuadCount[face] = static_cast<uint32_t>(faceQuads[face].size());
+            quadData.insert(quadData.end(), faceQuads[face].begin(), faceQuads[face].end());
+        }
+
+        // Quads are chunk local, so equal hashes can share one vertex buffer
+        static_assert(sizeof(VertexAttributes) == sizeof(uint32_t), "quads hash as words");
+        meshHash = ChunkHash::words(ChunkHash::SEED, meshFaceQuadCount.data(), meshFaceQuadCount.size());
+        meshHash = ChunkHash::words(meshHash, reinterpret_cast<const uint32_t*>(quadData.data()), quadData.size());
+    }
+
 public:
     // Must be run on main thread only
     void uploadToGPU(TextureManager* tex, BufferManager* buf, PipelineManager* pip) {
-        if (state.load() != ChunkState::MeshReady) return;
-
-        setState(ChunkState::UploadingToGPU);
+        // An in-place remesh swaps its staged mesh in and stays Active
+        // throughout, so a failure keeps drawing the old mesh
+        bool remesh = hasRemeshReady();
+        if (state.load() != ChunkState::MeshReady && !remesh) return;
+
+        ChunkState retryState = remesh ? ChunkState::Active : ChunkState::MeshReady;
+        if (!remesh) {
+            setState(ChunkState::UploadingToGPU);
+        }
 
-        // Initialize all GPU resources if needed
-        if (!initializeGPUResources(tex, buf, pip)) {
-            setState(ChunkState::MeshReady); // Failed, try again later
+        // Initialize the per-position resources if needed
+        if (!initializeGPUResources(buf, pip)) {
+            setState(retryState); // Failed, try again later
             return;
         }
 
         // Update chunk data
         updateChunkDataBuffer(buf);
 
-        // Upload material texture
-        uploadMaterialTexture(tex);
-
-        // Clean up old mesh buffers
-        if (meshBufferInitialized.load()) {
-            if (vertexBuffer) {
-                vertexBuffer.destroy();
-                vertexBuffer.release();
-            }
-            if (indexBuffer) {
-                indexBuffer.destroy();
-                indexBuffer.release();
-            }
+        // Material texture, shared with identical chunks
+        uploadMaterialTexture(tex, pip);
+        if (!materialInitialized.load()) {
+            setState(retryState); // Failed, try again later
+            return;
         }
 
-        // Create new mesh buffers
+        // Take the vertex buffer for the new mesh. The old one may still be
+        // drawn by other chunks and is only dropped, never overwritten.
         std::lock_guard<std::mutex> lock(meshDataMutex);
 
-        if (!vertexData.empty() && !indexData.empty()) {
-            // Create vertex buffer
-            BufferDescriptor vertexBufferDesc;
-            vertexBufferSize = vertexData.size() * sizeof(VertexAttributes);
-            vertexBufferDesc.size = vertexBufferSize;
-            vertexBufferDesc.usage = BufferUsage::CopyDst | BufferUsage::Vertex;
-            vertexBufferDesc.mappedAtCreation = false;
-
-            vertexBuffer = buf->getDevice().createBuffer(vertexBufferDesc);
-
-            // Create index buffer
-            BufferDescriptor indexBufferDesc;
-            indexBufferSize = indexData.size() * sizeof(uint16_t);
-            indexBufferDesc.size = indexBufferSize;
-            indexBufferDesc.usage = BufferUsage::CopyDst | BufferUsage::Index;
-            indexBufferDesc.mappedAtCreation = false;
-
-            indexBuffer = buf->getDevice().createBuffer(indexBufferDesc);
-
-            indexCount = static_cast<uint16_t>(indexData.size());
-
-            // Upload data
-            buf->getQueue().writeBuffer(vertexBuffer, 0, vertexData.data(), vertexBufferSize);
-            buf->getQueue().writeBuffer(indexBuffer, 0, indexData.data(), indexBufferSize);
-
+        if (!quadData.empty()) {
+            if (!sharedMesh || sharedMesh->key != meshHash) {
+                std::shared_ptr<SharedChunkMesh> entry;
+                if (dedup) {
+                    entry = dedup->findMesh(meshHash, [this](const SharedChunkMesh& found) {
+#if CHUNK_DEDUP_VERIFY
+                        return found.faceQuadCount == meshFaceQuadCount && found.quads.size() == quadData.size() &&
+                            std::equal(found.quads.begin(), found.quads.end(), quadData.begin(),
+                                [](uint32_t word, const VertexAttributes& quad) { return word == quad.data; });
+#else
+                        (void)found;
+                        return true;
+#endif
+                    });
+                }
+                if (!entry) {
+                    entry = createMeshLocked(buf);
+                    if (!entry) {
+                        setState(retryState); // Failed, try again later
+                        return;
+                    }
+                    if (dedup) {
+                        dedup->addMesh(entry);
+                    }
+                }
+                sharedMesh = std::move(entry);
+            }
             meshBufferInitialized.store(true);
         }
+        else {
+            meshBufferInitialized.store(false);
+            sharedMesh.reset();
+        }
+
+        // The GPU owns the mesh now; edits and evictions mesh again from voxels
+        std::vector<VertexAttributes>().swap(quadData);
 
+        finishRemesh();
         setState(ChunkState::Active);
     }
 
@@ -1353,12 +1790,22 @@ public:
 
         ChunkRenderData renderData;
         renderData.chunkDataBindGroup = chunkDataBindGroup;
-        renderData.materialBindGroup = materialBindGroup;
-        renderData.indexBuffer = indexBuffer;
-        renderData.vertexBuffer = vertexBuffer;
-        renderData.indexBufferSize = indexBufferSize;
-        renderData.vertexBufferSize = vertexBufferSize;
-        renderData.indexCount = indexCount;
+        {
+            std::lock_guard<std::mutex> lock(materialDataMutex);
+            if (!sharedMaterial) return std::nullopt;
+            renderData.materialBindGroup = sharedMaterial->bindGroup;
+        }
+        {
+            std::lock_guard<std::mutex> lock(meshDataMutex);
+            if (!sharedMesh) return std::nullopt;
+            renderData.vertexBuffer = sharedMesh->vertexBuffer;
+            renderData.vertexBufferSize = sharedMesh->vertexBufferSize;
+            renderData.quadCount = sharedMesh->quadCount;
+            renderData.faceQuadCount = sharedMesh->faceQuadCount;
+        }
+        for (int face = 1; face < 6; ++face) {
+            renderData.faceQuadStart[face] = renderData.faceQuadStart[face - 1] + renderData.faceQuadCount[face - 1];
+        }
         renderData.chunkPosition = position;
 
         return renderData;
@@ -1368,31 +1815,67 @@ public:
         return bindGroupsInitialized.load() && meshBufferInitialized.load();
     }
 
-    size_t getVertexDataSize() const {
+    size_t getQuadCount() const {
         std::lock_guard<std::mutex> lock(meshDataMutex);
-        return vertexData.size();
-    }
-
-    size_t getIndexDataSize() const {
-        std::lock_guard<std::mutex> lock(meshDataMutex);
-        return indexData.size();
+        return quadData.size();
     }
 
     bool hasMaterialTexture() const {
         return materialInitialized;
     }
 
+
+    // Bytes held by this chunk right now. CPU storage is measured by capacity,
+    // GPU sizes mirror what the allocation hooks counted. A texture or vertex
+    // buffer shared with identical chunks is split evenly between them.
+    MemoryFootprint getMemoryFootprint() const {
+        MemoryFootprint footprint;
+        footprint.chunks = 1;
+        {
+            std::lock_guard<std::mutex> lock(voxelDataMutex);
+            uint64_t bits = voxelData.capacity() + sizeof(brickOccupancy) + sizeof(regionOccupancy);
+            if (occupancySnapshot) bits += sizeof(OccupancySnapshot);
+            if (lodMip) bits += sizeof(LodMip) + lodMip->materials.capacity() * sizeof(uint16_t);
+            footprint.add(MemoryCategory::VoxelBits, bits);
+        }
+        {
+            std::lock_guard<std::mutex> lock(materialDataMutex);
+            footprint.add(MemoryCategory::MaterialData,
+                materialData.capacity() * sizeof(VoxelMaterial) + packedMaterials.capacity() * sizeof(uint32_t));
+            if (sharedMaterial) {
+                footprint.add(MemoryCategory::ChunkTexture, uint64_t(TOTAL_VOXELS) * 2 / sharedMaterial.holders()); // RG8
+                footprint.add(MemoryCategory::BindGroup, 0);
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(lightDataMutex);
+            uint64_t light = lightData.capacity() + packedLight.capacity() * sizeof(uint32_t);
+            if (light) footprint.add(MemoryCategory::LightData, light);
+        }
+        {
+            std::lock_guard<std::mutex> lock(meshDataMutex);
+            uint64_t retained = quadData.capacity() * sizeof(VertexAttributes);
+            if (retained) footprint.add(MemoryCategory::RetainedMesh, retained);
+            if (sharedMesh) {
+                footprint.add(MemoryCategory::VertexBuffer, sharedMesh->vertexBufferSize / sharedMesh.holders());
+            }
+        }
+
+        if (chunkDataBufferInitialized.load()) {
+            footprint.add(MemoryCategory::UniformBuffer, sizeof(ChunkData));
+        }
+        if (bindGroupsInitialized.load()) {
+            footprint.add(MemoryCategory::BindGroup, 0);
+        }
+        return footprint;
+    }
+
     void cleanupBuffersOnly() {
         /*if (vertexBuffer) {
             vertexBuffer.destroy();
             vertexBuffer.release();
             vertexBuffer = nullptr;
         }
-        if (indexBuffer) {
-            indexBuffer.destroy();
-            indexBuffer.release();
-            indexBuffer = nullptr;
-        }
         if (materialTexture3D) {
             materialTextureView3D.release();
             materialTexture3D.destroy();
@@ -1411,57 +1894,87 @@ public:
     }
 
 
-    void cleanup() {
-        // Clean up WebGPU resources
-        if (materialTextureView) {
-            materialTextureView.release();
-            materialTextureView = nullptr;
-        }
-        if (materialTexture) {
-            materialTexture.destroy();
-            materialTexture.release();
-            materialTexture = nullptr;
+    // Pack materials and light of a finished chunk into runs. Returns the
+    // bytes freed, 0 if already packed or runs would not be smaller.
+    size_t packColdData() {
+        size_t freed = 0;
+        {
+            std::lock_guard<std::mutex> lock(materialDataMutex);
+            if (packedMaterials.empty() && materialData.size() == TOTAL_VOXELS) {
+                std::vector<uint32_t> runs = packRuns(materialData, [](const VoxelMaterial& m) { return uint32_t(m.materialType); });
+                size_t flatBytes = materialData.capacity() * sizeof(VoxelMaterial);
+                if (runs.size() * sizeof(uint32_t) < flatBytes) {
+                    freed += flatBytes - runs.size() * sizeof(uint32_t);
+                    packedMaterials = std::move(runs);
+                    std::vector<VoxelMaterial>().swap(materialData);
+                }
+            }
         }
-        if (chunkDataBuffer) {
-            chunkDataBuffer.destroy();
-            chunkDataBuffer.release();
-            chunkDataBuffer = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(lightDataMutex);
+            if (packedLight.empty() && lightData.size() == TOTAL_VOXELS) {
+                std::vector<uint32_t> runs = packRuns(lightData, [](uint8_t light) { return uint32_t(light); });
+                size_t flatBytes = lightData.capacity();
+                if (runs.size() * sizeof(uint32_t) < flatBytes) {
+                    freed += flatBytes - runs.size() * sizeof(uint32_t);
+                    packedLight = std::move(runs);
+                    std::vector<uint8_t>().swap(lightData);
+                }
+            }
         }
-        if (vertexBuffer) {
-            vertexBuffer.destroy();
-            vertexBuffer.release();
-            vertexBuffer = nullptr;
+        return freed;
+    }
+
+    bool hasPackedData() const {
+        std::lock_guard<std::mutex> lock(materialDataMutex);
+        return !packedMaterials.empty();
+    }
+
+    // Drop every GPU resource but keep voxel data, so the chunk can be meshed
+    // and uploaded again. Main thread only, like uploadToGPU.
+    void releaseGPUResources() {
+        bindGroupsInitialized.store(false);
+        meshBufferInitialized.store(false);
+        materialInitialized.store(false);
+        chunkDataBufferInitialized.store(false);
+
+        // Shared entries are freed by whichever chunk lets go last
+        {
+            std::lock_guard<std::mutex> lock(materialDataMutex);
+            sharedMaterial.reset();
         }
-        if (indexBuffer) {
-            indexBuffer.destroy();
-            indexBuffer.release();
-            indexBuffer = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(meshDataMutex);
+            sharedMesh.reset();
         }
+        BufferManager::destroyTrackedBuffer(chunkDataBuffer, MemoryCategory::UniformBuffer);
         if (chunkDataBindGroup) {
             chunkDataBindGroup.release();
             chunkDataBindGroup = nullptr;
+            MemoryTracker::instance().release(MemoryCategory::BindGroup, 0);
         }
-        if (materialBindGroup) {
-            materialBindGroup.release();
-            materialBindGroup = nullptr;
-        }
+    }
 
-        // Reset state
-        materialInitialized.store(false);
-        chunkDataBufferInitialized.store(false);
-        meshBufferInitialized.store(false);
-        bindGroupsInitialized.store(false);
+    // Drop the CPU mesh copy without a GPU upload (headless runs)
+    void releaseMeshData() {
+        std::lock_guard<std::mutex> lock(meshDataMutex);
+        std::vector<VertexAttributes>().swap(quadData);
+    }
+
+    void cleanup() {
+        // Clean up WebGPU resources
+        releaseGPUResources();
 
         // Clean up data
         std::lock_guard<std::mutex> lock1(voxelDataMutex);
         std::lock_guard<std::mutex> lock2(meshDataMutex);
         std::lock_guard<std::mutex> lock3(materialDataMutex);
 
-        vertexData.clear();
-        indexData.clear();
+        quadData.clear();
+        meshFaceQuadCount = {};
         materialData.clear();
+        packedMaterials.clear();
         solidVoxels.store(0);
-        indexCount = 0;
     }
 };
 
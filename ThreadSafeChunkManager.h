@@ -4,11 +4,19 @@
 #include <mutex>
 #include <shared_mutex>
 #include <memory>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <tuple>
 #include "glm/glm.hpp"
 #include <webgpu/webgpu.hpp>
 #include <unordered_set>
 #include "ThreadSafeChunk.h"
 #include "ChunkWorkerSystem.h"
+#include "EditJournal.h"
+#include "VoxelSnapshot.h"
+#include "RayBatch.h"
+#include "VoxelLight.h"
 #include "Rendering/TextureManager.h"
 #include "Rendering/BufferManager.h"
 #include "Rendering/PipelineManager.h"
@@ -34,12 +42,19 @@ struct IVec3Equal {
     }
 };
 
+// Soft limits enforced by the manager. CPU covers chunk storage on the heap,
+// GPU the live total from MemoryTracker including shared renderer resources.
+struct MemoryBudget {
+    uint64_t cpuBytes = 8ull << 30;
+    uint64_t gpuBytes = 3ull << 30;
+};
+
 struct ChunkPriority {
     ivec3 position;
-    float distanceSquared;
+    float score; // See ThreadSafeChunkManager::creationScore
 
     bool operator<(const ChunkPriority& other) const {
-        return distanceSquared > other.distanceSquared; // Min-heap (closest first)
+        return score > other.score; // Min-heap (lowest score first)
     }
 };
 
@@ -47,9 +62,16 @@ class ThreadSafeChunkManager {
 private:
     mutable std::shared_mutex chunksMutex; // Add mutex for thread safety
     std::unordered_map<ivec3, std::shared_ptr<ThreadSafeChunk>, IVec3Hash, IVec3Equal> chunks;
+    // Chunks regenerated at another level, built next to the live chunk and
+    // swapped into chunks once they can be drawn. Guarded by chunksMutex.
+    std::unordered_map<ivec3, std::shared_ptr<ThreadSafeChunk>, IVec3Hash, IVec3Equal> replacements;
     std::unique_ptr<ChunkWorkerSystem> workerSystem;
+    std::unique_ptr<EditJournal> editJournal;
+    std::shared_ptr<HeightmapSource> heightmap; // Null for noise terrain
+    std::shared_ptr<ChunkDedup> dedup = std::make_shared<ChunkDedup>(); // Shared GPU resources of identical chunks
+    std::unique_ptr<VoxelLightEngine> lightEngine;
 
-    mutable std::vector<ChunkRenderData> cachedRenderData;
+    mutable ChunkRenderList cachedRenderData;
     mutable std::atomic<bool> renderDataDirty{ true };
     mutable std::mutex renderCacheMutex;
 
@@ -60,6 +82,8 @@ private:
     };
 
 public:
+    static constexpr int MAX_UPLOADS_PER_FRAME = 8; // Reduced from 128
+
     std::queue<GPUUploadItem> pendingGPUUploads;
     std::mutex gpuUploadMutex;
 
@@ -69,50 +93,137 @@ private:
     std::unordered_set<ivec3, IVec3Hash, IVec3Equal> chunksNeedingBindGroupUpdate;
     std::mutex bindGroupUpdateMutex;
 
-    ivec3 playerChunkPos;
+    ivec3 playerChunkPos = ivec3(0);
 
     int renderDistance = 32;
     static constexpr int CHUNK_SIZE = 32;
-    static constexpr int MAX_CHUNKS_PER_UPDATE = 6;
+    // Chunk creation per update adapts to how fast the workers finish terrain
+    static constexpr int MIN_CHUNKS_PER_UPDATE = 6;
+    static constexpr int MAX_CHUNKS_PER_UPDATE = 128;
+    static constexpr size_t TARGET_QUEUE_DEPTH = 256; // Keeps all workers fed between updates
     static constexpr int MAX_COORDINATE = 1000000; // Prevent integer overflow issues
+    // In getNeighbors order: right, left, front, back, top, bottom
+    static inline const ivec3 NEIGHBOR_OFFSETS[6] = {
+        ivec3(1, 0, 0), ivec3(-1, 0, 0), ivec3(0, 1, 0), ivec3(0, -1, 0), ivec3(0, 0, 1), ivec3(0, 0, -1)
+    };
 
     std::priority_queue<ChunkPriority> pendingChunkCreation;
 
+    // Camera state the creation order is planned around, in chunk units
+    vec3 focusChunk = vec3(0.0f);
+    vec3 focusFront = vec3(0.0f);
+    vec3 focusVelocity = vec3(0.0f); // Chunks per second
+    uint64_t lastTerrainCompleted = 0;
+
+    static constexpr float PREFETCH_SECONDS = 3.0f;  // How far ahead the camera path is extrapolated
+    static constexpr float PATH_DISCOUNT = 0.5f;     // Distance along the path counts this much
+    static constexpr float VIEW_CONE_COS = 0.6f;     // About 53 degrees, a bit wider than the view
+    static constexpr float OUT_OF_VIEW_PENALTY = 2.0f; // Straight behind counts as 1 + this times farther
+
+    MemoryBudget memoryBudget;
+    int updatesSinceCpuBudget = 0;
+    int updatesSinceLodPass = 0;
+    static constexpr int LOD_UPDATE_INTERVAL = 10;
+    static constexpr int MAX_LOD_CHANGES_PER_PASS = 64;
+    static constexpr int CPU_BUDGET_INTERVAL = 50; // Updates between packing passes
+    static constexpr int MAX_PACKS_PER_PASS = 2048;
+    static constexpr int MAX_GPU_EVICTIONS_PER_FRAME = 64;
+
+    // Chunks at or beyond this distance had their GPU data evicted and are not
+    // meshed again until it grows back. Written on the main thread.
+    std::atomic<float> gpuEvictionDistance{ std::numeric_limits<float>::infinity() };
+    std::chrono::steady_clock::time_point lastEvictionDistanceGrowth;
+
 public:
-    ThreadSafeChunkManager() {
+    static constexpr const char* WORLD_SAVE_DIR = "saves/world";
+
+    // Edits are journaled under saveDirectory; headless tools pass a scratch
+    // directory so they never touch the player's world
+    explicit ThreadSafeChunkManager(const std::filesystem::path& saveDirectory = WORLD_SAVE_DIR) {
         workerSystem = std::make_unique<ChunkWorkerSystem>();
+
+        lightEngine = std::make_unique<VoxelLightEngine>(
+            [this](const ivec3& pos) { return getChunk(pos); },
+            [this](std::function<void()> task, bool urgent) {
+                return workerSystem && workerSystem->queueTask(std::move(task),
+                    urgent ? ChunkWorkerSystem::URGENT_PRIORITY : ChunkWorkerSystem::NORMAL_PRIORITY);
+            });
+
+        editJournal = std::make_unique<EditJournal>();
+        if (!editJournal->open(saveDirectory)) {
+            std::cerr << "Edit journal unavailable, edits will not be saved" << std::endl;
+            editJournal.reset();
+        }
     }
 
     ~ThreadSafeChunkManager() {
         // Ensure proper cleanup order
+        if (lightEngine) {
+            lightEngine->requestStop();
+        }
+
         if (workerSystem) {
             workerSystem->shutdown();
-            workerSystem.reset();
+        }
+
+        if (lightEngine) {
+            lightEngine->shutdown();
+            lightEngine.reset();
+        }
+        workerSystem.reset();
+
+        if (editJournal) {
+            editJournal->close();
         }
 
         std::unique_lock<std::shared_mutex> lock(chunksMutex);
         for (auto& pair : chunks) {
             if (pair.second) {
-                pair.second->setState(ChunkState::Unloading);
-                pair.second->cleanup();
+                retireChunk(pair.second);
             }
         }
+        for (auto& pair : replacements) {
+            retireChunk(pair.second);
+        }
         chunks.clear();
+        replacements.clear();
     }
 
-    void updateChunksAsync(vec3 playerPos) {
+    // viewDir and velocity (voxels per second) steer chunk creation and
+    // queued work towards where the camera is looking and heading; zero
+    // leaves that term out
+    void updateChunksAsync(vec3 playerPos, vec3 viewDir = vec3(0.0f), vec3 velocity = vec3(0.0f)) {
         // Clamp player position to prevent coordinate overflow
         /*playerPos.x = glm::clamp(playerPos.x, -MAX_COORDINATE * CHUNK_SIZE, MAX_COORDINATE * CHUNK_SIZE);
         playerPos.y = glm::clamp(playerPos.y, -MAX_COORDINATE * CHUNK_SIZE, MAX_COORDINATE * CHUNK_SIZE);
         playerPos.z = glm::clamp(playerPos.z, -MAX_COORDINATE * CHUNK_SIZE, MAX_COORDINATE * CHUNK_SIZE);*/
 
-        playerChunkPos = ivec3(0, 0, 0);// glm::floor(playerPos / 32.0f));
+        playerChunkPos = ivec3(glm::floor(playerPos / float(CHUNK_SIZE)));
+
+        focusChunk = playerPos / float(CHUNK_SIZE);
+        focusFront = glm::length(viewDir) > 0.0f ? glm::normalize(viewDir) : vec3(0.0f);
+        focusVelocity = velocity / float(CHUNK_SIZE);
+
+        if (workerSystem) {
+            workerSystem->setFocus(playerPos, viewDir);
+        }
 
         removeDistantChunks(playerChunkPos);
         queueNewChunks(playerChunkPos);
         queueChunkBatchForGeneration(playerChunkPos);
         generateTopsoil();
+
+        if (++updatesSinceLodPass >= LOD_UPDATE_INTERVAL) {
+            updatesSinceLodPass = 0;
+            updateChunkLods(playerChunkPos);
+        }
         generateMeshes();
+        swapInReplacements();
+
+        if (++updatesSinceCpuBudget >= CPU_BUDGET_INTERVAL) {
+            updatesSinceCpuBudget = 0;
+            enforceCpuBudget(playerChunkPos);
+        }
     }
 
     void updateChunks(vec3 playerPos, TextureManager* tex, PipelineManager* pip, BufferManager* buf) {
@@ -121,25 +232,16 @@ public:
 
     // Get chunks ready for GPU upload with null safety
     std::vector<std::pair<ivec3, std::shared_ptr<ThreadSafeChunk>>> getChunksReadyForGPU() {
-        std::vector<std::pair<ivec3, std::shared_ptr<ThreadSafeChunk>>> readyChunks;
-
-        std::shared_lock<std::shared_mutex> lock(chunksMutex);
-        readyChunks.reserve(chunks.size() / 4); // Reserve some space
-
-        for (const auto& pair : chunks) {
-            if (pair.second && pair.second->getState() == ChunkState::MeshReady) {
-                readyChunks.push_back({ pair.first, pair.second });
-            }
-        }
-
-        return readyChunks;
+        return collectChunks([](const ThreadSafeChunk& chunk) {
+            return chunk.getState() == ChunkState::MeshReady || chunk.hasRemeshReady();
+        });
     }
 
-    std::vector<ChunkRenderData> getChunkRenderData() {
+    ChunkRenderList getChunkRenderData() {
         // Check if we can use cached data
         if (!renderDataDirty.load()) {
             std::lock_guard<std::mutex> lock(renderCacheMutex);
-            return cachedRenderData; // Return cached copy
+            return cachedRenderData; // Shared, not copied
         }
 
         // Rebuild render data
@@ -161,7 +263,7 @@ public:
         // Cache the result
         {
             std::lock_guard<std::mutex> lock(renderCacheMutex);
-            cachedRenderData = std::move(renderData);
+            cachedRenderData = std::make_shared<std::vector<ChunkRenderData>>(std::move(renderData));
             renderDataDirty.store(false);
         }
 
@@ -172,7 +274,6 @@ public:
         std::lock_guard<std::mutex> lock(gpuUploadMutex);
 
         // Limit uploads per frame to prevent stutter
-        const int MAX_UPLOADS_PER_FRAME = 8; // Reduced from 128
         int uploadsThisFrame = 0;
 
         // Process in batches for better cache locality
@@ -183,7 +284,7 @@ public:
             GPUUploadItem item = pendingGPUUploads.front();
             pendingGPUUploads.pop();
 
-            if (item.chunk && item.chunk->getState() == ChunkState::MeshReady) {
+            if (item.chunk && (item.chunk->getState() == ChunkState::MeshReady || item.chunk->hasRemeshReady())) {
                 currentBatch.push_back(std::move(item));
                 uploadsThisFrame++;
             }
@@ -194,8 +295,9 @@ public:
             try {
                 item.chunk->uploadToGPU(tex, buf, pip);
 
-                // Mark render cache as dirty when new chunks become active
-                if (item.chunk->getState() == ChunkState::Active) {
+                // Mark render cache as dirty when new chunks become active or
+                // swap in a new mesh
+                if (item.chunk->getState() == ChunkState::Active && !item.chunk->hasRemeshReady()) {
                     invalidateRenderCache();
                 }
             }
@@ -205,6 +307,40 @@ public:
         }
     }
 
+    // Queue every MeshReady chunk for upload; duplicates are skipped when processed
+    void queueReadyChunksForUpload() {
+        std::lock_guard<std::mutex> lock(gpuUploadMutex);
+        for (const auto& pair : getChunksReadyForGPU()) {
+            pendingGPUUploads.push({ pair.first, pair.second });
+        }
+    }
+
+    // Headless stand-in for processGPUUploads: takes the same per-frame number
+    // of queued chunks and marks them Active without touching the GPU.
+    // Returns how many chunks were activated.
+    int processUploadsWithoutGPU(int maxUploads = MAX_UPLOADS_PER_FRAME) {
+        std::lock_guard<std::mutex> lock(gpuUploadMutex);
+
+        int uploaded = 0;
+        while (!pendingGPUUploads.empty() && uploaded < maxUploads) {
+            GPUUploadItem item = pendingGPUUploads.front();
+            pendingGPUUploads.pop();
+
+            if (item.chunk && item.chunk->hasRemeshReady()) {
+                item.chunk->releaseMeshData();
+                item.chunk->finishRemesh();
+                invalidateRenderCache();
+                uploaded++;
+            }
+            else if (item.chunk && item.chunk->getState() == ChunkState::MeshReady) {
+                item.chunk->releaseMeshData();
+                setChunkStateAndInvalidate(item.chunk, ChunkState::Active);
+                uploaded++;
+            }
+        }
+        return uploaded;
+    }
+
     // Call this when chunks change state
     void invalidateRenderCache() {
         renderDataDirty.store(true);
@@ -253,19 +389,11 @@ public:
 
     std::array<std::shared_ptr<ThreadSafeChunk>, 6> getNeighbors(const ivec3& chunkPos) {
         std::array<std::shared_ptr<ThreadSafeChunk>, 6> neighbors = {};
-        ivec3 neighborPositions[6] = {
-            chunkPos + ivec3(1, 0, 0),   // Right
-            chunkPos + ivec3(-1, 0, 0),  // Left
-            chunkPos + ivec3(0, 1, 0),   // Front
-            chunkPos + ivec3(0, -1, 0),  // Back
-            chunkPos + ivec3(0, 0, 1),   // Top
-            chunkPos + ivec3(0, 0, -1)   // Bottom
-        };
 
         std::shared_lock<std::shared_mutex> lock(chunksMutex);
         for (int i = 0; i < 6; ++i) {
             // Check for coordinate overflow
-            ivec3 neighborPos = neighborPositions[i];
+            ivec3 neighborPos = chunkPos + NEIGHBOR_OFFSETS[i];
             if (glm::abs(neighborPos.x) > MAX_COORDINATE ||
                 glm::abs(neighborPos.y) > MAX_COORDINATE ||
                 glm::abs(neighborPos.z) > MAX_COORDINATE) {
@@ -283,6 +411,112 @@ public:
     }
 
 private:
+    // Update thread. Packs materials and light of every finished LOD chunk, and
+    // of full detail chunks farthest first while CPU storage is over budget.
+    void enforceCpuBudget(ivec3 center) {
+        std::vector<std::pair<float, std::shared_ptr<ThreadSafeChunk>>> finished;
+        {
+            std::shared_lock<std::shared_mutex> lock(chunksMutex);
+            for (const auto& pair : chunks) {
+                ChunkState state = pair.second ? pair.second->getState() : ChunkState::Unloading;
+                if (state == ChunkState::Active || state == ChunkState::Air) {
+                    finished.push_back({ glm::length(vec3(pair.first - center)), pair.second });
+                }
+            }
+        }
+
+        int packed = 0;
+        for (auto& [distance, chunk] : finished) {
+            if (packed >= MAX_PACKS_PER_PASS) return;
+            if (chunk->getLod() > 0 && chunk->packColdData() > 0) {
+                packed++;
+            }
+        }
+
+        uint64_t used = 0;
+        for (auto& [distance, chunk] : finished) {
+            used += chunk->getMemoryFootprint().cpuBytes();
+        }
+        if (used <= memoryBudget.cpuBytes) return;
+
+        std::sort(finished.begin(), finished.end(),
+            [](const auto& a, const auto& b) { return a.first > b.first; });
+        for (auto& [distance, chunk] : finished) {
+            if (used <= memoryBudget.cpuBytes || packed >= MAX_PACKS_PER_PASS) break;
+            if (chunk->getLod() == 0) {
+                size_t freed = chunk->packColdData();
+                used -= glm::min<uint64_t>(used, freed);
+                packed += freed > 0;
+            }
+        }
+    }
+
+    // Update thread. Moves finished chunks to the level their distance asks
+    // for, nearest first. Remeshed chunks keep drawing their old mesh until
+    // the new one is uploaded. Chunks coming nearer than the level their
+    // voxels were generated for are generated again, the coarse lattice
+    // would otherwise stay in near terrain. Neighbours are remeshed only
+    // when the shared border starts or stops matching their level, since
+    // border faces are culled against same-level chunks only.
+    void updateChunkLods(ivec3 center) {
+        std::vector<std::tuple<float, ivec3, std::shared_ptr<ThreadSafeChunk>>> changes;
+        {
+            std::shared_lock<std::shared_mutex> lock(chunksMutex);
+            for (const auto& pair : chunks) {
+                if (!pair.second || replacements.count(pair.first)) continue;
+                ChunkState state = pair.second->getState();
+                if (state != ChunkState::Active && state != ChunkState::Air) continue;
+
+                float distance = glm::length(vec3(pair.first - center));
+                uint32_t current = pair.second->getLod();
+                if (chunkLodForDistance(distance, current) != current) {
+                    changes.emplace_back(distance, pair.first, pair.second);
+                }
+            }
+        }
+        if (changes.empty()) return;
+
+        std::sort(changes.begin(), changes.end(),
+            [](const auto& a, const auto& b) { return std::get<0>(a) < std::get<0>(b); });
+        if (changes.size() > MAX_LOD_CHANGES_PER_PASS) {
+            changes.resize(MAX_LOD_CHANGES_PER_PASS);
+        }
+
+        for (auto& [distance, chunkPos, chunk] : changes) {
+            uint32_t level = chunkLodForDistance(distance);
+            if (chunkLodNeedsRegeneration(chunk->getGenerationLod(), level)) {
+                regenerateChunk(chunkPos, chunk, level); // Neighbours follow at the swap
+                continue;
+            }
+
+            uint32_t oldLevel = chunk->getLod();
+            chunk->setLod(level);
+            requestRemesh(chunkPos, chunk);
+            remeshChangedBorders(chunkPos, oldLevel, level);
+        }
+    }
+
+    // A shared border only changes when the chunk starts or stops matching
+    // the neighbour's level
+    void remeshChangedBorders(ivec3 chunkPos, uint32_t oldLevel, uint32_t level) {
+        std::array<std::shared_ptr<ThreadSafeChunk>, 6> neighbors = getNeighbors(chunkPos);
+        for (int i = 0; i < 6; ++i) {
+            if (!neighbors[i]) continue;
+            uint32_t neighborLevel = neighbors[i]->getLod();
+            if ((oldLevel == neighborLevel) != (level == neighborLevel)) {
+                requestRemesh(chunkPos + NEIGHBOR_OFFSETS[i], neighbors[i]);
+            }
+        }
+    }
+
+    // Mesh an Active chunk again in the background; it keeps drawing its
+    // current mesh until the new one is uploaded
+    void requestRemesh(ivec3 chunkPos, const std::shared_ptr<ThreadSafeChunk>& chunk) {
+        if (workerSystem && chunk->beginRemesh()) {
+            workerSystem->queueMeshRegeneration(chunk, chunkPos, getNeighbors(chunkPos));
+        }
+    }
+
     void setChunkStateAndInvalidate(std::shared_ptr<ThreadSafeChunk> chunk, ChunkState newState) {
         if (chunk) {
             ChunkState oldState = chunk->getState();
@@ -296,6 +530,73 @@ private:
         }
     }
 
+    // Builds a fresh chunk at the given level next to the live one, edits
+    // replay from the journal. The old chunk keeps drawing until
+    // swapInReplacements puts the new one in its place.
+    void regenerateChunk(ivec3 chunkPos, const std::shared_ptr<ThreadSafeChunk>& chunk, uint32_t lodlevel) {
+        {
+            std::shared_lock<std::shared_mutex> readLock(chunksMutex);
+            auto it = chunks.find(chunkPos);
+            if (it == chunks.end() || it->second != chunk || replacements.count(chunkPos)) return;
+        }
+
+        std::shared_ptr<ThreadSafeChunk> replacement = makeChunk(chunkPos, lodlevel);
+        {
+            std::unique_lock<std::shared_mutex> writeLock(chunksMutex);
+            replacements[chunkPos] = replacement;
+        }
+        if (workerSystem) {
+            workerSystem->queueTerrainGeneration(replacement, chunkPos);
+        }
+    }
+
+    // Update thread. Replacements that are drawable, or turned out to be air,
+    // take over from the chunk they were built for. Neighbours whose shared
+    // border changed level are remeshed in place.
+    void swapInReplacements() {
+        std::vector<std::tuple<ivec3, uint32_t, std::shared_ptr<ThreadSafeChunk>>> swapped;
+        {
+            std::unique_lock<std::shared_mutex> writeLock(chunksMutex);
+            for (auto it = replacements.begin(); it != replacements.end();) {
+                ChunkState state = it->second->getState();
+                if (state != ChunkState::Active && state != ChunkState::Air) {
+                    ++it;
+                    continue;
+                }
+
+                auto live = chunks.find(it->first);
+                if (live != chunks.end() && live->second) {
+                    swapped.emplace_back(it->first, live->second->getLod(), it->second);
+                    retireChunk(live->second);
+                    if (lightEngine) {
+                        lightEngine->removeChunk(it->first);
+                    }
+                    live->second = it->second;
+                }
+                else {
+                    retireChunk(it->second); // The live chunk was unloaded meanwhile
+                }
+                it = replacements.erase(it);
+            }
+        }
+        if (swapped.empty()) return;
+
+        for (auto& [chunkPos, oldLevel, chunk] : swapped) {
+            if (lightEngine && chunk->getState() == ChunkState::Active) {
+                lightEngine->addChunk(chunkPos, chunk);
+            }
+            remeshChangedBorders(chunkPos, oldLevel, chunk->getLod());
+        }
+        invalidateRenderCache();
+    }
+
+    // Queued and running jobs of a dropped chunk stop at their next check
+    static void retireChunk(const std::shared_ptr<ThreadSafeChunk>& chunk) {
+        chunk->cancelJobs();
+        chunk->setState(ChunkState::Unloading);
+        chunk->cleanup();
+    }
+
     void removeDistantChunks(ivec3 playerPos) {
         std::vector<ivec3> chunksToRemove;
 
@@ -328,11 +629,22 @@ private:
                 auto it = chunks.find(chunkPos);
                 if (it != chunks.end()) {
                     if (it->second) {
+                        // Queued and running jobs for the chunk stop at their next check
+                        it->second->cancelJobs();
                         it->second->setState(ChunkState::Unloading);
                         it->second->cleanup();
                     }
+                    if (lightEngine) {
+                        lightEngine->removeChunk(chunkPos);
+                    }
                     chunks.erase(it);
                 }
+
+                auto pending = replacements.find(chunkPos);
+                if (pending != replacements.end()) {
+                    retireChunk(pending->second);
+                    replacements.erase(pending);
+                }
             }
         }
     }
@@ -365,17 +677,60 @@ private:
 
                     std::shared_lock<std::shared_mutex> lock(chunksMutex);
                     if (chunks.find(chunkPos) == chunks.end()) {
-                        float distSq = x * x + y * y + z * z;
-                        pendingChunkCreation.push({ chunkPos, distSq });
+                        pendingChunkCreation.push({ chunkPos, creationScore(chunkPos) });
                     }
                 }
             }
         }
     }
 
+    // Lower is created sooner. Distance is taken to the camera's extrapolated
+    // path instead of its position, plus part of the way along the path, so
+    // chunks the camera is flying into come in before the ones it leaves.
+    // Chunks outside the view cone count as farther away.
+    float creationScore(ivec3 chunkPos) const {
+        vec3 center = vec3(chunkPos) + 0.5f;
+        vec3 path = focusVelocity * PREFETCH_SECONDS;
+        float pathLength = glm::length(path);
+
+        float along = 0.0f;
+        if (pathLength > 0.0f) {
+            along = glm::clamp(glm::dot(center - focusChunk, path) / (pathLength * pathLength), 0.0f, 1.0f);
+        }
+        float score = glm::length(center - (focusChunk + path * along)) + PATH_DISCOUNT * along * pathLength;
+
+        vec3 offset = center - focusChunk;
+        float distance = glm::length(offset);
+        if (distance > 1.0f && glm::length(focusFront) > 0.0f) {
+            float facing = glm::dot(offset / distance, focusFront);
+            if (facing < VIEW_CONE_COS) {
+                score *= 1.0f + OUT_OF_VIEW_PENALTY * (VIEW_CONE_COS - facing) / (1.0f + VIEW_CONE_COS);
+            }
+        }
+        return score;
+    }
+
+    // As many chunks as the workers finished terrain for since the last
+    // update, topped up while the queue is below TARGET_QUEUE_DEPTH
+    int chunkCreationBudget() {
+        if (!workerSystem) {
+            return MIN_CHUNKS_PER_UPDATE;
+        }
+
+        ChunkWorkerSystem::Stats stats = workerSystem->getStats();
+        uint64_t completed = stats.completed[ChunkWorkItem::GenerateTerrain];
+        uint64_t finished = completed - lastTerrainCompleted;
+        lastTerrainCompleted = completed;
+
+        size_t headroom = stats.queueSize < TARGET_QUEUE_DEPTH ? TARGET_QUEUE_DEPTH - stats.queueSize : 0;
+        uint64_t budget = finished + headroom;
+        return static_cast<int>(glm::clamp<uint64_t>(budget, MIN_CHUNKS_PER_UPDATE, MAX_CHUNKS_PER_UPDATE));
+    }
+
     void queueChunkBatchForGeneration(ivec3 playerChunkPos) {
         int chunksCreated = 0;
-        while (!pendingChunkCreation.empty() && chunksCreated < MAX_CHUNKS_PER_UPDATE) {
+        int budget = chunkCreationBudget();
+        while (!pendingChunkCreation.empty() && chunksCreated < budget) {
             ChunkPriority nextChunk = pendingChunkCreation.top();
             pendingChunkCreation.pop();
 
@@ -387,44 +742,63 @@ private:
             }
 
             float distanceFromPlayer = glm::length(vec3(nextChunk.position) - vec3(playerChunkPos));
-            uint32_t lodlevel = 0;
-
-            if (distanceFromPlayer > 12) {
-                lodlevel = 1;
+            if (createChunk(nextChunk.position, chunkLodForDistance(distanceFromPlayer))) {
+                chunksCreated++;
             }
+        }
+    }
 
-            auto newChunk = std::make_shared<ThreadSafeChunk>(
-                nextChunk.position * CHUNK_SIZE,
-                nextChunk.position,
-                lodlevel
-            );
+    // A new chunk with its journal edits, not inserted anywhere yet
+    std::shared_ptr<ThreadSafeChunk> makeChunk(ivec3 chunkPos, uint32_t lodlevel) {
+        auto newChunk = std::make_shared<ThreadSafeChunk>(
+            chunkPos * CHUNK_SIZE,
+            chunkPos,
+            lodlevel
+        );
 
-            if (newChunk) { // Null check for new chunk
-                {
-                    std::unique_lock<std::shared_mutex> writeLock(chunksMutex);
-                    chunks[nextChunk.position] = newChunk;
-                }
+        if (editJournal) {
+            newChunk->setPendingEdits(editJournal->getChunkEdits(chunkPos));
+        }
+        newChunk->setHeightmap(heightmap);
+        newChunk->setDedup(dedup);
+        return newChunk;
+    }
 
-                if (workerSystem) { // Null check for worker system
-                    workerSystem->queueTerrainGeneration(newChunk, nextChunk.position);
-                }
+    // Inserts a new chunk and queues its terrain generation
+    std::shared_ptr<ThreadSafeChunk> createChunk(ivec3 chunkPos, uint32_t lodlevel) {
+        auto newChunk = makeChunk(chunkPos, lodlevel);
 
-                chunksCreated++;
+        if (newChunk) { // Null check for new chunk
+            {
+                std::unique_lock<std::shared_mutex> writeLock(chunksMutex);
+                chunks[chunkPos] = newChunk;
+            }
+
+            if (workerSystem) { // Null check for worker system
+                workerSystem->queueTerrainGeneration(newChunk, chunkPos);
             }
         }
+        return newChunk;
     }
 
-    void generateTopsoil() {
-        std::vector<std::pair<ivec3, std::shared_ptr<ThreadSafeChunk>>> chunksToProcess;
-
-        {
-            std::shared_lock<std::shared_mutex> lock(chunksMutex);
-            for (const auto& pair : chunks) {
-                if (pair.second && pair.second->getState() == ChunkState::TerrainReady) {
-                    chunksToProcess.push_back(pair);
+    // Live chunks and pending replacements the predicate accepts
+    template <typename Predicate>
+    std::vector<std::pair<ivec3, std::shared_ptr<ThreadSafeChunk>>> collectChunks(Predicate accept) const {
+        std::vector<std::pair<ivec3, std::shared_ptr<ThreadSafeChunk>>> found;
+        std::shared_lock<std::shared_mutex> lock(chunksMutex);
+        for (const auto* map : { &chunks, &replacements }) {
+            for (const auto& pair : *map) {
+                if (pair.second && accept(*pair.second)) {
+                    found.push_back(pair);
                 }
             }
         }
+        return found;
+    }
+
+    void generateTopsoil() {
+        std::vector<std::pair<ivec3, std::shared_ptr<ThreadSafeChunk>>> chunksToProcess = collectChunks(
+            [](const ThreadSafeChunk& chunk) { return chunk.getState() == ChunkState::TerrainReady; });
 
         for (const auto& pair : chunksToProcess) {
             std::shared_ptr<ThreadSafeChunk> chunk = pair.second;
@@ -465,22 +839,18 @@ private:
     }
 
     void generateMeshes() {
-        std::vector<std::pair<ivec3, std::shared_ptr<ThreadSafeChunk>>> chunksToProcess;
-
-        {
-            std::shared_lock<std::shared_mutex> lock(chunksMutex);
-            for (const auto& pair : chunks) {
-                if (pair.second && pair.second->getState() == ChunkState::TopsoilReady) {
-                    chunksToProcess.push_back(pair);
-                }
-            }
-        }
+        std::vector<std::pair<ivec3, std::shared_ptr<ThreadSafeChunk>>> chunksToProcess = collectChunks(
+            [](const ThreadSafeChunk& chunk) { return chunk.getState() == ChunkState::TopsoilReady; });
 
+        float evictionDistance = gpuEvictionDistance.load();
         for (const auto& pair : chunksToProcess) {
             std::shared_ptr<ThreadSafeChunk> chunk = pair.second;
             if (!chunk) continue; // Additional null check
 
             ivec3 chunkPos = pair.first;
+            if (glm::length(vec3(chunkPos - playerChunkPos)) >= evictionDistance) {
+                continue; // Over the GPU budget out here
+            }
             std::array<std::shared_ptr<ThreadSafeChunk>, 6> neighbors = getNeighbors(chunkPos);
 
             // Check if all existing neighbors are ready
@@ -506,6 +876,12 @@ private:
             if (allNeighborsReady && workerSystem) {
                 chunk->setState(ChunkState::GeneratingMesh);
                 workerSystem->queueMeshGeneration(chunk, chunkPos, neighbors);
+
+                // Materials are final once meshing starts. Replacements are
+                // lit once they are swapped in.
+                if (lightEngine && getChunk(chunkPos) == chunk) {
+                    lightEngine->addChunk(chunkPos, chunk);
+                }
             }
         }
     }
@@ -544,11 +920,217 @@ public:
         std::cout << std::endl;
     }
 
+    // Any thread. Walks every loaded chunk, so keep it off the per-frame path.
+    MemoryReport getMemoryReport() const {
+        std::vector<std::shared_ptr<ThreadSafeChunk>> loaded;
+        {
+            std::shared_lock<std::shared_mutex> lock(chunksMutex);
+            loaded.reserve(chunks.size());
+            for (const auto& pair : chunks) {
+                if (pair.second) loaded.push_back(pair.second);
+            }
+        }
+
+        MemoryReport report;
+        for (const auto& chunk : loaded) {
+            MemoryFootprint footprint = chunk->getMemoryFootprint();
+            report.byState[chunkStateName(chunk->getState())].add(footprint);
+            report.byLod[chunk->getLod()].add(footprint);
+            report.loadedChunks.add(footprint);
+        }
+        report.liveGpu = MemoryTracker::instance().snapshot();
+        return report;
+    }
+
+    void setMemoryBudget(const MemoryBudget& budget) {
+        memoryBudget = budget;
+    }
+
+    MemoryBudget getMemoryBudget() const {
+        return memoryBudget;
+    }
+
+    // Main thread, once per frame. Evicts GPU data of the farthest Active chunks
+    // while live GPU bytes exceed the budget, down to 90% of it. Evicted chunks
+    // fall back to TopsoilReady and are meshed again once the eviction distance
+    // grows back past them.
+    void enforceGpuBudget() {
+        uint64_t used = MemoryTracker::instance().snapshot().gpuBytes();
+        auto now = std::chrono::steady_clock::now();
+
+        if (used <= memoryBudget.gpuBytes) {
+            // Let evicted chunks back in slowly while there is headroom
+            float distance = gpuEvictionDistance.load();
+            if (std::isfinite(distance) && used < memoryBudget.gpuBytes / 10 * 8 &&
+                now - lastEvictionDistanceGrowth > std::chrono::milliseconds(500)) {
+                lastEvictionDistanceGrowth = now;
+                distance += 1.0f;
+                gpuEvictionDistance.store(distance > 2.0f * renderDistance ? std::numeric_limits<float>::infinity() : distance);
+            }
+            return;
+        }
+
+        std::vector<std::pair<float, std::shared_ptr<ThreadSafeChunk>>> candidates;
+        {
+            std::shared_lock<std::shared_mutex> lock(chunksMutex);
+            for (const auto& pair : chunks) {
+                if (pair.second && pair.second->getState() == ChunkState::Active && pair.second->hasMaterialTexture()) {
+                    candidates.push_back({ glm::length(vec3(pair.first - playerChunkPos)), pair.second });
+                }
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(),
+            [](const auto& a, const auto& b) { return a.first > b.first; });
+
+        uint64_t target = memoryBudget.gpuBytes / 10 * 9;
+        int evicted = 0;
+        for (auto& [distance, chunk] : candidates) {
+            if (used <= target || evicted >= MAX_GPU_EVICTIONS_PER_FRAME) break;
+
+            // Block re-meshing before the chunk becomes eligible for it
+            if (distance < gpuEvictionDistance.load()) {
+                gpuEvictionDistance.store(distance);
+            }
+            uint64_t before = MemoryTracker::instance().snapshot().gpuBytes();
+            setChunkStateAndInvalidate(chunk, ChunkState::TopsoilReady);
+            chunk->releaseGPUResources();
+            used -= glm::min(used, before - MemoryTracker::instance().snapshot().gpuBytes());
+            evicted++;
+        }
+        lastEvictionDistanceGrowth = now;
+    }
+
+    // Main thread: persist a player edit. Cheap enough to call per click.
+    void recordVoxelEdit(const ivec3& worldVoxelPos, uint16_t oldMaterial, uint16_t newMaterial) {
+        if (editJournal) {
+            editJournal->recordEdit(worldVoxelPos, oldMaterial, newMaterial);
+        }
+        {
+            // A replacement read the journal before this edit; the next LOD
+            // pass starts it again
+            std::unique_lock<std::shared_mutex> writeLock(chunksMutex);
+            auto pending = replacements.find(ivec3(glm::floor(vec3(worldVoxelPos) / float(CHUNK_SIZE))));
+            if (pending != replacements.end()) {
+                retireChunk(pending->second);
+                replacements.erase(pending);
+            }
+        }
+        if (lightEngine) {
+            lightEngine->onVoxelChanged(worldVoxelPos, oldMaterial, newMaterial);
+        }
+    }
+
+    // Main thread, once per frame: worker time the light engine may spend
+    // this frame, summed over workers. Work past it waits for the next call.
+    void beginLightFrame(float relightBudgetMs) {
+        if (lightEngine) {
+            lightEngine->beginFrame(relightBudgetMs);
+        }
+    }
+
+    // Main thread: re-upload textures of chunks whose light changed, stopping
+    // once budgetMs is spent. Leftovers stay queued for the next frame.
+    void processLightUploads(TextureManager* tex, PipelineManager* pip, float budgetMs) {
+        if (!lightEngine) return;
+
+        auto start = std::chrono::steady_clock::now();
+        const size_t CHUNKS_PER_POLL = 4;
+
+        while (true) {
+            std::vector<std::shared_ptr<ThreadSafeChunk>> dirty = lightEngine->takeDirtyChunks(CHUNKS_PER_POLL);
+            if (dirty.empty()) break;
+
+            for (auto& chunk : dirty) {
+                // Chunks not yet on the GPU pick up their light in uploadToGPU.
+                // Only a chunk leaving a shared texture changes bind group.
+                if (chunk->getState() == ChunkState::Active && chunk->updateMaterialLight(tex, pip)) {
+                    invalidateRenderCache();
+                }
+            }
+
+            float elapsedMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if (elapsedMs >= budgetMs) break;
+        }
+    }
+
+    float getLastEditRelightMs() const {
+        return lightEngine ? lightEngine->getLastEditRelightMs() : 0.0f;
+    }
+
+    // Main thread: capture occupancy of every settled chunk in [minChunk, maxChunk].
+    // Unchanged chunks share their cached copy, so repeat snapshots are cheap.
+    std::shared_ptr<const VoxelSnapshot> createVoxelSnapshot(const ivec3& minChunk, const ivec3& maxChunk) const {
+        auto snapshot = std::make_shared<VoxelSnapshot>();
+
+        std::shared_lock<std::shared_mutex> lock(chunksMutex);
+        for (const auto& [pos, chunk] : chunks) {
+            if (!chunk ||
+                pos.x < minChunk.x || pos.y < minChunk.y || pos.z < minChunk.z ||
+                pos.x > maxChunk.x || pos.y > maxChunk.y || pos.z > maxChunk.z) {
+                continue;
+            }
+
+            // Skip chunks whose voxels are still being written or are all air
+            ChunkState state = chunk->getState();
+            if (state == ChunkState::Empty || state == ChunkState::GeneratingTerrain ||
+                state == ChunkState::Air || state == ChunkState::Unloading ||
+                chunk->getSolidVoxels() == 0) {
+                continue;
+            }
+            snapshot->addChunk(pos, chunk->getOccupancySnapshot());
+        }
+        return snapshot;
+    }
+
+    // Trace a batch on the worker threads; poll isDone() or wait() on the job
+    std::shared_ptr<RayBatchJob> castRayBatchAsync(std::shared_ptr<const VoxelSnapshot> snapshot, RayBatchInput rays) {
+        return RayBatchCaster::castAsync(std::move(snapshot), std::move(rays), [this](std::function<void()> task) {
+            return workerSystem && workerSystem->queueTask(std::move(task));
+            });
+    }
+
     size_t getChunkCount() const {
         std::shared_lock<std::shared_mutex> lock(chunksMutex);
         return chunks.size();
     }
 
+    void setRenderDistance(int distance) {
+        renderDistance = glm::max(distance, 1);
+    }
+
+    int getRenderDistance() const {
+        return renderDistance;
+    }
+
+    // On by default. Off brings back the separate topsoil stage that waits
+    // for all six neighbours' terrain, for comparison runs.
+    void setFusedTopsoil(bool fused) {
+        if (workerSystem) {
+            workerSystem->setFusedTopsoil(fused);
+        }
+    }
+
+    // Chunks created after this call take their density from the heightmap,
+    // null goes back to the noise terrain
+    void setHeightmap(std::shared_ptr<HeightmapSource> source) {
+        heightmap = std::move(source);
+    }
+
+    // Chunk the last update streamed around
+    ivec3 getStreamingCenter() const {
+        return playerChunkPos;
+    }
+
+    ChunkWorkerSystem::Stats getWorkerStats() const {
+        return workerSystem ? workerSystem->getStats() : ChunkWorkerSystem::Stats();
+    }
+
+    // Hit rates of content hashing since startup. Content counts cover every
+    // generated chunk, texture and mesh lookups only GPU uploads.
+    ChunkDedup::Stats getDedupStats() const {
+        return dedup->getStats();
+    }
+
     std::shared_ptr<ThreadSafeChunk> getChunk(const ivec3& pos) const {
         // Bounds check to prevent coordinate overflow
         if (glm::abs(pos.x) > MAX_COORDINATE ||
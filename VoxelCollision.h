@@ -0,0 +1,279 @@
+// VoxelCollision.h - Swept AABB collision against the voxel grid
+#ifndef VOXEL_COLLISION
+#define VOXEL_COLLISION
+
+#include "glm/glm.hpp"
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include "VoxelSnapshot.h"
+
+using glm::vec2;
+using glm::vec3;
+using glm::ivec3;
+
+// Axis-aligned box. Voxel (x, y, z) fills [x, x+1) on every axis; z is up.
+struct CollisionBody {
+    vec3 center = vec3(0.0f);
+    vec3 halfExtents = vec3(0.3f, 0.3f, 0.9f);
+    bool onGround = false;
+};
+
+struct CollisionSettings {
+    float stepHeight = 1.01f; // Ledges up to this height are climbed (one voxel); 0 disables
+    float skin = 0.001f;     // Gap kept between bodies and voxel faces
+};
+
+struct CollisionResult {
+    vec3 applied = vec3(0.0f); // Displacement actually applied
+    glm::bvec3 blocked = glm::bvec3(false);
+    bool stepped = false;
+};
+
+class CollisionBatchJob;
+
+// Pure functions of (snapshot, bodies, displacements): the same inputs give
+// bit-identical results on any thread and in any batch split.
+class VoxelCollision {
+public:
+    static constexpr int BODIES_PER_TASK = 64;
+    static constexpr float MAX_DISPLACEMENT = 64.0f; // Per axis per call
+
+    // Broadphase: any solid voxel in the inclusive voxel range? Walks the
+    // per-column z bitmasks, one map lookup per chunk touched.
+    static bool boxHasSolid(const VoxelSnapshot& snapshot, const ivec3& voxelMin, const ivec3& voxelMax) {
+        constexpr int CS = VoxelSnapshot::CHUNK_SIZE;
+        if (voxelMin.x > voxelMax.x || voxelMin.y > voxelMax.y || voxelMin.z > voxelMax.z) {
+            return false;
+        }
+
+        ivec3 chunkMin = VoxelSnapshot::chunkOf(voxelMin);
+        ivec3 chunkMax = VoxelSnapshot::chunkOf(voxelMax);
+
+        for (int cz = chunkMin.z; cz <= chunkMax.z; ++cz) {
+            int z0 = std::max(voxelMin.z - cz * CS, 0);
+            int z1 = std::min(voxelMax.z - cz * CS, CS - 1);
+            uint32_t zBits = static_cast<uint32_t>(((uint64_t(1) << (z1 + 1)) - 1) & ~((uint64_t(1) << z0) - 1));
+
+            for (int cy = chunkMin.y; cy <= chunkMax.y; ++cy) {
+                int y0 = std::max(voxelMin.y - cy * CS, 0);
+                int y1 = std::min(voxelMax.y - cy * CS, CS - 1);
+
+                for (int cx = chunkMin.x; cx <= chunkMax.x; ++cx) {
+                    const VoxelSnapshot::ChunkBits* bits = snapshot.findChunk(ivec3(cx, cy, cz));
+                    if (!bits) continue;
+
+                    int x0 = std::max(voxelMin.x - cx * CS, 0);
+                    int x1 = std::min(voxelMax.x - cx * CS, CS - 1);
+                    for (int y = y0; y <= y1; ++y) {
+                        const uint32_t* row = bits->columns.data() + y * CS;
+                        for (int x = x0; x <= x1; ++x) {
+                            if (row[x] & zBits) return true;
+                        }
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    static bool overlapsSolid(const VoxelSnapshot& snapshot, const vec3& boxMin, const vec3& boxMax) {
+        return boxHasSolid(snapshot, voxelRangeMin(boxMin), voxelRangeMax(boxMax));
+    }
+
+    // Move one body by displacement: up axis first, then x and y, each swept
+    // layer by layer so nothing tunnels. Blocked horizontal moves retry from
+    // stepHeight higher and keep whichever attempt gets further.
+    static CollisionResult moveBody(const VoxelSnapshot& snapshot, CollisionBody& body, const vec3& displacement,
+        const CollisionSettings& settings = CollisionSettings()) {
+        CollisionResult result;
+        vec3 move = glm::clamp(displacement, vec3(-MAX_DISPLACEMENT), vec3(MAX_DISPLACEMENT));
+        vec3 center = body.center;
+
+        float dz = sweepAxis(snapshot, center, body.halfExtents, 2, move.z, settings.skin);
+        center.z += dz;
+        result.blocked.z = dz != move.z;
+
+        vec3 flat = center;
+        vec2 flatMove = moveHorizontal(snapshot, flat, body.halfExtents, vec2(move.x, move.y), settings.skin);
+        result.blocked.x = flatMove.x != move.x;
+        result.blocked.y = flatMove.y != move.y;
+
+        if ((result.blocked.x || result.blocked.y) && settings.stepHeight > 0.0f) {
+            vec3 stepped = center;
+            float up = sweepAxis(snapshot, stepped, body.halfExtents, 2, settings.stepHeight, settings.skin);
+            stepped.z += up;
+            vec2 stepMove = moveHorizontal(snapshot, stepped, body.halfExtents, vec2(move.x, move.y), settings.skin);
+            stepped.z += sweepAxis(snapshot, stepped, body.halfExtents, 2, -up, settings.skin);
+
+            if (glm::dot(stepMove, stepMove) > glm::dot(flatMove, flatMove)) {
+                flat = stepped;
+                flatMove = stepMove;
+                result.stepped = true;
+                result.blocked.x = stepMove.x != move.x;
+                result.blocked.y = stepMove.y != move.y;
+            }
+        }
+
+        result.applied = flat - body.center;
+        body.center = flat;
+        body.onGround = sweepAxis(snapshot, body.center, body.halfExtents, 2, -GROUND_PROBE, settings.skin) > -GROUND_PROBE;
+        return result;
+    }
+
+    // Resolve a contiguous run of bodies; this is the unit handed to workers
+    static void moveBodies(const VoxelSnapshot& snapshot, CollisionBody* bodies, const vec3* displacements,
+        CollisionResult* results, size_t count, const CollisionSettings& settings = CollisionSettings()) {
+        for (size_t i = 0; i < count; ++i) {
+            results[i] = moveBody(snapshot, bodies[i], displacements[i], settings);
+        }
+    }
+
+    // Split a tick's bodies into BODIES_PER_TASK runs for submit(std::function<void()>),
+    // which returns false if it could not queue; rejected runs execute inline.
+    template <typename Submit>
+    static std::shared_ptr<CollisionBatchJob> moveBodiesAsync(std::shared_ptr<const VoxelSnapshot> snapshot,
+        std::vector<CollisionBody> bodies, std::vector<vec3> displacements, const CollisionSettings& settings, Submit&& submit);
+
+private:
+    static constexpr float GROUND_PROBE = 0.01f;
+
+    static ivec3 voxelRangeMin(const vec3& boxMin) {
+        return ivec3(glm::floor(boxMin));
+    }
+
+    static ivec3 voxelRangeMax(const vec3& boxMax) {
+        return ivec3(glm::ceil(boxMax)) - ivec3(1);
+    }
+
+    static vec2 moveHorizontal(const VoxelSnapshot& snapshot, vec3& center, const vec3& halfExtents, const vec2& move, float skin) {
+        float dx = sweepAxis(snapshot, center, halfExtents, 0, move.x, skin);
+        center.x += dx;
+        float dy = sweepAxis(snapshot, center, halfExtents, 1, move.y, skin);
+        center.y += dy;
+        return vec2(dx, dy);
+    }
+
+    // How far the box can travel along one axis: step through each voxel layer
+    // the leading face enters and stop skin short of the first solid one.
+    static float sweepAxis(const VoxelSnapshot& snapshot, const vec3& center, const vec3& halfExtents, int axis, float distance, float skin) {
+        if (distance == 0.0f) {
+            return 0.0f;
+        }
+
+        vec3 boxMin = center - halfExtents;
+        vec3 boxMax = center + halfExtents;
+        ivec3 layerMin = voxelRangeMin(boxMin);
+        ivec3 layerMax = voxelRangeMax(boxMax);
+
+        if (distance > 0.0f) {
+            float face = boxMax[axis];
+            int first = static_cast<int>(std::ceil(face));
+            int last = static_cast<int>(std::ceil(face + distance)) - 1;
+            for (int layer = first; layer <= last; ++layer) {
+                layerMin[axis] = layer;
+                layerMax[axis] = layer;
+                if (boxHasSolid(snapshot, layerMin, layerMax)) {
+                    return std::max(0.0f, std::min(distance, static_cast<float>(layer) - face - skin));
+                }
+            }
+        }
+        else {
+            float face = boxMin[axis];
+            int first = static_cast<int>(std::floor(face)) - 1;
+            int last = static_cast<int>(std::floor(face + distance));
+            for (int layer = first; layer >= last; --layer) {
+                layerMin[axis] = layer;
+                layerMax[axis] = layer;
+                if (boxHasSolid(snapshot, layerMin, layerMax)) {
+                    return std::min(0.0f, std::max(distance, static_cast<float>(layer + 1) - face + skin));
+                }
+            }
+        }
+        return distance;
+    }
+
+};
+
+// Handle for bodies resolved on worker threads. Bodies and results are
+// valid once isDone() returns true or wait() has returned.
+class CollisionBatchJob {
+    friend class VoxelCollision;
+
+    std::shared_ptr<const VoxelSnapshot> snapshot;
+    std::vector<CollisionBody> bodies;
+    std::vector<vec3> displacements;
+    std::vector<CollisionResult> results;
+    CollisionSettings settings;
+
+    std::atomic<int> remainingTasks{ 0 };
+    mutable std::mutex doneMutex;
+    mutable std::condition_variable doneCondition;
+
+    void finishTask() {
+        if (remainingTasks.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(doneMutex);
+            doneCondition.notify_all();
+        }
+    }
+
+public:
+    bool isDone() const {
+        return remainingTasks.load() == 0;
+    }
+
+    void wait() const {
+        std::unique_lock<std::mutex> lock(doneMutex);
+        doneCondition.wait(lock, [this] { return remainingTasks.load() == 0; });
+    }
+
+    const std::vector<CollisionBody>& getBodies() const {
+        return bodies;
+    }
+
+    const std::vector<CollisionResult>& getResults() const {
+        return results;
+    }
+};
+
+template <typename Submit>
+std::shared_ptr<CollisionBatchJob> VoxelCollision::moveBodiesAsync(std::shared_ptr<const VoxelSnapshot> snapshot,
+    std::vector<CollisionBody> bodies, std::vector<vec3> displacements, const CollisionSettings& settings, Submit&& submit) {
+    auto job = std::make_shared<CollisionBatchJob>();
+    job->snapshot = std::move(snapshot);
+    job->bodies = std::move(bodies);
+    job->displacements = std::move(displacements);
+    job->displacements.resize(job->bodies.size(), vec3(0.0f));
+    job->results.resize(job->bodies.size());
+    job->settings = settings;
+
+    size_t count = job->bodies.size();
+    if (count == 0 || !job->snapshot) {
+        return job;
+    }
+
+    int taskCount = static_cast<int>((count + BODIES_PER_TASK - 1) / BODIES_PER_TASK);
+    job->remainingTasks.store(taskCount);
+
+    for (int i = 0; i < taskCount; ++i) {
+        size_t begin = static_cast<size_t>(i) * BODIES_PER_TASK;
+        size_t end = std::min(count, begin + BODIES_PER_TASK);
+        std::function<void()> task = [job, begin, end] {
+            moveBodies(*job->snapshot, job->bodies.data() + begin, job->displacements.data() + begin,
+                job->results.data() + begin, end - begin, job->settings);
+            job->finishTask();
+        };
+        if (!submit(task)) {
+            task();
+        }
+    }
+    return job;
+}
+
+#endif
@@ -0,0 +1,696 @@
+// VoxelLight.h - Sky and block light flood fill across chunks on the worker pool
+#ifndef VOXEL_LIGHT
+#define VOXEL_LIGHT
+
+#include "glm/glm.hpp"
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <unordered_set>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <algorithm>
+#include <cstdint>
+#include "ThreadSafeChunk.h"
+
+using glm::ivec3;
+
+// One queued change for a chunk. Chunks only ever write their own light:
+// anything that crosses a border becomes an update posted to the neighbour.
+struct LightUpdate {
+    enum Op : uint8_t {
+        Add,          // Offer level to voxel
+        Remove,       // Light of level arrived from a source that went dark
+        Refresh,      // Re-spread whatever light the voxel has
+        SetSolid,     // Voxel became opaque
+        SetAir,       // Voxel became transparent
+        SetEmitter,   // Voxel now emits level block light
+        ClearEmitter, // Voxel stopped emitting
+    };
+
+    uint16_t index;
+    Op op;
+    uint8_t channel; // 0 = sky, 1 = block
+    uint8_t level;
+    uint8_t fromAbove; // Sky moving straight down keeps full strength
+};
+
+class VoxelLightEngine {
+public:
+    using ChunkLookup = std::function<std::shared_ptr<ThreadSafeChunk>(const ivec3&)>;
+    using TaskSubmit = std::function<bool(std::function<void()>, bool urgent)>; // false = run inline
+
+    static constexpr int CHUNK_SIZE = 32;
+    static constexpr int TOTAL_VOXELS = CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE;
+    static constexpr uint8_t MAX_LIGHT = 15;
+    static constexpr int SKY = 0;
+    static constexpr int BLOCK = 1;
+
+    // Block light emitted by a material; 0 for everything that doesn't glow
+    static uint8_t getEmission(uint16_t material) {
+        switch (material) {
+        case LAMP_MATERIAL: return 14;
+        default: return 0;
+        }
+    }
+
+    static constexpr uint16_t LAMP_MATERIAL = 8;
+
+private:
+    struct ChunkKeyHash {
+        std::size_t operator()(const ivec3& k) const {
+            return std::hash<int64_t>{}((int64_t(k.x) * 73856093) ^ (int64_t(k.y) * 19349663) ^ (int64_t(k.z) * 83492791));
+        }
+    };
+
+    struct ChunkLightState {
+        ivec3 position;
+        std::shared_ptr<ThreadSafeChunk> chunk;
+        std::vector<LightUpdate> incoming;   // Guarded by statesMutex
+        bool scheduled = false;              // Guarded by statesMutex
+        bool urgent = false;                 // Guarded by statesMutex
+        std::array<uint8_t, 6> openSky{};    // Sky entering each face from untracked open neighbours; guarded by statesMutex
+        bool deferred = false;               // Waiting for the next frame's budget; guarded by statesMutex
+        bool lit = false;                    // First batch has run; only touched by the chunk's own task
+        std::unordered_map<uint16_t, uint8_t> emitters; // Only touched by the chunk's own task
+    };
+
+    ChunkLookup lookupChunk;
+    TaskSubmit submitTask;
+
+    mutable std::mutex statesMutex;
+    std::unordered_map<ivec3, std::shared_ptr<ChunkLightState>, ChunkKeyHash> states;
+
+    mutable std::mutex dirtyMutex;
+    std::unordered_set<ivec3, ChunkKeyHash> dirtyUrgent;
+    std::unordered_set<ivec3, ChunkKeyHash> dirtyNormal;
+
+    std::atomic<int> runningTasks{ 0 };
+    std::atomic<int> urgentChunks{ 0 };
+    std::atomic<bool> stopping{ false };
+    std::atomic<int64_t> lastEditTicks{ 0 }; // steady_clock ticks, read by whichever task finishes the edit
+    std::atomic<float> lastEditRelightMs{ 0.0f };
+
+    // Worker time left for this frame, spent by every batch. A batch that
+    // starts within it runs to the end; chunks that find it used up wait in
+    // deferred until beginFrame. Unlimited until the first beginFrame, so
+    // headless callers never stall.
+    std::atomic<int64_t> relightBudgetUs{ INT64_MAX };
+    std::vector<std::shared_ptr<ChunkLightState>> deferred; // Guarded by statesMutex
+
+    static const ivec3& direction(int face) {
+        static const ivec3 dirs[6] = {
+            ivec3(1, 0, 0), ivec3(-1, 0, 0),
+            ivec3(0, 1, 0), ivec3(0, -1, 0),
+            ivec3(0, 0, 1), ivec3(0, 0, -1)
+        };
+        return dirs[face];
+    }
+
+    static int toIndex(int x, int y, int z) {
+        return x + y * CHUNK_SIZE + z * CHUNK_SIZE * CHUNK_SIZE;
+    }
+
+public:
+    VoxelLightEngine(ChunkLookup lookup, TaskSubmit submit)
+        : lookupChunk(std::move(lookup)), submitTask(std::move(submit)) {
+    }
+
+    ~VoxelLightEngine() {
+        shutdown();
+    }
+
+    // Queued tasks return without doing work once this is set
+    void requestStop() {
+        stopping.store(true);
+    }
+
+    // Stop scheduling and wait for queued tasks; pending updates are dropped
+    void shutdown() {
+        requestStop();
+        while (runningTasks.load() > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    // Main thread: start the next frame's relight budget and hand deferred
+    // chunks back to the pool, edits first
+    void beginFrame(float budgetMs) {
+        relightBudgetUs.store(static_cast<int64_t>(budgetMs * 1000.0f));
+
+        std::vector<std::shared_ptr<ChunkLightState>> resume;
+        {
+            std::lock_guard<std::mutex> lock(statesMutex);
+            for (auto& state : deferred) {
+                state->deferred = false;
+                auto it = states.find(state->position);
+                if (it == states.end() || it->second != state) continue; // Unloaded meanwhile
+                state->scheduled = true;
+                resume.push_back(state);
+            }
+            deferred.clear();
+            std::stable_partition(resume.begin(), resume.end(), [](const auto& state) { return state->urgent; });
+        }
+
+        for (auto& state : resume) {
+            schedule(state, state->urgent);
+        }
+    }
+
+    // Main thread: start lighting a chunk whose materials are final. Open
+    // neighbours (missing above, or Air) pour sky light in; lit neighbours
+    // re-send their border so light flows across.
+    void addChunk(const ivec3& chunkPos, std::shared_ptr<ThreadSafeChunk> chunk) {
+        if (!chunk) return;
+        {
+            std::lock_guard<std::mutex> lock(statesMutex);
+            if (states.count(chunkPos)) return;
+        }
+
+        // Drawn with plain sky until the first batch replaces it in one go,
+        // see processBatch
+        chunk->withLightData([](uint8_t* light) {
+            std::fill(light, light + TOTAL_VOXELS, ThreadSafeChunk::DEFAULT_LIGHT);
+        });
+
+        std::array<uint8_t, 6> openSky = probeOpenSky(chunkPos);
+        std::array<bool, 6> trackedNeighbors{};
+        if (!track(chunkPos, chunk, openSky, trackedNeighbors)) return;
+
+        std::vector<LightUpdate> seeds;
+        chunk->withMaterialData([&](const VoxelMaterial* materials, size_t count) {
+            for (size_t i = 0; i < count; ++i) {
+                uint8_t emission = getEmission(materials[i].materialType);
+                if (emission > 0) {
+                    seeds.push_back({ static_cast<uint16_t>(i), LightUpdate::SetEmitter, BLOCK, emission, 0 });
+                }
+            }
+        });
+
+        for (int face = 0; face < 6; ++face) {
+            if (trackedNeighbors[face]) {
+                // Ask the neighbour to re-spread its border layer into us
+                post(chunkPos + direction(face), borderRefresh(face ^ 1), false);
+                continue;
+            }
+            if (openSky[face] == 0) continue;
+
+            // Sky enters the border layer; straight down it keeps full strength
+            forEachFaceVoxel(face, [&](int index) {
+                seeds.push_back({ static_cast<uint16_t>(index), LightUpdate::Add, SKY, openSky[face], uint8_t(face == 4) });
+            });
+        }
+
+        post(chunkPos, std::move(seeds), false);
+    }
+
+    // Main thread: stop tracking a chunk that is being unloaded
+    void removeChunk(const ivec3& chunkPos) {
+        std::lock_guard<std::mutex> lock(statesMutex);
+        states.erase(chunkPos);
+    }
+
+    // Main thread: a voxel changed material. Only the affected region is
+    // relit: darkness spreads out from the change, then surrounding light
+    // flows back in. Updates run ahead of normal lighting work.
+    void onVoxelChanged(const ivec3& worldVoxel, uint16_t oldMaterial, uint16_t newMaterial) {
+        ivec3 chunkPos = chunkOf(worldVoxel);
+        ivec3 local = worldVoxel - chunkPos * CHUNK_SIZE;
+        uint16_t index = static_cast<uint16_t>(toIndex(local.x, local.y, local.z));
+
+        bool tracked;
+        {
+            std::lock_guard<std::mutex> lock(statesMutex);
+            tracked = states.count(chunkPos) > 0;
+        }
+        if (!tracked) {
+            // Edits in Air chunks: start tracking with the open sky they implied
+            std::shared_ptr<ThreadSafeChunk> chunk = lookupChunk(chunkPos);
+            if (!chunk || !isOpen(chunk, false)) return;
+            addOpenChunk(chunkPos, chunk);
+        }
+
+        std::vector<LightUpdate> updates;
+        uint8_t oldEmission = getEmission(oldMaterial);
+        uint8_t newEmission = getEmission(newMaterial);
+
+        if (oldEmission > 0) {
+            updates.push_back({ index, LightUpdate::ClearEmitter, BLOCK, oldEmission, 0 });
+        }
+        if (newMaterial != 0 && oldMaterial == 0) {
+            updates.push_back({ index, LightUpdate::SetSolid, SKY, 0, 0 });
+        }
+        else if (newMaterial == 0 && oldMaterial != 0) {
+            updates.push_back({ index, LightUpdate::SetAir, SKY, 0, 0 });
+        }
+        if (newEmission > 0) {
+            updates.push_back({ index, LightUpdate::SetEmitter, BLOCK, newEmission, 0 });
+        }
+        if (updates.empty()) return;
+
+        lastEditTicks.store(std::chrono::steady_clock::now().time_since_epoch().count());
+        post(chunkPos, std::move(updates), true);
+    }
+
+    // Main thread: chunks whose light changed since the last call, edit
+    // results first, so uploads can be spread over frames
+    std::vector<std::shared_ptr<ThreadSafeChunk>> takeDirtyChunks(size_t maxCount) {
+        std::vector<ivec3> positions;
+        {
+            std::lock_guard<std::mutex> lock(dirtyMutex);
+            for (auto* set : { &dirtyUrgent, &dirtyNormal }) {
+                auto it = set->begin();
+                while (it != set->end() && positions.size() < maxCount) {
+                    positions.push_back(*it);
+                    it = set->erase(it);
+                }
+            }
+        }
+
+        std::vector<std::shared_ptr<ThreadSafeChunk>> result;
+        result.reserve(positions.size());
+        std::lock_guard<std::mutex> lock(statesMutex);
+        for (const ivec3& pos : positions) {
+            auto it = states.find(pos);
+            if (it != states.end()) {
+                result.push_back(it->second->chunk);
+            }
+        }
+        return result;
+    }
+
+    bool isIdle() const {
+        std::lock_guard<std::mutex> lock(statesMutex);
+        for (const auto& pair : states) {
+            if (pair.second->scheduled || !pair.second->incoming.empty()) return false;
+        }
+        return true;
+    }
+
+    // Time from the last edit until all of its relight work finished,
+    // including frames it spent deferred
+    float getLastEditRelightMs() const {
+        return lastEditRelightMs.load();
+    }
+
+    size_t getTrackedChunkCount() const {
+        std::lock_guard<std::mutex> lock(statesMutex);
+        return states.size();
+    }
+
+    static ivec3 chunkOf(const ivec3& voxel) {
+        return ivec3(
+            voxel.x >= 0 ? voxel.x / CHUNK_SIZE : (voxel.x - CHUNK_SIZE + 1) / CHUNK_SIZE,
+            voxel.y >= 0 ? voxel.y / CHUNK_SIZE : (voxel.y - CHUNK_SIZE + 1) / CHUNK_SIZE,
+            voxel.z >= 0 ? voxel.z / CHUNK_SIZE : (voxel.z - CHUNK_SIZE + 1) / CHUNK_SIZE
+        );
+    }
+
+private:
+    // Air chunks (and missing chunks above) count as open sky
+    static bool isOpen(const std::shared_ptr<ThreadSafeChunk>& chunk, bool missingIsOpen) {
+        if (!chunk) return missingIsOpen;
+        return chunk->getState() == ChunkState::Air || chunk->getSolidVoxels() == 0;
+    }
+
+    // Sky level entering each face: from above through a missing or Air
+    // chunk at full strength, sideways through an Air chunk one level down
+    std::array<uint8_t, 6> probeOpenSky(const ivec3& chunkPos) const {
+        std::array<uint8_t, 6> openSky{};
+        for (int face = 0; face < 6; ++face) {
+            std::shared_ptr<ThreadSafeChunk> neighbor = lookupChunk(chunkPos + direction(face));
+            if (isOpen(neighbor, face == 4)) {
+                openSky[face] = face == 4 ? MAX_LIGHT : MAX_LIGHT - 1;
+            }
+        }
+        return openSky;
+    }
+
+    // Start tracking a chunk. Tracked neighbours exchange light directly from
+    // now on, so neither side treats the shared face as open sky any more.
+    bool track(const ivec3& chunkPos, std::shared_ptr<ThreadSafeChunk> chunk, std::array<uint8_t, 6> openSky, std::array<bool, 6>& trackedNeighbors,
+        bool lit = false) {
+        std::lock_guard<std::mutex> lock(statesMutex);
+        if (states.count(chunkPos)) return false;
+
+        for (int face = 0; face < 6; ++face) {
+            auto it = states.find(chunkPos + direction(face));
+            trackedNeighbors[face] = it != states.end();
+            if (trackedNeighbors[face]) {
+                openSky[face] = 0;
+                it->second->openSky[face ^ 1] = 0;
+            }
+        }
+
+        auto state = std::make_shared<ChunkLightState>();
+        state->position = chunkPos;
+        state->chunk = std::move(chunk);
+        state->openSky = openSky;
+        state->lit = lit;
+        states[chunkPos] = state;
+        return true;
+    }
+
+    // Track an Air chunk as all sky light, the state its neighbours assumed
+    void addOpenChunk(const ivec3& chunkPos, std::shared_ptr<ThreadSafeChunk> chunk) {
+        chunk->withLightData([](uint8_t* light) {
+            std::fill(light, light + TOTAL_VOXELS, uint8_t(MAX_LIGHT << 4));
+        });
+        std::array<bool, 6> trackedNeighbors{};
+        track(chunkPos, chunk, probeOpenSky(chunkPos), trackedNeighbors, true);
+    }
+
+    template <typename Fn>
+    static void forEachFaceVoxel(int face, Fn&& fn) {
+        int axis = face / 2;
+        int layer = (face % 2 == 0) ? CHUNK_SIZE - 1 : 0;
+        for (int a = 0; a < CHUNK_SIZE; ++a) {
+            for (int b = 0; b < CHUNK_SIZE; ++b) {
+                ivec3 p;
+                p[axis] = layer;
+                p[(axis + 1) % 3] = a;
+                p[(axis + 2) % 3] = b;
+                fn(toIndex(p.x, p.y, p.z));
+            }
+        }
+    }
+
+    static std::vector<LightUpdate> borderRefresh(int face) {
+        std::vector<LightUpdate> updates;
+        updates.reserve(CHUNK_SIZE * CHUNK_SIZE);
+        forEachFaceVoxel(face, [&](int index) {
+            updates.push_back({ static_cast<uint16_t>(index), LightUpdate::Refresh, SKY, 0, 0 });
+        });
+        return updates;
+    }
+
+    void post(const ivec3& chunkPos, std::vector<LightUpdate> updates, bool urgent) {
+        if (updates.empty() || stopping.load()) return;
+
+        std::shared_ptr<ChunkLightState> toSchedule;
+        bool scheduleUrgent = false;
+        {
+            std::lock_guard<std::mutex> lock(statesMutex);
+            auto it = states.find(chunkPos);
+            if (it == states.end()) return; // Not lit (unloaded or never added)
+
+            ChunkLightState& state = *it->second;
+            state.incoming.insert(state.incoming.end(), updates.begin(), updates.end());
+            if (urgent && !state.urgent) {
+                state.urgent = true;
+                urgentChunks.fetch_add(1);
+            }
+            if (!state.scheduled && !state.deferred) {
+                state.scheduled = true;
+                toSchedule = it->second;
+                scheduleUrgent = state.urgent;
+            }
+        }
+
+        if (toSchedule) {
+            schedule(toSchedule, scheduleUrgent);
+        }
+    }
+
+    // Caller has set state->scheduled
+    void schedule(const std::shared_ptr<ChunkLightState>& state, bool urgent) {
+        runningTasks.fetch_add(1);
+        std::function<void()> task = [this, state] { runChunk(state); };
+        if (!submitTask || !submitTask(task, urgent)) {
+            task();
+        }
+    }
+
+    // Drain a chunk's queue until it stays empty. Only one task per chunk
+    // runs at a time, so its light is never written concurrently.
+    void runChunk(std::shared_ptr<ChunkLightState> state) {
+        while (!stopping.load()) {
+            std::vector<LightUpdate> batch;
+            bool urgent;
+            std::array<uint8_t, 6> openSky;
+            {
+                std::lock_guard<std::mutex> lock(statesMutex);
+                if (state->incoming.empty()) {
+                    state->scheduled = false;
+                    if (state->urgent) {
+                        state->urgent = false;
+                        if (urgentChunks.fetch_sub(1) == 1) {
+                            std::chrono::steady_clock::duration sinceEdit(
+                                std::chrono::steady_clock::now().time_since_epoch().count() - lastEditTicks.load());
+                            lastEditRelightMs.store(std::chrono::duration<float, std::milli>(sinceEdit).count());
+                        }
+                    }
+                    break;
+                }
+                if (relightBudgetUs.load() <= 0) {
+                    // Frame budget spent, the rest waits for beginFrame
+                    state->scheduled = false;
+                    state->deferred = true;
+                    deferred.push_back(state);
+                    break;
+                }
+                batch.swap(state->incoming);
+                urgent = state->urgent;
+                openSky = state->openSky;
+            }
+
+            auto batchStart = std::chrono::steady_clock::now();
+            std::array<std::vector<LightUpdate>, 6> outgoing;
+            bool changed = processBatch(*state, batch, openSky, outgoing);
+            relightBudgetUs.fetch_sub(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - batchStart).count());
+
+            if (changed) {
+                std::lock_guard<std::mutex> lock(dirtyMutex);
+                (urgent ? dirtyUrgent : dirtyNormal).insert(state->position);
+            }
+
+            for (int face = 0; face < 6; ++face) {
+                if (!outgoing[face].empty()) {
+                    post(state->position + direction(face), std::move(outgoing[face]), urgent);
+                }
+            }
+        }
+
+        if (stopping.load()) {
+            std::lock_guard<std::mutex> lock(statesMutex);
+            state->scheduled = false;
+        }
+        runningTasks.fetch_sub(1);
+    }
+
+    struct RemoveEntry {
+        uint16_t index;
+        uint8_t level;
+    };
+
+    // Two-phase BFS per channel: spread darkness from removed light, then
+    // re-spread from everything still lit at its edge plus new light.
+    bool processBatch(ChunkLightState& state, const std::vector<LightUpdate>& batch, const std::array<uint8_t, 6>& openSky,
+        std::array<std::vector<LightUpdate>, 6>& outgoing) {
+        std::shared_ptr<const ThreadSafeChunk::OccupancySnapshot> occupancy = state.chunk->getOccupancySnapshot();
+        const uint8_t* solidBits = occupancy->bits.data();
+        auto isSolid = [solidBits](int index) {
+            return (solidBits[index / 8] & (1 << (index % 8))) != 0;
+        };
+
+        bool changed = false;
+        state.chunk->withLightData([&](uint8_t* light) {
+            if (!state.lit) {
+                // The flood fill starts from darkness. The placeholder sky is
+                // replaced under the same lock, so no frame ever sees it black.
+                std::fill(light, light + TOTAL_VOXELS, uint8_t(0));
+                state.lit = true;
+                changed = true;
+            }
+            for (int channel = 0; channel < 2; ++channel) {
+                int shift = channel == SKY ? 4 : 0;
+                auto get = [&](int index) -> uint8_t { return (light[index] >> shift) & 0xF; };
+                auto set = [&](int index, uint8_t value) {
+                    light[index] = static_cast<uint8_t>((light[index] & ~(0xF << shift)) | (value << shift));
+                    changed = true;
+                };
+                auto emission = [&](int index) -> uint8_t {
+                    if (channel != BLOCK || state.emitters.empty()) return 0;
+                    auto it = state.emitters.find(static_cast<uint16_t>(index));
+                    return it != state.emitters.end() ? it->second : 0;
+                };
+
+                std::vector<RemoveEntry> removeQueue;
+                std::vector<uint16_t> cleared; // Border voxels may need their open sky back
+                std::vector<uint16_t> addQueue;
+
+                // Darkness arriving at a voxel: clear it if it was lit by the
+                // removed source, otherwise it is a light edge to re-spread
+                // Neighbours re-offer their light to a voxel that was just cleared
+                auto refreshNeighbors = [&](int index) {
+                    int x = index % CHUNK_SIZE, y = (index / CHUNK_SIZE) % CHUNK_SIZE, z = index / (CHUNK_SIZE * CHUNK_SIZE);
+                    for (int face = 0; face < 6; ++face) {
+                        ivec3 n = ivec3(x, y, z) + direction(face);
+                        if (n.x < 0 || n.x >= CHUNK_SIZE || n.y < 0 || n.y >= CHUNK_SIZE || n.z < 0 || n.z >= CHUNK_SIZE) {
+                            ivec3 wrapped = (n + ivec3(CHUNK_SIZE)) % CHUNK_SIZE;
+                            outgoing[face].push_back({ static_cast<uint16_t>(toIndex(wrapped.x, wrapped.y, wrapped.z)), LightUpdate::Refresh, SKY, 0, 0 });
+                            continue;
+                        }
+                        int ni = toIndex(n.x, n.y, n.z);
+                        if (get(ni) > 0) addQueue.push_back(static_cast<uint16_t>(ni));
+                    }
+                };
+
+                auto removeAt = [&](int index, uint8_t oldLevel, bool fromAbove) {
+                    uint8_t current = get(index);
+                    if (current == 0) return;
+                    bool derived = current < oldLevel || (channel == SKY && fromAbove && oldLevel == MAX_LIGHT && current == MAX_LIGHT);
+                    uint8_t emitted = emission(index);
+                    if (emitted > 0) {
+                        // Emitters fall back to their own level, never below
+                        if (derived && current > emitted) {
+                            set(index, emitted);
+                            removeQueue.push_back({ static_cast<uint16_t>(index), current });
+                        }
+                        addQueue.push_back(static_cast<uint16_t>(index));
+                        return;
+                    }
+                    if (derived) {
+                        set(index, 0);
+                        cleared.push_back(static_cast<uint16_t>(index));
+                        if (!isSolid(index)) {
+                            removeQueue.push_back({ static_cast<uint16_t>(index), current });
+                        }
+                        else {
+                            // Darkness stops at solids, so it may have missed
+                            // another face still lighting this one
+                            refreshNeighbors(index);
+                        }
+                    }
+                    else if (!isSolid(index)) {
+                        addQueue.push_back(static_cast<uint16_t>(index));
+                    }
+                };
+
+                // Light offered to a voxel: solids just remember the brightest offer
+                auto addAt = [&](int index, uint8_t level) {
+                    if (get(index) >= level) return;
+                    set(index, level);
+                    if (!isSolid(index)) {
+                        addQueue.push_back(static_cast<uint16_t>(index));
+                    }
+                };
+
+                std::vector<std::pair<uint16_t, uint8_t>> emitterSeeds;
+
+                for (const LightUpdate& u : batch) {
+                    switch (u.op) {
+                    case LightUpdate::Add:
+                        if (u.channel == channel) addAt(u.index, u.level);
+                        break;
+                    case LightUpdate::Remove:
+                        if (u.channel == channel) removeAt(u.index, u.level, u.fromAbove != 0);
+                        break;
+                    case LightUpdate::Refresh:
+                        if (get(u.index) > 0) addQueue.push_back(u.index);
+                        break;
+                    case LightUpdate::SetSolid: {
+                        uint8_t current = get(u.index);
+                        if (current > 0 && emission(u.index) == 0) {
+                            set(u.index, 0);
+                            cleared.push_back(u.index);
+                            removeQueue.push_back({ u.index, current });
+                        }
+                        break;
+                    }
+                    case LightUpdate::SetAir:
+                        if (emission(u.index) == 0) {
+                            if (get(u.index) > 0) set(u.index, 0); // Drop the stored face offer
+                            cleared.push_back(u.index);
+                            refreshNeighbors(u.index);
+                        }
+                        break;
+                    case LightUpdate::SetEmitter:
+                        if (channel == BLOCK) {
+                            state.emitters[u.index] = u.level;
+                            emitterSeeds.push_back({ u.index, u.level });
+                        }
+                        break;
+                    case LightUpdate::ClearEmitter:
+                        if (channel == BLOCK) {
+                            state.emitters.erase(u.index);
+                            uint8_t current = get(u.index);
+                            if (current > 0) {
+                                set(u.index, 0);
+                                removeQueue.push_back({ u.index, current });
+                            }
+                        }
+                        break;
+                    }
+                }
+
+                // Phase 1: darkness
+                for (size_t head = 0; head < removeQueue.size(); ++head) {
+                    RemoveEntry entry = removeQueue[head];
+                    int x = entry.index % CHUNK_SIZE, y = (entry.index / CHUNK_SIZE) % CHUNK_SIZE, z = entry.index / (CHUNK_SIZE * CHUNK_SIZE);
+                    for (int face = 0; face < 6; ++face) {
+                        ivec3 n = ivec3(x, y, z) + direction(face);
+                        bool down = face == 5;
+                        if (n.x < 0 || n.x >= CHUNK_SIZE || n.y < 0 || n.y >= CHUNK_SIZE || n.z < 0 || n.z >= CHUNK_SIZE) {
+                            ivec3 wrapped = (n + ivec3(CHUNK_SIZE)) % CHUNK_SIZE;
+                            outgoing[face].push_back({ static_cast<uint16_t>(toIndex(wrapped.x, wrapped.y, wrapped.z)),
+                                LightUpdate::Remove, static_cast<uint8_t>(channel), entry.level, uint8_t(down) });
+                            continue;
+                        }
+                        removeAt(toIndex(n.x, n.y, n.z), entry.level, down);
+                    }
+                }
+
+                if (channel == SKY) {
+                    for (uint16_t index : cleared) {
+                        int x = index % CHUNK_SIZE, y = (index / CHUNK_SIZE) % CHUNK_SIZE, z = index / (CHUNK_SIZE * CHUNK_SIZE);
+                        int coord[3] = { x, y, z };
+                        for (int face = 0; face < 6; ++face) {
+                            int edge = (face % 2 == 0) ? CHUNK_SIZE - 1 : 0;
+                            if (openSky[face] > 0 && coord[face / 2] == edge) {
+                                addAt(index, openSky[face]);
+                            }
+                        }
+                    }
+                }
+
+                // Emitters are applied after darkness so a removal wave can't eat them
+                for (const auto& seed : emitterSeeds) {
+                    if (get(seed.first) < seed.second) set(seed.first, seed.second);
+                    addQueue.push_back(seed.first);
+                }
+
+                // Phase 2: light
+                for (size_t head = 0; head < addQueue.size(); ++head) {
+                    int index = addQueue[head];
+                    uint8_t level = get(index);
+                    if (level == 0 || (isSolid(index) && emission(index) == 0)) continue;
+                    int x = index % CHUNK_SIZE, y = (index / CHUNK_SIZE) % CHUNK_SIZE, z = index / (CHUNK_SIZE * CHUNK_SIZE);
+                    for (int face = 0; face < 6; ++face) {
+                        bool down = face == 5;
+                        uint8_t next = (channel == SKY && down && level == MAX_LIGHT) ? MAX_LIGHT : static_cast<uint8_t>(level - 1);
+                        if (next == 0) continue;
+
+                        ivec3 n = ivec3(x, y, z) + direction(face);
+                        if (n.x < 0 || n.x >= CHUNK_SIZE || n.y < 0 || n.y >= CHUNK_SIZE || n.z < 0 || n.z >= CHUNK_SIZE) {
+                            ivec3 wrapped = (n + ivec3(CHUNK_SIZE)) % CHUNK_SIZE;
+                            outgoing[face].push_back({ static_cast<uint16_t>(toIndex(wrapped.x, wrapped.y, wrapped.z)),
+                                LightUpdate::Add, static_cast<uint8_t>(channel), next, uint8_t(down) });
+                            continue;
+                        }
+                        addAt(toIndex(n.x, n.y, n.z), next);
+                    }
+                }
+            }
+        });
+
+        return changed;
+    }
+};
+
+#endif
@@ -0,0 +1,114 @@
+// VoxelSnapshot.h - Immutable occupancy view of a region of the world
+#ifndef VOXEL_SNAPSHOT
+#define VOXEL_SNAPSHOT
+
+#include "glm/glm.hpp"
+#include <unordered_map>
+#include <memory>
+#include <cstdint>
+#include "ChunkOccupancy.h"
+
+using glm::vec3;
+using glm::ivec3;
+
+// Built on the main thread from the chunk map, then read lock-free by any
+// number of workers. Chunks that are missing, Air, or still generating are
+// left out and read as empty.
+class VoxelSnapshot {
+public:
+    using ChunkBits = ChunkOccupancy::Snapshot;
+
+    static constexpr int CHUNK_SIZE = 32;
+    static constexpr int BRICK_SIZE = ChunkOccupancy::BRICK_SIZE;
+    static constexpr int REGION_SIZE = ChunkOccupancy::REGION_SIZE;
+
+private:
+    struct ChunkKeyHash {
+        std::size_t operator()(const ivec3& k) const {
+            return std::hash<int64_t>{}((int64_t(k.x) * 73856093) ^ (int64_t(k.y) * 19349663) ^ (int64_t(k.z) * 83492791));
+        }
+    };
+
+    std::unordered_map<ivec3, std::shared_ptr<const ChunkBits>, ChunkKeyHash> chunks;
+    ivec3 minChunk = ivec3(INT32_MAX);
+    ivec3 maxChunk = ivec3(INT32_MIN);
+
+public:
+    void addChunk(const ivec3& chunkPos, std::shared_ptr<const ChunkBits> bits) {
+        if (bits) {
+            chunks[chunkPos] = std::move(bits);
+            minChunk = glm::min(minChunk, chunkPos);
+            maxChunk = glm::max(maxChunk, chunkPos);
+        }
+    }
+
+    const ChunkBits* findChunk(const ivec3& chunkPos) const {
+        auto it = chunks.find(chunkPos);
+        return it != chunks.end() ? it->second.get() : nullptr;
+    }
+
+    bool empty() const {
+        return chunks.empty();
+    }
+
+    // World-space bounds of every stored chunk; nothing outside can be hit
+    vec3 getBoundsMin() const {
+        return vec3(minChunk * CHUNK_SIZE);
+    }
+
+    vec3 getBoundsMax() const {
+        return vec3((maxChunk + ivec3(1)) * CHUNK_SIZE);
+    }
+
+    size_t getChunkCount() const {
+        return chunks.size();
+    }
+
+    static ivec3 chunkOf(const ivec3& voxel) {
+        return ivec3(
+            voxel.x >= 0 ? voxel.x / CHUNK_SIZE : (voxel.x - CHUNK_SIZE + 1) / CHUNK_SIZE,
+            voxel.y >= 0 ? voxel.y / CHUNK_SIZE : (voxel.y - CHUNK_SIZE + 1) / CHUNK_SIZE,
+            voxel.z >= 0 ? voxel.z / CHUNK_SIZE : (voxel.z - CHUNK_SIZE + 1) / CHUNK_SIZE
+        );
+    }
+
+    bool isSolid(const ivec3& voxel) const {
+        ivec3 chunkPos = chunkOf(voxel);
+        const ChunkBits* bits = findChunk(chunkPos);
+        if (!bits) {
+            return false;
+        }
+        ivec3 local = voxel - chunkPos * CHUNK_SIZE;
+        return ChunkOccupancy::testVoxelBit(bits->bits.data(), local.x, local.y, local.z);
+    }
+
+    // Largest empty aligned cell around a voxel: 32 for an empty chunk,
+    // 8 for an empty region, 4 for an empty brick, 1 for an air voxel, 0 if the voxel is solid.
+    // Callers pass a per-ray cache so runs inside one chunk skip the map.
+    struct ChunkCache {
+        ivec3 chunkPos = ivec3(INT32_MAX);
+        const ChunkBits* bits = nullptr;
+    };
+
+    int emptyCellSize(const ivec3& voxel, ChunkCache& cache) const {
+        ivec3 chunkPos = chunkOf(voxel);
+        if (chunkPos != cache.chunkPos) {
+            cache.chunkPos = chunkPos;
+            cache.bits = findChunk(chunkPos);
+        }
+        if (!cache.bits) {
+            return CHUNK_SIZE;
+        }
+
+        ivec3 local = voxel - chunkPos * CHUNK_SIZE;
+        if (!ChunkOccupancy::testRegionBit(cache.bits->regions, local.x, local.y, local.z)) {
+            return REGION_SIZE;
+        }
+        if (!ChunkOccupancy::testBrickBit(cache.bits->bricks.data(), local.x, local.y, local.z)) {
+            return BRICK_SIZE;
+        }
+        return ChunkOccupancy::testVoxelBit(cache.bits->bits.data(), local.x, local.y, local.z) ? 0 : 1;
+    }
+};
+
+#endif
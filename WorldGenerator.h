@@ -1,5 +1,9 @@
+#ifndef WORLD_GENERATOR
+#define WORLD_GENERATOR
+
 #include "glm/glm.hpp"
 #include <FastNoise/FastNoise.h>
+#include <vector>
 
 using namespace FastNoise;
 using glm::vec3;
@@ -16,6 +20,26 @@ public:
 	float noiseScale2 = 0.015f;
     int CHUNK_SIZE = 32;
 
+	// A voxel is solid where sample3D is above this
+	static constexpr float SOLID_THRESHOLD = -0.4f;
+
+	// Bound on how much sample3D changes per voxel of distance. The largest
+	// gradient seen over 1500 random chunks is 0.047, this leaves 1.6x margin.
+	static constexpr float DENSITY_LIPSCHITZ = 0.075f;
+	static constexpr int CLASSIFY_SPACING = 4;
+
+	enum class BoxContents { Mixed, Air, Solid };
+
+	// Coarse lattice mode for sampleGrid3D and sampleGrid3D2, per graph.
+	// 1 samples every voxel. 2, 4 or 8 sample a lattice that often and fill
+	// in by trilinear interpolation. Density cells whose corners come within
+	// densityRefineMargin of SOLID_THRESHOLD are sampled in full, so the
+	// surface keeps full detail. ChunkBenchmark --lattice-report measures
+	// speed and error for each spacing.
+	int densitySpacing = 1;
+	int strataSpacing = 1;
+	float densityRefineMargin = 0.0f;
+
 public:
 	bool initialize(uint32_t s) {
 		seed = s;
@@ -32,9 +56,180 @@ public:
 		return fnGenerator2->GenSingle3D(position.x * noiseScale2, position.y * noiseScale2, position.z * noiseScale2, seed);
 	}
 
+	// Batched sample3D over a box of voxels starting at start (world x, y, z).
+	// Like sample3D the noise runs with y and z swapped, so out is indexed
+	// x + z * size.x + y * size.x * size.z
+	void sampleGrid3D(float* out, ivec3 start, ivec3 size) {
+		if (densitySpacing > 1) {
+			sampleLattice(fnGenerator, out, ivec3(start.x, start.z, start.y), ivec3(size.x, size.z, size.y),
+				noiseScale, densitySpacing, true);
+			return;
+		}
+		fnGenerator->GenUniformGrid3D(out, start.x, start.z, start.y, size.x, size.z, size.y, noiseScale, seed);
+	}
+
+	// Batched sample3D2, out is indexed x + y * size.x + z * size.x * size.y
+	void sampleGrid3D2(float* out, ivec3 start, ivec3 size) {
+		if (strataSpacing > 1) {
+			sampleLattice(fnGenerator2, out, start, size, noiseScale2, strataSpacing, false);
+			return;
+		}
+		fnGenerator2->GenUniformGrid3D(out, start.x, start.y, start.z, size.x, size.y, size.z, noiseScale2, seed);
+	}
+
+	// Proves a box of voxels all air or all solid without sampling every
+	// voxel. A lattice every CLASSIFY_SPACING voxels covers the box, so each
+	// voxel is within half a lattice diagonal of a sample and can differ from
+	// it by at most DENSITY_LIPSCHITZ times that. If every sample clears the
+	// threshold by that margin, so does every voxel. Mixed only means not
+	// proven, the caller has to sample the box in full.
+	BoxContents classifyBox(ivec3 start, ivec3 size) {
+		const int spacing = CLASSIFY_SPACING;
+		ivec3 low = floorDiv(start, spacing);
+		ivec3 posts = -floorDiv(-(start + size - 1), spacing) - low + 1;
+
+		// Lattice post i sits at voxel (low + i) * spacing
+		std::vector<float> lattice(posts.x * posts.y * posts.z);
+		fnGenerator->GenUniformGrid3D(lattice.data(), low.x, low.z, low.y, posts.x, posts.z, posts.y, noiseScale * spacing, seed);
+
+		float margin = DENSITY_LIPSCHITZ * 0.5f * spacing * 1.7320508f;
+		float minDensity = lattice[0], maxDensity = lattice[0];
+		for (float density : lattice) {
+			minDensity = glm::min(minDensity, density);
+			maxDensity = glm::max(maxDensity, density);
+		}
+
+		if (maxDensity + margin < SOLID_THRESHOLD) return BoxContents::Air;
+		if (minDensity - margin > SOLID_THRESHOLD) return BoxContents::Solid;
+		return BoxContents::Mixed;
+	}
+
 	float sample2D(vec2 position) {
 		return fnGenerator->GenSingle2D(position.x * noiseScale, position.y * noiseScale, seed);
 	}
 
+private:
+	static ivec3 floorDiv(ivec3 value, int divisor) {
+		auto axis = [divisor](int v) { return v >= 0 ? v / divisor : -((-v + divisor - 1) / divisor); };
+		return ivec3(axis(value.x), axis(value.y), axis(value.z));
+	}
+
+	// Fills out, indexed x + y * size.x + z * size.x * size.y in the node's
+	// own axes, from a lattice every spacing voxels aligned to multiples of
+	// spacing. Interpolation is separable: x, then y and z as lerps of whole
+	// rows and planes, which the compiler vectorises.
+	void sampleLattice(const FastNoise::SmartNode<>& node, float* out, ivec3 start, ivec3 size,
+		float scale, int spacing, bool refine) {
+		ivec3 low = floorDiv(start, spacing);
+		ivec3 posts = glm::max(-floorDiv(-(start + size - 1), spacing) - low + 1, ivec3(2));
+
+		std::vector<float> lattice(posts.x * posts.y * posts.z);
+		node->GenUniformGrid3D(lattice.data(), low.x, low.y, low.z, posts.x, posts.y, posts.z, scale * spacing, seed);
+
+		// Lower post and weight of the upper post for each voxel along each axis
+		std::vector<int> post[3];
+		std::vector<float> weight[3];
+		for (int axis = 0; axis < 3; ++axis) {
+			post[axis].resize(size[axis]);
+			weight[axis].resize(size[axis]);
+			for (int i = 0; i < size[axis]; ++i) {
+				int offset = start[axis] + i - low[axis] * spacing;
+				int p = glm::min(offset / spacing, posts[axis] - 2);
+				post[axis][i] = p;
+				weight[axis][i] = float(offset - p * spacing) / float(spacing);
+			}
+		}
+
+		// Along x for every lattice row
+		std::vector<float> rows(size.x * posts.y * posts.z);
+		for (int r = 0; r < posts.y * posts.z; ++r) {
+			const float* src = &lattice[r * posts.x];
+			float* dst = &rows[r * size.x];
+			for (int x = 0; x < size.x; ++x) {
+				float a = src[post[0][x]];
+				dst[x] = a + weight[0][x] * (src[post[0][x] + 1] - a);
+			}
+		}
+
+		// Along y for every lattice plane
+		std::vector<float> planes(size.x * size.y * posts.z);
+		for (int z = 0; z < posts.z; ++z) {
+			for (int y = 0; y < size.y; ++y) {
+				const float* a = &rows[(post[1][y] + z * posts.y) * size.x];
+				const float* b = a + size.x;
+				float* dst = &planes[(y + z * size.y) * size.x];
+				float w = weight[1][y];
+				for (int x = 0; x < size.x; ++x) {
+					dst[x] = a[x] + w * (b[x] - a[x]);
+				}
+			}
+		}
+
+		// Along z into out
+		const int plane = size.x * size.y;
+		for (int z = 0; z < size.z; ++z) {
+			const float* a = &planes[post[2][z] * plane];
+			const float* b = a + plane;
+			float* dst = out + z * plane;
+			float w = weight[2][z];
+			for (int i = 0; i < plane; ++i) {
+				dst[i] = a[i] + w * (b[i] - a[i]);
+			}
+		}
+
+		if (!refine) {
+			return;
+		}
+
+		// Cells whose corners straddle the threshold hold surface the
+		// lattice cannot resolve, their voxels are sampled in one batch
+		ivec3 cells = posts - 1;
+		std::vector<uint8_t> straddles(cells.x * cells.y * cells.z);
+		for (int z = 0; z < cells.z; ++z) {
+			for (int y = 0; y < cells.y; ++y) {
+				for (int x = 0; x < cells.x; ++x) {
+					float low = lattice[x + (y + z * posts.y) * posts.x];
+					float high = low;
+					for (int corner = 1; corner < 8; ++corner) {
+						int cx = x + (corner & 1), cy = y + ((corner >> 1) & 1), cz = z + (corner >> 2);
+						float value = lattice[cx + (cy + cz * posts.y) * posts.x];
+						low = glm::min(low, value);
+						high = glm::max(high, value);
+					}
+					straddles[x + (y + z * cells.y) * cells.x] =
+						low - densityRefineMargin <= SOLID_THRESHOLD && high + densityRefineMargin >= SOLID_THRESHOLD;
+				}
+			}
+		}
+
+		std::vector<int> targets;
+		std::vector<float> positions[3];
+		for (int z = 0; z < size.z; ++z) {
+			for (int y = 0; y < size.y; ++y) {
+				for (int x = 0; x < size.x; ++x) {
+					if (!straddles[post[0][x] + (post[1][y] + post[2][z] * cells.y) * cells.x]) {
+						continue;
+					}
+					targets.push_back(x + y * size.x + z * plane);
+					positions[0].push_back(float(start.x + x) * scale);
+					positions[1].push_back(float(start.y + y) * scale);
+					positions[2].push_back(float(start.z + z) * scale);
+				}
+			}
+		}
+		if (targets.empty()) {
+			return;
+		}
+
+		std::vector<float> values(targets.size());
+		node->GenPositionArray3D(values.data(), static_cast<int>(targets.size()),
+			positions[0].data(), positions[1].data(), positions[2].data(), 0.0f, 0.0f, 0.0f, seed);
+		for (size_t i = 0; i < targets.size(); ++i) {
+			out[targets[i]] = values[i];
+		}
+	}
+
     
-};
\ No newline at end of file
+};
+
+#endif // WORLD_GENERATOR
@@ -0,0 +1,129 @@
+/**
+* Far terrain: one (CELLS+1)^2 grid drawn once per clipmap level, displaced by
+* the level's height texture layer. See HeightClipmap.h for the layout.
+*/
+struct VertexInput {
+    @location(0) data: u32, // post i | post j << 16
+};
+
+struct VertexOutput {
+    @builtin(position) position: vec4f,
+    @location(0) normal: vec3f,
+    @location(1) world_position: vec3f,
+    @location(2) @interpolate(flat) material: u32,
+    @location(3) @interpolate(flat) level: i32,
+};
+
+struct FarTerrainUniforms {
+    viewProjection: mat4x4f,
+    cameraPos: vec4f,             // w = radius covered by voxel chunks
+    fog: vec4f,                   // x = fog start, y = fog end
+    levels: array<vec4i, 5>,      // origin post xy, spacing, ready
+};
+
+@group(0) @binding(0) var<uniform> uFar: FarTerrainUniforms;
+@group(0) @binding(1) var heights: texture_2d_array<f32>;
+@group(0) @binding(2) var textureAtlas: texture_2d<f32>;
+@group(0) @binding(3) var textureSampler: sampler;
+
+const CELLS: i32 = 64;
+const POSTS: i32 = 65;
+const ATLAS_TILES_X: f32 = 3.0;
+const ATLAS_TILE_MIP: f32 = 3.0; // 24px atlas, 8px tiles: one texel per tile
+
+// Posts are stored toroidally, post p in slot p mod POSTS
+fn height_at(level: i32, post: vec2i) -> f32 {
+    let slot = ((post % POSTS) + POSTS) % POSTS;
+    return textureLoad(heights, slot, level, 0).r;
+}
+
+// Neighbours are clamped to the window, slots outside it hold other posts
+fn local_height(level: i32, origin: vec2i, local_post: vec2i) -> f32 {
+    return height_at(level, origin + clamp(local_post, vec2i(0), vec2i(CELLS)));
+}
+
+@vertex
+fn vs_main(in: VertexInput, @builtin(instance_index) instance: u32) -> VertexOutput {
+    var out: VertexOutput;
+    let level = i32(instance);
+    let info = uFar.levels[level];
+    out.level = level;
+
+    if (info.w == 0) {
+        // Level not sampled yet, push the whole grid outside the clip volume
+        out.position = vec4f(2.0, 2.0, 2.0, 1.0);
+        return out;
+    }
+
+    let local_post = vec2i(i32(in.data & 0xFFFFu), i32(in.data >> 16u));
+    let origin = info.xy;
+    let spacing = f32(info.z);
+
+    var h = local_height(level, origin, local_post);
+
+    // Odd posts on the outer edge sit halfway along an edge of the next
+    // coarser level; take the midpoint of that edge so the rings meet without cracks
+    let on_x_edge = local_post.x == 0 || local_post.x == CELLS;
+    let on_y_edge = local_post.y == 0 || local_post.y == CELLS;
+    if (on_x_edge && (local_post.y & 1) == 1) {
+        h = 0.5 * (local_height(level, origin, local_post - vec2i(0, 1)) + local_height(level, origin, local_post + vec2i(0, 1)));
+    } else if (on_y_edge && (local_post.x & 1) == 1) {
+        h = 0.5 * (local_height(level, origin, local_post - vec2i(1, 0)) + local_height(level, origin, local_post + vec2i(1, 0)));
+    }
+
+    let hx0 = local_height(level, origin, local_post - vec2i(1, 0));
+    let hx1 = local_height(level, origin, local_post + vec2i(1, 0));
+    let hy0 = local_height(level, origin, local_post - vec2i(0, 1));
+    let hy1 = local_height(level, origin, local_post + vec2i(0, 1));
+    let dx = (hx1 - hx0) / (2.0 * spacing);
+    let dy = (hy1 - hy0) / (2.0 * spacing);
+    out.normal = normalize(vec3f(-dx, -dy, 1.0));
+
+    // Same rule as topsoil: grass up to one block of rise per block, dirt up
+    // to two, bare stone above that
+    let slope = max(abs(dx), abs(dy));
+    out.material = select(select(3u, 1u, slope <= 2.0), 2u, slope <= 1.0);
+
+    let world = vec3f(vec2f(origin + local_post) * spacing, h);
+    out.world_position = world;
+    out.position = uFar.viewProjection * vec4f(world, 1.0);
+    return out;
+}
+
+@fragment
+fn fs_main(in: VertexOutput) -> @location(0) vec4f {
+    let offset = in.world_position.xy - uFar.cameraPos.xy;
+    let dist = length(offset);
+
+    // Voxel chunks cover the inside of the radius
+    if (dist < uFar.cameraPos.w) {
+        discard;
+    }
+
+    // The next finer level covers the inside of this one
+    if (in.level > 0) {
+        let inner = uFar.levels[in.level - 1];
+        if (inner.w != 0) {
+            let low = vec2f(inner.xy * inner.z);
+            let high = vec2f((inner.xy + vec2i(CELLS)) * inner.z);
+            if (all(in.world_position.xy > low) && all(in.world_position.xy < high)) {
+                discard;
+            }
+        }
+    }
+
+    let tile = in.material - 1u;
+    let tile_uv = (vec2f(f32(tile % u32(ATLAS_TILES_X)), f32(tile / u32(ATLAS_TILES_X))) + vec2f(0.5)) / ATLAS_TILES_X;
+    let textureColor = textureSampleLevel(textureAtlas, textureSampler, tile_uv, ATLAS_TILE_MIP).rgb;
+
+    // Lights match shader.wgsl
+    let normal = normalize(in.normal);
+    let shading1 = max(0.3, dot(normalize(vec3f(1.5, 1.0, 2.5)), normal));
+    let shading2 = max(0.3, dot(normalize(vec3f(-1.5, -1.0, 0.0)), normal));
+    let lighting = shading1 * vec3f(0.7, 1.0, 0.95) + shading2 * vec3f(1.0, 0.6, 0.4);
+    let baseColor = textureColor * lighting;
+
+    let fogColor = vec3(0.7, 0.8, 0.9);
+    let fogFactor = pow(clamp((dist - uFar.fog.x) / (uFar.fog.y - uFar.fog.x), 0.0, 1.0), 1.2);
+    return vec4f(mix(baseColor, fogColor, fogFactor), 1.0);
+}
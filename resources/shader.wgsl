@@ -3,7 +3,7 @@
 * as input to the entry point of a shader.
 */
 struct VertexInput {
-    @location(0) data: u32,
+    @location(0) data: u32, // One packed quad per instance
 };
 
 /**
@@ -20,6 +20,7 @@ struct VertexOutput {
     @location(4) ao: f32,
     @location(5) voxel_pos: vec3f,
     @location(6) highlighted: f32,
+    @location(7) @interpolate(flat) material: u32, // LOD meshes only, 0 = sample the 3D texture
 };
 
 /**
@@ -44,8 +45,9 @@ struct UnpackedData {
     position_y: u32,
     position_z: u32,
     normal_index: u32,
-    vertex_index: u32,
+    vertex_index: u32, // Quad corner 0-3
     ao_index: u32,
+    material: u32,     // LOD quads only
 }
 
 @group(0) @binding(0) var<uniform> uMyUniforms: MyUniforms;
@@ -62,11 +64,25 @@ const ATLAS_TILES_Y: f32 = 3.0;
 const TILE_SIZE: f32 = 1.0 / ATLAS_TILES_X;
 const CHUNK_SIZE: f32 = 32.0;
 
+const LIGHT_FALLOFF: f32 = 0.8;
+const MIN_AMBIENT: f32 = 0.04;
+const BLOCK_LIGHT_COLOR: vec3f = vec3f(1.0, 0.85, 0.6);
+
+// R = material id, G = light (sky in the high nibble, block light in the low)
 fn sample_material_3d(local_pos: vec3<f32>) -> u32 {
     let sample = textureSample(material_texture_3d, material_sampler_3d, local_pos);
-    let r = u32(sample.r * 255.0 + 0.5);
+    return u32(sample.r * 255.0 + 0.5);
+}
+
+// Returns (sky, block) levels in 0..15
+fn sample_light_3d(local_pos: vec3<f32>) -> vec2<f32> {
+    let sample = textureSample(material_texture_3d, material_sampler_3d, local_pos);
     let g = u32(sample.g * 255.0 + 0.5);
-    return r | (g << 8u);
+    return vec2<f32>(f32(g >> 4u), f32(g & 15u));
+}
+
+fn light_brightness(level: f32) -> f32 {
+    return pow(LIGHT_FALLOFF, 15.0 - level);
 }
 
 fn get_atlas_uv(base_uv: vec2<f32>, material_id: u32) -> vec2<f32> {
@@ -113,15 +129,35 @@ fn fbm(st_input: vec2<f32>) -> f32 {
     return value;
 }
 
-fn unpack_data(packed_data: u32) -> UnpackedData {
+// Triangle corners for the 6 vertices of a quad. Flipped quads split along
+// the 1-3 diagonal so AO interpolates evenly.
+const quadCorners = array<u32, 6>(0u, 1u, 2u, 0u, 2u, 3u);
+const flippedQuadCorners = array<u32, 6>(0u, 1u, 3u, 1u, 2u, 3u);
+
+// Quad layout: bits 0-14 position (5 bits per axis), 15-17 normal,
+// 18-25 AO of corners 0-3 (2 bits each) or the material for LOD quads,
+// 26 flip
+fn unpack_data(packed_data: u32, quad_vertex: u32, lod: bool) -> UnpackedData {
     let packed_bits = bitcast<u32>(packed_data);
     
-    let position_x = packed_bits & 0xFFu;
-    let position_y = (packed_bits >> 8u) & 0xFFu;
-    let position_z = (packed_bits >> 16u) & 0xFFu;
-    let normal_index = (packed_bits >> 24u) & 0x7u;
-    let vertex_index = (packed_bits >> 27u) & 0x3u;
-    let ao_index = (packed_bits >> 29u) & 0x3u;
+    let position_x = packed_bits & 0x1Fu;
+    let position_y = (packed_bits >> 5u) & 0x1Fu;
+    let position_z = (packed_bits >> 10u) & 0x1Fu;
+    let normal_index = (packed_bits >> 15u) & 0x7u;
+    let flip = ((packed_bits >> 26u) & 0x1u) == 1u;
+
+    var vertex_index = quadCorners[quad_vertex];
+    if (flip) {
+        vertex_index = flippedQuadCorners[quad_vertex];
+    }
+
+    var ao_index = 3u; // LOD quads have no AO
+    var material = 0u;
+    if (lod) {
+        material = (packed_bits >> 18u) & 0xFFu;
+    } else {
+        ao_index = (packed_bits >> (18u + vertex_index * 2u)) & 0x3u;
+    }
     
     return UnpackedData(
         position_x,
@@ -129,7 +165,8 @@ fn unpack_data(packed_data: u32) -> UnpackedData {
         position_z,
         normal_index,
         vertex_index,
-        ao_index
+        ao_index,
+        material
     );
 }
 
@@ -142,37 +179,37 @@ const faceNormals: array<vec3<f32>, 6> = array<vec3<f32>, 6>(
     vec3<f32>(0.0, 0.0, -1.0)   // Bottom
 );
 
-// LOD quad vertices - these span the entire chunk face and match the original face vertex order
-const lodQuadVertices: array<array<vec3<f32>, 4>, 6> = array<array<vec3<f32>, 4>, 6>(
-    // Right face (+X) - YZ plane at x position (matches original right face)
+// Unit cube face corners, in the vertex order the mesher emits
+const faceVertices: array<array<vec3<f32>, 4>, 6> = array<array<vec3<f32>, 4>, 6>(
+    // Right face (+X)
     array<vec3<f32>, 4>(
-        vec3<f32>(0.0, 0.0, 0.0), vec3<f32>(0.0, CHUNK_SIZE, 0.0), 
-        vec3<f32>(0.0, CHUNK_SIZE, CHUNK_SIZE), vec3<f32>(0.0, 0.0, CHUNK_SIZE)
+        vec3<f32>(1.0, 0.0, 0.0), vec3<f32>(1.0, 1.0, 0.0), 
+        vec3<f32>(1.0, 1.0, 1.0), vec3<f32>(1.0, 0.0, 1.0)
     ),
-    // Left face (-X) - YZ plane at x position (matches original left face)
+    // Left face (-X)
     array<vec3<f32>, 4>(
-        vec3<f32>(0.0, 0.0, CHUNK_SIZE), vec3<f32>(0.0, CHUNK_SIZE, CHUNK_SIZE), 
-        vec3<f32>(0.0, CHUNK_SIZE, 0.0), vec3<f32>(0.0, 0.0, 0.0)
+        vec3<f32>(0.0, 0.0, 1.0), vec3<f32>(0.0, 1.0, 1.0), 
+        vec3<f32>(0.0, 1.0, 0.0), vec3<f32>(0.0, 0.0, 0.0)
     ),
-    // Front face (+Y) - XZ plane at y position (matches original front face)
+    // Front face (+Y)
     array<vec3<f32>, 4>(
-        vec3<f32>(0.0, 0.0, 0.0), vec3<f32>(0.0, 0.0, CHUNK_SIZE), 
-        vec3<f32>(CHUNK_SIZE, 0.0, CHUNK_SIZE), vec3<f32>(CHUNK_SIZE, 0.0, 0.0)
+        vec3<f32>(0.0, 1.0, 0.0), vec3<f32>(0.0, 1.0, 1.0), 
+        vec3<f32>(1.0, 1.0, 1.0), vec3<f32>(1.0, 1.0, 0.0)
     ),
-    // Back face (-Y) - XZ plane at y position (matches original back face)
+    // Back face (-Y)
     array<vec3<f32>, 4>(
-        vec3<f32>(0.0, 0.0, CHUNK_SIZE), vec3<f32>(0.0, 0.0, 0.0), 
-        vec3<f32>(CHUNK_SIZE, 0.0, 0.0), vec3<f32>(CHUNK_SIZE, 0.0, CHUNK_SIZE)
+        vec3<f32>(0.0, 0.0, 1.0), vec3<f32>(0.0, 0.0, 0.0), 
+        vec3<f32>(1.0, 0.0, 0.0), vec3<f32>(1.0, 0.0, 1.0)
     ),
-    // Top face (+Z) - XY plane at z position (matches original top face)
+    // Top face (+Z)
     array<vec3<f32>, 4>(
-        vec3<f32>(0.0, 0.0, 0.0), vec3<f32>(CHUNK_SIZE, 0.0, 0.0), 
-        vec3<f32>(CHUNK_SIZE, CHUNK_SIZE, 0.0), vec3<f32>(0.0, CHUNK_SIZE, 0.0)
+        vec3<f32>(0.0, 0.0, 1.0), vec3<f32>(1.0, 0.0, 1.0), 
+        vec3<f32>(1.0, 1.0, 1.0), vec3<f32>(0.0, 1.0, 1.0)
     ),
-    // Bottom face (-Z) - XY plane at z position (matches original bottom face)
+    // Bottom face (-Z)
     array<vec3<f32>, 4>(
-        vec3<f32>(CHUNK_SIZE, 0.0, 0.0), vec3<f32>(0.0, 0.0, 0.0), 
-        vec3<f32>(0.0, CHUNK_SIZE, 0.0), vec3<f32>(CHUNK_SIZE, CHUNK_SIZE, 0.0)
+        vec3<f32>(1.0, 0.0, 0.0), vec3<f32>(0.0, 0.0, 0.0), 
+        vec3<f32>(0.0, 1.0, 0.0), vec3<f32>(1.0, 1.0, 0.0)
     )
 );
 
@@ -214,10 +251,10 @@ const aoLevels = array<f32, 4>(
 );
 
 @vertex
-fn vs_main(in: VertexInput) -> VertexOutput {
+fn vs_main(in: VertexInput, @builtin(vertex_index) quad_vertex: u32) -> VertexOutput {
     var out: VertexOutput;
 
-    let data = unpack_data(in.data);
+    let data = unpack_data(in.data, quad_vertex, chunkData.lod > 0u);
     let chunk_world_pos = vec3f(f32(chunkData.worldPosition.x), f32(chunkData.worldPosition.y), f32(chunkData.worldPosition.z));
     
     var position: vec3f;
@@ -225,84 +262,22 @@ fn vs_main(in: VertexInput) -> VertexOutput {
     var uv: vec2f;
     
     if (chunkData.lod > 0u) {
-        // LOD rendering: generate large quads spanning chunk faces
-        // Get the base vertex position for this face and vertex
-        var base_vertex = lodQuadVertices[data.normal_index][data.vertex_index];
-        
-        // For LOD, we need to position the quad at the correct slice
-        // The slice position is encoded differently based on the axis
-        switch (data.normal_index) {
-            case 0u, 1u: { // X-axis faces (YZ planes)
-                // X position comes from packed data, Y and Z span the full chunk
-                // Handle boundary case where position might be at chunk edge (32)
-                base_vertex.x = f32(data.position_x);
-                if (base_vertex.x >= CHUNK_SIZE+1) {
-                    base_vertex.x = CHUNK_SIZE+1;
-                }
-            }
-            case 2u, 3u: { // Y-axis faces (XZ planes)  
-                // Y position comes from packed data, X and Z span the full chunk
-                base_vertex.y = f32(data.position_y);
-                if (base_vertex.y >= CHUNK_SIZE+1) {
-                    base_vertex.y = CHUNK_SIZE+1;
-                }
-            }
-            case 4u, 5u: { // Z-axis faces (XY planes)
-                // Z position comes from packed data, X and Y span the full chunk
-                base_vertex.z = f32(data.position_z);
-                if (base_vertex.z >= CHUNK_SIZE+1) {
-                    base_vertex.z = CHUNK_SIZE+1;
-                }
-            }
-            default: {}
-        }
-        
-        position = chunk_world_pos + base_vertex;
-        
-        // For material sampling, use the slice position
-        voxel_pos = vec3f(f32(data.position_x), f32(data.position_y), f32(data.position_z));
-        
-        // For LOD, scale UVs to tile across the entire quad (32x32 times)
-        let base_uv = faceUVsIndependent[data.normal_index][data.vertex_index];
-        uv = base_uv * CHUNK_SIZE; // Scale UV by chunk size to get 32x32 tiling
+        // LOD rendering: cells of 2^lod voxels, material carried in the vertex
+        let scale = f32(1u << chunkData.lod);
+        let cell = vec3f(f32(data.position_x), f32(data.position_y), f32(data.position_z));
+        out.material = data.material;
+
+        voxel_pos = cell * scale;
+        position = chunk_world_pos + (cell + faceVertices[data.normal_index][data.vertex_index]) * scale;
+
+        // Keep one texture tile per voxel across the larger face
+        uv = faceUVsIndependent[data.normal_index][data.vertex_index] * scale;
     } else {
+        out.material = 0u;
+
         // Regular voxel rendering
         voxel_pos = vec3f(f32(data.position_x), f32(data.position_y), f32(data.position_z));
         
-        // Face vertices array for regular voxel faces
-        const faceVertices: array<array<vec3<f32>, 4>, 6> = array<array<vec3<f32>, 4>, 6>(
-            // Right face (+X)
-            array<vec3<f32>, 4>(
-                vec3<f32>(1.0, 0.0, 0.0), vec3<f32>(1.0, 1.0, 0.0), 
-                vec3<f32>(1.0, 1.0, 1.0), vec3<f32>(1.0, 0.0, 1.0)
-            ),
-            // Left face (-X)
-            array<vec3<f32>, 4>(
-                vec3<f32>(0.0, 0.0, 1.0), vec3<f32>(0.0, 1.0, 1.0), 
-                vec3<f32>(0.0, 1.0, 0.0), vec3<f32>(0.0, 0.0, 0.0)
-            ),
-            // Front face (+Y)
-            array<vec3<f32>, 4>(
-                vec3<f32>(0.0, 1.0, 0.0), vec3<f32>(0.0, 1.0, 1.0), 
-                vec3<f32>(1.0, 1.0, 1.0), vec3<f32>(1.0, 1.0, 0.0)
-            ),
-            // Back face (-Y)
-            array<vec3<f32>, 4>(
-                vec3<f32>(0.0, 0.0, 1.0), vec3<f32>(0.0, 0.0, 0.0), 
-                vec3<f32>(1.0, 0.0, 0.0), vec3<f32>(1.0, 0.0, 1.0)
-            ),
-            // Top face (+Z)
-            array<vec3<f32>, 4>(
-                vec3<f32>(0.0, 0.0, 1.0), vec3<f32>(1.0, 0.0, 1.0), 
-                vec3<f32>(1.0, 1.0, 1.0), vec3<f32>(0.0, 1.0, 1.0)
-            ),
-            // Bottom face (-Z)
-            array<vec3<f32>, 4>(
-                vec3<f32>(1.0, 0.0, 0.0), vec3<f32>(0.0, 0.0, 0.0), 
-                vec3<f32>(0.0, 1.0, 0.0), vec3<f32>(1.0, 1.0, 0.0)
-            )
-        );
-        
         position = chunk_world_pos + voxel_pos + faceVertices[data.normal_index][data.vertex_index];
         
         // Regular voxel rendering uses standard UVs
@@ -353,11 +328,12 @@ fn fs_main(in: VertexOutput) -> @location(0) vec4f {
     let lightColor2 = vec3f(1.0, 0.6, 0.4);
 
     var material_id: u32;
+    var light_level: vec2<f32>;
     
     var aoComp = 1.0;
     if (chunkData.lod > 0u) {
         aoComp = 0.92;
-        // For LOD rendering, sample the 3D texture at the fragment's world position
+        // For LOD rendering, sample light at the fragment's world position
         // Convert world position back to local chunk coordinates
         let chunk_world_pos = vec3f(f32(chunkData.worldPosition.x), f32(chunkData.worldPosition.y), f32(chunkData.worldPosition.z));
         let local_world_pos = in.world_position - chunk_world_pos;
@@ -365,13 +341,10 @@ fn fs_main(in: VertexOutput) -> @location(0) vec4f {
         // Convert to normalized texture coordinates [0,1], clamping to valid range
         let texture_coords = clamp(local_world_pos / CHUNK_SIZE, vec3f(0.0), vec3f(1.0));
         
-        // For bidirectional quads, we need to sample based on the normal direction
-        // to determine which side of the boundary we're rendering
+        // Step just inside the face so the solid side is sampled
         var sample_offset = vec3f(0.0);
         let epsilon = 0.9 / CHUNK_SIZE; // Half voxel offset
         
-        // Offset sampling position slightly in the direction of the normal
-        // This ensures we sample the correct voxel on each side of the boundary
         if (abs(normal.x) > 0.9) {
             sample_offset.x = -sign(normal.x) * epsilon;
         } else if (abs(normal.y) > 0.9) {
@@ -382,17 +355,16 @@ fn fs_main(in: VertexOutput) -> @location(0) vec4f {
         
         let adjusted_coords = clamp(texture_coords + sample_offset, vec3f(0.0), vec3f(0.999));
         
-        // Sample the 3D material texture
-        material_id = sample_material_3d(adjusted_coords);
-        
-        // Discard air blocks (assuming material_id 0 is air)
-        if (material_id == 0u) {
-            discard;
-        }
+        // The cell material comes from the mesh; only light is sampled here
+        material_id = in.material;
+        light_level = sample_light_3d(adjusted_coords);
     } else {
         // Regular voxel rendering - sample at voxel center
         let material_sample_pos = (in.voxel_pos + vec3f(0.5)) / CHUNK_SIZE;
         material_id = sample_material_3d(material_sample_pos);
+
+        // Solid voxels store the brightest light reaching any of their faces
+        light_level = sample_light_3d(material_sample_pos);
         
         // Discard air blocks
         if (material_id == 0u) {
@@ -406,7 +378,12 @@ fn fs_main(in: VertexOutput) -> @location(0) vec4f {
     let ao_adjusted = pow(in.ao, 1.0);
     let shading = shading1 * lightColor1 + shading2 * lightColor2;
     
-    var baseColor = textureColor * shading * ao_adjusted * aoComp;
+    // Open sky (15) keeps the directional look; block light adds a warm fill
+    let sky = light_brightness(light_level.x);
+    let block = select(0.0, light_brightness(light_level.y), light_level.y > 0.0);
+    let lighting = max(shading * sky + BLOCK_LIGHT_COLOR * block, vec3f(MIN_AMBIENT));
+
+    var baseColor = textureColor * lighting * ao_adjusted * aoComp;
 
     if (in.highlighted > 0) {
         baseColor *= 1.5;
@@ -0,0 +1,23 @@
+#ifndef TEST_CHECK
+#define TEST_CHECK
+
+// Check.h - Minimal assertions for the headless tests
+//
+// CHECK logs a failed condition and keeps going, so one run reports every
+// broken case. main returns testFailures() for ctest.
+#include <iostream>
+
+inline int& testFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition)                                                                         \
+    do {                                                                                         \
+        if (!(condition)) {                                                                      \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed" << std::endl; \
+            testFailures()++;                                                                    \
+        }                                                                                        \
+    } while (0)
+
+#endif // TEST_CHECK
@@ -0,0 +1,111 @@
+// EditJournalTest.cpp - Journal replay and compaction across restarts
+
+#include "../EditJournal.h"
+#include "Check.h"
+#include <filesystem>
+#include <string>
+
+namespace {
+
+std::filesystem::path freshDirectory(const std::string& name) {
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / name;
+    std::filesystem::remove_all(directory);
+    return directory;
+}
+
+uint16_t editedMaterial(EditJournal& journal, const ivec3& worldPosition) {
+    ivec3 chunk = EditJournal::chunkOf(worldPosition);
+    ivec3 local = worldPosition - chunk * 32;
+    uint16_t index = static_cast<uint16_t>(local.x + local.y * 32 + local.z * 32 * 32);
+    for (const ChunkVoxelEdit& edit : journal.getChunkEdits(chunk)) {
+        if (edit.voxelIndex == index) return edit.material;
+    }
+    return UINT16_MAX; // No edit
+}
+
+// Closing compacts and truncates the journal. Edits made after the restart
+// must still win over the compacted ones, live and after the next replay.
+void compactRestartEditReplay() {
+    std::filesystem::path directory = freshDirectory("voxel_edit_journal_test");
+    const ivec3 voxel(5, 6, 7);
+
+    {
+        EditJournal journal;
+        CHECK(journal.open(directory));
+        for (int i = 0; i < 10; ++i) {
+            journal.recordEdit(voxel, 1, 2);
+        }
+        journal.recordEdit(ivec3(40, 6, 7), 0, 3);
+        journal.close();
+    }
+    CHECK(std::filesystem::file_size(directory / "edits.journal") == 0);
+
+    {
+        EditJournal journal;
+        CHECK(journal.open(directory));
+        CHECK(editedMaterial(journal, voxel) == 2);
+        CHECK(journal.getChunkEdits(ivec3(0, 1, 0)).empty()); // Same region, never edited
+
+        uint64_t sequence = journal.recordEdit(voxel, 2, 4);
+        CHECK(sequence > 11);
+        CHECK(editedMaterial(journal, voxel) == 4);
+        CHECK(journal.flush());
+        CHECK(journal.getDurableSequence() >= sequence);
+        journal.close();
+    }
+
+    {
+        EditJournal journal;
+        CHECK(journal.open(directory));
+        CHECK(editedMaterial(journal, voxel) == 4);
+        CHECK(editedMaterial(journal, ivec3(40, 6, 7)) == 3);
+        CHECK(journal.flush()); // Nothing pending, must not wait
+        journal.close();
+    }
+
+    std::filesystem::remove_all(directory);
+}
+
+// A journal that can't be written makes flush fail instead of waiting
+// forever. The writer keeps the group and saves it once writes work again.
+void failedWritesRetry() {
+#ifndef _WIN32
+    if (!std::filesystem::exists("/dev/full")) {
+        return;
+    }
+    std::filesystem::path directory = freshDirectory("voxel_edit_journal_full_test");
+    std::filesystem::create_directories(directory);
+    std::filesystem::create_symlink("/dev/full", directory / "edits.journal");
+    const ivec3 voxel(-3, 70, 12);
+
+    {
+        EditJournal journal;
+        CHECK(journal.open(directory));
+        uint64_t sequence = journal.recordEdit(voxel, 1, 5);
+        CHECK(!journal.flush());
+        CHECK(journal.getDurableSequence() < sequence);
+
+        std::filesystem::remove(directory / "edits.journal");
+        CHECK(journal.flush());
+        CHECK(journal.getDurableSequence() >= sequence);
+        journal.close();
+    }
+
+    {
+        EditJournal journal;
+        CHECK(journal.open(directory));
+        CHECK(editedMaterial(journal, voxel) == 5);
+        journal.close();
+    }
+
+    std::filesystem::remove_all(directory);
+#endif
+}
+
+} // namespace
+
+int main() {
+    compactRestartEditReplay();
+    failedWritesRetry();
+    return testFailures();
+}
@@ -0,0 +1,198 @@
+// RayBatchTest.cpp - Packet raycasts against a plain voxel-by-voxel DDA
+
+#include "../RayBatch.h"
+#include "Check.h"
+#include <cstring>
+#include <thread>
+
+namespace {
+
+constexpr int CS = ChunkOccupancy::CHUNK_SIZE;
+
+void setSolid(ChunkOccupancy::Snapshot& bits, int x, int y, int z) {
+    int index = x + y * CS + z * CS * CS;
+    bits.bits[index / 8] |= uint8_t(1 << (index % 8));
+    int brick = ChunkOccupancy::brickIndex(x, y, z);
+    bits.bricks[brick / 64] |= uint64_t(1) << (brick % 64);
+    bits.regions |= uint64_t(1) << ChunkOccupancy::regionIndex(x, y, z);
+    bits.columns[x + y * CS] |= 1u << z;
+}
+
+uint32_t nextRandom(uint32_t& state) {
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+float randomFloat(uint32_t& state, float min, float max) {
+    return min + (max - min) * float(nextRandom(state) % 100000) / 100000.0f;
+}
+
+// 4x4x2 chunks from (-2, -2, -1): sparse voxels in the lower half, a box,
+// and some chunks that are stored but empty, so every skip size (chunk,
+// region, brick) gets crossed
+std::shared_ptr<VoxelSnapshot> buildWorld() {
+    auto snapshot = std::make_shared<VoxelSnapshot>();
+    uint32_t state = 777;
+    for (int cz = -1; cz <= 0; ++cz) {
+        for (int cy = -2; cy <= 1; ++cy) {
+            for (int cx = -2; cx <= 1; ++cx) {
+                auto bits = std::make_shared<ChunkOccupancy::Snapshot>();
+                std::memset(bits.get(), 0, sizeof(ChunkOccupancy::Snapshot));
+                if ((cx + cy + cz) % 3 != 0) {
+                    for (int i = 0; i < 400; ++i) {
+                        setSolid(*bits, nextRandom(state) % CS, nextRandom(state) % CS, nextRandom(state) % (CS / 2));
+                    }
+                    int bx = nextRandom(state) % (CS - 10), by = nextRandom(state) % (CS - 10), bz = nextRandom(state) % (CS - 10);
+                    for (int z = bz; z < bz + 9; ++z) {
+                        for (int y = by; y < by + 9; ++y) {
+                            for (int x = bx; x < bx + 9; ++x) {
+                                setSolid(*bits, x, y, z);
+                            }
+                        }
+                    }
+                }
+                CHECK(bits->regions == ChunkOccupancy::regionsFromBricks(bits->bricks.data()));
+                snapshot->addChunk(ivec3(cx, cy, cz), bits);
+            }
+        }
+    }
+    return snapshot;
+}
+
+struct ReferenceHit {
+    bool hit = false;
+    ivec3 voxel = ivec3(INT32_MAX);
+    ivec3 normal = ivec3(0);
+    float distance = 0.0f;
+};
+
+// One voxel per step, no skipping
+ReferenceHit referenceCast(const VoxelSnapshot& snapshot, vec3 origin, vec3 dir, float maxDistance) {
+    dir = glm::normalize(dir);
+    ivec3 voxel(glm::floor(origin));
+    ivec3 step(dir.x > 0 ? 1 : -1, dir.y > 0 ? 1 : -1, dir.z > 0 ? 1 : -1);
+    vec3 tMax, tDelta;
+    for (int a = 0; a < 3; ++a) {
+        float boundary = float(voxel[a] + (step[a] > 0 ? 1 : 0));
+        tMax[a] = dir[a] != 0.0f ? (boundary - origin[a]) / dir[a] : INFINITY;
+        tDelta[a] = dir[a] != 0.0f ? std::abs(1.0f / dir[a]) : INFINITY;
+    }
+
+    ReferenceHit result;
+    float t = 0.0f;
+    while (t <= maxDistance) {
+        if (snapshot.isSolid(voxel)) {
+            result.hit = true;
+            result.voxel = voxel;
+            result.distance = t;
+            return result;
+        }
+        int a = tMax.x < tMax.y ? (tMax.x < tMax.z ? 0 : 2) : (tMax.y < tMax.z ? 1 : 2);
+        t = tMax[a];
+        voxel[a] += step[a];
+        tMax[a] += tDelta[a];
+        result.normal = ivec3(0);
+        result.normal[a] = -step[a];
+    }
+    return ReferenceHit();
+}
+
+RayBatchInput randomRays(const VoxelSnapshot& snapshot, size_t count) {
+    RayBatchInput rays;
+    rays.maxDistance = 150.0f;
+    rays.reserve(count);
+    uint32_t state = 4242;
+    while (rays.size() < count) {
+        vec3 origin(randomFloat(state, -60.0f, 60.0f), randomFloat(state, -60.0f, 60.0f), randomFloat(state, -30.0f, 30.0f));
+        vec3 dir(randomFloat(state, -1.0f, 1.0f), randomFloat(state, -1.0f, 1.0f), randomFloat(state, -1.0f, 1.0f));
+        if (snapshot.isSolid(ivec3(glm::floor(origin))) || glm::length(dir) < 0.1f) {
+            continue;
+        }
+        rays.addRay(origin, dir);
+    }
+    // Axis-parallel rays take the tiny-component path
+    rays.addRay(vec3(-50.5f, 3.5f, 2.5f), vec3(1.0f, 0.0f, 0.0f));
+    rays.addRay(vec3(3.5f, 50.5f, -2.5f), vec3(0.0f, -1.0f, 0.0f));
+    rays.addRay(vec3(-3.5f, -7.5f, 30.5f), vec3(0.0f, 0.0f, -1.0f));
+    return rays;
+}
+
+void checkAgainstReference(const VoxelSnapshot& snapshot, const RayBatchInput& rays, const RayBatchResults& results) {
+    CHECK(results.size() == rays.size());
+    int hits = 0;
+    for (size_t i = 0; i < rays.size(); ++i) {
+        vec3 origin(rays.originX[i], rays.originY[i], rays.originZ[i]);
+        vec3 dir(rays.dirX[i], rays.dirY[i], rays.dirZ[i]);
+        ReferenceHit expected = referenceCast(snapshot, origin, dir, rays.maxDistance);
+
+        CHECK(bool(results.hit[i]) == expected.hit);
+        if (!expected.hit || !results.hit[i]) {
+            continue;
+        }
+        hits++;
+        CHECK(ivec3(results.hitX[i], results.hitY[i], results.hitZ[i]) == expected.voxel);
+        CHECK(ivec3(results.normalX[i], results.normalY[i], results.normalZ[i]) == expected.normal);
+        CHECK(std::abs(results.distance[i] - expected.distance) < 1e-3f);
+    }
+    CHECK(hits > int(rays.size()) / 4); // Dense enough that most checks see a hit
+}
+
+bool sameResults(const RayBatchResults& a, const RayBatchResults& b) {
+    return a.hit == b.hit && a.hitX == b.hitX && a.hitY == b.hitY && a.hitZ == b.hitZ &&
+        a.normalX == b.normalX && a.normalY == b.normalY && a.normalZ == b.normalZ && a.distance == b.distance;
+}
+
+// Inline batch matches the reference, and the scalar lanes match the SIMD ones
+void matchesReference() {
+    auto snapshot = buildWorld();
+    RayBatchInput rays = randomRays(*snapshot, 2000);
+
+    RayBatchResults results;
+    RayBatchCaster::cast(*snapshot, rays, results);
+    checkAgainstReference(*snapshot, rays, results);
+
+    RayBatchResults scalar;
+    scalar.resize(rays.size());
+    std::vector<uint32_t> order = RayBatchCaster::coherentOrder(rays);
+    RayBatchCaster::castRange<ScalarLanes>(*snapshot, rays, order, 0, order.size(), scalar);
+    CHECK(sameResults(results, scalar));
+}
+
+// Split over threads, including tasks the submitter refuses, gives the same
+// results as the inline cast
+void asyncMatchesInline() {
+    std::shared_ptr<const VoxelSnapshot> snapshot = buildWorld();
+    RayBatchInput rays = randomRays(*snapshot, 3000);
+
+    RayBatchResults inlineResults;
+    RayBatchCaster::cast(*snapshot, rays, inlineResults);
+
+    std::vector<std::thread> threads;
+    int submitted = 0;
+    auto job = RayBatchCaster::castAsync(snapshot, rays, [&threads, &submitted](std::function<void()> task) {
+        if (submitted++ % 3 == 2) {
+            return false;
+        }
+        threads.emplace_back(std::move(task));
+        return true;
+        });
+    job->wait();
+    CHECK(job->isDone());
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    CHECK(sameResults(job->getResults(), inlineResults));
+
+    // Empty batches are done at once
+    auto empty = RayBatchCaster::castAsync(snapshot, RayBatchInput(), [](std::function<void()>) { return false; });
+    CHECK(empty->isDone());
+    CHECK(empty->getResults().size() == 0);
+}
+
+} // namespace
+
+int main() {
+    matchesReference();
+    asyncMatchesInline();
+    return testFailures();
+}
@@ -0,0 +1,251 @@
+// VoxelCollisionTest.cpp - Swept AABB collision against hand-built snapshots
+
+#include "../VoxelCollision.h"
+#include "Check.h"
+#include <array>
+#include <cstring>
+#include <map>
+#include <thread>
+
+namespace {
+
+// Occupancy for a handful of voxels, turned into a snapshot like the one
+// the chunk manager builds
+class SnapshotBuilder {
+    std::map<std::array<int, 3>, ChunkOccupancy::Snapshot> chunks;
+
+public:
+    void solid(const ivec3& voxel) {
+        constexpr int CS = ChunkOccupancy::CHUNK_SIZE;
+        ivec3 chunkPos = VoxelSnapshot::chunkOf(voxel);
+        ivec3 local = voxel - chunkPos * CS;
+        auto it = chunks.emplace(std::array<int, 3>{ chunkPos.x, chunkPos.y, chunkPos.z }, ChunkOccupancy::Snapshot{}).first;
+        ChunkOccupancy::Snapshot& bits = it->second;
+
+        int index = local.x + local.y * CS + local.z * CS * CS;
+        bits.bits[index / 8] |= uint8_t(1 << (index % 8));
+        int brick = ChunkOccupancy::brickIndex(local.x, local.y, local.z);
+        bits.bricks[brick / 64] |= uint64_t(1) << (brick % 64);
+        bits.regions |= uint64_t(1) << ChunkOccupancy::regionIndex(local.x, local.y, local.z);
+        bits.columns[local.x + local.y * CS] |= 1u << local.z;
+    }
+
+    void box(const ivec3& min, const ivec3& max) {
+        for (int z = min.z; z <= max.z; ++z) {
+            for (int y = min.y; y <= max.y; ++y) {
+                for (int x = min.x; x <= max.x; ++x) {
+                    solid(ivec3(x, y, z));
+                }
+            }
+        }
+    }
+
+    std::shared_ptr<VoxelSnapshot> build() const {
+        auto snapshot = std::make_shared<VoxelSnapshot>();
+        for (const auto& pair : chunks) {
+            ivec3 chunkPos(pair.first[0], pair.first[1], pair.first[2]);
+            snapshot->addChunk(chunkPos, std::make_shared<ChunkOccupancy::Snapshot>(pair.second));
+        }
+        return snapshot;
+    }
+};
+
+constexpr float SKIN = CollisionSettings().skin;
+
+bool near(float a, float b) {
+    return std::abs(a - b) < 1e-4f;
+}
+
+// Floor at z = -1 under [-16, 16) on x and y, bodies stand on z = 0
+SnapshotBuilder floorWorld() {
+    SnapshotBuilder world;
+    world.box(ivec3(-16, -16, -1), ivec3(15, 15, -1));
+    return world;
+}
+
+CollisionBody bodyAt(const vec3& feet) {
+    CollisionBody body;
+    body.center = feet + vec3(0.0f, 0.0f, body.halfExtents.z);
+    return body;
+}
+
+// Falling is resolved before the horizontal move, and a wall on x leaves y
+// free to slide
+void axisSeparatedSweeps() {
+    SnapshotBuilder world = floorWorld();
+    world.box(ivec3(3, -16, 0), ivec3(3, 15, 3));
+    auto snapshot = world.build();
+
+    CollisionBody body = bodyAt(vec3(0.5f, 0.5f, 0.5f));
+    CollisionResult result = VoxelCollision::moveBody(*snapshot, body, vec3(5.0f, 5.0f, -2.0f));
+
+    CHECK(near(result.applied.z, -0.5f + SKIN));
+    CHECK(near(body.center.x, 3.0f - body.halfExtents.x - SKIN));
+    CHECK(near(result.applied.y, 5.0f));
+    CHECK(result.blocked.x);
+    CHECK(!result.blocked.y);
+    CHECK(result.blocked.z);
+    CHECK(!result.stepped);
+    CHECK(body.onGround);
+
+    // Pressed flush against the wall, pushing further does nothing
+    vec3 before = body.center;
+    result = VoxelCollision::moveBody(*snapshot, body, vec3(1.0f, 0.0f, 0.0f));
+    CHECK(result.blocked.x);
+    CHECK(body.center == before);
+}
+
+void cornerAndEdgeContacts() {
+    // Inside corner: both walls stop the diagonal move
+    {
+        SnapshotBuilder world = floorWorld();
+        world.box(ivec3(3, -16, 0), ivec3(3, 15, 3));
+        world.box(ivec3(-16, 3, 0), ivec3(15, 3, 3));
+        auto snapshot = world.build();
+
+        CollisionBody body = bodyAt(vec3(0.5f, 0.5f, SKIN));
+        CollisionResult result = VoxelCollision::moveBody(*snapshot, body, vec3(4.0f, 4.0f, 0.0f));
+        CHECK(result.blocked.x);
+        CHECK(result.blocked.y);
+        CHECK(near(body.center.x, 3.0f - body.halfExtents.x - SKIN));
+        CHECK(near(body.center.y, 3.0f - body.halfExtents.y - SKIN));
+    }
+
+    // Outside corner of a pillar at (2, 2): a box whose side lies exactly
+    // on the pillar face touches it without overlapping and slides past,
+    // one that overlaps it by a sliver is stopped
+    {
+        SnapshotBuilder world = floorWorld();
+        world.box(ivec3(2, 2, 0), ivec3(2, 2, 3));
+        auto snapshot = world.build();
+
+        CollisionBody grazing = bodyAt(vec3(0.5f, 2.0f - 0.3f, SKIN));
+        CollisionResult result = VoxelCollision::moveBody(*snapshot, grazing, vec3(4.0f, 0.0f, 0.0f));
+        CHECK(!result.blocked.x);
+        CHECK(near(result.applied.x, 4.0f));
+
+        CollisionBody clipping = bodyAt(vec3(0.5f, 2.0f - 0.25f, SKIN));
+        result = VoxelCollision::moveBody(*snapshot, clipping, vec3(4.0f, 0.0f, 0.0f));
+        CHECK(result.blocked.x);
+        CHECK(near(clipping.center.x, 2.0f - clipping.halfExtents.x - SKIN));
+
+        // Dropping onto the pillar's top edge lands on it
+        CollisionBody falling = bodyAt(vec3(1.75f, 1.75f, 6.0f));
+        result = VoxelCollision::moveBody(*snapshot, falling, vec3(0.0f, 0.0f, -5.0f));
+        CHECK(result.blocked.z);
+        CHECK(near(falling.center.z - falling.halfExtents.z, 4.0f + SKIN));
+        CHECK(falling.onGround);
+    }
+}
+
+void stepUp() {
+    SnapshotBuilder world = floorWorld();
+    world.box(ivec3(3, -16, 0), ivec3(3, 15, 0));  // One voxel ledge
+    world.box(ivec3(8, -16, 0), ivec3(8, 15, 1));  // Two voxel wall
+    auto snapshot = world.build();
+
+    CollisionBody body = bodyAt(vec3(1.5f, 0.5f, SKIN));
+    CollisionResult result = VoxelCollision::moveBody(*snapshot, body, vec3(2.0f, 0.0f, 0.0f));
+    CHECK(result.stepped);
+    CHECK(!result.blocked.x);
+    CHECK(near(body.center.x, 3.5f));
+    CHECK(near(body.center.z - body.halfExtents.z, 1.0f + SKIN));
+    CHECK(body.onGround);
+
+    CollisionBody blocked = bodyAt(vec3(6.5f, 0.5f, SKIN));
+    result = VoxelCollision::moveBody(*snapshot, blocked, vec3(2.0f, 0.0f, 0.0f));
+    CHECK(!result.stepped);
+    CHECK(result.blocked.x);
+    CHECK(near(blocked.center.x, 8.0f - blocked.halfExtents.x - SKIN));
+
+    CollisionSettings noStep;
+    noStep.stepHeight = 0.0f;
+    CollisionBody walker = bodyAt(vec3(1.5f, 0.5f, SKIN));
+    result = VoxelCollision::moveBody(*snapshot, walker, vec3(2.0f, 0.0f, 0.0f), noStep);
+    CHECK(!result.stepped);
+    CHECK(result.blocked.x);
+}
+
+// A single voxel thick wall or floor stops a move far longer than the body
+void tunnelling() {
+    SnapshotBuilder world;
+    world.box(ivec3(10, -4, -4), ivec3(10, 4, 4));
+    world.box(ivec3(-4, -4, -40), ivec3(4, 4, -40));
+    auto snapshot = world.build();
+
+    CollisionBody body;
+    body.center = vec3(0.5f, 0.5f, 0.5f);
+    CollisionResult result = VoxelCollision::moveBody(*snapshot, body, vec3(60.0f, 0.0f, 0.0f));
+    CHECK(result.blocked.x);
+    CHECK(near(body.center.x, 10.0f - body.halfExtents.x - SKIN));
+
+    body.center = vec3(0.5f, 0.5f, 0.5f);
+    result = VoxelCollision::moveBody(*snapshot, body, vec3(0.0f, 0.0f, -1000.0f));
+    CHECK(result.blocked.z);
+    CHECK(near(body.center.z - body.halfExtents.z, -39.0f + SKIN));
+
+    // Moves past MAX_DISPLACEMENT are clamped, not wrapped or dropped
+    body.center = vec3(0.5f, 0.5f, 0.5f);
+    result = VoxelCollision::moveBody(*snapshot, body, vec3(-1000.0f, 0.0f, 0.0f));
+    CHECK(near(result.applied.x, -VoxelCollision::MAX_DISPLACEMENT));
+}
+
+// Same inputs give the same bits, inline and split over threads
+void deterministic() {
+    SnapshotBuilder world = floorWorld();
+    uint32_t state = 12345;
+    auto next = [&state] {
+        state = state * 1664525u + 1013904223u;
+        return state >> 8;
+    };
+    for (int i = 0; i < 200; ++i) {
+        world.solid(ivec3(int(next() % 32) - 16, int(next() % 32) - 16, int(next() % 4)));
+    }
+    std::shared_ptr<const VoxelSnapshot> snapshot = world.build();
+
+    std::vector<CollisionBody> bodies(300);
+    std::vector<vec3> displacements(bodies.size());
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        bodies[i] = bodyAt(vec3(float(next() % 2400) / 100.0f - 12.0f, float(next() % 2400) / 100.0f - 12.0f, 4.0f));
+        displacements[i] = vec3(float(next() % 800) / 100.0f - 4.0f, float(next() % 800) / 100.0f - 4.0f, -8.0f);
+    }
+
+    auto runInline = [&] {
+        std::vector<CollisionBody> moved = bodies;
+        std::vector<CollisionResult> results(bodies.size());
+        VoxelCollision::moveBodies(*snapshot, moved.data(), displacements.data(), results.data(), moved.size());
+        return std::make_pair(moved, results);
+    };
+    auto first = runInline();
+    auto second = runInline();
+
+    std::vector<std::thread> threads;
+    auto job = VoxelCollision::moveBodiesAsync(snapshot, bodies, displacements, CollisionSettings(),
+        [&threads](std::function<void()> task) {
+            threads.emplace_back(std::move(task));
+            return true;
+        });
+    job->wait();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        CHECK(std::memcmp(&first.first[i].center, &second.first[i].center, sizeof(vec3)) == 0);
+        CHECK(std::memcmp(&first.second[i].applied, &second.second[i].applied, sizeof(vec3)) == 0);
+        CHECK(std::memcmp(&first.first[i].center, &job->getBodies()[i].center, sizeof(vec3)) == 0);
+        CHECK(std::memcmp(&first.second[i].applied, &job->getResults()[i].applied, sizeof(vec3)) == 0);
+        CHECK(first.first[i].onGround == job->getBodies()[i].onGround);
+    }
+}
+
+} // namespace
+
+int main() {
+    axisSeparatedSweeps();
+    cornerAndEdgeContacts();
+    stepUp();
+    tunnelling();
+    deterministic();
+    return testFailures();
+}